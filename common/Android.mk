@@ -59,6 +59,7 @@ endif
 LOCAL_SRC_FILES := \
         compositor/compositor.cpp \
         compositor/compositorthread.cpp \
+        compositor/renderworker.cpp \
         compositor/factory.cpp \
         compositor/nativesurface.cpp \
         compositor/renderstate.cpp \
@@ -76,10 +77,13 @@ LOCAL_SRC_FILES := \
         display/vblankeventhandler.cpp \
         display/virtualdisplay.cpp \
         utils/fdhandler.cpp \
+        utils/framelatencytracker.cpp \
         utils/hwcevent.cpp \
         utils/hwcthread.cpp \
         utils/hwcutils.cpp \
-        utils/disjoint_layers.cpp
+        utils/idletimeout.cpp \
+        utils/disjoint_layers.cpp \
+        utils/drawregioncache.cpp
 
 LOCAL_CPPFLAGS += -DUSE_GRALLOC1
 
@@ -147,7 +151,8 @@ LOCAL_SHARED_LIBRARIES += \
 
 LOCAL_CPPFLAGS += \
         -DUSE_VK \
-        -DDISABLE_EXPLICIT_SYNC
+        -DDISABLE_EXPLICIT_SYNC \
+        -DSHADER_CACHE_PATH='"/data/vendor/hwc"'
 
 LOCAL_C_INCLUDES += \
         $(LOCAL_PATH)/compositor/vk \
@@ -162,7 +167,8 @@ LOCAL_SRC_FILES += \
 else
 LOCAL_CPPFLAGS += \
         -DUSE_GL \
-        -DPREBUILT_SHADER_FILE_PATH='"/vendor/etc"'
+        -DPREBUILT_SHADER_FILE_PATH='"/vendor/etc"' \
+        -DSHADER_CACHE_PATH='"/data/vendor/hwc"'
 
 LOCAL_SRC_FILES += \
         compositor/gl/glprogram.cpp \
@@ -19,6 +19,7 @@
 #include <xf86drmMode.h>
 
 #include <algorithm>
+#include <utility>
 
 #include "disjoint_layers.h"
 #include "displayplanestate.h"
@@ -44,9 +45,16 @@ void Compositor::Init(ResourceManager *resource_manager, uint32_t gpu_fd) {
   if (!thread_)
     thread_.reset(new CompositorThread());
 
+  thread_->SetContextCount(context_count_);
   thread_->Initialize(resource_manager, gpu_fd);
 }
 
+void Compositor::SetContextCount(uint32_t count) {
+  context_count_ = count;
+  if (thread_)
+    thread_->SetContextCount(count);
+}
+
 void Compositor::BeginFrame(bool disable_explicit_sync) {
   thread_->SetDisableExplicitSync(disable_explicit_sync);
 }
@@ -56,15 +64,30 @@ void Compositor::Reset() {
     thread_->ExitThread();
 }
 
+// Returns DrawState to be used next, re-using one left from an earlier
+// frame if possible.
+static DrawState &NextDrawState(std::vector<DrawState> &states,
+                                size_t &count) {
+  if (count == states.size())
+    states.emplace_back();
+
+  DrawState &state = states.at(count++);
+  state.Reset();
+  return state;
+}
+
 bool Compositor::Draw(DisplayPlaneStateList &comp_planes,
                       std::vector<OverlayLayer> &layers) {
   CTRACE();
   const DisplayPlaneState *comp = NULL;
-  std::vector<size_t> dedicated_layers;
-  std::vector<DrawState> draw_state;
-  std::vector<DrawState> media_state;
-  std::vector<OverlayBuffer *> draw_buffers;
-  std::vector<HwcRect<int>> display_frame;
+  std::vector<size_t> &dedicated_layers = dedicated_layers_;
+  std::vector<OverlayBuffer *> &draw_buffers = draw_buffers_;
+  std::vector<HwcRect<int>> &display_frame = display_frame_;
+  size_t draw_count = 0;
+  size_t media_count = 0;
+  dedicated_layers.clear();
+  draw_buffers.clear();
+  display_frame.clear();
 
   for (auto &layer : layers) {
     draw_buffers.emplace_back(layer.GetBuffer());
@@ -90,9 +113,8 @@ bool Compositor::Draw(DisplayPlaneStateList &comp_planes,
       dedicated_layers.insert(dedicated_layers.end(),
                               plane.GetSourceLayers().begin(),
                               plane.GetSourceLayers().end());
-      media_state.emplace_back();
       plane.SwapSurfaceIfNeeded();
-      DrawState &state = media_state.back();
+      DrawState &state = NextDrawState(media_state_, media_count);
       state.surface_ = plane.GetOffScreenTarget();
       MediaState &media_state = state.media_state_;
       lock_.lock();
@@ -123,6 +145,9 @@ bool Compositor::Draw(DisplayPlaneStateList &comp_planes,
         ETRACE("GetOffScreenTarget() returned NULL pointer 'surface'.");
         return false;
       }
+
+      // Redraw only what changed since this surface was last rendered.
+      plane.UpdateBufferAgeDamage(surface);
       if (!regions_empty &&
           (surface->ClearSurface() || surface->IsPartialClear() ||
            surface->IsSurfaceDamageChanged())) {
@@ -131,20 +156,19 @@ bool Compositor::Draw(DisplayPlaneStateList &comp_planes,
       }
 
       if (surface->ClearSurface()) {
-        plane.UpdateDamage(plane.GetDisplayFrame());
+        surface->UpdateSurfaceDamage(plane.GetDisplayFrame(), true);
       }
 
       if (regions_empty) {
         SeparateLayers(dedicated_layers, comp->GetSourceLayers(), display_frame,
-                       surface->GetSurfaceDamage(), comp_regions);
+                       surface->GetSurfaceDamageRegion(), comp_regions);
       }
 
-      std::vector<size_t>().swap(dedicated_layers);
+      dedicated_layers.clear();
       if (comp_regions.empty())
         continue;
 
-      draw_state.emplace_back();
-      DrawState &state = draw_state.back();
+      DrawState &state = NextDrawState(draw_state_, draw_count);
       state.surface_ = surface;
       size_t num_regions = comp_regions.size();
       state.states_.reserve(num_regions);
@@ -159,14 +183,18 @@ bool Compositor::Draw(DisplayPlaneStateList &comp_planes,
                            plane.IsUsingPlaneScalar(), use_plane_transform);
 
       if (state.states_.empty()) {
-        draw_state.pop_back();
+        draw_count--;
       }
     }
   }
 
+  // Drop states left from earlier frames which are not used by this one.
+  draw_state_.erase(draw_state_.begin() + draw_count, draw_state_.end());
+  media_state_.erase(media_state_.begin() + media_count, media_state_.end());
+
   bool status = true;
-  if (!draw_state.empty() || !media_state.empty())
-    status = thread_->Draw(draw_state, media_state, draw_buffers);
+  if (!draw_state_.empty() || !media_state_.empty())
+    status = thread_->Draw(draw_state_, media_state_, draw_buffers);
 
   return status;
 }
@@ -189,7 +217,8 @@ bool Compositor::DrawOffscreen(std::vector<OverlayLayer> &layers,
 
   std::vector<CompositionRegion> comp_regions;
   SeparateLayers(std::vector<size_t>(), source_layers, display_frame,
-                 HwcRect<int>(0, 0, width, height), comp_regions);
+                 HwcRegion(1, HwcRect<int>(0, 0, width, height)),
+                 comp_regions);
   if (comp_regions.empty()) {
     ETRACE(
         "Failed to prepare offscreen buffer. "
@@ -230,6 +259,7 @@ bool Compositor::DrawOffscreen(std::vector<OverlayLayer> &layers,
 
 void Compositor::FreeResources() {
   thread_->FreeResources();
+  region_cache_.Clear();
 }
 
 void Compositor::CalculateRenderState(
@@ -238,17 +268,25 @@ void Compositor::CalculateRenderState(
     uint32_t downscaling_factor, bool uses_display_up_scaling,
     bool use_plane_transform) {
   CTRACE();
-  size_t num_regions = comp_regions.size();
-  for (size_t region_index = 0; region_index < num_regions; region_index++) {
-    const CompositionRegion &region = comp_regions.at(region_index);
-    RenderState state;
+  // Render states are kept in reverse order of regions. Storage of
+  // states already in draw_state is re-used.
+  std::vector<RenderState> &states = draw_state.states_;
+  size_t num_states = 0;
+  size_t region_index = comp_regions.size();
+  while (region_index > 0) {
+    const CompositionRegion &region = comp_regions.at(--region_index);
+    if (num_states == states.size())
+      states.emplace_back();
+
+    RenderState &state = states.at(num_states);
+    state.layer_state_.clear();
     state.ConstructState(layers, region, downscaling_factor,
                          uses_display_up_scaling, use_plane_transform);
     if (state.layer_state_.empty()) {
       continue;
     }
 
-    draw_state.states_.emplace(draw_state.states_.begin(), state);
+    num_states++;
     const std::vector<size_t> &source = region.source_layers;
     for (size_t texture_index : source) {
       OverlayLayer &layer = layers.at(texture_index);
@@ -258,6 +296,8 @@ void Compositor::CalculateRenderState(
       }
     }
   }
+
+  states.erase(states.begin() + num_states, states.end());
 }
 
 void Compositor::SetVideoScalingMode(uint32_t mode) {
@@ -300,73 +340,60 @@ void Compositor::RestoreVideoDefaultDeinterlace() {
 }
 
 // Below code is taken from drm_hwcomposer adopted to our needs.
+// Returns layers of index_map for ids from offset onwards in id_set, top
+// most first.
 static std::vector<size_t> SetBitsToVector(
-    uint64_t in, const std::vector<size_t> &index_map) {
+    const RectIDs &id_set, size_t offset,
+    const std::vector<size_t> &index_map) {
   std::vector<size_t> out;
-  size_t msb = sizeof(in) * 8 - 1;
-  uint64_t mask = (uint64_t)1 << msb;
-  for (size_t i = msb; mask != (uint64_t)0; i--, mask >>= 1)
-    if (in & mask)
-      out.emplace_back(index_map[i]);
+  id_set.forEach([&](RectIDs::TId id) {
+    if (id >= offset)
+      out.emplace_back(index_map[id - offset]);
+  });
+  std::reverse(out.begin(), out.end());
   return out;
 }
 
 void Compositor::SeparateLayers(const std::vector<size_t> &dedicated_layers,
                                 const std::vector<size_t> &source_layers,
                                 const std::vector<HwcRect<int>> &display_frame,
-                                const HwcRect<int> &damage_region,
+                                const HwcRegion &damage_region,
                                 std::vector<CompositionRegion> &comp_regions) {
   CTRACE();
-  if (source_layers.size() > 64) {
-    ETRACE("Failed to separate layers because there are more than 64");
-    return;
-  }
-
-  size_t num_exclude_rects = 0;
   // Index at which the actual layers begin
   size_t layer_offset = dedicated_layers.size();
-  if (source_layers.size() + layer_offset > 64) {
-    WTRACE(
-        "Exclusion rectangles are being truncated to make the rectangle count "
-        "fit into 64");
-    num_exclude_rects = 64 - source_layers.size() - dedicated_layers.size();
-  }
 
-  // We inject all the exclude rects into the rects list. Any resulting rect
-  // that includes ANY of the first num_exclude_rects is rejected. After the
-  // exclude rects, we add the lower layers. The rects that intersect with
-  // these layers will be inspected and only those which are to be composited
+  // We inject the dedicated layers into the rects list first, followed by
+  // the layers to be composited. The rects that intersect with dedicated
+  // layers will be inspected and only those which are to be composited
   // above the layer will be included in the composition regions.
-  std::vector<HwcRect<int>> layer_rects(source_layers.size() + layer_offset);
+  std::vector<HwcRect<int>> &layer_rects = layer_rects_;
+  layer_rects.resize(source_layers.size() + layer_offset);
   std::transform(
-      dedicated_layers.begin(), dedicated_layers.end(),
-      layer_rects.begin() + num_exclude_rects,
+      dedicated_layers.begin(), dedicated_layers.end(), layer_rects.begin(),
       [=](size_t layer_index) { return display_frame[layer_index]; });
   std::transform(source_layers.begin(), source_layers.end(),
                  layer_rects.begin() + layer_offset, [=](size_t layer_index) {
                    return display_frame[layer_index];
                  });
 
-  std::vector<RectSet<int>> separate_regions;
-  get_draw_regions(layer_rects, damage_region, &separate_regions);
-  uint64_t exclude_mask = ((uint64_t)1 << num_exclude_rects) - 1;
-  uint64_t dedicated_mask = (((uint64_t)1 << dedicated_layers.size()) - 1)
-                            << num_exclude_rects;
+  // Layer geometry rarely changes from frame to frame, re-use regions
+  // computed for a recent frame when possible.
+  const std::vector<RectSet<int>> &separate_regions =
+      region_cache_.GetDrawRegions(layer_rects, damage_region);
 
-  for (RectSet<int> &region : separate_regions) {
-    if (region.id_set.getBits() & exclude_mask)
-      continue;
+  for (const RectSet<int> &separate_region : separate_regions) {
+    // Cached regions stay untouched, layers are removed from a copy.
+    RectSet<int> region = separate_region;
 
     // If a rect intersects one of the dedicated layers, we need to remove the
     // layers from the composition region which appear *below* the dedicated
     // layer. This effectively punches a hole through the composition layer such
     // that the dedicated layer can be placed below the composition and not
     // be occluded.
-    uint64_t dedicated_intersect = region.id_set.getBits() & dedicated_mask;
-    for (size_t i = 0; dedicated_intersect && i < dedicated_layers.size();
-         ++i) {
+    for (size_t i = 0; i < dedicated_layers.size(); ++i) {
       // Only exclude layers if they intersect this particular dedicated layer
-      if (!(dedicated_intersect & (1 << (i + num_exclude_rects))))
+      if (!region.id_set.test(i))
         continue;
 
       for (size_t j = 0; j < source_layers.size(); ++j) {
@@ -375,12 +402,12 @@ void Compositor::SeparateLayers(const std::vector<size_t> &dedicated_layers,
       }
     }
 
-    if (!(region.id_set.getBits() >> layer_offset))
+    std::vector<size_t> layers =
+        SetBitsToVector(region.id_set, layer_offset, source_layers);
+    if (layers.empty())
       continue;
 
-    comp_regions.emplace_back(CompositionRegion{
-        region.rect, SetBitsToVector(region.id_set.getBits() >> layer_offset,
-                                     source_layers)});
+    comp_regions.emplace_back(CompositionRegion{region.rect, std::move(layers)});
   }
 }
 
@@ -25,6 +25,7 @@
 #include "compositionregion.h"
 #include "compositorthread.h"
 #include "displayplanestate.h"
+#include "drawregioncache.h"
 #include "factory.h"
 #include "renderstate.h"
 
@@ -42,6 +43,9 @@ class Compositor {
   ~Compositor();
 
   void Init(ResourceManager *buffer_manager, uint32_t gpu_fd);
+  // Sets number of contexts offscreen planes are rendered with in
+  // parallel.
+  void SetContextCount(uint32_t count);
   void Reset();
   void BeginFrame(bool disable_explicit_sync);
   bool Draw(DisplayPlaneStateList &planes, std::vector<OverlayLayer> &layers);
@@ -71,13 +75,22 @@ class Compositor {
   void SeparateLayers(const std::vector<size_t> &dedicated_layers,
                       const std::vector<size_t> &source_layers,
                       const std::vector<HwcRect<int>> &display_frame,
-                      const HwcRect<int> &damage_region,
+                      const HwcRegion &damage_region,
                       std::vector<CompositionRegion> &comp_regions);
 
+  // Per frame state, kept to re-use storage across frames.
+  std::vector<size_t> dedicated_layers_;
+  std::vector<DrawState> draw_state_;
+  std::vector<DrawState> media_state_;
+  std::vector<OverlayBuffer *> draw_buffers_;
+  std::vector<HwcRect<int>> display_frame_;
+  std::vector<HwcRect<int>> layer_rects_;
+  DrawRegionCache region_cache_;
   std::unique_ptr<CompositorThread> thread_;
   SpinLock lock_;
   HWCColorMap colors_;
   uint32_t scaling_mode_ = 0;
+  uint32_t context_count_ = 1;
   HWCDeinterlaceProp deinterlace_;
 };
 
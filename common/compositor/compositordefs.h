@@ -45,7 +45,13 @@ static float TransformMatrices[] = {
 // clang-format on
 
 #if USE_DC
+#ifdef USE_CPU_COMPOSITOR
+class OverlayBuffer;
+// CPURenderer maps layer buffers itself.
+typedef OverlayBuffer* GpuResourceHandle;
+#else
 typedef unsigned GpuResourceHandle;
+#endif
 typedef struct dc_import {
   HWCNativeHandle handle_ = 0;
   uint32_t drm_fd_ = 0;
@@ -16,7 +16,13 @@
 
 #include "compositorthread.h"
 
+#include <libsync.h>
 #include <nativebufferhandler.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <utility>
+
 #include "displayplanemanager.h"
 #include "framebuffermanager.h"
 #include "gpudevice.h"
@@ -59,6 +65,12 @@ void CompositorThread::SetDisableExplicitSync(bool disable_explicit_sync) {
   disable_explicit_sync_ = disable_explicit_sync;
 }
 
+void CompositorThread::SetContextCount(uint32_t count) {
+  tasks_lock_.lock();
+  context_count_ = count ? count : 1;
+  tasks_lock_.unlock();
+}
+
 void CompositorThread::FreeResources() {
   tasks_lock_.lock();
   tasks_ |= kReleaseResources;
@@ -119,6 +131,7 @@ void CompositorThread::ExitThread() {
 
 void CompositorThread::HandleExit() {
   HandleReleaseRequest();
+  ReleaseRenderWorkers();
   gl_renderer_.reset(nullptr);
   gpu_resource_handler_.reset(nullptr);
 }
@@ -159,6 +172,9 @@ void CompositorThread::HandleReleaseRequest() {
     if (has_gpu_resource) {
       Ensure3DRenderer();
       gpu_resource_handler_->ReleaseGPUResources(purged_gl_resources);
+      for (std::unique_ptr<RenderWorker> &worker : render_workers_) {
+        worker->ReleaseResources(purged_gl_resources);
+      }
     }
 
     const NativeBufferHandler *handler =
@@ -235,35 +251,140 @@ void CompositorThread::Handle3DDrawRequest() {
             gpu_resource_handler_->GetResourceHandle(temp.layer_index_);
       }
     }
+  }
 
-    const std::vector<int32_t> &fences = draw_state.acquire_fences_;
-    for (int32_t fence : fences) {
-      gl_renderer_->InsertFence(fence);
+  if (size > 1 && EnsureRenderWorkers()) {
+    if (!DrawInParallel())
+      draw_succeeded_ = false;
+  } else {
+    for (size_t i = 0; i < size; i++) {
+      if (!RenderWorker::Render(gl_renderer_.get(), states_.at(i))) {
+        draw_succeeded_ = false;
+        break;
+      }
     }
+  }
 
-    std::vector<int32_t>().swap(draw_state.acquire_fences_);
+  if (disable_explicit_sync_)
+    gl_renderer_->InsertFence(-1);
+}
 
-    if (!gl_renderer_->Draw(draw_state.states_, draw_state.surface_)) {
-      ETRACE(
-          "Failed to Draw: "
-          "error: %s",
-          PRINTERROR());
-      draw_succeeded_ = false;
+// Spreads states_ over gl_renderer_ and the render workers. Every surface
+// still gets its own fence from the renderer drawing it, this returns once
+// all of them have been submitted.
+bool CompositorThread::DrawInParallel() {
+  size_t size = states_.size();
+  size_t renderers = render_workers_.size() + 1;
+  worker_states_.resize(render_workers_.size());
+  for (std::vector<DrawState *> &states : worker_states_) {
+    states.clear();
+  }
+
+  for (size_t i = 0; i < size; i++) {
+    DrawState &draw_state = states_.at(i);
+    if (i % renderers == 0)
+      continue;
+
+    // Textures of surfaces are created here, shared renderers attach them
+    // to framebuffers of their own.
+    if (!draw_state.surface_->MakeCurrent()) {
+      ETRACE("Failed to initialize surface for shared renderer.");
+      return false;
+    }
+
+    worker_states_.at(i % renderers - 1).emplace_back(&draw_state);
+  }
+
+  // Make textures and images set up on this context visible to the
+  // shared ones.
+  gl_renderer_->InsertFence(-1);
+
+  size_t workers = std::min(render_workers_.size(), size - 1);
+  for (size_t i = 0; i < workers; i++) {
+    render_workers_.at(i)->Draw(worker_states_.at(i), disable_explicit_sync_);
+  }
+
+  bool succeeded = true;
+  for (size_t i = 0; i < size; i += renderers) {
+    if (!RenderWorker::Render(gl_renderer_.get(), states_.at(i))) {
+      succeeded = false;
       break;
     }
+  }
 
-    if (draw_state.destroy_surface_) {
-      if (draw_succeeded_) {
-        draw_state.retire_fence_ =
-            draw_state.surface_->GetLayer()->ReleaseAcquireFence();
-      }
+  for (size_t i = 0; i < workers; i++) {
+    if (!render_workers_.at(i)->Wait())
+      succeeded = false;
+  }
+
+  if (succeeded && !disable_explicit_sync_)
+    MergeSurfaceFences();
 
-      delete draw_state.surface_;
+  return succeeded;
+}
+
+void CompositorThread::MergeSurfaceFences() {
+  int32_t merged = -1;
+  for (const DrawState &draw_state : states_) {
+    if (draw_state.destroy_surface_)
+      continue;
+
+    int32_t fence = draw_state.surface_->GetLayer()->GetAcquireFence();
+    if (fence <= 0)
+      continue;
+
+    if (merged < 0) {
+      merged = dup(fence);
+    } else if (sync_accumulate("hwc_composition_fence", &merged, fence)) {
+      ETRACE("Unable to merge composition fences.");
+      close(merged);
+      return;
     }
   }
 
-  if (disable_explicit_sync_)
-    gl_renderer_->InsertFence(-1);
+  if (merged < 0)
+    return;
+
+  for (const DrawState &draw_state : states_) {
+    if (!draw_state.destroy_surface_)
+      draw_state.surface_->SetNativeFence(dup(merged));
+  }
+
+  close(merged);
+}
+
+bool CompositorThread::EnsureRenderWorkers() {
+  tasks_lock_.lock();
+  size_t count = context_count_ - 1;
+  tasks_lock_.unlock();
+  if (render_workers_.size() == count)
+    return count != 0;
+
+  ReleaseRenderWorkers();
+  for (size_t i = 0; i < count; i++) {
+    std::unique_ptr<RenderWorker> worker(new RenderWorker());
+    if (!worker->Initialize(gl_renderer_.get())) {
+      ETRACE("Failed to create render worker, rendering on one context.");
+      worker->ExitThread();
+      ReleaseRenderWorkers();
+      tasks_lock_.lock();
+      context_count_ = 1;
+      tasks_lock_.unlock();
+      return false;
+    }
+
+    render_workers_.emplace_back(std::move(worker));
+  }
+
+  return count != 0;
+}
+
+void CompositorThread::ReleaseRenderWorkers() {
+  for (std::unique_ptr<RenderWorker> &worker : render_workers_) {
+    worker->ExitThread();
+  }
+
+  std::vector<std::unique_ptr<RenderWorker>>().swap(render_workers_);
 }
 
 void CompositorThread::HandleMediaDrawRequest() {
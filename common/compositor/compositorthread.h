@@ -26,6 +26,7 @@
 #include "factory.h"
 #include "hwcthread.h"
 #include "renderstate.h"
+#include "renderworker.h"
 
 #include "fdhandler.h"
 #include "hwcevent.h"
@@ -50,6 +51,10 @@ class CompositorThread : public HWCThread {
             const std::vector<OverlayBuffer*>& buffers);
 
   void SetDisableExplicitSync(bool disable_explicit_sync);
+
+  // Sets number of renderers DrawStates of a frame are spread over, each
+  // drawing from its own thread. One renders everything on this thread.
+  void SetContextCount(uint32_t count);
   void FreeResources();
 
   void HandleRoutine() override;
@@ -65,6 +70,12 @@ class CompositorThread : public HWCThread {
   };
 
   void Handle3DDrawRequest();
+  bool DrawInParallel();
+  // Replaces native fences of surfaces drawn in parallel with a single
+  // one, signaling once all of them are rendered.
+  void MergeSurfaceFences();
+  bool EnsureRenderWorkers();
+  void ReleaseRenderWorkers();
   void HandleMediaDrawRequest();
   void HandleReleaseRequest();
   void Wait();
@@ -74,6 +85,10 @@ class CompositorThread : public HWCThread {
   SpinLock tasks_lock_;
   std::unique_ptr<Renderer> gl_renderer_;
   std::unique_ptr<Renderer> media_renderer_;
+  // Renderers used besides gl_renderer_, with states each of them draws.
+  std::vector<std::unique_ptr<RenderWorker>> render_workers_;
+  std::vector<std::vector<DrawState*>> worker_states_;
+  uint32_t context_count_ = 1;
   std::unique_ptr<NativeGpuResource> gpu_resource_handler_;
   std::vector<OverlayBuffer*> buffers_;
   std::vector<DrawState> states_;
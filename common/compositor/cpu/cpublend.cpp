@@ -0,0 +1,492 @@
+/*
+// Copyright (c) 2016 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+*/
+
+#include "cpublend.h"
+
+#include <math.h>
+
+#include <algorithm>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define CPU_BLEND_X86
+#endif
+
+namespace hwcomposer {
+
+static const float kInv255 = 1.0f / 255.0f;
+// Layers below pixels covered to less than this are skipped, as in
+// GLProgram.
+static const float kCoverThreshold = 0.5f / 255.0f;
+
+// Parameters of one layer for BlendLayer.
+struct BlendParams {
+  float color[3];
+  float alpha_limit;
+  float alpha;
+  float premult;
+  // Skip pixels which are already covered.
+  bool skip_covered;
+};
+
+// Kernels. Unpack converts count pixels to planar floats, BlendLayer
+// adds src to dst and returns the largest remaining cover, Pack converts
+// dst back to pixels.
+static void UnpackScalar(const uint8_t *in, size_t count, float *const *out) {
+  for (size_t i = 0; i < count; i++) {
+    for (int c = 0; c < 4; c++) {
+      out[c][i] = in[i * 4 + c] * kInv255;
+    }
+  }
+}
+
+static float BlendLayerScalar(const BlendParams &params,
+                              const float (*src)[kCPUBlendSpan],
+                              float (*dst)[kCPUBlendSpan], size_t begin,
+                              size_t count) {
+  float max_cover = 0;
+  for (size_t i = begin; i < count; i++) {
+    float cover = dst[3][i];
+    if (params.skip_covered && cover <= kCoverThreshold)
+      continue;
+
+    float alpha = std::min(src[3][i], params.alpha_limit);
+    float weight = std::max(alpha, params.premult) * params.alpha * cover;
+    for (int c = 0; c < 3; c++) {
+      dst[c][i] += (src[c][i] + params.color[c]) * weight;
+    }
+
+    cover *= 1.0f - src[3][i] * params.alpha;
+    dst[3][i] = cover;
+    max_cover = std::max(max_cover, cover);
+  }
+
+  return max_cover;
+}
+
+static void PackScalar(const float (*dst)[kCPUBlendSpan], size_t begin,
+                       size_t count, uint8_t *out) {
+  for (size_t i = begin; i < count; i++) {
+    for (int c = 0; c < 4; c++) {
+      float value = c == 3 ? 1.0f - dst[3][i] : dst[c][i];
+      value = std::min(std::max(value, 0.0f), 1.0f);
+      out[i * 4 + c] = static_cast<uint8_t>(value * 255.0f + 0.5f);
+    }
+  }
+}
+
+#ifdef CPU_BLEND_X86
+// Shuffles four interleaved pixels to four bytes of each channel and back.
+#define TRANSPOSE_4X4_BYTES \
+  0, 4, 8, 12, 1, 5, 9, 13, 2, 6, 10, 14, 3, 7, 11, 15
+
+__attribute__((target("sse4.1"))) static void UnpackSSE41(const uint8_t *in,
+                                                          size_t count,
+                                                          float *const *out) {
+  const __m128i transpose = _mm_setr_epi8(TRANSPOSE_4X4_BYTES);
+  const __m128 scale = _mm_set1_ps(kInv255);
+  size_t i = 0;
+  for (; i + 4 <= count; i += 4) {
+    __m128i pixels = _mm_loadu_si128(reinterpret_cast<const __m128i *>(in));
+    pixels = _mm_shuffle_epi8(pixels, transpose);
+    for (int c = 0; c < 4; c++) {
+      __m128i channel = _mm_cvtepu8_epi32(pixels);
+      _mm_storeu_ps(out[c] + i,
+                    _mm_mul_ps(_mm_cvtepi32_ps(channel), scale));
+      pixels = _mm_srli_si128(pixels, 4);
+    }
+
+    in += 16;
+  }
+
+  float *tail[4] = {out[0] + i, out[1] + i, out[2] + i, out[3] + i};
+  UnpackScalar(in, count - i, tail);
+}
+
+__attribute__((target("sse4.1"))) static float BlendLayerSSE41(
+    const BlendParams &params, const float (*src)[kCPUBlendSpan],
+    float (*dst)[kCPUBlendSpan], size_t begin, size_t count) {
+  const __m128 threshold = _mm_set1_ps(params.skip_covered ? kCoverThreshold
+                                                           : -1.0f);
+  const __m128 limit = _mm_set1_ps(params.alpha_limit);
+  const __m128 premult = _mm_set1_ps(params.premult);
+  const __m128 alpha = _mm_set1_ps(params.alpha);
+  const __m128 one = _mm_set1_ps(1.0f);
+  __m128 color[3];
+  for (int c = 0; c < 3; c++) {
+    color[c] = _mm_set1_ps(params.color[c]);
+  }
+
+  __m128 max_cover = _mm_setzero_ps();
+  size_t i = begin;
+  for (; i + 4 <= count; i += 4) {
+    __m128 cover = _mm_loadu_ps(dst[3] + i);
+    __m128 active = _mm_cmpgt_ps(cover, threshold);
+    __m128 src_alpha = _mm_loadu_ps(src[3] + i);
+    __m128 weight = _mm_mul_ps(
+        _mm_mul_ps(_mm_max_ps(_mm_min_ps(src_alpha, limit), premult), alpha),
+        cover);
+    for (int c = 0; c < 3; c++) {
+      __m128 value = _mm_loadu_ps(dst[c] + i);
+      __m128 blended = _mm_add_ps(
+          value,
+          _mm_mul_ps(_mm_add_ps(_mm_loadu_ps(src[c] + i), color[c]), weight));
+      _mm_storeu_ps(dst[c] + i, _mm_blendv_ps(value, blended, active));
+    }
+
+    __m128 covered =
+        _mm_mul_ps(cover, _mm_sub_ps(one, _mm_mul_ps(src_alpha, alpha)));
+    covered = _mm_blendv_ps(cover, covered, active);
+    _mm_storeu_ps(dst[3] + i, covered);
+    max_cover = _mm_max_ps(max_cover, _mm_and_ps(covered, active));
+  }
+
+  float lanes[4];
+  _mm_storeu_ps(lanes, max_cover);
+  float tail_cover = BlendLayerScalar(params, src, dst, i, count);
+  return std::max(std::max(std::max(lanes[0], lanes[1]),
+                           std::max(lanes[2], lanes[3])),
+                  tail_cover);
+}
+
+__attribute__((target("sse4.1"))) static void PackSSE41(
+    const float (*dst)[kCPUBlendSpan], size_t begin, size_t count,
+    uint8_t *out) {
+  const __m128i transpose = _mm_setr_epi8(TRANSPOSE_4X4_BYTES);
+  const __m128 zero = _mm_setzero_ps();
+  const __m128 one = _mm_set1_ps(1.0f);
+  const __m128 scale = _mm_set1_ps(255.0f);
+  const __m128 half = _mm_set1_ps(0.5f);
+  size_t i = begin;
+  for (; i + 4 <= count; i += 4) {
+    __m128i channels[4];
+    for (int c = 0; c < 4; c++) {
+      __m128 value = _mm_loadu_ps(dst[c] + i);
+      if (c == 3)
+        value = _mm_sub_ps(one, value);
+
+      value = _mm_min_ps(_mm_max_ps(value, zero), one);
+      channels[c] =
+          _mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(value, scale), half));
+    }
+
+    __m128i pixels =
+        _mm_packus_epi16(_mm_packs_epi32(channels[0], channels[1]),
+                         _mm_packs_epi32(channels[2], channels[3]));
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(out + i * 4),
+                     _mm_shuffle_epi8(pixels, transpose));
+  }
+
+  PackScalar(dst, i, count, out);
+}
+
+__attribute__((target("avx2"))) static void UnpackAVX2(const uint8_t *in,
+                                                       size_t count,
+                                                       float *const *out) {
+  const __m256i transpose = _mm256_setr_epi8(TRANSPOSE_4X4_BYTES,
+                                             TRANSPOSE_4X4_BYTES);
+  // Gathers the four bytes of each channel of both lanes together.
+  const __m256i interleave = _mm256_setr_epi32(0, 4, 1, 5, 2, 6, 3, 7);
+  const __m256 scale = _mm256_set1_ps(kInv255);
+  size_t i = 0;
+  for (; i + 8 <= count; i += 8) {
+    __m256i pixels = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(in));
+    pixels = _mm256_permutevar8x32_epi32(
+        _mm256_shuffle_epi8(pixels, transpose), interleave);
+    __m128i halves[2] = {_mm256_castsi256_si128(pixels),
+                         _mm256_extracti128_si256(pixels, 1)};
+    for (int c = 0; c < 4; c++) {
+      __m128i bytes = halves[c / 2];
+      if (c % 2)
+        bytes = _mm_srli_si128(bytes, 8);
+
+      __m256i channel = _mm256_cvtepu8_epi32(bytes);
+      _mm256_storeu_ps(out[c] + i,
+                       _mm256_mul_ps(_mm256_cvtepi32_ps(channel), scale));
+    }
+
+    in += 32;
+  }
+
+  // Avoid AVX to SSE transition penalties in the non VEX code below.
+  _mm256_zeroupper();
+  float *tail[4] = {out[0] + i, out[1] + i, out[2] + i, out[3] + i};
+  UnpackSSE41(in, count - i, tail);
+}
+
+__attribute__((target("avx2"))) static float BlendLayerAVX2(
+    const BlendParams &params, const float (*src)[kCPUBlendSpan],
+    float (*dst)[kCPUBlendSpan], size_t begin, size_t count) {
+  const __m256 threshold = _mm256_set1_ps(
+      params.skip_covered ? kCoverThreshold : -1.0f);
+  const __m256 limit = _mm256_set1_ps(params.alpha_limit);
+  const __m256 premult = _mm256_set1_ps(params.premult);
+  const __m256 alpha = _mm256_set1_ps(params.alpha);
+  const __m256 one = _mm256_set1_ps(1.0f);
+  __m256 color[3];
+  for (int c = 0; c < 3; c++) {
+    color[c] = _mm256_set1_ps(params.color[c]);
+  }
+
+  __m256 max_cover = _mm256_setzero_ps();
+  size_t i = begin;
+  for (; i + 8 <= count; i += 8) {
+    __m256 cover = _mm256_loadu_ps(dst[3] + i);
+    __m256 active = _mm256_cmp_ps(cover, threshold, _CMP_GT_OQ);
+    __m256 src_alpha = _mm256_loadu_ps(src[3] + i);
+    __m256 weight = _mm256_mul_ps(
+        _mm256_mul_ps(
+            _mm256_max_ps(_mm256_min_ps(src_alpha, limit), premult), alpha),
+        cover);
+    for (int c = 0; c < 3; c++) {
+      __m256 value = _mm256_loadu_ps(dst[c] + i);
+      __m256 blended = _mm256_add_ps(
+          value, _mm256_mul_ps(
+                     _mm256_add_ps(_mm256_loadu_ps(src[c] + i), color[c]),
+                     weight));
+      _mm256_storeu_ps(dst[c] + i, _mm256_blendv_ps(value, blended, active));
+    }
+
+    __m256 covered = _mm256_mul_ps(
+        cover, _mm256_sub_ps(one, _mm256_mul_ps(src_alpha, alpha)));
+    covered = _mm256_blendv_ps(cover, covered, active);
+    _mm256_storeu_ps(dst[3] + i, covered);
+    max_cover = _mm256_max_ps(max_cover, _mm256_and_ps(covered, active));
+  }
+
+  float lanes[8];
+  _mm256_storeu_ps(lanes, max_cover);
+  _mm256_zeroupper();
+  float result = BlendLayerSSE41(params, src, dst, i, count);
+  for (int lane = 0; lane < 8; lane++) {
+    result = std::max(result, lanes[lane]);
+  }
+
+  return result;
+}
+
+__attribute__((target("avx2"))) static void PackAVX2(
+    const float (*dst)[kCPUBlendSpan], size_t begin, size_t count,
+    uint8_t *out) {
+  const __m256i transpose = _mm256_setr_epi8(TRANSPOSE_4X4_BYTES,
+                                             TRANSPOSE_4X4_BYTES);
+  const __m256 zero = _mm256_setzero_ps();
+  const __m256 one = _mm256_set1_ps(1.0f);
+  const __m256 scale = _mm256_set1_ps(255.0f);
+  const __m256 half = _mm256_set1_ps(0.5f);
+  size_t i = begin;
+  for (; i + 8 <= count; i += 8) {
+    __m256i channels[4];
+    for (int c = 0; c < 4; c++) {
+      __m256 value = _mm256_loadu_ps(dst[c] + i);
+      if (c == 3)
+        value = _mm256_sub_ps(one, value);
+
+      value = _mm256_min_ps(_mm256_max_ps(value, zero), one);
+      channels[c] = _mm256_cvttps_epi32(
+          _mm256_add_ps(_mm256_mul_ps(value, scale), half));
+    }
+
+    // Packs work within lanes, which leaves pixels 0-3 in the low lane and
+    // 4-7 in the high one, laid out as in PackSSE41.
+    __m256i pixels = _mm256_packus_epi16(
+        _mm256_packs_epi32(channels[0], channels[1]),
+        _mm256_packs_epi32(channels[2], channels[3]));
+    _mm256_storeu_si256(reinterpret_cast<__m256i *>(out + i * 4),
+                        _mm256_shuffle_epi8(pixels, transpose));
+  }
+
+  _mm256_zeroupper();
+  PackSSE41(dst, i, count, out);
+}
+#endif
+
+CPUBlendKernel GetBestBlendKernel() {
+#ifdef CPU_BLEND_X86
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx2"))
+    return kBlendAVX2;
+
+  if (__builtin_cpu_supports("sse4.1"))
+    return kBlendSSE41;
+#endif
+  return kBlendScalar;
+}
+
+static void Unpack(CPUBlendKernel kernel, const uint8_t *in, size_t count,
+                   float *const *out) {
+#ifdef CPU_BLEND_X86
+  if (kernel == kBlendAVX2) {
+    UnpackAVX2(in, count, out);
+    return;
+  }
+
+  if (kernel == kBlendSSE41) {
+    UnpackSSE41(in, count, out);
+    return;
+  }
+#endif
+  UnpackScalar(in, count, out);
+}
+
+static float BlendLayer(CPUBlendKernel kernel, const BlendParams &params,
+                        const float (*src)[kCPUBlendSpan],
+                        float (*dst)[kCPUBlendSpan], size_t count) {
+#ifdef CPU_BLEND_X86
+  if (kernel == kBlendAVX2)
+    return BlendLayerAVX2(params, src, dst, 0, count);
+
+  if (kernel == kBlendSSE41)
+    return BlendLayerSSE41(params, src, dst, 0, count);
+#endif
+  return BlendLayerScalar(params, src, dst, 0, count);
+}
+
+static void Pack(CPUBlendKernel kernel, const float (*dst)[kCPUBlendSpan],
+                 size_t count, uint8_t *out) {
+#ifdef CPU_BLEND_X86
+  if (kernel == kBlendAVX2) {
+    PackAVX2(dst, 0, count, out);
+    return;
+  }
+
+  if (kernel == kBlendSSE41) {
+    PackSSE41(dst, 0, count, out);
+    return;
+  }
+#endif
+  PackScalar(dst, 0, count, out);
+}
+
+// Returns texel x, y of image, clamped to its edges.
+static inline const uint8_t *Texel(const CPUImage &image, int x, int y) {
+  x = std::min(std::max(x, 0), static_cast<int>(image.width) - 1);
+  y = std::min(std::max(y, 0), static_cast<int>(image.height) - 1);
+  return image.pixels + y * image.stride + x * 4;
+}
+
+// Samples count pixels of layer starting at x, y into planar src.
+static void Fetch(CPUBlendKernel kernel, const CPUBlendLayer &layer,
+                  uint32_t x, uint32_t y, size_t count,
+                  float (*src)[kCPUBlendSpan]) {
+  if (!layer.image) {
+    std::fill_n(src[0], count, 0.0f);
+    std::fill_n(src[1], count, 0.0f);
+    std::fill_n(src[2], count, 0.0f);
+    std::fill_n(src[3], count, 1.0f);
+    return;
+  }
+
+  const CPUImage &image = *layer.image;
+  float *out[4] = {src[0], src[1], src[2], src[3]};
+  if (image.swap_rb)
+    std::swap(out[0], out[2]);
+
+  // Texel centers are at half integers, shift them to integers.
+  float s = layer.s_origin + (x + 0.5f) * layer.ds_dx +
+            (y + 0.5f) * layer.ds_dy - 0.5f;
+  float t = layer.t_origin + (x + 0.5f) * layer.dt_dx +
+            (y + 0.5f) * layer.dt_dy - 0.5f;
+  float s_texel = floorf(s + 0.5f);
+  float t_texel = floorf(t + 0.5f);
+  // Unscaled and not rotated, texels can be copied as they are.
+  if (layer.ds_dx == 1.0f && layer.dt_dx == 0.0f &&
+      fabsf(s - s_texel) < 1e-3f && fabsf(t - t_texel) < 1e-3f &&
+      s_texel >= 0 && t_texel >= 0 && s_texel + count <= image.width &&
+      t_texel < image.height) {
+    Unpack(kernel,
+           Texel(image, static_cast<int>(s_texel), static_cast<int>(t_texel)),
+           count, out);
+  } else {
+    for (size_t i = 0; i < count; i++) {
+      float s_floor = floorf(s);
+      float t_floor = floorf(t);
+      float s_frac = s - s_floor;
+      float t_frac = t - t_floor;
+      int s0 = static_cast<int>(s_floor);
+      int t0 = static_cast<int>(t_floor);
+      const uint8_t *texels[4] = {
+          Texel(image, s0, t0), Texel(image, s0 + 1, t0),
+          Texel(image, s0, t0 + 1), Texel(image, s0 + 1, t0 + 1)};
+      for (int c = 0; c < 4; c++) {
+        float top = texels[0][c] + (texels[1][c] - texels[0][c]) * s_frac;
+        float bottom = texels[2][c] + (texels[3][c] - texels[2][c]) * s_frac;
+        out[c][i] = (top + (bottom - top) * t_frac) * kInv255;
+      }
+
+      s += layer.ds_dx;
+      t += layer.dt_dx;
+    }
+  }
+
+  if (image.opaque)
+    std::fill_n(src[3], count, 1.0f);
+}
+
+void BlendSpan(CPUBlendKernel kernel, const CPUBlendLayer *layers,
+               size_t layer_count, uint32_t x, uint32_t y, size_t count,
+               CPUBlendScratch *scratch, uint8_t *out) {
+  std::fill_n(scratch->dst[0], count, 0.0f);
+  std::fill_n(scratch->dst[1], count, 0.0f);
+  std::fill_n(scratch->dst[2], count, 0.0f);
+  std::fill_n(scratch->dst[3], count, 1.0f);
+  for (size_t i = 0; i < layer_count; i++) {
+    const CPUBlendLayer &layer = layers[i];
+    Fetch(kernel, layer, x, y, count, scratch->src);
+    BlendParams params;
+    std::copy_n(layer.color, 3, params.color);
+    params.alpha_limit = layer.color[3];
+    params.alpha = layer.alpha;
+    params.premult = layer.premult;
+    params.skip_covered = i > 0;
+    // Layers below are skipped for covered pixels, stop once all are.
+    if (BlendLayer(kernel, params, scratch->src, scratch->dst, count) <=
+        kCoverThreshold)
+      break;
+  }
+
+  Pack(kernel, scratch->dst, count, out);
+}
+
+void BlendRegions(CPUBlendKernel kernel,
+                  const std::vector<CPUBlendRegion> &regions, uint8_t *pixels,
+                  uint32_t stride, uint32_t band_index, uint32_t band_count,
+                  CPUBlendScratch *scratch) {
+  for (const CPUBlendRegion &region : regions) {
+    if (region.layers.empty())
+      continue;
+
+    uint32_t bottom = region.y + region.height;
+    uint32_t band = region.y / kCPUBlendBandRows;
+    band += (band_index + band_count - band % band_count) % band_count;
+    for (uint32_t top = band * kCPUBlendBandRows; top < bottom;
+         top += band_count * kCPUBlendBandRows) {
+      uint32_t first = std::max(top, region.y);
+      uint32_t last = std::min(top + kCPUBlendBandRows, bottom);
+      for (uint32_t y = first; y < last; y++) {
+        uint8_t *row = pixels + static_cast<size_t>(y) * stride;
+        for (uint32_t x = 0; x < region.width; x += kCPUBlendSpan) {
+          size_t count = std::min<size_t>(kCPUBlendSpan, region.width - x);
+          BlendSpan(kernel, region.layers.data(), region.layers.size(), x,
+                    y - region.y, count, scratch,
+                    row + (region.x + x) * 4);
+        }
+      }
+    }
+  }
+}
+
+}  // namespace hwcomposer
@@ -0,0 +1,99 @@
+/*
+// Copyright (c) 2016 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+*/
+
+#ifndef COMMON_COMPOSITOR_CPU_CPUBLEND_H_
+#define COMMON_COMPOSITOR_CPU_CPUBLEND_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <vector>
+
+namespace hwcomposer {
+
+// Longest span blended at once, keeps the planar scratch in L1.
+static const size_t kCPUBlendSpan = 256;
+
+// Rows of a band, bands are spread over blend threads.
+static const uint32_t kCPUBlendBandRows = 16;
+
+enum CPUBlendKernel { kBlendScalar = 0, kBlendSSE41, kBlendAVX2 };
+
+// Mapped 32 bit per pixel buffer. Channels are in memory order c0, c1, c2,
+// alpha, swap_rb swaps c0 and c2 to match the target.
+struct CPUImage {
+  const uint8_t* pixels = NULL;
+  uint32_t stride = 0;
+  uint32_t width = 0;
+  uint32_t height = 0;
+  bool swap_rb = false;
+  // Format has no alpha, it reads as 1.
+  bool opaque = false;
+};
+
+// One layer of a RenderState, in target channel order. Texel coordinates
+// of target pixel x, y, relative to the top left of the RenderState, are
+// origin + (x + 0.5) * dx + (y + 0.5) * dy.
+struct CPUBlendLayer {
+  // NULL for solid colors, which sample as (0, 0, 0, 1).
+  const CPUImage* image = NULL;
+  float s_origin = 0;
+  float t_origin = 0;
+  float ds_dx = 0;
+  float dt_dx = 0;
+  float ds_dy = 0;
+  float dt_dy = 0;
+  // Added to the sampled color, the alpha limits the sampled alpha.
+  float color[4] = {0, 0, 0, 1};
+  float alpha = 1;
+  float premult = 1;
+};
+
+// Layers of one RenderState and the rect of the target they are blended
+// to.
+struct CPUBlendRegion {
+  uint32_t x = 0;
+  uint32_t y = 0;
+  uint32_t width = 0;
+  uint32_t height = 0;
+  std::vector<CPUBlendLayer> layers;
+};
+
+// Planar storage of one span.
+struct CPUBlendScratch {
+  float src[4][kCPUBlendSpan];
+  float dst[4][kCPUBlendSpan];
+};
+
+// Returns the fastest kernel supported by this CPU.
+CPUBlendKernel GetBestBlendKernel();
+
+// Blends count (at most kCPUBlendSpan) pixels starting at x, y of layers,
+// top most first, the same way GLProgram does, and stores them to out.
+void BlendSpan(CPUBlendKernel kernel, const CPUBlendLayer* layers,
+               size_t layer_count, uint32_t x, uint32_t y, size_t count,
+               CPUBlendScratch* scratch, uint8_t* out);
+
+// Blends rows of regions to pixels, a target with stride bytes per row.
+// Only rows in bands with index band_index modulo band_count are blended,
+// so that band_count threads can share the regions.
+void BlendRegions(CPUBlendKernel kernel,
+                  const std::vector<CPUBlendRegion>& regions, uint8_t* pixels,
+                  uint32_t stride, uint32_t band_index, uint32_t band_count,
+                  CPUBlendScratch* scratch);
+
+}  // namespace hwcomposer
+#endif  // COMMON_COMPOSITOR_CPU_CPUBLEND_H_
@@ -0,0 +1,87 @@
+/*
+// Copyright (c) 2016 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+*/
+
+#include "cpublendthread.h"
+
+#include "hwctrace.h"
+
+namespace hwcomposer {
+
+CPUBlendThread::CPUBlendThread() : HWCThread(-8, "CPUBlendThread") {
+  if (!cevent_.Initialize())
+    return;
+
+  fd_chandler_.AddFd(cevent_.get_fd());
+}
+
+CPUBlendThread::~CPUBlendThread() {
+}
+
+bool CPUBlendThread::Initialize(CPUBlendKernel kernel) {
+  kernel_ = kernel;
+  if (!InitWorker()) {
+    ETRACE("Failed to initalize CPUBlendThread. %s", PRINTERROR());
+    return false;
+  }
+
+  return true;
+}
+
+void CPUBlendThread::Blend(const std::vector<CPUBlendRegion> *regions,
+                           uint8_t *pixels, uint32_t stride,
+                           uint32_t band_index, uint32_t band_count) {
+  tasks_lock_.lock();
+  regions_ = regions;
+  pixels_ = pixels;
+  stride_ = stride;
+  band_index_ = band_index;
+  band_count_ = band_count;
+  pending_ = true;
+  tasks_lock_.unlock();
+  Resume();
+}
+
+void CPUBlendThread::Wait() {
+  if (fd_chandler_.Poll(-1) <= 0) {
+    ETRACE("Poll Failed in CPUBlendThread %s", PRINTERROR());
+    return;
+  }
+
+  if (fd_chandler_.IsReady(cevent_.get_fd())) {
+    // If eventfd_ is ready, we need to wait on it (using read()) to clean
+    // the flag that says it is ready.
+    cevent_.Wait();
+  }
+}
+
+void CPUBlendThread::ExitThread() {
+  HWCThread::Exit();
+}
+
+void CPUBlendThread::HandleRoutine() {
+  tasks_lock_.lock();
+  bool pending = pending_;
+  pending_ = false;
+  tasks_lock_.unlock();
+  if (!pending)
+    return;
+
+  BlendRegions(kernel_, *regions_, pixels_, stride_, band_index_, band_count_,
+               &scratch_);
+  cevent_.Signal();
+}
+
+}  // namespace hwcomposer
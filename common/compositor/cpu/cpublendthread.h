@@ -0,0 +1,66 @@
+/*
+// Copyright (c) 2016 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+*/
+
+#ifndef COMMON_COMPOSITOR_CPU_CPUBLENDTHREAD_H_
+#define COMMON_COMPOSITOR_CPU_CPUBLENDTHREAD_H_
+
+#include <spinlock.h>
+
+#include <vector>
+
+#include "cpublend.h"
+#include "hwcthread.h"
+
+#include "fdhandler.h"
+#include "hwcevent.h"
+
+namespace hwcomposer {
+
+// Blends a share of the bands of a frame for CPURenderer.
+class CPUBlendThread : public HWCThread {
+ public:
+  CPUBlendThread();
+  ~CPUBlendThread() override;
+
+  bool Initialize(CPUBlendKernel kernel);
+
+  // Starts blending bands band_index modulo band_count of regions to
+  // pixels. Everything passed needs to stay valid till Wait returns.
+  void Blend(const std::vector<CPUBlendRegion>* regions, uint8_t* pixels,
+             uint32_t stride, uint32_t band_index, uint32_t band_count);
+
+  // Waits for the bands passed to Blend to be done.
+  void Wait();
+
+  void HandleRoutine() override;
+  void ExitThread();
+
+ private:
+  SpinLock tasks_lock_;
+  CPUBlendKernel kernel_ = kBlendScalar;
+  const std::vector<CPUBlendRegion>* regions_ = NULL;
+  uint8_t* pixels_ = NULL;
+  uint32_t stride_ = 0;
+  uint32_t band_index_ = 0;
+  uint32_t band_count_ = 1;
+  bool pending_ = false;
+  CPUBlendScratch scratch_;
+  FDHandler fd_chandler_;
+  HWCEvent cevent_;
+};
+
+}  // namespace hwcomposer
+#endif  // COMMON_COMPOSITOR_CPU_CPUBLENDTHREAD_H_
@@ -0,0 +1,287 @@
+/*
+// Copyright (c) 2016 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+*/
+
+#include "cpurenderer.h"
+
+#include <drm_fourcc.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <thread>
+
+#include "cpublendthread.h"
+#include "cpusurface.h"
+#include "hwctrace.h"
+#include "hwcutils.h"
+#include "nativebufferhandler.h"
+#include "overlaybuffer.h"
+#include "renderstate.h"
+
+namespace hwcomposer {
+
+// Threads blending a frame, including the compositor thread.
+static const uint32_t kMaxBlendThreads = 4;
+
+// Returns false if format can't be blended. Channels of formats with
+// rgb_order are in memory order R, G, B, others B, G, R.
+static bool GetChannelOrder(uint32_t format, bool *rgb_order, bool *opaque) {
+  switch (format) {
+    case DRM_FORMAT_ARGB8888:
+      *rgb_order = false;
+      *opaque = false;
+      return true;
+    case DRM_FORMAT_XRGB8888:
+      *rgb_order = false;
+      *opaque = true;
+      return true;
+    case DRM_FORMAT_ABGR8888:
+      *rgb_order = true;
+      *opaque = false;
+      return true;
+    case DRM_FORMAT_XBGR8888:
+      *rgb_order = true;
+      *opaque = true;
+      return true;
+    default:
+      return false;
+  }
+}
+
+static void ClearRect(const HwcRect<int> &clear, uint32_t frame_width,
+                      uint32_t frame_height, uint32_t stride,
+                      uint8_t *pixels) {
+  int left = std::max(clear.left, 0);
+  int right = std::min(clear.right, static_cast<int>(frame_width));
+  for (int y = std::max(clear.top, 0);
+       y < std::min(clear.bottom, static_cast<int>(frame_height)); y++) {
+    if (right > left)
+      memset(pixels + y * stride + left * 4, 0, (right - left) * 4);
+  }
+}
+
+CPURenderer::CPURenderer() {
+}
+
+CPURenderer::~CPURenderer() {
+  for (std::unique_ptr<CPUBlendThread> &thread : threads_) {
+    thread->ExitThread();
+  }
+}
+
+bool CPURenderer::Init() {
+  kernel_ = GetBestBlendKernel();
+  uint32_t count = std::min(std::thread::hardware_concurrency(),
+                            kMaxBlendThreads);
+  for (uint32_t i = 1; i < count; i++) {
+    std::unique_ptr<CPUBlendThread> thread(new CPUBlendThread());
+    if (!thread->Initialize(kernel_)) {
+      ETRACE("Failed to create blend thread, blending on fewer threads.");
+      thread->ExitThread();
+      break;
+    }
+
+    threads_.emplace_back(std::move(thread));
+  }
+
+  return true;
+}
+
+bool CPURenderer::Draw(const std::vector<RenderState> &render_states,
+                       NativeSurface *surface) {
+  surface->GetLayer()->SetProtected(false);
+  if (!surface->MakeCurrent())
+    return false;
+
+  const NativeBufferHandler *handler =
+      static_cast<CPUSurface *>(surface)->GetBufferHandler();
+  OverlayBuffer *target = surface->GetLayer()->GetBuffer();
+  bool rgb_order = false;
+  bool opaque = false;
+  if (!GetChannelOrder(target->GetFormat(), &rgb_order, &opaque)) {
+    ETRACE("Surface format %x is not supported by CPURenderer.",
+           target->GetFormat());
+    return false;
+  }
+
+  uint32_t frame_width = surface->GetWidth();
+  uint32_t frame_height = surface->GetHeight();
+  HWCNativeHandle target_handle = target->GetOriginalHandle();
+  uint32_t stride = 0;
+  void *map_data = NULL;
+  uint8_t *pixels = static_cast<uint8_t *>(
+      handler->Map(target_handle, 0, 0, frame_width, frame_height, &stride,
+                   &map_data, 0));
+  if (!pixels) {
+    ETRACE("Failed to map surface for CPURenderer.");
+    return false;
+  }
+
+  bool clear_surface = surface->ClearSurface();
+  bool partial_clear = surface->IsPartialClear();
+
+  surface->SetClearSurface(NativeSurface::kNone);
+
+  if (clear_surface || partial_clear) {
+    if (surface->IsOnScreen()) {
+      for (const HwcRect<int> &clear : surface->GetSurfaceDamageRegion()) {
+        ClearRect(clear, frame_width, frame_height, stride, pixels);
+      }
+    } else {
+      ClearRect(HwcRect<int>(0, 0, frame_width, frame_height), frame_width,
+                frame_height, stride, pixels);
+    }
+  }
+
+  size_t layer_count = 0;
+  for (const RenderState &state : render_states) {
+    layer_count += state.layer_state_.size();
+  }
+
+  // Images handed out by MapBuffer point into mapped_.
+  mapped_.clear();
+  mapped_.reserve(layer_count);
+  regions_.resize(render_states.size());
+  for (size_t i = 0; i < render_states.size(); i++) {
+    const RenderState &state = render_states.at(i);
+    CPUBlendRegion &region = regions_.at(i);
+    region.x = state.scissor_x_;
+    region.y = state.scissor_y_;
+    region.width = std::min(state.scissor_width_,
+                            frame_width - std::min(region.x, frame_width));
+    region.height = std::min(state.scissor_height_,
+                             frame_height - std::min(region.y, frame_height));
+    region.layers.clear();
+    for (const RenderState::LayerState &src : state.layer_state_) {
+      region.layers.emplace_back();
+      CPUBlendLayer &layer = region.layers.back();
+      float tex_width = 1;
+      float tex_height = 1;
+      if (src.handle_) {
+        layer.image = MapBuffer(handler, src.handle_, rgb_order);
+        if (!layer.image) {
+          UnMapBuffers(handler);
+          handler->UnMap(target_handle, map_data);
+          return false;
+        }
+
+        tex_width = layer.image->width;
+        tex_height = layer.image->height;
+      }
+
+      // Same mapping as GLProgram, texture coordinates across the state
+      // go from 0 to 1 and are transformed by texture_matrix_, which is
+      // column major, into the crop.
+      const float *crop = src.crop_bounds_;
+      const float *matrix = src.texture_matrix_;
+      float crop_width = (crop[2] - crop[0]) * tex_width;
+      float crop_height = (crop[3] - crop[1]) * tex_height;
+      float width = static_cast<float>(state.width_);
+      float height = static_cast<float>(state.height_);
+      layer.s_origin = crop[0] * tex_width;
+      layer.t_origin = crop[1] * tex_height;
+      layer.ds_dx = matrix[0] * crop_width / width;
+      layer.ds_dy = matrix[1] * crop_width / height;
+      layer.dt_dx = matrix[2] * crop_height / width;
+      layer.dt_dy = matrix[3] * crop_height / height;
+      // Solid colors are passed unnormalized, as GLProgram does.
+      const uint8_t *color = src.solid_color_array_;
+      layer.color[0] = rgb_order ? color[3] : color[1];
+      layer.color[1] = color[2];
+      layer.color[2] = rgb_order ? color[1] : color[3];
+      layer.color[3] = color[0];
+      layer.alpha = src.alpha_;
+      layer.premult = src.premult_;
+    }
+  }
+
+  uint32_t band_count = threads_.size() + 1;
+  for (uint32_t i = 1; i < band_count; i++) {
+    threads_.at(i - 1)->Blend(&regions_, pixels, stride, i, band_count);
+  }
+
+  BlendRegions(kernel_, regions_, pixels, stride, 0, band_count, &scratch_);
+
+  for (std::unique_ptr<CPUBlendThread> &thread : threads_) {
+    thread->Wait();
+  }
+
+  UnMapBuffers(handler);
+  handler->UnMap(target_handle, map_data);
+
+  // Everything is written by now, there is nothing to wait for.
+  surface->SetNativeFence(-1);
+  surface->ResetDamage();
+  return true;
+}
+
+const CPUImage *CPURenderer::MapBuffer(const NativeBufferHandler *handler,
+                                       OverlayBuffer *buffer, bool rgb_order) {
+  for (const MappedBuffer &mapped : mapped_) {
+    if (mapped.buffer == buffer)
+      return &mapped.image;
+  }
+
+  bool buffer_rgb_order = false;
+  bool opaque = false;
+  if (!GetChannelOrder(buffer->GetFormat(), &buffer_rgb_order, &opaque)) {
+    ETRACE("Layer format %x is not supported by CPURenderer.",
+           buffer->GetFormat());
+    return NULL;
+  }
+
+  mapped_.emplace_back();
+  MappedBuffer &mapped = mapped_.back();
+  mapped.buffer = buffer;
+  mapped.handle = buffer->GetOriginalHandle();
+  mapped.map_data = NULL;
+  CPUImage &image = mapped.image;
+  image.width = buffer->GetWidth();
+  image.height = buffer->GetHeight();
+  image.pixels = static_cast<const uint8_t *>(
+      handler->MapForRead(mapped.handle, 0, 0, image.width, image.height,
+                          &image.stride, &mapped.map_data, 0));
+  if (!image.pixels) {
+    ETRACE("Failed to map layer buffer for CPURenderer.");
+    mapped_.pop_back();
+    return NULL;
+  }
+
+  image.swap_rb = buffer_rgb_order != rgb_order;
+  image.opaque = opaque;
+  return &image;
+}
+
+void CPURenderer::UnMapBuffers(const NativeBufferHandler *handler) {
+  for (const MappedBuffer &mapped : mapped_) {
+    handler->UnMap(mapped.handle, mapped.map_data);
+  }
+
+  mapped_.clear();
+}
+
+void CPURenderer::InsertFence(int32_t kms_fence) {
+  // Layers are read as soon as they are mapped, wait for them here.
+  if (kms_fence > 0) {
+    HWCPoll(kms_fence, -1);
+    close(kms_fence);
+  }
+}
+
+void CPURenderer::SetDisableExplicitSync(bool /*disable_explicit_sync*/) {
+}
+
+}  // namespace hwcomposer
@@ -0,0 +1,71 @@
+/*
+// Copyright (c) 2016 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+*/
+
+#ifndef COMMON_COMPOSITOR_CPU_CPURENDERER_H_
+#define COMMON_COMPOSITOR_CPU_CPURENDERER_H_
+
+#include <memory>
+#include <vector>
+
+#include "cpublend.h"
+#include "platformdefines.h"
+#include "renderer.h"
+
+namespace hwcomposer {
+
+class CPUBlendThread;
+class NativeBufferHandler;
+class OverlayBuffer;
+
+// Renderer blending layers with the CPU, for builds without a GPU
+// compositor. Produces the same output as GLRenderer for 32 bit RGB
+// formats.
+class CPURenderer : public Renderer {
+ public:
+  CPURenderer();
+  ~CPURenderer() override;
+
+  bool Init() override;
+  bool Draw(const std::vector<RenderState>& commands,
+            NativeSurface* surface) override;
+
+  void InsertFence(int32_t kms_fence) override;
+
+  void SetDisableExplicitSync(bool disable_explicit_sync) override;
+
+ private:
+  struct MappedBuffer {
+    OverlayBuffer* buffer;
+    HWCNativeHandle handle;
+    void* map_data;
+    CPUImage image;
+  };
+
+  // Maps buffer for reading, in the channel order of a target with
+  // rgb_order. Returns NULL if buffer can't be blended.
+  const CPUImage* MapBuffer(const NativeBufferHandler* handler,
+                            OverlayBuffer* buffer, bool rgb_order);
+  void UnMapBuffers(const NativeBufferHandler* handler);
+
+  CPUBlendKernel kernel_ = kBlendScalar;
+  std::vector<std::unique_ptr<CPUBlendThread>> threads_;
+  std::vector<CPUBlendRegion> regions_;
+  std::vector<MappedBuffer> mapped_;
+  CPUBlendScratch scratch_;
+};
+
+}  // namespace hwcomposer
+#endif  // COMMON_COMPOSITOR_CPU_CPURENDERER_H_
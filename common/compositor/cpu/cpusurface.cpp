@@ -0,0 +1,46 @@
+/*
+// Copyright (c) 2016 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+*/
+
+#include "cpusurface.h"
+
+#include "hwctrace.h"
+#include "resourcemanager.h"
+
+namespace hwcomposer {
+
+CPUSurface::CPUSurface(uint32_t width, uint32_t height)
+    : NativeSurface(width, height) {
+}
+
+CPUSurface::~CPUSurface() {
+}
+
+bool CPUSurface::MakeCurrent() {
+  // Buffer is mapped by CPURenderer for every draw, there is nothing to
+  // bind.
+  if (!layer_.GetBuffer()) {
+    ETRACE("Surface has no buffer to render to.");
+    return false;
+  }
+
+  return true;
+}
+
+const NativeBufferHandler* CPUSurface::GetBufferHandler() const {
+  return resource_manager_->GetNativeBufferHandler();
+}
+
+}  // namespace hwcomposer
@@ -0,0 +1,40 @@
+/*
+// Copyright (c) 2016 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+*/
+
+#ifndef COMMON_COMPOSITOR_CPU_CPUSURFACE_H_
+#define COMMON_COMPOSITOR_CPU_CPUSURFACE_H_
+
+#include "nativesurface.h"
+
+namespace hwcomposer {
+
+class NativeBufferHandler;
+
+class CPUSurface : public NativeSurface {
+ public:
+  CPUSurface() = default;
+  ~CPUSurface() override;
+  CPUSurface(uint32_t width, uint32_t height);
+
+  bool MakeCurrent() override;
+
+  // Handler to map the buffer of this surface and the layers blended to
+  // it with.
+  const NativeBufferHandler* GetBufferHandler() const;
+};
+
+}  // namespace hwcomposer
+#endif  // COMMON_COMPOSITOR_CPU_CPUSURFACE_H_
@@ -0,0 +1,42 @@
+/*
+// Copyright (c) 2016 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+*/
+
+#include "nativecpuresource.h"
+
+namespace hwcomposer {
+
+NativeCPUResource::~NativeCPUResource() {
+}
+
+bool NativeCPUResource::PrepareResources(
+    const std::vector<OverlayBuffer*>& buffers) {
+  layer_buffers_ = buffers;
+  return true;
+}
+
+void NativeCPUResource::ReleaseGPUResources(
+    const std::vector<ResourceHandle>& /*handles*/) {
+}
+
+GpuResourceHandle NativeCPUResource::GetResourceHandle(
+    uint32_t layer_index) const {
+  if (layer_buffers_.size() <= layer_index)
+    return NULL;
+
+  return layer_buffers_.at(layer_index);
+}
+
+}  // namespace hwcomposer
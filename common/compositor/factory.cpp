@@ -19,6 +19,11 @@
 
 #ifdef USE_DC
 #include "nativesurface.h"
+#ifdef USE_CPU_COMPOSITOR
+#include "cpurenderer.h"
+#include "cpusurface.h"
+#include "nativecpuresource.h"
+#endif
 #elif USE_GL
 #include "glrenderer.h"
 #include "glsurface.h"
@@ -36,7 +41,9 @@
 namespace hwcomposer {
 
 NativeSurface* Create3DSurface(uint32_t width, uint32_t height) {
-#ifdef USE_GL
+#ifdef USE_CPU_COMPOSITOR
+  return new CPUSurface(width, height);
+#elif USE_GL
   return new GLSurface(width, height);
 #elif USE_VK
   return new VKSurface(width, height);
@@ -50,7 +57,9 @@ NativeSurface* CreateVideoSurface(uint32_t width, uint32_t height) {
 }
 
 Renderer* Create3DRenderer() {
-#ifdef USE_GL
+#ifdef USE_CPU_COMPOSITOR
+  return new CPURenderer();
+#elif USE_GL
   return new GLRenderer();
 #elif USE_VK
   return new VKRenderer();
@@ -72,7 +81,9 @@ Renderer* CreateMediaRenderer() {
 }
 
 NativeGpuResource* CreateNativeGpuResourceHandler() {
-#ifdef USE_GL
+#ifdef USE_CPU_COMPOSITOR
+  return new NativeCPUResource();
+#elif USE_GL
   return new NativeGLResource();
 #elif USE_VK
   return new NativeVKResource();
@@ -30,7 +30,7 @@ EGLOffScreenContext::~EGLOffScreenContext() {
       ETRACE("Failed to destroy OpenGL ES Context.");
 }
 
-bool EGLOffScreenContext::Init() {
+bool EGLOffScreenContext::Init(EGLContext share_context) {
   EGLint num_configs;
   EGLConfig egl_config;
   static const EGLint context_attribs[] = {
@@ -57,7 +57,7 @@ bool EGLOffScreenContext::Init() {
     return false;
   }
 
-  egl_ctx_ = eglCreateContext(egl_display_, egl_config, EGL_NO_CONTEXT,
+  egl_ctx_ = eglCreateContext(egl_display_, egl_config, share_context,
                               context_attribs);
 
   if (egl_ctx_ == EGL_NO_CONTEXT) {
@@ -26,7 +26,9 @@ class EGLOffScreenContext {
   EGLOffScreenContext();
   ~EGLOffScreenContext();
 
-  bool Init();
+  // Creates the context. Textures are shared with share_context, if
+  // given.
+  bool Init(EGLContext share_context = EGL_NO_CONTEXT);
 
   EGLint GetSyncFD(bool onScreen);
 
@@ -34,6 +36,10 @@ class EGLOffScreenContext {
     return egl_display_;
   }
 
+  EGLContext GetContext() const {
+    return egl_ctx_;
+  }
+
   bool MakeCurrent();
 
  private:
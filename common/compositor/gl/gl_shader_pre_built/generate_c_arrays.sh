@@ -22,7 +22,9 @@ SHADER_TEST_FOLDER=$SHADER_PRE_BUILT_PATH/shader-test
 BIN_TO_ARRAY=$SHADER_PRE_BUILT_PATH/bin_to_c_array
 SHADER_DB_DIR=$SHADER_PRE_BUILT_PATH/shader-db
 
-MAX_NUM_LAYERS=16
+# Programs are built for 1 up to MAX_NUM_LAYERS layers, which should not
+# exceed the number of texture units of the target.
+MAX_NUM_LAYERS=${2:-16}
 GEN_SHADER_TEST=$SHADER_PRE_BUILT_PATH/generate_shader_test.sh
 
 #building bin_to_c_arrays
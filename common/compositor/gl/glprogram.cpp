@@ -16,10 +16,21 @@
 
 #include "glprogram.h"
 
+#ifdef SHADER_CACHE_PATH
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
 #include <string>
 #include <sstream>
+#include <vector>
 
 #include "hwctrace.h"
+#ifdef SHADER_CACHE_PATH
+#include "hwcutils.h"
+#endif
 #include "renderstate.h"
 
 namespace hwcomposer {
@@ -83,6 +94,28 @@ static std::string GenerateVertexShader(int layer_count) {
   return vertex_shader_stream.str();
 }
 
+// Texture coordinates of every layer come with the vertices, so that
+// regions drawing the same layers can share a draw call.
+static std::string GenerateBatchedVertexShader(int layer_count) {
+  std::ostringstream vertex_shader_stream;
+  vertex_shader_stream << "#version 300 es\n"
+                       << "#define LAYER_COUNT " << layer_count << "\n"
+                       << "precision mediump int;\n"
+                       << "in vec2 vPosition;\n";
+  for (int i = 0; i < layer_count; ++i) {
+    vertex_shader_stream << "in vec2 vTexCoords" << i << ";\n";
+  }
+  vertex_shader_stream << "out vec2 fTexCoords[LAYER_COUNT];\n"
+                       << "void main() {\n";
+  for (int i = 0; i < layer_count; ++i) {
+    vertex_shader_stream << "  fTexCoords[" << i << "] = vTexCoords" << i
+                         << ";\n";
+  }
+  vertex_shader_stream << "  gl_Position = vec4(vPosition, 0.0, 1.0);\n"
+                       << "}\n";
+  return vertex_shader_stream.str();
+}
+
 static std::string GenerateFragmentShader(int layer_count) {
   std::ostringstream fragment_shader_stream;
   fragment_shader_stream << "#version 300 es\n"
@@ -158,11 +191,232 @@ static GLint LoadPreBuiltBinary(GLint gl_program, void *binary, long size) {
 #include "glprebuiltshaderarray.h"
 #endif
 
-static GLint GenerateProgram(unsigned num_textures,
-                             std::ostringstream *shader_log) {
+#ifdef SHADER_CACHE_PATH
+static const uint32_t kProgramCacheMagic = 0x50435748;  // "HWCP"
+// Bump whenever the layout of cache files changes.
+static const uint32_t kProgramCacheVersion = 1;
+/* 10MB limit, same as for pre-built shader files */
+static const GLint kProgramCacheSizeLimit = 10485760;
+
+struct ProgramCacheHeader {
+  uint32_t magic;
+  uint32_t version;
+  uint64_t key;
+  uint32_t format;
+  uint32_t size;
+};
+
+static void HashString(uint64_t &hash, const char *str) {
+  if (!str) {
+    HashCombine(hash, 0);
+    return;
+  }
+
+  for (; *str; str++) {
+    HashCombine(hash, static_cast<uint8_t>(*str));
+  }
+}
+
+// Program binaries are only valid for the driver which produced them, a
+// driver update or a change to the shaders results in a different key.
+static uint64_t ProgramCacheKey(const std::string &vertex_shader,
+                                const std::string &fragment_shader) {
+  uint64_t key = kHashSeed;
+  HashString(key, reinterpret_cast<const char *>(glGetString(GL_VENDOR)));
+  HashString(key, reinterpret_cast<const char *>(glGetString(GL_RENDERER)));
+  HashString(key, reinterpret_cast<const char *>(glGetString(GL_VERSION)));
+  HashString(key, vertex_shader.c_str());
+  HashString(key, fragment_shader.c_str());
+  return key;
+}
+
+static std::string ProgramCachePath(unsigned num_textures, bool batched) {
+  std::ostringstream path;
+  path << SHADER_CACHE_PATH "/hwc_program_" << num_textures
+       << (batched ? "_batched" : "") << ".bin";
+  return path.str();
+}
+
+static bool ProgramBinarySupported() {
+  if (!glProgramBinaryOES || !glGetProgramBinaryOES)
+    return false;
+
+  GLint formats = 0;
+  glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS_OES, &formats);
+  return formats > 0;
+}
+
+static bool LoadCachedProgram(GLint program, const std::string &path,
+                              uint64_t key) {
+  FILE *fp = fopen(path.c_str(), "rb");
+  if (!fp)
+    return false;
+
+  ProgramCacheHeader header;
+  std::vector<uint8_t> binary;
+  bool valid = fread(&header, sizeof(header), 1, fp) == 1 &&
+               header.magic == kProgramCacheMagic &&
+               header.version == kProgramCacheVersion && header.key == key &&
+               header.size > 0 &&
+               header.size <= static_cast<uint32_t>(kProgramCacheSizeLimit);
+  if (valid) {
+    binary.resize(header.size);
+    valid = fread(binary.data(), 1, header.size, fp) == header.size;
+  }
+
+  fclose(fp);
+  if (!valid)
+    return false;
+
   GLint status;
+  glProgramBinaryOES(program, header.format, binary.data(), header.size);
+  glGetProgramiv(program, GL_LINK_STATUS, &status);
+  return status;
+}
+
+// Writes to a temporary file which is then renamed, renderers sharing
+// this cache never read a partially written program.
+static void SaveCachedProgram(GLint program, const std::string &path,
+                              uint64_t key) {
+  GLint length = 0;
+  glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH_OES, &length);
+  if (length <= 0 || length > kProgramCacheSizeLimit)
+    return;
+
+  std::vector<uint8_t> binary(length);
+  GLsizei binary_size = 0;
+  GLenum format = 0;
+  glGetProgramBinaryOES(program, length, &binary_size, &format, binary.data());
+  if (binary_size <= 0)
+    return;
+
+  ProgramCacheHeader header;
+  header.magic = kProgramCacheMagic;
+  header.version = kProgramCacheVersion;
+  header.key = key;
+  header.format = format;
+  header.size = binary_size;
+
+  mkdir(SHADER_CACHE_PATH, 0755);
+  std::string temp_path = path + ".XXXXXX";
+  int fd = mkstemp(&temp_path.front());
+  if (fd < 0)
+    return;
+
+  FILE *fp = fdopen(fd, "wb");
+  if (!fp) {
+    close(fd);
+    unlink(temp_path.c_str());
+    return;
+  }
+
+  bool written = fwrite(&header, sizeof(header), 1, fp) == 1 &&
+                 fwrite(binary.data(), 1, binary_size, fp) ==
+                     static_cast<size_t>(binary_size);
+  if (fclose(fp) != 0)
+    written = false;
+
+  if (!written || rename(temp_path.c_str(), path.c_str()) != 0) {
+    ETRACE("Failed to write shader program cache %s", path.c_str());
+    unlink(temp_path.c_str());
+  }
+}
+#endif
+
+static GLint CompileProgram(GLint program, unsigned num_textures,
+                            bool batched,
+                            const std::string &vertex_shader_string,
+                            const std::string &fragment_shader_string,
+                            std::ostringstream *shader_log) {
+  GLint status;
+  const GLchar *vertex_shader_source = vertex_shader_string.c_str();
+  GLint vertex_shader = CompileAndCheckShader(
+      GL_VERTEX_SHADER, 1, &vertex_shader_source, shader_log);
+  if (!vertex_shader)
+    return 0;
+
+  const GLchar *fragment_shader_source = fragment_shader_string.c_str();
+  GLint fragment_shader = CompileAndCheckShader(
+      GL_FRAGMENT_SHADER, 1, &fragment_shader_source, shader_log);
+  if (!fragment_shader) {
+    glDeleteShader(vertex_shader);
+    return 0;
+  }
+
+  glAttachShader(program, vertex_shader);
+  glAttachShader(program, fragment_shader);
+  glBindAttribLocation(program, 0, "vPosition");
+  if (batched) {
+    for (unsigned i = 0; i < num_textures; i++) {
+      std::ostringstream attrib_name_formatter;
+      attrib_name_formatter << "vTexCoords" << i;
+      glBindAttribLocation(program, i + 1,
+                           attrib_name_formatter.str().c_str());
+    }
+  } else {
+    glBindAttribLocation(program, 1, "vTexCoords");
+  }
+
+  glLinkProgram(program);
+  glDetachShader(program, vertex_shader);
+  glDetachShader(program, fragment_shader);
+  glDeleteShader(vertex_shader);
+  glDeleteShader(fragment_shader);
+
+  glGetProgramiv(program, GL_LINK_STATUS, &status);
+
+  if (!status) {
+    if (shader_log) {
+      GLint log_length;
+      glGetProgramiv(program, GL_INFO_LOG_LENGTH, &log_length);
+      std::string program_log(log_length, ' ');
+      glGetProgramInfoLog(program, log_length, NULL, &program_log.front());
+      *shader_log << "Failed to link program:\n" << program_log.c_str() << "\n";
+    }
+    return 0;
+  }
+
+  return program;
+}
+
+// Tries the shader cache before building program from source, programs
+// built from source are added to the cache.
+static GLint LoadOrCompileProgram(GLint program, unsigned num_textures,
+                                  bool batched,
+                                  std::ostringstream *shader_log) {
+  std::string vertex_shader = batched
+                                  ? GenerateBatchedVertexShader(num_textures)
+                                  : GenerateVertexShader(num_textures);
+  std::string fragment_shader = GenerateFragmentShader(num_textures);
+#ifdef SHADER_CACHE_PATH
+  bool use_cache = ProgramBinarySupported();
+  uint64_t key = 0;
+  std::string cache_path;
+  if (use_cache) {
+    key = ProgramCacheKey(vertex_shader, fragment_shader);
+    cache_path = ProgramCachePath(num_textures, batched);
+    if (LoadCachedProgram(program, cache_path, key))
+      return program;
+  }
+#endif
+
+  if (!CompileProgram(program, num_textures, batched, vertex_shader,
+                      fragment_shader, shader_log))
+    return 0;
+
+#ifdef SHADER_CACHE_PATH
+  if (use_cache)
+    SaveCachedProgram(program, cache_path, key);
+#endif
+
+  return program;
+}
+
+static GLint GenerateProgram(unsigned num_textures, bool batched,
+                             std::ostringstream *shader_log) {
   GLint program = glCreateProgram();
 #if defined(LOAD_PREBUILT_SHADER_FILE) || defined(USE_PREBUILT_SHADER_BIN_ARRAY)
+  GLint status;
   void *binary_prog;
   long binary_sz;
 #endif
@@ -174,11 +428,16 @@ static GLint GenerateProgram(unsigned num_textures,
     return 0;
   }
 
+  // Pre-built binaries only exist for programs drawing a single region.
+  if (batched)
+    return LoadOrCompileProgram(program, num_textures, true, shader_log);
+
 #ifdef USE_PREBUILT_SHADER_BIN_ARRAY
   /* try to retrieve shader binary program from built-in arrays */
 
-  /* support only up to 16 layers */
-  if (num_textures > 0 && num_textures < 17) {
+  /* support only up to the layer count the arrays were generated for */
+  if (num_textures > 0 && num_textures <= sizeof(shader_prog_arrays) /
+                                              sizeof(*shader_prog_arrays)) {
     /* first long is the size of binary */
     binary_sz = *(long *)shader_prog_arrays[num_textures - 1];
     binary_prog =
@@ -252,46 +511,7 @@ fail_file_open:
                 << "now trying run-time build\n";
 #endif
 
-  std::string vertex_shader_string = GenerateVertexShader(num_textures);
-  const GLchar *vertex_shader_source = vertex_shader_string.c_str();
-  GLint vertex_shader = CompileAndCheckShader(
-      GL_VERTEX_SHADER, 1, &vertex_shader_source, shader_log);
-  if (!vertex_shader)
-    return 0;
-
-  std::string fragment_shader_string = GenerateFragmentShader(num_textures);
-  const GLchar *fragment_shader_source = fragment_shader_string.c_str();
-  GLint fragment_shader = CompileAndCheckShader(
-      GL_FRAGMENT_SHADER, 1, &fragment_shader_source, shader_log);
-  if (!fragment_shader) {
-    glDeleteShader(vertex_shader);
-    return 0;
-  }
-
-  glAttachShader(program, vertex_shader);
-  glAttachShader(program, fragment_shader);
-  glBindAttribLocation(program, 0, "vPosition");
-  glBindAttribLocation(program, 1, "vTexCoords");
-  glLinkProgram(program);
-  glDetachShader(program, vertex_shader);
-  glDetachShader(program, fragment_shader);
-  glDeleteShader(vertex_shader);
-  glDeleteShader(fragment_shader);
-
-  glGetProgramiv(program, GL_LINK_STATUS, &status);
-
-  if (!status) {
-    if (shader_log) {
-      GLint log_length;
-      glGetProgramiv(program, GL_INFO_LOG_LENGTH, &log_length);
-      std::string program_log(log_length, ' ');
-      glGetProgramInfoLog(program, log_length, NULL, &program_log.front());
-      *shader_log << "Failed to link program:\n" << program_log.c_str() << "\n";
-    }
-    return 0;
-  }
-
-  return program;
+  return LoadOrCompileProgram(program, num_textures, false, shader_log);
 }
 
 GLProgram::GLProgram()
@@ -310,9 +530,9 @@ GLProgram::~GLProgram() {
     glDeleteProgram(program_);
 }
 
-bool GLProgram::Init(unsigned texture_count) {
+bool GLProgram::Init(unsigned texture_count, bool batched) {
   std::ostringstream shader_log;
-  program_ = GenerateProgram(texture_count, &shader_log);
+  program_ = GenerateProgram(texture_count, batched, &shader_log);
   if (!program_) {
     ETRACE("%s", shader_log.str().c_str());
     return false;
@@ -323,6 +543,28 @@ bool GLProgram::Init(unsigned texture_count) {
 
 void GLProgram::UseProgram(const RenderState &state, GLuint viewport_width,
                            GLuint viewport_height) {
+  BindLayers(state);
+  glUniform4f(viewport_loc_, state.x_ / (float)viewport_width,
+              state.y_ / (float)viewport_height,
+              (state.width_) / (float)viewport_width,
+              (state.height_) / (float)viewport_height);
+
+  for (unsigned src_index = 0; src_index < state.layer_state_.size();
+       src_index++) {
+    const RenderState::LayerState &src = state.layer_state_[src_index];
+    glUniform4f(crop_loc_ + src_index, src.crop_bounds_[0], src.crop_bounds_[1],
+                src.crop_bounds_[2] - src.crop_bounds_[0],
+                src.crop_bounds_[3] - src.crop_bounds_[1]);
+    glUniformMatrix2fv(tex_matrix_loc_ + src_index, 1, GL_FALSE,
+                       src.texture_matrix_);
+  }
+}
+
+void GLProgram::UseBatchedProgram(const RenderState &state) {
+  BindLayers(state);
+}
+
+void GLProgram::BindLayers(const RenderState &state) {
   glUseProgram(program_);
   unsigned size = state.layer_state_.size();
   if (!initialized_) {
@@ -343,20 +585,10 @@ void GLProgram::UseProgram(const RenderState &state, GLuint viewport_width,
     initialized_ = true;
   }
 
-  glUniform4f(viewport_loc_, state.x_ / (float)viewport_width,
-              state.y_ / (float)viewport_height,
-              (state.width_) / (float)viewport_width,
-              (state.height_) / (float)viewport_height);
-
   for (unsigned src_index = 0; src_index < size; src_index++) {
     const RenderState::LayerState &src = state.layer_state_[src_index];
     glUniform1f(alpha_loc_ + src_index, src.alpha_);
     glUniform1f(premult_loc_ + src_index, src.premult_);
-    glUniform4f(crop_loc_ + src_index, src.crop_bounds_[0], src.crop_bounds_[1],
-                src.crop_bounds_[2] - src.crop_bounds_[0],
-                src.crop_bounds_[3] - src.crop_bounds_[1]);
-    glUniformMatrix2fv(tex_matrix_loc_ + src_index, 1, GL_FALSE,
-                       src.texture_matrix_);
     glActiveTexture(GL_TEXTURE0 + src_index);
     glBindTexture(GL_TEXTURE_EXTERNAL_OES, src.handle_);
     glUniform4f(solid_color_loc_ + src_index, (float)src.solid_color_array_[3],
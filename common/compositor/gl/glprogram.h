@@ -33,11 +33,17 @@ class GLProgram {
 
   ~GLProgram();
 
-  bool Init(unsigned texture_count);
+  // Batched programs take position and texture coordinates of every
+  // layer from vertex data instead of uniforms of a single RenderState.
+  bool Init(unsigned texture_count, bool batched = false);
   void UseProgram(const RenderState& cmd, GLuint viewport_width,
                   GLuint viewport_height);
+  // Binds layers of cmd, which has to match the vertex data drawn.
+  void UseBatchedProgram(const RenderState& cmd);
 
  private:
+  void BindLayers(const RenderState& cmd);
+
   GLint program_;
   GLint viewport_loc_;
   GLint crop_loc_;
@@ -19,6 +19,7 @@
 #include "glprogram.h"
 #include "hwctrace.h"
 #include "nativesurface.h"
+#include "overlaybuffer.h"
 #include "renderstate.h"
 #include "shim.h"
 #ifdef COMPOSITOR_TRACING
@@ -27,6 +28,55 @@
 
 namespace hwcomposer {
 
+// Batched programs take position and texture coordinates of every layer
+// as separate attributes, GLES 3.0 guarantees 16 of them.
+static const size_t kMaxBatchedLayers = 15;
+
+static const size_t kNoBatch = static_cast<size_t>(-1);
+
+// Two triangles covering a region, corners in units of the region size.
+static const size_t kVerticesPerRegion = 6;
+static const float kRegionCorners[kVerticesPerRegion * 2] = {
+    0.0f, 0.0f, 1.0f, 0.0f, 0.0f, 1.0f, 0.0f, 1.0f, 1.0f, 0.0f, 1.0f, 1.0f};
+
+// Floats per vertex, position and texture coordinates of every layer.
+static size_t VertexSize(size_t layer_count) {
+  return 2 + layer_count * 2;
+}
+
+static bool HasSameLayers(const RenderState &lhs, const RenderState &rhs) {
+  if (lhs.layer_state_.size() != rhs.layer_state_.size())
+    return false;
+
+  for (size_t i = 0; i < lhs.layer_state_.size(); i++) {
+    const RenderState::LayerState &lhs_layer = lhs.layer_state_[i];
+    const RenderState::LayerState &rhs_layer = rhs.layer_state_[i];
+    if (lhs_layer.layer_index_ != rhs_layer.layer_index_ ||
+        lhs_layer.handle_ != rhs_layer.handle_)
+      return false;
+  }
+
+  return true;
+}
+
+// Computes on the CPU what the vertex shader of the regular programs
+// does for the corners of state.
+static void WriteRegionVertices(const RenderState &state, GLuint frame_width,
+                                GLuint frame_height, float *out) {
+  for (size_t vertex = 0; vertex < kVerticesPerRegion; vertex++) {
+    float s = kRegionCorners[vertex * 2];
+    float t = kRegionCorners[vertex * 2 + 1];
+    *out++ = (state.x_ + s * state.width_) / frame_width * 2.0f - 1.0f;
+    *out++ = (state.y_ + t * state.height_) / frame_height * 2.0f - 1.0f;
+    for (const RenderState::LayerState &src : state.layer_state_) {
+      const float *matrix = src.texture_matrix_;
+      const float *crop = src.crop_bounds_;
+      *out++ = crop[0] + (s * matrix[0] + t * matrix[1]) * (crop[2] - crop[0]);
+      *out++ = crop[1] + (s * matrix[2] + t * matrix[3]) * (crop[3] - crop[1]);
+    }
+  }
+}
+
 GLRenderer::~GLRenderer() {
   if (!context_.MakeCurrent()) {
     ETRACE("Failed make current context.");
@@ -35,14 +85,33 @@ GLRenderer::~GLRenderer() {
 
   if (vertex_array_)
     glDeleteVertexArraysOES(1, &vertex_array_);
+
+  if (batch_vertex_array_)
+    glDeleteVertexArraysOES(1, &batch_vertex_array_);
+
+  if (batch_buffer_)
+    glDeleteBuffers(1, &batch_buffer_);
+
+  for (auto &surface_fb : surface_fbs_) {
+    glDeleteFramebuffers(1, &surface_fb.second);
+  }
 }
 
 bool GLRenderer::Init() {
+  return InitContext(EGL_NO_CONTEXT);
+}
+
+bool GLRenderer::InitShared(Renderer *share) {
+  shared_ = true;
+  return InitContext(static_cast<GLRenderer *>(share)->context_.GetContext());
+}
+
+bool GLRenderer::InitContext(EGLContext share_context) {
   // clang-format off
   const GLfloat verts[] = {0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 2.0f,
                            0.0f, 2.0f, 2.0f, 0.0f, 2.0f, 0.0f};
   // clang-format on
-  if (!context_.Init()) {
+  if (!context_.Init(share_context)) {
     ETRACE("Failed to initialize EGLContext.");
     return false;
   }
@@ -82,6 +151,9 @@ bool GLRenderer::Init() {
 
   vertex_array_ = vertex_array;
 
+  glGenVertexArraysOES(1, &batch_vertex_array_);
+  glGenBuffers(1, &batch_buffer_);
+
   return true;
 }
 
@@ -95,7 +167,7 @@ bool GLRenderer::Draw(const std::vector<RenderState> &render_states,
   // GL rendere should not support protected
   surface->GetLayer()->SetProtected(false);
 
-  if (!surface->MakeCurrent())
+  if (!MakeSurfaceCurrent(surface))
     return false;
 #ifdef COMPOSITOR_TRACING
   ICOMPOSITORTRACE("Draw starts \n");
@@ -115,8 +187,12 @@ bool GLRenderer::Draw(const std::vector<RenderState> &render_states,
     if (surface->IsOnScreen() &&
         ((frame_width != clear_width) || (frame_height != clear_height))) {
       glEnable(GL_SCISSOR_TEST);
-      glScissor(damage.left, damage.top, clear_width, clear_height);
-      glClear(GL_COLOR_BUFFER_BIT);
+      // Pixels between damaged rects are still valid.
+      for (const HwcRect<int> &rect : surface->GetSurfaceDamageRegion()) {
+        glScissor(rect.left, rect.top, rect.right - rect.left,
+                  rect.bottom - rect.top);
+        glClear(GL_COLOR_BUFFER_BIT);
+      }
     } else {
       glClear(GL_COLOR_BUFFER_BIT);
       glEnable(GL_SCISSOR_TEST);
@@ -137,13 +213,16 @@ bool GLRenderer::Draw(const std::vector<RenderState> &render_states,
       damage.left, damage.top, damage.right - damage.left,
       damage.bottom - damage.top);
 #endif
-  for (const RenderState &state : render_states) {
-    unsigned size = state.layer_state_.size();
-    GLProgram *program = GetProgram(size);
-    if (!program)
-      continue;
+  // Vertices of batched regions cover only them, no scissor needed.
+  BuildBatches(render_states, frame_width, frame_height);
+  if (!batches_.empty()) {
+    glDisable(GL_SCISSOR_TEST);
+    DrawBatches();
+    glEnable(GL_SCISSOR_TEST);
+  }
 
-    program->UseProgram(state, frame_width, frame_height);
+  for (size_t i = 0; i < render_states.size(); i++) {
+    const RenderState &state = render_states[i];
 #ifdef COMPOSITOR_TRACING
     ICOMPOSITORTRACE(
         "scissor_x_: %d state.scissor_y_: %d scissor_width_: %d "
@@ -161,6 +240,15 @@ bool GLRenderer::Draw(const std::vector<RenderState> &render_states,
       ICOMPOSITORTRACE("ALERT: Rendering Layer outside Damaged Region. \n");
     }
 #endif
+    if (state_batch_[i] != kNoBatch)
+      continue;
+
+    unsigned size = state.layer_state_.size();
+    GLProgram *program = GetProgram(size);
+    if (!program)
+      continue;
+
+    program->UseProgram(state, frame_width, frame_height);
     glScissor(state.scissor_x_, state.scissor_y_, state.scissor_width_,
               state.scissor_height_);
 
@@ -194,6 +282,57 @@ bool GLRenderer::Draw(const std::vector<RenderState> &render_states,
   return true;
 }
 
+// Binds framebuffer of surface. Shared renderers attach the texture of
+// surface, created by the renderer it shares with, to a framebuffer of
+// their own.
+bool GLRenderer::MakeSurfaceCurrent(NativeSurface *surface) {
+  if (!shared_)
+    return surface->MakeCurrent();
+
+  OverlayBuffer *buffer = surface->GetLayer()->GetBuffer();
+  GLuint texture = buffer ? buffer->GetGpuResource().texture_ : 0;
+  if (!texture) {
+    ETRACE("Surface has no texture to render to.");
+    return false;
+  }
+
+  auto surface_fb = surface_fbs_.find(texture);
+  if (surface_fb != surface_fbs_.end()) {
+    glBindFramebuffer(GL_FRAMEBUFFER, surface_fb->second);
+    return true;
+  }
+
+  GLuint fb = 0;
+  glGenFramebuffers(1, &fb);
+  glBindFramebuffer(GL_FRAMEBUFFER, fb);
+  glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D,
+                         texture, 0);
+  if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+    ETRACE("GL Framebuffer is not complete %d.", texture);
+    glDeleteFramebuffers(1, &fb);
+    return false;
+  }
+
+  surface_fbs_.emplace(texture, fb);
+  return true;
+}
+
+void GLRenderer::ReleaseSharedResources(
+    const std::vector<ResourceHandle> &handles) {
+  if (surface_fbs_.empty())
+    return;
+
+  glBindFramebuffer(GL_FRAMEBUFFER, 0);
+  for (const ResourceHandle &handle : handles) {
+    auto surface_fb = surface_fbs_.find(handle.texture_);
+    if (surface_fb == surface_fbs_.end())
+      continue;
+
+    glDeleteFramebuffers(1, &surface_fb->second);
+    surface_fbs_.erase(surface_fb);
+  }
+}
+
 void GLRenderer::InsertFence(int32_t kms_fence) {
   if (kms_fence > 0) {
     EGLint attrib_list[] = {
@@ -213,23 +352,116 @@ void GLRenderer::SetDisableExplicitSync(bool disable_explicit_sync) {
   disable_explicit_sync_ = disable_explicit_sync;
 }
 
-GLProgram *GLRenderer::GetProgram(unsigned texture_count) {
-  if (programs_.size() >= texture_count) {
-    GLProgram *program = programs_[texture_count - 1].get();
+GLProgram *GLRenderer::GetProgram(unsigned texture_count, bool batched) {
+  std::vector<std::unique_ptr<GLProgram>> &programs =
+      batched ? batched_programs_ : programs_;
+  if (programs.size() >= texture_count) {
+    GLProgram *program = programs[texture_count - 1].get();
     if (program != 0)
       return program;
   }
 
   std::unique_ptr<GLProgram> program(new GLProgram());
-  if (program->Init(texture_count)) {
-    if (programs_.size() < texture_count)
-      programs_.resize(texture_count);
+  if (program->Init(texture_count, batched)) {
+    if (programs.size() < texture_count)
+      programs.resize(texture_count);
 
-    programs_[texture_count - 1] = std::move(program);
-    return programs_[texture_count - 1].get();
+    programs[texture_count - 1] = std::move(program);
+    return programs[texture_count - 1].get();
   }
 
   return 0;
 }
 
+void GLRenderer::BuildBatches(const std::vector<RenderState> &states,
+                              GLuint frame_width, GLuint frame_height) {
+  batches_.clear();
+  state_batch_.assign(states.size(), kNoBatch);
+  for (size_t i = 0; i < states.size(); i++) {
+    const RenderState &state = states[i];
+    size_t size = state.layer_state_.size();
+    if (!size || size > kMaxBatchedLayers)
+      continue;
+
+    size_t batch = 0;
+    while (batch < batches_.size() &&
+           !HasSameLayers(*batches_[batch].state, state)) {
+      batch++;
+    }
+
+    if (batch == batches_.size()) {
+      if (!GetProgram(size, true))
+        continue;
+
+      batches_.emplace_back(Batch{&state, 0, 0});
+    }
+
+    batches_[batch].regions++;
+    state_batch_[i] = batch;
+  }
+
+  size_t total_size = 0;
+  for (Batch &batch : batches_) {
+    batch.offset = total_size;
+    total_size += batch.regions * kVerticesPerRegion *
+                  VertexSize(batch.state->layer_state_.size());
+    // Counted again while writing vertices.
+    batch.regions = 0;
+  }
+
+  vertices_.resize(total_size);
+  for (size_t i = 0; i < states.size(); i++) {
+    if (state_batch_[i] == kNoBatch)
+      continue;
+
+    const RenderState &state = states[i];
+    Batch &batch = batches_[state_batch_[i]];
+    size_t region_size =
+        kVerticesPerRegion * VertexSize(state.layer_state_.size());
+    WriteRegionVertices(
+        state, frame_width, frame_height,
+        vertices_.data() + batch.offset + batch.regions * region_size);
+    batch.regions++;
+  }
+}
+
+void GLRenderer::DrawBatches() {
+  glBindVertexArrayOES(batch_vertex_array_);
+  glBindBuffer(GL_ARRAY_BUFFER, batch_buffer_);
+  glBufferData(GL_ARRAY_BUFFER, vertices_.size() * sizeof(float),
+               vertices_.data(), GL_STREAM_DRAW);
+
+  for (const Batch &batch : batches_) {
+    const RenderState &state = *batch.state;
+    unsigned size = state.layer_state_.size();
+    GLProgram *program = GetProgram(size, true);
+    program->UseBatchedProgram(state);
+
+    GLsizei stride = VertexSize(size) * sizeof(float);
+    for (unsigned attrib = 0; attrib <= size; attrib++) {
+      if (attrib >= batch_attribs_)
+        glEnableVertexAttribArray(attrib);
+
+      size_t offset = (batch.offset + attrib * 2) * sizeof(float);
+      glVertexAttribPointer(attrib, 2, GL_FLOAT, GL_FALSE, stride,
+                            (void *)offset);
+    }
+
+    for (unsigned attrib = size + 1; attrib < batch_attribs_; attrib++) {
+      glDisableVertexAttribArray(attrib);
+    }
+
+    batch_attribs_ = size + 1;
+    glDrawArrays(GL_TRIANGLES, 0, batch.regions * kVerticesPerRegion);
+
+    for (unsigned src_index = 0; src_index < size; src_index++) {
+      glActiveTexture(GL_TEXTURE0 + src_index);
+      glBindTexture(GL_TEXTURE_EXTERNAL_OES, 0);
+    }
+  }
+
+  glBindBuffer(GL_ARRAY_BUFFER, 0);
+  glBindVertexArrayOES(vertex_array_);
+}
+
 }  // namespace hwcomposer
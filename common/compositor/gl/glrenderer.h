@@ -18,6 +18,7 @@
 #define COMMON_COMPOSITOR_GL_GLRENDERER_H_
 
 #include <memory>
+#include <unordered_map>
 #include <vector>
 
 #include "renderer.h"
@@ -33,6 +34,7 @@ class GLRenderer : public Renderer {
   ~GLRenderer();
 
   bool Init() override;
+  bool InitShared(Renderer *share) override;
   bool Draw(const std::vector<RenderState> &commands,
             NativeSurface *surface) override;
 
@@ -40,14 +42,50 @@ class GLRenderer : public Renderer {
 
   void SetDisableExplicitSync(bool disable_explicit_sync) override;
 
+  void ReleaseSharedResources(
+      const std::vector<ResourceHandle> &handles) override;
+
  private:
-  GLProgram *GetProgram(unsigned texture_count);
+  // Regions drawing the same layers. They only differ in which part of
+  // the layers they show, which goes into their vertices, so they are
+  // drawn with a single call.
+  struct Batch {
+    // First region of the batch, its layers are bound for all of them.
+    const RenderState *state;
+    size_t regions;
+    // Offset of vertices of the batch in vertices_, in floats.
+    size_t offset;
+  };
+
+  bool InitContext(EGLContext share_context);
+  bool MakeSurfaceCurrent(NativeSurface *surface);
+  GLProgram *GetProgram(unsigned texture_count, bool batched = false);
+  void BuildBatches(const std::vector<RenderState> &states, GLuint frame_width,
+                    GLuint frame_height);
+  void DrawBatches();
 
   EGLOffScreenContext context_;
 
   std::vector<std::unique_ptr<GLProgram>> programs_;
+  std::vector<std::unique_ptr<GLProgram>> batched_programs_;
+  // Per frame state, kept to re-use storage across frames.
+  std::vector<Batch> batches_;
+  // Index in batches_ of every RenderState, kNoBatch if it's drawn on its
+  // own.
+  std::vector<size_t> state_batch_;
+  std::vector<float> vertices_;
   GLuint vertex_array_ = 0;
+  GLuint batch_vertex_array_ = 0;
+  GLuint batch_buffer_ = 0;
+  // Vertex attribute arrays enabled in batch_vertex_array_.
+  unsigned batch_attribs_ = 0;
   bool disable_explicit_sync_ = false;
+  // Framebuffers aren't shared between contexts, so a shared renderer
+  // can't use the one kept by the surface.
+  bool shared_ = false;
+  // Framebuffers of a shared renderer, by texture of the surface they
+  // render to. Kept till the texture is released.
+  std::unordered_map<GLuint, GLuint> surface_fbs_;
 };
 
 }  // namespace hwcomposer
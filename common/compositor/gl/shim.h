@@ -42,6 +42,7 @@ extern PFNGLDELETEVERTEXARRAYSOESPROC glDeleteVertexArraysOES;
 extern PFNGLGENVERTEXARRAYSOESPROC glGenVertexArraysOES;
 extern PFNGLBINDVERTEXARRAYOESPROC glBindVertexArrayOES;
 extern PFNGLPROGRAMBINARYOESPROC glProgramBinaryOES;
+extern PFNGLGETPROGRAMBINARYOESPROC glGetProgramBinaryOES;
 #ifndef USE_ANDROID_SHIM
 extern PFNEGLDUPNATIVEFENCEFDANDROIDPROC eglDupNativeFenceFDANDROID;
 #endif
@@ -142,15 +142,14 @@ bool NativeSurface::IsSurfaceDamageChanged() const {
 }
 
 void NativeSurface::SetPlaneTarget(const DisplayPlaneState &plane) {
-  HwcRect<int> &current_damage = layer_.GetSurfaceDamage();
-  CalculateRect(layer_.GetDisplayFrame(), current_damage);
-  CalculateRect(plane.GetDisplayFrame(), current_damage);
-  previous_damage_ = current_damage;
-  previous_nc_damage_ = current_damage;
+  layer_.AddSurfaceDamage(layer_.GetDisplayFrame());
+  layer_.AddSurfaceDamage(plane.GetDisplayFrame());
+  previous_damage_ = layer_.GetSurfaceDamageRegion();
   clear_surface_ = kFullClear;
   damage_changed_ = true;
   on_screen_ = false;
   surface_age_ = 0;
+  rendered_frame_ = 0;
   OverlayBuffer *layer_buffer = layer_.GetBuffer();
   if (!layer_buffer || layer_buffer->GetFb() == 0) {
     ETRACE("SetPlaneTarget unable to create framebuffer for nativesurface");
@@ -167,58 +166,53 @@ void NativeSurface::ResetSourceCrop(const HwcRect<float> &source_crop) {
 
 void NativeSurface::UpdateSurfaceDamage(
     const HwcRect<int> &currentsurface_damage, bool force) {
-  HwcRect<int> current_damage = currentsurface_damage;
-  if (current_damage.right > width_) {
-    current_damage.right = width_;
-  }
+  AddSurfaceDamage(&currentsurface_damage, 1, force);
+}
 
-  if (current_damage.bottom > height_) {
-    current_damage.bottom = height_;
-  }
+void NativeSurface::UpdateSurfaceDamage(const HwcRegion &damage, bool force) {
+  AddSurfaceDamage(damage.data(), damage.size(), force);
+}
 
-  HwcRect<int> &surface_damage = layer_.GetSurfaceDamage();
+void NativeSurface::AddSurfaceDamage(const HwcRect<int> *rects, size_t count,
+                                     bool force) {
   if (reset_damage_) {
     reset_damage_ = false;
-    surface_damage.reset();
-  }
-
-  if (surface_damage.empty()) {
-    surface_damage = current_damage;
-    damage_changed_ = true;
-
-    if (!surface_damage.empty()) {
-      CalculateRect(previous_nc_damage_, surface_damage);
-
-      previous_nc_damage_ = current_damage;
-    }
-
-    if (!force && (previous_damage_ == surface_damage))
-      damage_changed_ = false;
-
-    return;
+    layer_.ResetSurfaceDamage();
   }
 
-  CalculateRect(current_damage, previous_nc_damage_);
-
-  if (current_damage == surface_damage) {
-    return;
+  // Damage of earlier frames is added by DisplayPlaneState, depending on
+  // when this surface was last rendered.
+  bool was_empty = layer_.GetSurfaceDamageRegion().empty();
+  bool changed = false;
+  for (size_t i = 0; i < count; i++) {
+    HwcRect<int> current_damage = rects[i];
+    current_damage.right = std::min(current_damage.right, width_);
+    current_damage.bottom = std::min(current_damage.bottom, height_);
+    if (layer_.AddSurfaceDamage(current_damage))
+      changed = true;
   }
 
-  CalculateRect(current_damage, surface_damage);
-
-  if (!damage_changed_) {
+  if (was_empty || (changed && !damage_changed_)) {
     damage_changed_ = true;
-    if (!force && (previous_damage_ == surface_damage))
+    if (!force && (previous_damage_ == layer_.GetSurfaceDamageRegion()))
       damage_changed_ = false;
   }
 }
 
 void NativeSurface::ResetDamage() {
   reset_damage_ = true;
-  previous_damage_ = layer_.GetSurfaceDamage();
+  previous_damage_ = layer_.GetSurfaceDamageRegion();
   damage_changed_ = false;
 }
 
+const HwcRegion &NativeSurface::GetFrameDamage() const {
+  static const HwcRegion kNoDamage;
+  if (reset_damage_)
+    return kNoDamage;
+
+  return layer_.GetSurfaceDamageRegion();
+}
+
 void NativeSurface::InitializeLayer(HWCNativeHandle native_handle) {
   layer_.SetBlending(HWCBlending::kBlendingPremult);
   layer_.SetBuffer(native_handle, -1, resource_manager_, false);
@@ -104,16 +104,46 @@ class NativeSurface {
   void UpdateSurfaceDamage(const HwcRect<int>& currentsurface_damage,
                            bool force);
 
+  // Adds rects of damage to damage of this surface.
+  void UpdateSurfaceDamage(const HwcRegion& damage, bool force);
+
   // Resets damage of this surface to empty.
   void ResetDamage();
 
+  // Drops damage accumulated for the current frame without rendering,
+  // the plane keeps it in its damage history.
+  void ResetFrameDamage() {
+    reset_damage_ = true;
+  }
+
+  // Returns damage accumulated since the last reset, empty if there was
+  // none.
+  const HwcRegion& GetFrameDamage() const;
+
+  // Returns how many frames composed on the plane of this surface ago it
+  // was last rendered, 0 if contents of the surface are undefined.
+  uint64_t GetBufferAge(uint64_t frame) const {
+    return rendered_frame_ ? frame - rendered_frame_ : 0;
+  }
+
+  // Marks surface as rendered for frame of its plane.
+  void SetRenderedFrame(uint64_t frame) {
+    rendered_frame_ = frame;
+  }
+
   // Return's damage area of this surface.
   const HwcRect<int>& GetSurfaceDamage() const {
     return layer_.GetSurfaceDamage();
   }
 
+  // Return's damaged rects of this surface, GetSurfaceDamage() bounds
+  // them.
+  const HwcRegion& GetSurfaceDamageRegion() const {
+    return layer_.GetSurfaceDamageRegion();
+  }
+
   // Return's damage area of this surface.
-  const HwcRect<int>& GetPreviousSurfaceDamage() const {
+  const HwcRegion& GetPreviousSurfaceDamage() const {
     return previous_damage_;
   }
 
@@ -140,6 +170,7 @@ class NativeSurface {
 
  private:
   void InitializeLayer(HWCNativeHandle native_handle);
+  void AddSurfaceDamage(const HwcRect<int>* rects, size_t count, bool force);
   HWCNativeHandle native_handle_;
   int width_;
   int height_;
@@ -149,8 +180,9 @@ class NativeSurface {
   bool reset_damage_ = true;
   uint64_t modifier_ = 0;
   bool on_screen_ = false;
-  HwcRect<int> previous_damage_;
-  HwcRect<int> previous_nc_damage_;
+  HwcRegion previous_damage_;
+  // Frame of the plane this surface was last rendered for, 0 if none.
+  uint64_t rendered_frame_ = 0;
 };
 
 }  // namespace hwcomposer
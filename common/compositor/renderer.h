@@ -22,6 +22,8 @@
 
 #include <vector>
 
+#include "compositordefs.h"
+
 namespace hwcomposer {
 
 class NativeSurface;
@@ -42,11 +44,23 @@ class Renderer {
     return false;
   }
 
+  // Needs to be implemented for 3D Renderer's only. Initializes a
+  // renderer drawing from its own thread with textures of share.
+  virtual bool InitShared(Renderer* /*share*/) {
+    return false;
+  }
+
   virtual bool Draw(const std::vector<RenderState>& /*commands*/,
                     NativeSurface* /*surface*/) {
     return false;
   }
 
+  // Needs to be implemented for shared 3D Renderer's only. Drops state
+  // kept for resources released by the renderer it shares with.
+  virtual void ReleaseSharedResources(
+      const std::vector<ResourceHandle>& /*handles*/) {
+  }
+
   // Needs to be implemented for Media Renderer's only.
   virtual bool Init(int /*gpu_fd*/) {
     return false;
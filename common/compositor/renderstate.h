@@ -74,6 +74,20 @@ struct DrawState {
     }
   }
 
+  // Prepares this state to be re-used for a new frame. Storage of
+  // render states is kept.
+  void Reset() {
+    for (int32_t fence : acquire_fences_) {
+      close(fence);
+    }
+
+    acquire_fences_.clear();
+    media_state_.layers_.clear();
+    surface_ = NULL;
+    destroy_surface_ = false;
+    retire_fence_ = -1;
+  }
+
   std::vector<RenderState> states_;
   MediaState media_state_;
   NativeSurface *surface_;
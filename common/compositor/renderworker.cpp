@@ -0,0 +1,164 @@
+/*
+// Copyright (c) 2017 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+*/
+
+#include "renderworker.h"
+
+#include "factory.h"
+#include "hwctrace.h"
+#include "nativesurface.h"
+#include "overlaylayer.h"
+#include "renderer.h"
+
+namespace hwcomposer {
+
+RenderWorker::RenderWorker() : HWCThread(-8, "RenderWorker") {
+  if (!cevent_.Initialize())
+    return;
+
+  fd_chandler_.AddFd(cevent_.get_fd());
+}
+
+RenderWorker::~RenderWorker() {
+}
+
+bool RenderWorker::Initialize(Renderer *share) {
+  tasks_lock_.lock();
+  share_ = share;
+  tasks_ |= kInit;
+  tasks_lock_.unlock();
+  if (!InitWorker()) {
+    ETRACE("Failed to initalize RenderWorker. %s", PRINTERROR());
+    return false;
+  }
+
+  // The context has to be created and made current on the thread using it.
+  Resume();
+  WaitForSignal();
+  return succeeded_;
+}
+
+void RenderWorker::Draw(const std::vector<DrawState *> &states,
+                        bool disable_explicit_sync) {
+  tasks_lock_.lock();
+  states_ = states;
+  disable_explicit_sync_ = disable_explicit_sync;
+  tasks_ |= kRender;
+  tasks_lock_.unlock();
+  Resume();
+}
+
+void RenderWorker::ReleaseResources(
+    const std::vector<ResourceHandle> &handles) {
+  tasks_lock_.lock();
+  released_.insert(released_.end(), handles.begin(), handles.end());
+  tasks_lock_.unlock();
+}
+
+bool RenderWorker::Wait() {
+  WaitForSignal();
+  return succeeded_;
+}
+
+void RenderWorker::WaitForSignal() {
+  if (fd_chandler_.Poll(-1) <= 0) {
+    ETRACE("Poll Failed in RenderWorker %s", PRINTERROR());
+    return;
+  }
+
+  if (fd_chandler_.IsReady(cevent_.get_fd())) {
+    // If eventfd_ is ready, we need to wait on it (using read()) to clean
+    // the flag that says it is ready.
+    cevent_.Wait();
+  }
+}
+
+void RenderWorker::ExitThread() {
+  HWCThread::Exit();
+  std::vector<DrawState *>().swap(states_);
+}
+
+void RenderWorker::HandleExit() {
+  renderer_.reset(nullptr);
+}
+
+void RenderWorker::HandleRoutine() {
+  std::vector<ResourceHandle> released;
+  tasks_lock_.lock();
+  uint32_t tasks = tasks_;
+  tasks_ = kNone;
+  if (tasks & kRender)
+    released.swap(released_);
+  tasks_lock_.unlock();
+
+  if (tasks & kInit) {
+    renderer_.reset(Create3DRenderer());
+    succeeded_ = renderer_ && renderer_->InitShared(share_);
+    if (!succeeded_) {
+      ETRACE("Failed to initialize shared renderer %s", PRINTERROR());
+      renderer_.reset(nullptr);
+    }
+  }
+
+  if (tasks & kRender) {
+    succeeded_ = renderer_ != NULL;
+    if (renderer_) {
+      // Names of released textures can already have been re-used.
+      if (!released.empty())
+        renderer_->ReleaseSharedResources(released);
+
+      renderer_->SetDisableExplicitSync(disable_explicit_sync_);
+      for (DrawState *draw_state : states_) {
+        if (!Render(renderer_.get(), *draw_state)) {
+          succeeded_ = false;
+          break;
+        }
+      }
+
+      if (disable_explicit_sync_)
+        renderer_->InsertFence(-1);
+    }
+  }
+
+  if (tasks)
+    cevent_.Signal();
+}
+
+bool RenderWorker::Render(Renderer *renderer, DrawState &draw_state) {
+  const std::vector<int32_t> &fences = draw_state.acquire_fences_;
+  for (int32_t fence : fences) {
+    renderer->InsertFence(fence);
+  }
+
+  draw_state.acquire_fences_.clear();
+
+  if (!renderer->Draw(draw_state.states_, draw_state.surface_)) {
+    ETRACE(
+        "Failed to Draw: "
+        "error: %s",
+        PRINTERROR());
+    return false;
+  }
+
+  if (draw_state.destroy_surface_) {
+    draw_state.retire_fence_ =
+        draw_state.surface_->GetLayer()->ReleaseAcquireFence();
+    delete draw_state.surface_;
+  }
+
+  return true;
+}
+
+}  // namespace hwcomposer
@@ -0,0 +1,88 @@
+/*
+// Copyright (c) 2017 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+*/
+
+#ifndef COMMON_COMPOSITOR_RENDERWORKER_H_
+#define COMMON_COMPOSITOR_RENDERWORKER_H_
+
+#include <spinlock.h>
+
+#include <memory>
+#include <vector>
+
+#include "compositordefs.h"
+#include "hwcthread.h"
+#include "renderstate.h"
+
+#include "fdhandler.h"
+#include "hwcevent.h"
+
+namespace hwcomposer {
+
+class Renderer;
+
+// Renders DrawStates on a 3D renderer of its own, sharing textures with
+// the renderer of CompositorThread. Lets CompositorThread compose several
+// offscreen planes of a frame in parallel.
+class RenderWorker : public HWCThread {
+ public:
+  RenderWorker();
+  ~RenderWorker() override;
+
+  // Starts the thread and creates its renderer sharing with share. Returns
+  // false if the renderer couldn't be created.
+  bool Initialize(Renderer* share);
+
+  // Starts rendering states, which need to stay valid till Wait returns.
+  void Draw(const std::vector<DrawState*>& states, bool disable_explicit_sync);
+
+  // Waits for states passed to Draw to be submitted. Returns false if any
+  // of them failed.
+  bool Wait();
+
+  // Tells the renderer about resources released by the renderer it shares
+  // with, before it draws again.
+  void ReleaseResources(const std::vector<ResourceHandle>& handles);
+
+  void HandleRoutine() override;
+  void HandleExit() override;
+  void ExitThread();
+
+  // Inserts acquire fences of draw_state and renders it with renderer.
+  static bool Render(Renderer* renderer, DrawState& draw_state);
+
+ private:
+  enum Tasks {
+    kNone = 0,         // No tasks
+    kInit = 1 << 1,    // Create renderer.
+    kRender = 1 << 2,  // Render states_.
+  };
+
+  void WaitForSignal();
+
+  SpinLock tasks_lock_;
+  std::unique_ptr<Renderer> renderer_;
+  Renderer* share_ = NULL;
+  std::vector<DrawState*> states_;
+  std::vector<ResourceHandle> released_;
+  bool disable_explicit_sync_ = false;
+  bool succeeded_ = false;
+  uint32_t tasks_ = kNone;
+  FDHandler fd_chandler_;
+  HWCEvent cevent_;
+};
+
+}  // namespace hwcomposer
+#endif  // COMMON_COMPOSITOR_RENDERWORKER_H_
@@ -24,7 +24,9 @@ bool NativeVKResource::PrepareResources(
     const std::vector<OverlayBuffer*>& buffers) {
   VkResult res;
 
-  Reset();
+  src_image_views_.clear();
+  src_barrier_before_clear_.clear();
+  layer_textures_.clear();
 
   VkImageSubresourceRange clear_range = {};
   clear_range.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
@@ -37,8 +39,6 @@ bool NativeVKResource::PrepareResources(
       ETRACE("Failed to make import image\n");
       return false;
     }
-    src_images_.emplace_back(import.image_);
-    src_image_memory_.emplace_back(import.memory_);
 
     VkImageMemoryBarrier barrier = {};
     barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
@@ -52,59 +52,70 @@ bool NativeVKResource::PrepareResources(
     barrier.subresourceRange = clear_range;
     src_barrier_before_clear_.emplace_back(barrier);
 
-    VkImageViewCreateInfo view_create = {};
-    view_create.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
-    view_create.image = import.image_;
-    view_create.viewType = VK_IMAGE_VIEW_TYPE_2D;
-    view_create.format = NativeToVkFormat(buffer->GetFormat());
-    view_create.components = {};
-    view_create.components.r = VK_COMPONENT_SWIZZLE_R;
-    view_create.components.g = VK_COMPONENT_SWIZZLE_G;
-    view_create.components.b = VK_COMPONENT_SWIZZLE_B;
-    view_create.components.a = VK_COMPONENT_SWIZZLE_A;
-    view_create.subresourceRange = {};
-    view_create.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-    view_create.subresourceRange.levelCount = 1;
-    view_create.subresourceRange.layerCount = 1;
-
-    VkImageView image_view;
-    res = vkCreateImageView(dev_, &view_create, NULL, &image_view);
-    if (res != VK_SUCCESS) {
-      ETRACE("vkCreateImageView failed (%d)\n", res);
-      return false;
+    // Image and memory are destroyed along with the view, once the
+    // buffer is released.
+    ImportedImage& imported = imported_images_[import.image_];
+    imported.memory = import.memory_;
+    if (imported.view == VK_NULL_HANDLE) {
+      VkImageViewCreateInfo view_create = {};
+      view_create.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+      view_create.image = import.image_;
+      view_create.viewType = VK_IMAGE_VIEW_TYPE_2D;
+      view_create.format = NativeToVkFormat(buffer->GetFormat());
+      view_create.components = {};
+      view_create.components.r = VK_COMPONENT_SWIZZLE_R;
+      view_create.components.g = VK_COMPONENT_SWIZZLE_G;
+      view_create.components.b = VK_COMPONENT_SWIZZLE_B;
+      view_create.components.a = VK_COMPONENT_SWIZZLE_A;
+      view_create.subresourceRange = {};
+      view_create.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+      view_create.subresourceRange.levelCount = 1;
+      view_create.subresourceRange.layerCount = 1;
+
+      res = vkCreateImageView(dev_, &view_create, NULL, &imported.view);
+      if (res != VK_SUCCESS) {
+        ETRACE("vkCreateImageView failed (%d)\n", res);
+        imported.view = VK_NULL_HANDLE;
+        return false;
+      }
     }
-    src_image_views_.emplace_back(image_view);
+    src_image_views_.emplace_back(imported.view);
 
     struct vk_resource resource;
     resource.image = import.image_;
-    resource.image_view = image_view;
+    resource.image_view = imported.view;
     layer_textures_.emplace_back(resource);
   }
   return true;
 }
 
 NativeVKResource::~NativeVKResource() {
-  Reset();
+  for (auto& imported : imported_images_) {
+    DestroyImage(imported.first, imported.second);
+  }
 }
 
-void NativeVKResource::Reset() {
-  for (auto& image_view : src_image_views_) {
-    vkDestroyImageView(dev_, image_view, NULL);
-  }
-  src_image_views_.clear();
+void NativeVKResource::ReleaseGPUResources(
+    const std::vector<ResourceHandle>& handles) {
+  for (const ResourceHandle& handle : handles) {
+    auto imported = imported_images_.find(handle.image_);
+    if (imported == imported_images_.end())
+      continue;
 
-  for (auto& image : src_images_) {
-    vkDestroyImage(dev_, image, NULL);
+    DestroyImage(imported->first, imported->second);
+    imported_images_.erase(imported);
   }
-  src_images_.clear();
+}
 
-  for (auto& memory : src_image_memory_) {
-    vkFreeMemory(dev_, memory, NULL);
+void NativeVKResource::DestroyImage(VkImage image,
+                                    const ImportedImage& imported) {
+  if (imported.view != VK_NULL_HANDLE) {
+    vkDestroyImageView(dev_, imported.view, NULL);
+    released_handles_.emplace_back((uint64_t)imported.view);
   }
-  src_image_memory_.clear();
 
-  src_barrier_before_clear_.clear();
-  layer_textures_.clear();
+  vkDestroyImage(dev_, image, NULL);
+  vkFreeMemory(dev_, imported.memory, NULL);
 }
 
 GpuResourceHandle NativeVKResource::GetResourceHandle(
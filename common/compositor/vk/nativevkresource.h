@@ -15,6 +15,8 @@
 #ifndef NATIVE_VK_RESOURCE_H_
 #define NATIVE_VK_RESOURCE_H_
 
+#include <unordered_map>
+
 #include "nativegpuresource.h"
 #include "vkshim.h"
 
@@ -30,13 +32,19 @@ class NativeVKResource : public NativeGpuResource {
   bool PrepareResources(const std::vector<OverlayBuffer*>& buffers) override;
   GpuResourceHandle GetResourceHandle(uint32_t layer_index) const override;
   void ReleaseGPUResources(
-      const std::vector<ResourceHandle>& handles) override {
-  }
+      const std::vector<ResourceHandle>& handles) override;
 
  private:
-  void Reset();
+  // Layer buffer imported for composition. The view is kept till the
+  // buffer is released, so that commands recorded with it stay valid.
+  struct ImportedImage {
+    VkImageView view = VK_NULL_HANDLE;
+    VkDeviceMemory memory = VK_NULL_HANDLE;
+  };
+
+  void DestroyImage(VkImage image, const ImportedImage& imported);
   std::vector<struct vk_resource> layer_textures_;
-  std::vector<VkDeviceMemory> src_image_memory_;
+  std::unordered_map<VkImage, ImportedImage> imported_images_;
 };
 
 }  // namespace hwcomposer
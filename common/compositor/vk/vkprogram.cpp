@@ -210,19 +210,20 @@ bool VKProgram::Init(unsigned layer_index) {
   return true;
 }
 
-void VKProgram::UseProgram(const RenderState &state,
-                           unsigned int viewport_width,
-                           unsigned int viewport_height) {
-  unsigned layer_count = state.layer_state_.size();
+// Uniform data sizes in floats.
+static size_t VertUBSize(unsigned layer_count) {
+  return 4 + 12 * layer_count;
+}
 
-  size_t vert_ub_size = 4 + 12 * layer_count;
-  RingBuffer::Allocation vert_ub_alloc =
-      ring_buffer_.Allocate(vert_ub_size * sizeof(float), ub_offset_align_);
-  if (!vert_ub_alloc) {
-    ETRACE("Failed to allocate space for vert uniform buffer");
-    return;
-  }
-  float *vert_ub = vert_ub_alloc.get<float>();
+static size_t FragUBSize(unsigned layer_count) {
+  return 4 * layer_count;
+}
+
+void VKProgram::WriteUniforms(const RenderState &state,
+                              unsigned int viewport_width,
+                              unsigned int viewport_height, float *vert_ub,
+                              float *frag_ub) {
+  unsigned layer_count = state.layer_state_.size();
 
   vert_ub[0] = state.x_ / (float)viewport_width;
   vert_ub[1] = state.y_ / (float)viewport_height;
@@ -245,20 +246,36 @@ void VKProgram::UseProgram(const RenderState &state,
     vert_ub += 4;  // 2 data + 2 padding
   }
 
-  size_t frag_ub_size = 4 * layer_count;
+  for (unsigned src_index = 0; src_index < layer_count; src_index++) {
+    frag_ub[0] = state.layer_state_[src_index].alpha_;
+    frag_ub[1] = state.layer_state_[src_index].premult_;
+    frag_ub += 4;  // 2 data + 2 padding
+  }
+}
+
+bool VKProgram::UseProgram(const RenderState &state,
+                           unsigned int viewport_width,
+                           unsigned int viewport_height) {
+  unsigned layer_count = state.layer_state_.size();
+
+  size_t vert_ub_size = VertUBSize(layer_count);
+  RingBuffer::Allocation vert_ub_alloc =
+      ring_buffer_.Allocate(vert_ub_size * sizeof(float), ub_offset_align_);
+  if (!vert_ub_alloc) {
+    ETRACE("Failed to allocate space for vert uniform buffer");
+    return false;
+  }
+
+  size_t frag_ub_size = FragUBSize(layer_count);
   RingBuffer::Allocation frag_ub_alloc =
       ring_buffer_.Allocate(frag_ub_size * sizeof(float), ub_offset_align_);
   if (!frag_ub_alloc) {
     ETRACE("failed to allocate space for frag uniform buffer");
-    return;
+    return false;
   }
-  float *frag_ub = frag_ub_alloc.get<float>();
 
-  for (unsigned src_index = 0; src_index < layer_count; src_index++) {
-    frag_ub[0] = state.layer_state_[src_index].alpha_;
-    frag_ub[1] = state.layer_state_[src_index].premult_;
-    frag_ub += 4;  // 2 data + 2 padding
-  }
+  WriteUniforms(state, viewport_width, viewport_height,
+                vert_ub_alloc.get<float>(), frag_ub_alloc.get<float>());
 
   vert_buf_info_ = {};
   vert_buf_info_.buffer = uniform_buffer_;
@@ -282,6 +299,7 @@ void VKProgram::UseProgram(const RenderState &state,
 
   ub_allocs_.emplace_back(std::move(vert_ub_alloc));
   ub_allocs_.emplace_back(std::move(frag_ub_alloc));
+  return true;
 }
 
 }  // namespace hwcomposer
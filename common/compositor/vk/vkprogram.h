@@ -38,9 +38,16 @@ class VKProgram {
   ~VKProgram();
 
   bool Init(unsigned layer_index);
-  void UseProgram(const RenderState& cmd, unsigned int viewport_width,
+  bool UseProgram(const RenderState& cmd, unsigned int viewport_width,
                   unsigned int viewport_height);
 
+  // Writes uniform data of cmd, sized for UseProgram, to vert_ub and
+  // frag_ub. Lets recorded commands be resubmitted with new layer state.
+  static void WriteUniforms(const RenderState& cmd,
+                            unsigned int viewport_width,
+                            unsigned int viewport_height, float* vert_ub,
+                            float* frag_ub);
+
   VkDescriptorSetLayout getDescLayout() {
     return descriptor_set_layout_;
   }
@@ -15,13 +15,49 @@
 #include "vkrenderer.h"
 #include "vkprogram.h"
 
+#ifdef SHADER_CACHE_PATH
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include <algorithm>
+#include <string>
+
 #include "hwctrace.h"
 #include "nativesurface.h"
 #include "renderstate.h"
 
 namespace hwcomposer {
 
+// Recorded frames kept per surface, enough for a surface cycling through
+// its buffers, and in total.
+static const size_t kRecordedFramesPerSurface = 3;
+static const size_t kMaxRecordedFrames = 8;
+
+#ifdef SHADER_CACHE_PATH
+static const char kPipelineCachePath[] =
+    SHADER_CACHE_PATH "/hwc_vk_pipeline_cache.bin";
+/* 10MB limit, same as for GL program binaries */
+static const long kPipelineCacheSizeLimit = 10485760;
+
+// Header the driver puts in front of pipeline cache data, layout of
+// VK_PIPELINE_CACHE_HEADER_VERSION_ONE.
+struct PipelineCacheHeader {
+  uint32_t length;
+  uint32_t version;
+  uint32_t vendor_id;
+  uint32_t device_id;
+  uint8_t uuid[VK_UUID_SIZE];
+};
+#endif
+
 VKRenderer::~VKRenderer() {
+  for (RecordedFrame &frame : recorded_frames_) {
+    ReleaseFrame(&frame);
+  }
 }
 
 VKAPI_ATTR VkBool32 VKAPI_CALL VulkanDebugReportCallback(
@@ -451,8 +487,14 @@ bool VKRenderer::Init() {
     return false;
   }
 
+  std::vector<uint8_t> pipeline_cache_data;
+  LoadPipelineCache(&pipeline_cache_data);
+  pipeline_cache_size_ = pipeline_cache_data.size();
+
   VkPipelineCacheCreateInfo pipeline_cache_create = {};
   pipeline_cache_create.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+  pipeline_cache_create.initialDataSize = pipeline_cache_data.size();
+  pipeline_cache_create.pInitialData = pipeline_cache_data.data();
 
   res = vkCreatePipelineCache(dev_, &pipeline_cache_create, NULL,
                               &pipeline_cache_);
@@ -461,9 +503,88 @@ bool VKRenderer::Init() {
     return false;
   }
 
+  // Pipelines for the common layer counts, so that the first frames do
+  // not wait for them.
+  for (unsigned i = 1; i < 5; i++) {
+    GetProgram(i);
+  }
+
+  recorded_frames_.reserve(kMaxRecordedFrames);
+
   return true;
 }
 
+void VKRenderer::LoadPipelineCache(std::vector<uint8_t> *data) {
+#ifdef SHADER_CACHE_PATH
+  FILE *fp = fopen(kPipelineCachePath, "rb");
+  if (!fp)
+    return;
+
+  fseek(fp, 0, SEEK_END);
+  long size = ftell(fp);
+  rewind(fp);
+  if (size > static_cast<long>(sizeof(PipelineCacheHeader)) &&
+      size <= kPipelineCacheSizeLimit) {
+    data->resize(size);
+    if (fread(data->data(), 1, size, fp) != static_cast<size_t>(size))
+      data->clear();
+  }
+
+  fclose(fp);
+  if (data->empty())
+    return;
+
+  // Data written for another device or driver would be ignored anyway.
+  PipelineCacheHeader header;
+  memcpy(&header, data->data(), sizeof(header));
+  if (header.version != VK_PIPELINE_CACHE_HEADER_VERSION_ONE ||
+      header.vendor_id != device_props_.vendorID ||
+      header.device_id != device_props_.deviceID ||
+      memcmp(header.uuid, device_props_.pipelineCacheUUID, VK_UUID_SIZE)) {
+    ITRACE("Discarding pipeline cache of another device or driver\n");
+    data->clear();
+  }
+#endif
+}
+
+// Only writes the cache when pipelines were added to it since it was
+// loaded or last saved.
+void VKRenderer::SavePipelineCache() {
+#ifdef SHADER_CACHE_PATH
+  size_t size = 0;
+  VkResult res = vkGetPipelineCacheData(dev_, pipeline_cache_, &size, NULL);
+  if (res != VK_SUCCESS || size == 0 || size == pipeline_cache_size_)
+    return;
+
+  std::vector<uint8_t> data(size);
+  res = vkGetPipelineCacheData(dev_, pipeline_cache_, &size, data.data());
+  if (res != VK_SUCCESS) {
+    ETRACE("vkGetPipelineCacheData failed (%d)\n", res);
+    return;
+  }
+
+  // Written to a temporary file and renamed, so a partial file is never
+  // loaded.
+  mkdir(SHADER_CACHE_PATH, 0755);
+  std::string temp_path = std::string(kPipelineCachePath) + ".XXXXXX";
+  int fd = mkstemp(&temp_path.front());
+  if (fd < 0)
+    return;
+
+  bool written = write(fd, data.data(), size) == static_cast<ssize_t>(size);
+  if (close(fd) != 0)
+    written = false;
+
+  if (!written || rename(temp_path.c_str(), kPipelineCachePath) != 0) {
+    ETRACE("Failed to write pipeline cache %s\n", kPipelineCachePath);
+    unlink(temp_path.c_str());
+    return;
+  }
+
+  pipeline_cache_size_ = size;
+#endif
+}
+
 bool VKRenderer::Draw(const std::vector<RenderState> &render_states,
                       NativeSurface *surface) {
   VkResult res;
@@ -473,10 +594,128 @@ bool VKRenderer::Draw(const std::vector<RenderState> &render_states,
   surface->GetLayer()->SetProtected(false);
   surface->MakeCurrent();
 
+  // Everything recorded commands depend on, other than uniform data.
+  frame_structure_.clear();
+  frame_structure_.emplace_back((uint64_t)framebuffer_);
+  frame_structure_.emplace_back(frame_width);
+  frame_structure_.emplace_back(frame_height);
+  for (VkImageView view : src_image_views_) {
+    frame_structure_.emplace_back((uint64_t)view);
+  }
+
+  for (const RenderState &state : render_states) {
+    frame_structure_.emplace_back(state.layer_state_.size());
+    frame_structure_.emplace_back(state.x_);
+    frame_structure_.emplace_back(state.y_);
+    frame_structure_.emplace_back(state.width_);
+    frame_structure_.emplace_back(state.height_);
+    for (const RenderState::LayerState &layer : state.layer_state_) {
+      frame_structure_.emplace_back((uint64_t)layer.handle_.image_view);
+    }
+  }
+
+  // Commands recorded with destroyed views or framebuffers cannot be
+  // submitted again.
+  if (!released_handles_.empty()) {
+    for (RecordedFrame &recorded : recorded_frames_) {
+      for (uint64_t handle : released_handles_) {
+        if (std::find(recorded.structure.begin(), recorded.structure.end(),
+                      handle) != recorded.structure.end()) {
+          ReleaseFrame(&recorded);
+          break;
+        }
+      }
+    }
+    released_handles_.clear();
+  }
+
+  RecordedFrame *frame = GetRecordedFrame(surface);
+  if (frame->structure == frame_structure_) {
+    for (size_t cmd_index = 0; cmd_index < frame->desc_sets.size();
+         cmd_index++) {
+      float *vert_ub = frame->ub_allocs[cmd_index * 2].get<float>();
+      float *frag_ub = frame->ub_allocs[cmd_index * 2 + 1].get<float>();
+      VKProgram::WriteUniforms(render_states[cmd_index], frame_width,
+                               frame_height, vert_ub, frag_ub);
+    }
+  } else {
+    ReleaseFrame(frame);
+    if (!RecordFrame(render_states, frame_width, frame_height, frame)) {
+      // Other recorded frames may hold the uniform and descriptor space
+      // needed.
+      for (RecordedFrame &recorded : recorded_frames_) {
+        ReleaseFrame(&recorded);
+      }
+
+      if (!RecordFrame(render_states, frame_width, frame_height, frame)) {
+        ReleaseFrame(frame);
+        return false;
+      }
+    }
+
+    frame->structure = frame_structure_;
+  }
+
+  frame->last_used = ++frame_count_;
+
+  VkSubmitInfo submit = {};
+  submit.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+  submit.commandBufferCount = 1;
+  submit.pCommandBuffers = &frame->cmd_buffer;
+
+  res = vkQueueSubmit(queue_, 1, &submit, VK_NULL_HANDLE);
+  if (res != VK_SUCCESS) {
+    ETRACE("%d: vkQueueSubmit failed (%d)\n", __LINE__, res);
+    return false;
+  }
+
+  res = vkQueueWaitIdle(queue_);
+  if (res != VK_SUCCESS) {
+    ETRACE("vkQueueWaitIdle failed (%d)\n", res);
+    return false;
+  }
+
+  return true;
+}
+
+VKRenderer::RecordedFrame *VKRenderer::GetRecordedFrame(
+    NativeSurface *surface) {
+  RecordedFrame *oldest = NULL;
+  RecordedFrame *oldest_of_surface = NULL;
+  size_t surface_frames = 0;
+  for (RecordedFrame &frame : recorded_frames_) {
+    if (frame.surface == surface) {
+      if (frame.structure == frame_structure_)
+        return &frame;
+
+      surface_frames++;
+      if (!oldest_of_surface || frame.last_used < oldest_of_surface->last_used)
+        oldest_of_surface = &frame;
+    }
+
+    if (!oldest || frame.last_used < oldest->last_used)
+      oldest = &frame;
+  }
+
+  if (surface_frames >= kRecordedFramesPerSurface)
+    return oldest_of_surface;
+
+  if (recorded_frames_.size() < kMaxRecordedFrames) {
+    recorded_frames_.emplace_back();
+    oldest = &recorded_frames_.back();
+  }
+
+  oldest->surface = surface;
+  return oldest;
+}
+
+bool VKRenderer::RecordFrame(const std::vector<RenderState> &render_states,
+                             uint32_t frame_width, uint32_t frame_height,
+                             RecordedFrame *frame) {
+  VkResult res;
   src_image_infos_.clear();
   ub_allocs_.clear();
   std::vector<VkDescriptorSetLayout> desc_layouts;
-  std::vector<VkDescriptorSet> desc_sets(render_states.size());
   std::vector<VkDescriptorBufferInfo> ub_infos;
   for (const RenderState &state : render_states) {
     unsigned size = state.layer_state_.size();
@@ -485,34 +724,44 @@ bool VKRenderer::Draw(const std::vector<RenderState> &render_states,
 
     VKProgram *program = GetProgram(size);
     if (!program)
-      continue;
+      return false;
 
     desc_layouts.emplace_back(program->getDescLayout());
 
-    program->UseProgram(state, frame_width, frame_height);
+    if (!program->UseProgram(state, frame_width, frame_height)) {
+      ub_allocs_.clear();
+      return false;
+    }
 
     ub_infos.emplace_back(program->getVertUBInfo());
     ub_infos.emplace_back(program->getFragUBInfo());
   }
 
+  size_t state_count = desc_layouts.size();
+  frame->ub_allocs = std::move(ub_allocs_);
+  ub_allocs_.clear();
+
   VkDescriptorSetAllocateInfo alloc_desc_set = {};
   alloc_desc_set.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
   alloc_desc_set.descriptorPool = desc_pool_;
-  alloc_desc_set.descriptorSetCount = (uint32_t)desc_layouts.size();
+  alloc_desc_set.descriptorSetCount = (uint32_t)state_count;
   alloc_desc_set.pSetLayouts = desc_layouts.data();
 
-  res = vkAllocateDescriptorSets(dev_, &alloc_desc_set, desc_sets.data());
+  frame->desc_sets.resize(state_count);
+  res = vkAllocateDescriptorSets(dev_, &alloc_desc_set,
+                                 frame->desc_sets.data());
   if (res != VK_SUCCESS) {
     ETRACE("vkAllocateDescriptorSets failed (%d)\n", res);
+    frame->desc_sets.clear();
     return false;
   }
 
   std::vector<VkWriteDescriptorSet> write_desc_sets;
   size_t src_image_infos_offset = 0;
-  for (size_t cmd_index = 0; cmd_index < render_states.size(); cmd_index++) {
+  for (size_t cmd_index = 0; cmd_index < state_count; cmd_index++) {
     const RenderState &state = render_states[cmd_index];
     size_t layer_count = state.layer_state_.size();
-    VkDescriptorSet desc_set = desc_sets[cmd_index];
+    VkDescriptorSet desc_set = frame->desc_sets[cmd_index];
 
     VkWriteDescriptorSet write_desc_set = {};
     write_desc_set.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
@@ -552,16 +801,18 @@ bool VKRenderer::Draw(const std::vector<RenderState> &render_states,
   cmd_buffer_alloc.commandPool = cmd_pool_;
   cmd_buffer_alloc.commandBufferCount = 1;
 
-  VkCommandBuffer cmd_buffer;
-  res = vkAllocateCommandBuffers(dev_, &cmd_buffer_alloc, &cmd_buffer);
+  res = vkAllocateCommandBuffers(dev_, &cmd_buffer_alloc, &frame->cmd_buffer);
   if (res != VK_SUCCESS) {
     ETRACE("vkAllocateCommandBuffer failed (%d)\n", res);
+    frame->cmd_buffer = VK_NULL_HANDLE;
     return false;
   }
 
+  VkCommandBuffer cmd_buffer = frame->cmd_buffer;
+
+  // Submitted again for every frame with the same structure.
   VkCommandBufferBeginInfo begin_info = {};
   begin_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
-  begin_info.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
 
   res = vkBeginCommandBuffer(cmd_buffer, &begin_info);
   if (res != VK_SUCCESS) {
@@ -616,10 +867,10 @@ bool VKRenderer::Draw(const std::vector<RenderState> &render_states,
   vkCmdBindVertexBuffers(cmd_buffer, 0, 1, &vert_buffer_, &zero_offset);
 
   size_t last_layer_count = 0;
-  for (size_t cmd_index = 0; cmd_index < render_states.size(); cmd_index++) {
+  for (size_t cmd_index = 0; cmd_index < state_count; cmd_index++) {
     const RenderState &state = render_states[cmd_index];
     size_t layer_count = state.layer_state_.size();
-    VkDescriptorSet desc_set = desc_sets[cmd_index];
+    VkDescriptorSet desc_set = frame->desc_sets[cmd_index];
 
     VkRect2D scissor = {};
     scissor.offset = {
@@ -653,33 +904,26 @@ bool VKRenderer::Draw(const std::vector<RenderState> &render_states,
     return false;
   }
 
-  VkSubmitInfo submit = {};
-  submit.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
-  submit.commandBufferCount = 1;
-  submit.pCommandBuffers = &cmd_buffer;
-
-  res = vkQueueSubmit(queue_, 1, &submit, VK_NULL_HANDLE);
-  if (res != VK_SUCCESS) {
-    ETRACE("%d: vkQueueSubmit failed (%d)\n", __LINE__, res);
-    return false;
-  }
+  return true;
+}
 
-  res = vkQueueWaitIdle(queue_);
-  if (res != VK_SUCCESS) {
-    ETRACE("vkQueueWaitIdle failed (%d)\n", res);
-    return false;
+void VKRenderer::ReleaseFrame(RecordedFrame *frame) {
+  if (frame->cmd_buffer != VK_NULL_HANDLE) {
+    vkFreeCommandBuffers(dev_, cmd_pool_, 1, &frame->cmd_buffer);
+    frame->cmd_buffer = VK_NULL_HANDLE;
   }
 
-  vkFreeCommandBuffers(dev_, cmd_pool_, 1, &cmd_buffer);
+  if (!frame->desc_sets.empty()) {
+    VkResult res = vkFreeDescriptorSets(
+        dev_, desc_pool_, frame->desc_sets.size(), frame->desc_sets.data());
+    if (res != VK_SUCCESS)
+      ETRACE("vkFreeDescriptorSets failed (%d)\n", res);
 
-  res = vkFreeDescriptorSets(dev_, desc_pool_, desc_sets.size(),
-                             desc_sets.data());
-  if (res != VK_SUCCESS) {
-    ETRACE("vkFreeDescriptorSets failed (%d)\n", res);
-    return false;
+    frame->desc_sets.clear();
   }
 
-  return true;
+  frame->ub_allocs.clear();
+  frame->structure.clear();
 }
 
 void VKRenderer::InsertFence(int32_t kms_fence) {
@@ -701,6 +945,7 @@ VKProgram *VKRenderer::GetProgram(unsigned texture_count) {
       programs_.resize(texture_count);
 
     programs_[texture_count - 1] = std::move(program);
+    SavePipelineCache();
     return programs_[texture_count - 1].get();
   }
 
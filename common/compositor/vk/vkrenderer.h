@@ -35,7 +35,25 @@ class VKRenderer : public Renderer {
   void SetDisableExplicitSync(bool disable_explicit_sync) override;
 
  private:
+  // Commands recorded for a surface, resubmitted with fresh uniform data
+  // while the structure of the frame drawn to it stays the same.
+  struct RecordedFrame {
+    NativeSurface *surface = NULL;
+    std::vector<uint64_t> structure;
+    VkCommandBuffer cmd_buffer = VK_NULL_HANDLE;
+    std::vector<VkDescriptorSet> desc_sets;
+    std::vector<RingBuffer::Allocation> ub_allocs;
+    uint64_t last_used = 0;
+  };
+
   VKProgram *GetProgram(unsigned texture_count);
+  void LoadPipelineCache(std::vector<uint8_t> *data);
+  void SavePipelineCache();
+  RecordedFrame *GetRecordedFrame(NativeSurface *surface);
+  bool RecordFrame(const std::vector<RenderState> &commands,
+                   uint32_t frame_width, uint32_t frame_height,
+                   RecordedFrame *frame);
+  void ReleaseFrame(RecordedFrame *frame);
   uint32_t GetMemoryTypeIndex(uint32_t mem_type_bits, uint32_t required_props);
   VkBuffer UploadBuffer(size_t data_size, const uint8_t *data,
                         VkBufferUsageFlags usage);
@@ -49,6 +67,10 @@ class VKRenderer : public Renderer {
   VkBuffer vert_buffer_;
 
   std::vector<std::unique_ptr<VKProgram>> programs_;
+  std::vector<RecordedFrame> recorded_frames_;
+  std::vector<uint64_t> frame_structure_;
+  uint64_t frame_count_ = 0;
+  size_t pipeline_cache_size_ = 0;
 };
 
 }  // namespace hwcomposer
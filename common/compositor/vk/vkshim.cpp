@@ -24,7 +24,6 @@ VkRenderPass render_pass_;
 VkPipelineCache pipeline_cache_;
 VkBuffer uniform_buffer_;
 VkSampler sampler_;
-std::vector<VkImage> src_images_;
 std::vector<VkImageView> src_image_views_;
 std::vector<VkDescriptorImageInfo> src_image_infos_;
 RingBuffer ring_buffer_;
@@ -33,6 +32,7 @@ size_t ub_offset_align_;
 std::vector<VkImageMemoryBarrier> src_barrier_before_clear_;
 VkImageMemoryBarrier dst_barrier_before_clear_;
 VkFramebuffer framebuffer_;
+std::vector<uint64_t> released_handles_;
 
 RingBuffer::Allocation RingBuffer::Allocate(size_t size, size_t alignment) {
   if (size > buffer_size_)
@@ -131,7 +131,6 @@ extern VkRenderPass render_pass_;
 extern VkPipelineCache pipeline_cache_;
 extern VkBuffer uniform_buffer_;
 extern VkSampler sampler_;
-extern std::vector<VkImage> src_images_;
 extern std::vector<VkImageView> src_image_views_;
 extern std::vector<VkDescriptorImageInfo> src_image_infos_;
 extern RingBuffer ring_buffer_;
@@ -140,6 +139,10 @@ extern size_t ub_offset_align_;
 extern std::vector<VkImageMemoryBarrier> src_barrier_before_clear_;
 extern VkImageMemoryBarrier dst_barrier_before_clear_;
 extern VkFramebuffer framebuffer_;
+// Image views and framebuffers destroyed since the last draw. Commands
+// recorded with them cannot be submitted again, as their handles can be
+// reused by new objects.
+extern std::vector<uint64_t> released_handles_;
 
 }  // namespace hwcomposer
 
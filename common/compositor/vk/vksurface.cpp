@@ -26,6 +26,7 @@ VKSurface::VKSurface(uint32_t width, uint32_t height)
 }
 
 VKSurface::~VKSurface() {
+  released_handles_.emplace_back((uint64_t)surface_fb_);
   vkDestroyFramebuffer(dev_, surface_fb_, NULL);
   vkDestroyImageView(dev_, image_view_, NULL);
   vkDestroyImage(dev_, image_, NULL);
@@ -75,6 +75,30 @@ bool GpuDevice::Initialize() {
     display_manager_->RemoveUnreservedPlanes();
   }
 
+  if (use_cost_plane_allocator_) {
+    display_manager_->EnableCostModelPlaneAllocator(true);
+  }
+
+  if (surface_pool_budget_mb_ >= 0) {
+    display_manager_->SetSurfacePoolBudget(surface_pool_budget_mb_);
+  }
+
+  if (compositor_contexts_ > 1) {
+    display_manager_->SetCompositorContexts(compositor_contexts_);
+  }
+
+  if (use_pipelined_commit_) {
+    display_manager_->EnablePipelinedCommit(true);
+  }
+
+  if (use_adaptive_sync_) {
+    display_manager_->EnableAdaptiveSync(true);
+  }
+
+  if (use_group_commit_) {
+    display_manager_->EnableGroupCommit(true);
+  }
+
   lock_fd_ = open(HWC_LOCK_FILE, O_RDONLY);
   if (-1 != lock_fd_) {
     if (!InitWorker()) {
@@ -560,6 +584,38 @@ void GpuDevice::ParsePhysicalDisplayRotation(
   rotation_display_index.emplace_back(physical_index);
 }
 
+void GpuDevice::ParseIdleTimeoutSetting(
+    std::string &value, std::vector<uint32_t> &idle_timeouts,
+    std::vector<uint32_t> &idle_timeout_display_index) {
+  std::string display_line_str;
+  std::istringstream i_value(value);
+
+  // Get each display setting
+  while (std::getline(i_value, display_line_str, ';')) {
+    if (display_line_str.empty() ||
+        display_line_str.find_first_not_of("0123456789:+") != std::string::npos)
+      continue;
+
+    std::istringstream i_display(display_line_str);
+    std::string physical_index_str;
+    std::string min_timeout_str;
+    std::string max_timeout_str;
+    std::getline(i_display, physical_index_str, ':');
+    std::getline(i_display, min_timeout_str, '+');
+    std::getline(i_display, max_timeout_str, '+');
+    if (physical_index_str.empty() || min_timeout_str.empty() ||
+        max_timeout_str.empty() ||
+        min_timeout_str.find(':') != std::string::npos ||
+        max_timeout_str.find(':') != std::string::npos)
+      continue;
+
+    idle_timeout_display_index.emplace_back(
+        atoi(physical_index_str.c_str()));
+    idle_timeouts.emplace_back(atoi(min_timeout_str.c_str()));
+    idle_timeouts.emplace_back(atoi(max_timeout_str.c_str()));
+  }
+}
+
 void GpuDevice::ParseFloatDisplaySetting(
     std::string &value, std::vector<HwcRect<int32_t>> &float_displays,
     std::vector<uint32_t> &float_display_indices) {
@@ -679,6 +735,21 @@ void GpuDevice::InitializeDisplayRotation(
   }
 }
 
+void GpuDevice::InitializeIdleTimeout(
+    std::vector<uint32_t> &idle_timeouts,
+    std::vector<uint32_t> &idle_timeout_display_index,
+    std::vector<NativeDisplay *> &displays) {
+  size_t size = idle_timeout_display_index.size();
+  for (size_t i = 0; i < size; i++) {
+    uint32_t physical_index = idle_timeout_display_index.at(i);
+    if (physical_index >= displays.size())
+      continue;
+
+    displays.at(physical_index)
+        ->SetIdleTimeout(idle_timeouts.at(2 * i), idle_timeouts.at(2 * i + 1));
+  }
+}
+
 void GpuDevice::InitializeLogicalDisplay(
     std::vector<uint32_t> &logical_displays,
     std::vector<NativeDisplay *> &displays,
@@ -870,6 +941,8 @@ void GpuDevice::HandleHWCSettings() {
   std::vector<uint32_t> display_rotation;
   std::vector<uint32_t> float_display_indices;
   std::vector<uint32_t> rotation_display_index;
+  std::vector<uint32_t> idle_timeouts;
+  std::vector<uint32_t> idle_timeout_display_index;
   std::vector<HwcRect<int32_t>> float_displays;
   std::vector<std::vector<uint32_t>> cloned_displays;
   std::vector<std::vector<uint32_t>> mosaic_displays;
@@ -900,6 +973,13 @@ void GpuDevice::HandleHWCSettings() {
 #endif
 
   std::string key_reserved_drm_plane("DRM_PLANE_RESERVED");
+  std::string key_plane_allocator("PLANE_ALLOCATOR");
+  std::string key_surface_pool_budget("SURFACE_POOL_BUDGET");
+  std::string key_compositor_contexts("COMPOSITOR_CONTEXTS");
+  std::string key_pipelined_commit("PIPELINED_COMMIT");
+  std::string key_adaptive_sync("ADAPTIVE_SYNC");
+  std::string key_group_commit("GROUP_COMMIT");
+  std::string key_idle_timeout("IDLE_TIMEOUT");
 
   while (std::getline(fin, cfg_line)) {
     std::istringstream i_line(cfg_line);
@@ -984,6 +1064,34 @@ void GpuDevice::HandleHWCSettings() {
           // Got plan reserve config
         } else if (!key.compare(key_reserved_drm_plane)) {
           ParsePlaneReserveSettings(value);
+          // Got plane allocation strategy
+        } else if (!key.compare(key_plane_allocator)) {
+          use_cost_plane_allocator_ = !value.compare("cost");
+          // Got offscreen surface pool budget
+        } else if (!key.compare(key_surface_pool_budget)) {
+          surface_pool_budget_mb_ = atoi(value.c_str());
+          // Got number of GPU composition contexts
+        } else if (!key.compare(key_compositor_contexts)) {
+          compositor_contexts_ = atoi(value.c_str());
+          // Got pipelined commit switch
+        } else if (!key.compare(key_pipelined_commit)) {
+          if (!value.compare(enable_str)) {
+            use_pipelined_commit_ = true;
+          }
+          // Got adaptive sync switch
+        } else if (!key.compare(key_adaptive_sync)) {
+          if (!value.compare(enable_str)) {
+            use_adaptive_sync_ = true;
+          }
+          // Got group commit switch
+        } else if (!key.compare(key_group_commit)) {
+          if (!value.compare(enable_str)) {
+            use_group_commit_ = true;
+          }
+          // Got idle timeout config
+        } else if (!key.compare(key_idle_timeout)) {
+          ParseIdleTimeoutSetting(value, idle_timeouts,
+                                  idle_timeout_display_index);
         }
       }
     }
@@ -998,6 +1106,8 @@ void GpuDevice::HandleHWCSettings() {
                               displays);
   }
 
+  InitializeIdleTimeout(idle_timeouts, idle_timeout_display_index, displays);
+
   // Now, we should have all physical displays ordered as required.
   // Let's handle any Logical Display combinations or Mosaic.
   std::vector<NativeDisplay *> temp_displays;
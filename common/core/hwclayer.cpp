@@ -16,6 +16,7 @@
 
 #include <hwclayer.h>
 #include <libsync.h>
+#include <string.h>
 #include <cmath>
 
 #include <hwcutils.h>
@@ -41,6 +42,7 @@ void HwcLayer::SetTransform(int32_t transform) {
   if (transform != transform_) {
     layer_cache_ |= kLayerAttributesChanged;
     transform_ = transform;
+    fingerprint_ = 0;
     UpdateRenderingDamage(display_frame_, display_frame_, true);
   }
 }
@@ -48,12 +50,14 @@ void HwcLayer::SetTransform(int32_t transform) {
 void HwcLayer::SetDataSpace(uint32_t dataspace) {
   if (dataspace_ != dataspace) {
     dataspace_ = dataspace;
+    fingerprint_ = 0;
   }
 }
 
 void HwcLayer::SetAlpha(uint8_t alpha) {
   if (alpha_ != alpha) {
     alpha_ = alpha;
+    fingerprint_ = 0;
     UpdateRenderingDamage(display_frame_, display_frame_, true);
   }
 }
@@ -61,6 +65,7 @@ void HwcLayer::SetAlpha(uint8_t alpha) {
 void HwcLayer::SetBlending(HWCBlending blending) {
   if (blending != blending_) {
     blending_ = blending;
+    fingerprint_ = 0;
     UpdateRenderingDamage(display_frame_, display_frame_, true);
   }
 }
@@ -76,6 +81,7 @@ void HwcLayer::SetSourceCrop(const HwcRect<float>& source_crop) {
         static_cast<int>(ceilf(source_crop.right - source_crop.left));
     source_crop_height_ =
         static_cast<int>(ceilf(source_crop.bottom - source_crop.top));
+    fingerprint_ = 0;
   }
 }
 
@@ -96,6 +102,7 @@ void HwcLayer::SetDisplayFrame(const HwcRect<int>& display_frame,
     display_frame_ = frame;
     display_frame_width_ = display_frame_.right - display_frame_.left;
     display_frame_height_ = display_frame_.bottom - display_frame_.top;
+    fingerprint_ = 0;
   }
 
   if (!(state_ & kVisibleRegionSet)) {
@@ -109,27 +116,42 @@ void HwcLayer::SetSurfaceDamage(const HwcRegion& surface_damage) {
   state_ |= kSurfaceDamageChanged;
   HwcRect<int> rect;
   ResetRectToRegion(surface_damage, rect);
+  HwcRegion& damage = damage_scratch_;
+  damage.clear();
   if (rects == 1) {
     if ((rect.top == 0) && (rect.bottom == 0) && (rect.left == 0) &&
         (rect.right == 0)) {
       state_ &= ~kLayerContentChanged;
       UpdateRenderingDamage(rect, rect, true);
       surface_damage_.reset();
+      surface_damage_region_.clear();
       return;
     }
   } else if (rects == 0) {
     rect = source_crop_;
+    AddDamageRect(rect, damage);
   }
 
-  if ((surface_damage_.left == rect.left) &&
-      (surface_damage_.top == rect.top) &&
-      (surface_damage_.right == rect.right) &&
-      (surface_damage_.bottom == rect.bottom)) {
+  // Keep separate rects apart, bounds of a few small updates far from
+  // each other can cover most of the layer.
+  for (const HwcRect<int>& damage_rect : surface_damage) {
+    AddDamageRect(damage_rect, damage);
+  }
+
+  if (damage == surface_damage_region_) {
     return;
   }
 
-  UpdateRenderingDamage(surface_damage_, rect, false);
-  surface_damage_ = rect;
+  for (const HwcRect<int>& old_rect : surface_damage_region_) {
+    AddRenderingDamage(old_rect);
+  }
+
+  for (const HwcRect<int>& new_rect : damage) {
+    AddRenderingDamage(new_rect);
+  }
+
+  surface_damage_region_.swap(damage);
+  ResetRectToRegion(surface_damage_region_, surface_damage_);
 }
 
 void HwcLayer::SetVisibleRegion(const HwcRegion& visible_region) {
@@ -207,7 +229,10 @@ void HwcLayer::SetAcquireFence(int32_t fd) {
 }
 
 void HwcLayer::SetSolidColor(uint32_t color) {
-  solid_color_ = color;
+  if (solid_color_ != color) {
+    solid_color_ = color;
+    fingerprint_ = 0;
+  }
 }
 
 int32_t HwcLayer::GetAcquireFence() {
@@ -220,8 +245,7 @@ int32_t HwcLayer::GetAcquireFence() {
 
 void HwcLayer::SufaceDamageTransfrom() {
   int ox = 0, oy = 0;
-  HwcRect<int> translated_damage =
-      TranslateRect(surface_damage_, -source_crop_.left, -source_crop_.top);
+  rendering_damage_region_.clear();
 
   // From observation: In Android, when the source crop is not (0, 0),
   // the surface damage is already translated to global display coordinate.
@@ -257,17 +281,19 @@ void HwcLayer::SufaceDamageTransfrom() {
 
     float ratiow = display_width * 1.0 / source_width;
     float ratioh = display_height * 1.0 / source_height;
-    translated_damage.left = translated_damage.left * ratiow + 0.5;
-    translated_damage.right = translated_damage.right * ratiow + 0.5;
-    translated_damage.top = translated_damage.top * ratioh + 0.5;
-    translated_damage.bottom = translated_damage.bottom * ratioh + 0.5;
-
     ox = display_frame_.left;
     oy = display_frame_.top;
-    current_rendering_damage_.left = ox + translated_damage.left;
-    current_rendering_damage_.top = oy + translated_damage.top;
-    current_rendering_damage_.right = ox + translated_damage.right;
-    current_rendering_damage_.bottom = oy + translated_damage.bottom;
+    for (const HwcRect<int>& damage : surface_damage_region_) {
+      HwcRect<int> translated_damage =
+          TranslateRect(damage, -source_crop_.left, -source_crop_.top);
+      translated_damage.left = ox + translated_damage.left * ratiow + 0.5;
+      translated_damage.right = ox + translated_damage.right * ratiow + 0.5;
+      translated_damage.top = oy + translated_damage.top * ratioh + 0.5;
+      translated_damage.bottom = oy + translated_damage.bottom * ratioh + 0.5;
+      AddDamageRect(translated_damage, rendering_damage_region_);
+    }
+
+    ResetRectToRegion(rendering_damage_region_, current_rendering_damage_);
 #ifdef RECT_DAMAGE_TRACING
     IRECTDAMAGETRACE(
         "Re-calucated current_rendering_damage_ (LTWH): %d, %d, %d, %d",
@@ -279,6 +305,7 @@ void HwcLayer::SufaceDamageTransfrom() {
     current_rendering_damage_ = surface_damage_;
   } else {
     current_rendering_damage_ = display_frame_;
+    AddDamageRect(display_frame_, rendering_damage_region_);
   }
 }
 
@@ -294,6 +321,8 @@ void HwcLayer::Validate() {
     SufaceDamageTransfrom();
   } else {
     current_rendering_damage_ = display_frame_;
+    rendering_damage_region_.clear();
+    AddDamageRect(display_frame_, rendering_damage_region_);
   }
 
   if (left_constraint_.empty() && left_source_constraint_.empty())
@@ -316,10 +345,46 @@ void HwcLayer::Validate() {
   }
 }
 
+uint64_t HwcLayer::GetStateFingerprint() {
+  if (!fingerprint_)
+    UpdateStateFingerprint();
+
+  return fingerprint_;
+}
+
+void HwcLayer::UpdateStateFingerprint() {
+  uint32_t crop[4];
+  memcpy(&crop[0], &source_crop_.left, sizeof(crop[0]));
+  memcpy(&crop[1], &source_crop_.top, sizeof(crop[1]));
+  memcpy(&crop[2], &source_crop_.right, sizeof(crop[2]));
+  memcpy(&crop[3], &source_crop_.bottom, sizeof(crop[3]));
+
+  uint64_t hash = kHashSeed;
+  HashCombine(hash, static_cast<uint32_t>(display_frame_.left));
+  HashCombine(hash, static_cast<uint32_t>(display_frame_.top));
+  HashCombine(hash, static_cast<uint32_t>(display_frame_.right));
+  HashCombine(hash, static_cast<uint32_t>(display_frame_.bottom));
+  for (uint32_t value : crop)
+    HashCombine(hash, value);
+
+  HashCombine(hash, static_cast<uint32_t>(transform_));
+  HashCombine(hash, static_cast<uint32_t>(z_order_));
+  HashCombine(hash, dataspace_);
+  HashCombine(hash, solid_color_);
+  HashCombine(hash, alpha_ | (static_cast<uint64_t>(blending_) << 8) |
+                        (static_cast<uint64_t>(composition_type_) << 16) |
+                        (static_cast<uint64_t>(is_cursor_layer_) << 24) |
+                        (static_cast<uint64_t>(is_video_layer_) << 25));
+
+  // 0 marks fingerprint as not calculated.
+  fingerprint_ = hash ? hash : 1;
+}
+
 void HwcLayer::SetLayerZOrder(uint32_t order) {
   if (z_order_ != static_cast<int>(order)) {
     z_order_ = order;
     state_ |= kZorderChanged;
+    fingerprint_ = 0;
     UpdateRenderingDamage(display_frame_, visible_rect_, false);
   }
 }
@@ -413,7 +478,10 @@ int32_t HwcLayer::GetRightSourceConstraint() {
 }
 
 void HwcLayer::MarkAsCursorLayer() {
-  is_cursor_layer_ = true;
+  if (!is_cursor_layer_) {
+    is_cursor_layer_ = true;
+    fingerprint_ = 0;
+  }
 }
 
 bool HwcLayer::IsCursorLayer() const {
@@ -421,7 +489,10 @@ bool HwcLayer::IsCursorLayer() const {
 }
 
 void HwcLayer::MarkAsVideoLayer() {
-  is_video_layer_ = true;
+  if (!is_video_layer_) {
+    is_video_layer_ = true;
+    fingerprint_ = 0;
+  }
 }
 
 bool HwcLayer::IsVideoLayer() const {
@@ -439,20 +510,24 @@ bool HwcLayer::GetUseForMosaic() const {
 void HwcLayer::UpdateRenderingDamage(const HwcRect<int>& old_rect,
                                      const HwcRect<int>& newrect,
                                      bool same_rect) {
-  if (current_rendering_damage_.empty()) {
-    current_rendering_damage_ = old_rect;
-  } else {
-    CalculateRect(old_rect, current_rendering_damage_);
-  }
-
+  AddRenderingDamage(old_rect);
   if (same_rect)
     return;
 
-  CalculateRect(newrect, current_rendering_damage_);
+  AddRenderingDamage(newrect);
+}
+
+void HwcLayer::AddRenderingDamage(const HwcRect<int>& rect) {
+  CalculateRect(rect, current_rendering_damage_);
+  AddDamageRect(rect, rendering_damage_region_);
 }
 
 const HwcRect<int>& HwcLayer::GetLayerDamage() {
   return current_rendering_damage_;
 }
 
+const HwcRegion& HwcLayer::GetLayerDamageRegion() {
+  return rendering_damage_region_;
+}
+
 }  // namespace hwcomposer
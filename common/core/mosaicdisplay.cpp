@@ -265,6 +265,10 @@ bool MosaicDisplay::Present(std::vector<HwcLayer *> &source_layers,
   size_t total_layers = source_layers.size();
   int32_t fence = -1;
   *retire_fence = -1;
+  // All pipes flip together when frames of the displays are committed
+  // with one atomic commit.
+  bool grouped = size > 1 && connected_displays_.at(0)->BeginCommitGroup(
+                                 connected_displays_);
   for (uint32_t i = 0; i < size; i++) {
     NativeDisplay *display = connected_displays_.at(i);
     int32_t right_constraint = left_constraint + display->Width();
@@ -315,6 +319,9 @@ bool MosaicDisplay::Present(std::vector<HwcLayer *> &source_layers,
     left_constraint = right_constraint;
   }
 
+  if (grouped)
+    connected_displays_.at(0)->EndCommitGroup();
+
 #ifdef ENABLE_PANORAMA
   if (skip_update_) {
     event_.Signal();
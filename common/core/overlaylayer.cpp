@@ -30,40 +30,66 @@
 
 namespace hwcomposer {
 
+// A layer is considered frequently updated once its content changed in
+// kFrequentUpdatesHigh of the last 32 frames and stops being one when
+// it drops to kFrequentUpdatesLow, so that plane assignment doesn't
+// flip flop with occasional skipped frames.
+static const uint32_t kFrequentUpdatesHigh = 24;
+static const uint32_t kFrequentUpdatesLow = 8;
+
 OverlayLayer::ImportedBuffer::~ImportedBuffer() {
   if (acquire_fence_ > 0) {
     close(acquire_fence_);
   }
 }
 
-OverlayLayer::ImportedBuffer::ImportedBuffer(
-    std::shared_ptr<OverlayBuffer>& buffer, int32_t acquire_fence)
-    : acquire_fence_(acquire_fence) {
-  buffer_ = buffer;
+OverlayLayer::ImportedBuffer::ImportedBuffer(ImportedBuffer&& rhs)
+    : buffer_(std::move(rhs.buffer_)), acquire_fence_(rhs.acquire_fence_) {
+  rhs.acquire_fence_ = -1;
+}
+
+OverlayLayer::ImportedBuffer& OverlayLayer::ImportedBuffer::operator=(
+    ImportedBuffer&& rhs) {
+  if (this != &rhs) {
+    Reset(std::move(rhs.buffer_), rhs.acquire_fence_);
+    rhs.acquire_fence_ = -1;
+  }
+
+  return *this;
+}
+
+void OverlayLayer::ImportedBuffer::Reset(std::shared_ptr<OverlayBuffer> buffer,
+                                         int32_t acquire_fence) {
+  if (acquire_fence_ > 0) {
+    close(acquire_fence_);
+  }
+
+  buffer_ = std::move(buffer);
+  acquire_fence_ = acquire_fence;
 }
 
 void OverlayLayer::SetAcquireFence(int32_t acquire_fence) {
   // Release any existing fence.
-  if (imported_buffer_.get()) {
-    if (imported_buffer_->acquire_fence_ > 0) {
-      close(imported_buffer_->acquire_fence_);
+  if (imported_buffer_.buffer_) {
+    if (imported_buffer_.acquire_fence_ > 0) {
+      close(imported_buffer_.acquire_fence_);
     }
 
-    imported_buffer_->acquire_fence_ = acquire_fence;
+    imported_buffer_.acquire_fence_ = acquire_fence;
   }
 }
 
 int32_t OverlayLayer::GetAcquireFence() const {
-  if (imported_buffer_.get()) {
-    return imported_buffer_->acquire_fence_;
+  if (imported_buffer_.buffer_) {
+    return imported_buffer_.acquire_fence_;
   } else
     return -1;
 }
 
 int32_t OverlayLayer::ReleaseAcquireFence() const {
-  if (imported_buffer_.get()) {
-    int32_t fence = imported_buffer_->acquire_fence_;
-    imported_buffer_->acquire_fence_ = -1;
+  if (imported_buffer_.buffer_) {
+    int32_t fence = imported_buffer_.acquire_fence_;
+    imported_buffer_.acquire_fence_ = -1;
     return fence;
   } else {
     return -1;
@@ -71,23 +97,16 @@ int32_t OverlayLayer::ReleaseAcquireFence() const {
 }
 
 OverlayBuffer* OverlayLayer::GetBuffer() const {
-  if (imported_buffer_.get()) {
-    if (imported_buffer_->buffer_.get() == NULL)
-      ETRACE("hwc layer get NullBuffer");
-
-    return imported_buffer_->buffer_.get();
-  } else {
-    return NULL;
-  }
+  return imported_buffer_.buffer_.get();
 }
 
 std::shared_ptr<OverlayBuffer>& OverlayLayer::GetSharedBuffer() const {
-  return imported_buffer_->buffer_;
+  return imported_buffer_.buffer_;
 }
 
-void OverlayLayer::SetBuffer(HWCNativeHandle handle, int32_t acquire_fence,
-                             ResourceManager* resource_manager,
-                             bool register_buffer) {
+std::shared_ptr<OverlayBuffer> OverlayLayer::ImportBuffer(
+    HWCNativeHandle handle, ResourceManager* resource_manager,
+    bool register_buffer) {
   std::shared_ptr<OverlayBuffer> buffer(NULL);
 
   uint32_t id;
@@ -114,8 +133,14 @@ void OverlayLayer::SetBuffer(HWCNativeHandle handle, int32_t acquire_fence,
   }
 
   buffer->SetDataSpace(dataspace_);
+  return buffer;
+}
 
-  imported_buffer_.reset(new ImportedBuffer(buffer, acquire_fence));
+void OverlayLayer::SetBuffer(HWCNativeHandle handle, int32_t acquire_fence,
+                             ResourceManager* resource_manager,
+                             bool register_buffer) {
+  imported_buffer_.Reset(
+      ImportBuffer(handle, resource_manager, register_buffer), acquire_fence);
   ValidateForOverlayUsage();
 }
 
@@ -184,14 +209,60 @@ void OverlayLayer::ValidateTransform(uint32_t transform,
   }
 }
 
+HwcRect<int> OverlayLayer::TransformDamageRect(const HwcRect<int>& damage,
+                                               uint32_t max_height,
+                                               uint32_t max_width) const {
+  float ratio_w_h = max_width * 1.0 / max_height;
+  float ratio_h_w = max_height * 1.0 / max_width;
+
+  int ox = 0, oy = 0;
+  HwcRect<int> transformed = damage;
+
+  if (merged_transform_ == kTransform270) {
+    oy = max_height;
+    transformed.left = damage.top * ratio_w_h + 0.5;
+    transformed.top = oy - damage.right * ratio_h_w + 0.5;
+    transformed.right = damage.bottom * ratio_w_h + 0.5;
+    transformed.bottom = oy - damage.left * ratio_h_w + 0.5;
+  } else if (merged_transform_ == kTransform180) {
+    ox = max_width;
+    oy = max_height;
+    transformed.left = ox - damage.right;
+    transformed.top = oy - damage.bottom;
+    transformed.right = ox - damage.left;
+    transformed.bottom = oy - damage.top;
+  } else if (merged_transform_ & hwcomposer::HWCTransform::kTransform90) {
+    if (merged_transform_ & kReflectX) {
+      transformed.left = damage.top * ratio_w_h + 0.5;
+      transformed.top = damage.left * ratio_h_w + 0.5;
+      transformed.right = damage.bottom * ratio_w_h + 0.5;
+      transformed.bottom = damage.right * ratio_h_w + 0.5;
+    } else if (merged_transform_ & kReflectY) {
+      ox = max_width;
+      oy = max_height;
+      transformed.left = ox - (damage.bottom * ratio_w_h + 0.5);
+      transformed.top = oy - (damage.right * ratio_h_w + 0.5);
+      transformed.right = ox - (damage.top * ratio_w_h + 0.5);
+      transformed.bottom = oy - (damage.left * ratio_h_w + 0.5);
+    } else {
+      ox = max_width;
+      transformed.left = ox - damage.bottom * ratio_w_h + 0.5;
+      transformed.top = damage.left * ratio_h_w + 0.5;
+      transformed.right = ox - damage.top * ratio_w_h + 0.5;
+      transformed.bottom = damage.right * ratio_h_w + 0.5;
+    }
+  }
+
+  return transformed;
+}
+
 void OverlayLayer::TransformDamage(HwcLayer* layer, uint32_t max_height,
                                    uint32_t max_width) {
   const HwcRect<int>& surface_damage = layer->GetLayerDamage();
+  ResetSurfaceDamage();
   if (surface_damage.empty()) {
-    surface_damage_ = surface_damage;
     return;
   }
-  HwcRect<int> translated_damage = TranslateRect(surface_damage, 0, 0);
 #ifdef RECT_DAMAGE_TRACING
   IRECTDAMAGETRACE("Calculating Overlaylayer Damage for layer[%d]", z_order_);
   IRECTDAMAGETRACE("max_width: %d, max_height:%d", max_width, max_height);
@@ -199,10 +270,8 @@ void OverlayLayer::TransformDamage(HwcLayer* layer, uint32_t max_height,
                    surface_damage.left, surface_damage.top,
                    (surface_damage.right - surface_damage.left),
                    (surface_damage.bottom - surface_damage.top));
-  IRECTDAMAGETRACE("translated_damage (LTWH): %d, %d, %d, %d",
-                   translated_damage.left, translated_damage.top,
-                   (translated_damage.right - translated_damage.left),
-                   (translated_damage.bottom - translated_damage.top));
+  IRECTDAMAGETRACE("Original Surface_damage rects: %s",
+                   StringifyRegion(layer->GetLayerDamageRegion()).c_str());
   IRECTDAMAGETRACE("source_crop_ (LTWH): %f, %f, %f, %f", source_crop_.left,
                    source_crop_.top, (source_crop_.right - source_crop_.left),
                    (source_crop_.bottom - source_crop_.top));
@@ -211,49 +280,8 @@ void OverlayLayer::TransformDamage(HwcLayer* layer, uint32_t max_height,
                    (display_frame_.right - display_frame_.left),
                    (display_frame_.bottom - display_frame_.top));
 #endif
-  float ratio_w_h = max_width * 1.0 / max_height;
-  float ratio_h_w = max_height * 1.0 / max_width;
-
-  int ox = 0, oy = 0;
-
-  if (merged_transform_ == kTransform270) {
-    oy = max_height;
-    surface_damage_.left = translated_damage.top * ratio_w_h + 0.5;
-    surface_damage_.top = oy - translated_damage.right * ratio_h_w + 0.5;
-    surface_damage_.right = translated_damage.bottom * ratio_w_h + 0.5;
-    surface_damage_.bottom = oy - translated_damage.left * ratio_h_w + 0.5;
-  } else if (merged_transform_ == kTransform180) {
-    ox = max_width;
-    oy = max_height;
-    surface_damage_.left = ox - translated_damage.right;
-    surface_damage_.top = oy - translated_damage.bottom;
-    surface_damage_.right = ox - translated_damage.left;
-    surface_damage_.bottom = oy - translated_damage.top;
-  } else if (merged_transform_ & hwcomposer::HWCTransform::kTransform90) {
-    if (merged_transform_ & kReflectX) {
-      surface_damage_.left = translated_damage.top * ratio_w_h + 0.5;
-      surface_damage_.top = translated_damage.left * ratio_h_w + 0.5;
-      surface_damage_.right = translated_damage.bottom * ratio_w_h + 0.5;
-      surface_damage_.bottom = translated_damage.right * ratio_h_w + 0.5;
-    } else if (merged_transform_ & kReflectY) {
-      ox = max_width;
-      oy = max_height;
-      surface_damage_.left = ox - (translated_damage.bottom * ratio_w_h + 0.5);
-      surface_damage_.top = oy - (translated_damage.right * ratio_h_w + 0.5);
-      surface_damage_.right = ox - (translated_damage.top * ratio_w_h + 0.5);
-      surface_damage_.bottom = oy - (translated_damage.left * ratio_h_w + 0.5);
-    } else {
-      ox = max_width;
-      surface_damage_.left = ox - translated_damage.bottom * ratio_w_h + 0.5;
-      surface_damage_.top = translated_damage.left * ratio_h_w + 0.5;
-      surface_damage_.right = ox - translated_damage.top * ratio_w_h + 0.5;
-      surface_damage_.bottom = translated_damage.right * ratio_h_w + 0.5;
-    }
-  } else if (merged_transform_ == 0) {
-    surface_damage_.left = translated_damage.left;
-    surface_damage_.top = translated_damage.top;
-    surface_damage_.right = translated_damage.right;
-    surface_damage_.bottom = translated_damage.bottom;
+  for (const HwcRect<int>& damage : layer->GetLayerDamageRegion()) {
+    AddSurfaceDamage(TransformDamageRect(damage, max_height, max_width));
   }
 #ifdef RECT_DAMAGE_TRACING
   IRECTDAMAGETRACE("Surface_damage (LTWH): %d, %d, %d, %d",
@@ -263,6 +291,21 @@ void OverlayLayer::TransformDamage(HwcLayer* layer, uint32_t max_height,
 #endif
 }
 
+bool OverlayLayer::AddSurfaceDamage(const HwcRect<int>& damage) {
+  CalculateRect(damage, surface_damage_);
+  return AddDamageRect(damage, surface_damage_region_);
+}
+
+void OverlayLayer::ResetSurfaceDamage() {
+  surface_damage_.reset();
+  surface_damage_region_.clear();
+}
+
+void OverlayLayer::SetSurfaceDamage(const HwcRect<int>& damage) {
+  ResetSurfaceDamage();
+  AddSurfaceDamage(damage);
+}
+
 void OverlayLayer::InitializeState(HwcLayer* layer,
                                    ResourceManager* resource_manager,
                                    OverlayLayer* previous_layer,
@@ -293,7 +336,7 @@ void OverlayLayer::InitializeState(HwcLayer* layer,
 
   if (previous_layer && layer->HasZorderChanged()) {
     if (previous_layer->actual_composition_ == kGpu) {
-      CalculateRect(previous_layer->display_frame_, surface_damage_);
+      AddSurfaceDamage(previous_layer->display_frame_);
       bool force_partial_clear = true;
       // We can skip Clear in case display frame, transforms are same.
       if (previous_layer->display_frame_ == display_frame_ &&
@@ -320,7 +363,7 @@ void OverlayLayer::InitializeState(HwcLayer* layer,
     source_crop_.left = source_crop_.top = 0;
     source_crop_.right = source_crop_width_;
     source_crop_.top = source_crop_height_;
-    imported_buffer_.reset(NULL);
+    imported_buffer_.Reset();
   } else {
     ETRACE(
         "HWC don't support a layer with no buffer handle except in SolidColor "
@@ -329,15 +372,18 @@ void OverlayLayer::InitializeState(HwcLayer* layer,
 
   if (!surface_damage_.empty()) {
     if (type_ == kLayerCursor) {
-      const std::shared_ptr<OverlayBuffer>& buffer = imported_buffer_->buffer_;
-      surface_damage_.right = surface_damage_.left + buffer->GetWidth();
-      surface_damage_.bottom = surface_damage_.top + buffer->GetHeight();
+      const std::shared_ptr<OverlayBuffer>& buffer = imported_buffer_.buffer_;
+      SetSurfaceDamage(HwcRect<int>(
+          surface_damage_.left, surface_damage_.top,
+          surface_damage_.left + buffer->GetWidth(),
+          surface_damage_.top + buffer->GetHeight()));
     }
   }
 
   if (!handle_constraints) {
     if (previous_layer) {
       ValidatePreviousFrameState(previous_layer, layer);
+      UpdateContentHistory(previous_layer, layer);
     }
 #ifdef RECT_DAMAGE_TRACING
     IRECTDAMAGETRACE("Surface_damage after init (LTWH): %d, %d, %d, %d",
@@ -408,30 +454,22 @@ void OverlayLayer::InitializeState(HwcLayer* layer,
     display_frame_width_ = display_frame_.right - display_frame_.left;
     display_frame_height_ = display_frame_.bottom - display_frame_.top;
 
-    surface_damage_.left =
-        (surface_damage_.left - left_source_constraint) + left_constraint;
-    surface_damage_.right =
-        (surface_damage_.right - left_source_constraint) + left_constraint;
-
-    if ((surface_damage_.left < display_frame_.left) &&
-        (surface_damage_.right > display_frame_.left)) {
-      surface_damage_.left = display_frame_.left;
-    }
+    // Rects stay disjoint when moved and clipped the same way.
+    for (size_t i = surface_damage_region_.size(); i > 0; i--) {
+      HwcRect<int>& damage = surface_damage_region_[i - 1];
+      damage.left = (damage.left - left_source_constraint) + left_constraint;
+      damage.right = (damage.right - left_source_constraint) + left_constraint;
+      if (AnalyseOverlap(damage, display_frame_) == kOutside) {
+        surface_damage_region_.erase(surface_damage_region_.begin() + i - 1);
+        continue;
+      }
 
-    if (surface_damage_.right > display_frame_.right) {
-      surface_damage_.right = display_frame_.right;
+      damage.bottom = std::min(damage.bottom, display_frame_.bottom);
+      damage.right = std::min(damage.right, display_frame_.right);
+      damage.left = std::max(damage.left, display_frame_.left);
     }
 
-    if (AnalyseOverlap(surface_damage_, display_frame_) != kOutside) {
-      surface_damage_.bottom =
-          std::min(surface_damage_.bottom, display_frame_.bottom);
-      surface_damage_.right =
-          std::min(surface_damage_.right, display_frame_.right);
-      surface_damage_.left =
-          std::max(surface_damage_.left, display_frame_.left);
-    } else {
-      surface_damage_.reset();
-    }
+    ResetRectToRegion(surface_damage_region_, surface_damage_);
     IMOSAICDISPLAYTRACE(
         "surface_damage_ %d %d %d %d  left_source_constraint: %d "
         "left_constraint: %d \n",
@@ -458,6 +496,7 @@ void OverlayLayer::InitializeState(HwcLayer* layer,
 
   if (previous_layer) {
     ValidatePreviousFrameState(previous_layer, layer);
+    UpdateContentHistory(previous_layer, layer);
   }
 }
 
@@ -471,6 +510,101 @@ void OverlayLayer::InitializeFromHwcLayer(
   display_frame_ = layer->GetDisplayFrame();
   InitializeState(layer, resource_manager, previous_layer, z_order, layer_index,
                   max_height, max_width, rotation, handle_constraints);
+  // Constraints change from frame to frame without being part of the
+  // fingerprint.
+  if (!handle_constraints)
+    fingerprint_ = layer->GetStateFingerprint();
+}
+
+bool OverlayLayer::HasSameState(HwcLayer* layer) const {
+  // Fingerprints can collide, compare what they were calculated from.
+  // Source crop of solid color layers is not taken from layer.
+  if (type_ != kLayerSolidColor && !(source_crop_ == layer->GetSourceCrop()))
+    return false;
+
+  return display_frame_ == layer->GetDisplayFrame() &&
+         transform_ == layer->GetTransform() &&
+         alpha_ == layer->GetAlpha() && blending_ == layer->GetBlending() &&
+         dataspace_ == layer->GetDataSpace() &&
+         solid_color_ == layer->GetSolidColor();
+}
+
+bool OverlayLayer::InitializeFromPreviousFrame(
+    HwcLayer* layer, ResourceManager* resource_manager,
+    const OverlayLayer* previous_layer, uint32_t z_order, uint32_t layer_index,
+    uint32_t max_height, uint32_t max_width, uint32_t rotation) {
+  // A layer which wasn't validated has replaced the previous one.
+  if (!previous_layer->fingerprint_ || !layer->IsValidated() ||
+      previous_layer->plane_transform_ != rotation ||
+      previous_layer->z_order_ != z_order ||
+      previous_layer->fingerprint_ != layer->GetStateFingerprint() ||
+      !previous_layer->HasSameState(layer))
+    return false;
+
+  const std::shared_ptr<OverlayBuffer>& previous_buffer =
+      previous_layer->imported_buffer_.buffer_;
+  std::shared_ptr<OverlayBuffer> buffer(NULL);
+  HWCNativeHandle handle = layer->GetNativeHandle();
+  dataspace_ = previous_layer->dataspace_;
+  if (handle) {
+    if (!previous_buffer)
+      return false;
+
+    buffer = ImportBuffer(handle, resource_manager, true);
+    // Plane and composition results depend on these.
+    if (buffer->GetFormat() != previous_buffer->GetFormat() ||
+        buffer->GetUsage() != previous_buffer->GetUsage() ||
+        buffer->GetWidth() != previous_buffer->GetWidth() ||
+        buffer->GetHeight() != previous_buffer->GetHeight() ||
+        buffer->GetTilingMode() != previous_buffer->GetTilingMode())
+      return false;
+  } else if (previous_layer->type_ != kLayerSolidColor) {
+    return false;
+  }
+
+  transform_ = previous_layer->transform_;
+  plane_transform_ = previous_layer->plane_transform_;
+  merged_transform_ = previous_layer->merged_transform_;
+  z_order_ = z_order;
+  layer_index_ = layer_index;
+  source_crop_width_ = previous_layer->source_crop_width_;
+  source_crop_height_ = previous_layer->source_crop_height_;
+  display_frame_width_ = previous_layer->display_frame_width_;
+  display_frame_height_ = previous_layer->display_frame_height_;
+  alpha_ = previous_layer->alpha_;
+  solid_color_ = previous_layer->solid_color_;
+  source_crop_ = previous_layer->source_crop_;
+  display_frame_ = previous_layer->display_frame_;
+  blending_ = previous_layer->blending_;
+  supported_composition_ = previous_layer->supported_composition_;
+  actual_composition_ = previous_layer->actual_composition_;
+  fingerprint_ = previous_layer->fingerprint_;
+  TransformDamage(layer, max_height, max_width);
+
+  if (buffer) {
+    imported_buffer_.Reset(std::move(buffer), layer->GetAcquireFence());
+    ValidateForOverlayUsage();
+    if (type_ == kLayerCursor && !surface_damage_.empty()) {
+      const std::shared_ptr<OverlayBuffer>& cursor = imported_buffer_.buffer_;
+      SetSurfaceDamage(HwcRect<int>(
+          surface_damage_.left, surface_damage_.top,
+          surface_damage_.left + cursor->GetWidth(),
+          surface_damage_.top + cursor->GetHeight()));
+    }
+  } else {
+    type_ = kLayerSolidColor;
+    imported_buffer_.Reset();
+  }
+
+  // Geometry is same as last frame, only content can have changed.
+  state_ = kLayerContentChanged;
+  if (!layer->HasVisibleRegionChanged() && surface_damage_.empty() &&
+      !layer->HasLayerContentChanged() && !layer->GetUseForMosaic()) {
+    state_ &= ~kLayerContentChanged;
+  }
+
+  UpdateContentHistory(previous_layer, layer);
+  return true;
 }
 
 void OverlayLayer::InitializeFromScaledHwcLayer(
@@ -485,9 +619,7 @@ void OverlayLayer::InitializeFromScaledHwcLayer(
 
 void OverlayLayer::ValidatePreviousFrameState(OverlayLayer* rhs,
                                               HwcLayer* layer) {
-  OverlayBuffer* buffer = NULL;
-  if (imported_buffer_.get())
-    buffer = imported_buffer_->buffer_.get();
+  OverlayBuffer* buffer = imported_buffer_.buffer_.get();
 
   supported_composition_ = rhs->supported_composition_;
   actual_composition_ = rhs->actual_composition_;
@@ -507,11 +639,11 @@ void OverlayLayer::ValidatePreviousFrameState(OverlayLayer* rhs,
       // we re-draw this and previous layer regions.
       if (!layer->IsValidated()) {
         content_changed = true;
-        CalculateRect(rhs->display_frame_, surface_damage_);
+        AddSurfaceDamage(rhs->display_frame_);
       } else if (!content_changed) {
-        if ((buffer && rhs->imported_buffer_.get() &&
+        if ((buffer && rhs->imported_buffer_.buffer_ &&
              (buffer->GetFormat() !=
-              rhs->imported_buffer_->buffer_->GetFormat())) ||
+              rhs->imported_buffer_.buffer_->GetFormat())) ||
             (alpha_ != rhs->alpha_) || (blending_ != rhs->blending_) ||
             (transform_ != rhs->transform_)) {
           content_changed = true;
@@ -525,11 +657,11 @@ void OverlayLayer::ValidatePreviousFrameState(OverlayLayer* rhs,
   } else {
     // Ensure the buffer can be supported by display for direct
     // scanout.
-    if (!rhs->imported_buffer_.get()) {
+    if (!rhs->imported_buffer_.buffer_) {
       state_ |= kNeedsReValidation;
       return;
     } else if (buffer && (buffer->GetFormat() !=
-                          rhs->imported_buffer_->buffer_->GetFormat())) {
+                          rhs->imported_buffer_.buffer_->GetFormat())) {
       state_ |= kNeedsReValidation;
       return;
     }
@@ -576,8 +708,40 @@ void OverlayLayer::ValidatePreviousFrameState(OverlayLayer* rhs,
   }
 }
 
+void OverlayLayer::UpdateContentHistory(const OverlayLayer* rhs,
+                                        HwcLayer* layer) {
+  // This layer has replaced an existing layer, history of
+  // previous one doesn't apply.
+  if (!layer->IsValidated()) {
+    content_history_ = 1;
+    frequently_updated_ = false;
+    if (rhs->frequently_updated_)
+      state_ |= kUpdateFrequencyChanged;
+
+    return;
+  }
+
+  content_history_ = rhs->content_history_ << 1;
+  if (state_ & kLayerContentChanged)
+    content_history_ |= 1;
+
+  uint32_t updates = 0;
+  for (uint32_t history = content_history_; history; history &= history - 1)
+    updates++;
+
+  frequently_updated_ = rhs->frequently_updated_;
+  if (!frequently_updated_ && updates >= kFrequentUpdatesHigh) {
+    frequently_updated_ = true;
+  } else if (frequently_updated_ && updates <= kFrequentUpdatesLow) {
+    frequently_updated_ = false;
+  }
+
+  if (frequently_updated_ != rhs->frequently_updated_)
+    state_ |= kUpdateFrequencyChanged;
+}
+
 void OverlayLayer::ValidateForOverlayUsage() {
-  const std::shared_ptr<OverlayBuffer>& buffer = imported_buffer_->buffer_;
+  const std::shared_ptr<OverlayBuffer>& buffer = imported_buffer_.buffer_;
   type_ = buffer->GetUsage();
 }
 
@@ -598,7 +762,8 @@ void OverlayLayer::CloneLayer(const OverlayLayer* layer,
               true);
   }
   ValidateForOverlayUsage();
-  surface_damage_ = layer->GetSurfaceDamage();
+  surface_damage_ = layer->surface_damage_;
+  surface_damage_region_ = layer->surface_damage_region_;
   transform_ = layer->transform_;
   plane_transform_ = layer->plane_transform_;
   merged_transform_ = layer->merged_transform_;
@@ -607,6 +772,8 @@ void OverlayLayer::CloneLayer(const OverlayLayer* layer,
   z_order_ = z_order;
   blending_ = layer->blending_;
   solid_color_ = layer->solid_color_;
+  content_history_ = layer->content_history_;
+  frequently_updated_ = layer->frequently_updated_;
 }
 
 void OverlayLayer::Dump() {
@@ -639,6 +806,7 @@ void OverlayLayer::Dump() {
     DUMPTRACE("Transform: kTransform0.");
 
   DUMPTRACE("Alpha: %u", alpha_);
+  DUMPTRACE("FrequentlyUpdated: %d", frequently_updated_);
 
   DUMPTRACE("SourceWidth: %d", source_crop_width_);
   DUMPTRACE("SourceHeight: %d", source_crop_height_);
@@ -647,9 +815,9 @@ void OverlayLayer::Dump() {
   DUMPTRACE("Source crop %s", StringifyRect(source_crop_).c_str());
   DUMPTRACE("Display frame %s", StringifyRect(display_frame_).c_str());
   DUMPTRACE("Surface Damage %s", StringifyRect(surface_damage_).c_str());
-  if (imported_buffer_) {
-    DUMPTRACE("AquireFence: %d", imported_buffer_->acquire_fence_);
-    imported_buffer_->buffer_->Dump();
+  if (imported_buffer_.buffer_) {
+    DUMPTRACE("AquireFence: %d", imported_buffer_.acquire_fence_);
+    imported_buffer_.buffer_->Dump();
   }
 }
 
@@ -59,6 +59,19 @@ struct OverlayLayer {
                                     const HwcRect<int>& display_frame,
                                     uint32_t max_height, uint32_t max_width,
                                     uint32_t rotation, bool handle_constraints);
+
+  // Initialize OverlayLayer from previous_layer, the layer at same z order
+  // in last frame, in case state fingerprint of layer hasn't changed
+  // since. Only buffer, acquire fence and damage are taken from layer,
+  // composition results are carried over. Returns false, without
+  // consuming the acquire fence, if layer needs to be fully initialized.
+  bool InitializeFromPreviousFrame(HwcLayer* layer,
+                                   ResourceManager* buffer_manager,
+                                   const OverlayLayer* previous_layer,
+                                   uint32_t z_order, uint32_t layer_index,
+                                   uint32_t max_height, uint32_t max_width,
+                                   uint32_t rotation);
+
   // Get z order of this layer.
   uint32_t GetZorder() const {
     return z_order_;
@@ -122,14 +135,21 @@ struct OverlayLayer {
     return display_frame_;
   }
 
+  // Bounds of GetSurfaceDamageRegion().
   const HwcRect<int>& GetSurfaceDamage() const {
     return surface_damage_;
   }
 
-  HwcRect<int>& GetSurfaceDamage() {
-    return surface_damage_;
+  // Disjoint rects damaged, at most kMaxDamageRects.
+  const HwcRegion& GetSurfaceDamageRegion() const {
+    return surface_damage_region_;
   }
 
+  // Adds damage to this layer. Returns true if damage changed.
+  bool AddSurfaceDamage(const HwcRect<int>& damage);
+
+  void ResetSurfaceDamage();
+
   uint32_t GetSourceCropWidth() const {
     return source_crop_width_;
   }
@@ -152,6 +172,19 @@ struct OverlayLayer {
     return state_ & kLayerContentChanged;
   }
 
+  // Returns true if content of the layer has changed
+  // in most of the recent frames, i.e. it is likely to
+  // change again in the next frame.
+  bool IsFrequentlyUpdated() const {
+    return frequently_updated_;
+  }
+
+  // Returns true if IsFrequentlyUpdated() has changed
+  // compared to last frame.
+  bool HasUpdateFrequencyChanged() const {
+    return state_ & kUpdateFrequencyChanged;
+  }
+
   // Returns true if this layer is visible.
   bool IsVisible() const {
     return !(state_ & kInvisible);
@@ -261,15 +294,22 @@ struct OverlayLayer {
     kInvisible = 1 << 2,
     kSourceRectChanged = 1 << 3,
     kNeedsReValidation = 1 << 4,
-    kForcePartialClear = 1 << 5
+    kForcePartialClear = 1 << 5,
+    kUpdateFrequencyChanged = 1 << 6
   };
 
+  // Held by value, so that initializing a layer every frame doesn't
+  // need a heap allocation.
   struct ImportedBuffer {
    public:
-    ImportedBuffer(std::shared_ptr<OverlayBuffer>& buffer,
-                   int32_t acquire_fence);
+    ImportedBuffer() = default;
+    ImportedBuffer(ImportedBuffer&& rhs);
+    ImportedBuffer& operator=(ImportedBuffer&& rhs);
     ~ImportedBuffer();
 
+    void Reset(std::shared_ptr<OverlayBuffer> buffer = NULL,
+               int32_t acquire_fence = -1);
+
     std::shared_ptr<OverlayBuffer> buffer_;
     int32_t acquire_fence_ = -1;
   };
@@ -278,15 +318,33 @@ struct OverlayLayer {
   // layer at same z order.
   void ValidatePreviousFrameState(OverlayLayer* rhs, HwcLayer* layer);
 
+  // Tracks content changes of this layer across frames
+  // using history of layer at same z order.
+  void UpdateContentHistory(const OverlayLayer* rhs, HwcLayer* layer);
+
+  // Returns true if the state of layer which is part of its fingerprint
+  // is the one this layer was initialized from.
+  bool HasSameState(HwcLayer* layer) const;
+
+  std::shared_ptr<OverlayBuffer> ImportBuffer(
+      HWCNativeHandle handle, ResourceManager* buffer_manager,
+      bool register_buffer);
+
   // Check if we want to use a separate overlay for this
   // layer.
   void ValidateForOverlayUsage();
 
   void ValidateTransform(uint32_t transform, uint32_t display_transform);
 
+  HwcRect<int> TransformDamageRect(const HwcRect<int>& damage,
+                                   uint32_t max_height,
+                                   uint32_t max_width) const;
+
   void TransformDamage(HwcLayer* layer, uint32_t max_height,
                        uint32_t max_width);
 
+  void SetSurfaceDamage(const HwcRect<int>& damage);
+
   void InitializeState(HwcLayer* layer, ResourceManager* buffer_manager,
                        OverlayLayer* previous_layer, uint32_t z_order,
                        uint32_t layer_index, uint32_t max_height,
@@ -310,9 +368,16 @@ struct OverlayLayer {
   HwcRect<float> source_crop_;
   HwcRect<int> display_frame_;
   HwcRect<int> surface_damage_;
+  HwcRegion surface_damage_region_;
   HWCBlending blending_ = HWCBlending::kBlendingNone;
   uint32_t state_ = kLayerContentChanged | kDimensionsChanged;
-  std::unique_ptr<ImportedBuffer> imported_buffer_;
+  // Bit n is set if content changed n frames ago.
+  uint32_t content_history_ = 1;
+  bool frequently_updated_ = false;
+  // State fingerprint of the HwcLayer this layer was initialized
+  // from, 0 if it cannot be used to initialize next frame.
+  uint64_t fingerprint_ = 0;
+  mutable ImportedBuffer imported_buffer_;
   LayerComposition supported_composition_ = kAll;
   LayerComposition actual_composition_ = kAll;
   HWCLayerType type_ = kLayerNormal;
@@ -90,6 +90,9 @@ void ResourceManager::RegisterBuffer(const uint32_t& native_buffer,
 
 void ResourceManager::MarkResourceForDeletion(const ResourceHandle& handle,
                                               bool has_valid_gpu_resources) {
+  // Offscreen surfaces can be allocated, and dropped, off the present
+  // thread.
+  ScopedSpinLock lock(lock_);
   purged_resources_.emplace_back();
   ResourceHandle& temp = purged_resources_.back();
   std::memcpy(&temp, &handle, sizeof temp);
@@ -15,6 +15,7 @@
 */
 
 #include <algorithm>
+#include <limits>
 
 #include "displayplanemanager.h"
 
@@ -29,6 +30,45 @@
 
 namespace hwcomposer {
 
+// Maximum number of plane assignments remembered by ValidateLayers.
+static const size_t kMaxAssignmentCacheSize = 8;
+
+// Cost model used by ValidateLayersWithCostModel. All costs are in units
+// of pixels scanned out directly by display.
+// Cost of a pixel composited by GPU (source read plus surface write).
+static const uint64_t kGpuPixelCost = 3;
+// Fixed cost of every offscreen surface (allocation, clear and an extra
+// render pass), independent of its size.
+static const uint64_t kOffScreenSurfaceCost = 256 * 256;
+// Offscreen surfaces holding only static layers are composited once and
+// reused, a frequently updated layer makes GPU redo the whole surface
+// every frame.
+static const uint64_t kFrequentUpdateCostFactor = 4;
+
+// Default memory budget of offscreen surfaces kept for re-use.
+static const size_t kDefaultSurfacePoolBudget = 64 << 20;
+// A plane composited by GPU cycles through three surfaces, one being
+// rendered, one queued for next vblank and one on screen.
+static const size_t kPreWarmedSurfaces = 3;
+
+// Returns memory used by buffer of surface.
+static size_t GetSurfaceSize(NativeSurface *surface) {
+  OverlayBuffer *buffer = surface->GetLayer()->GetBuffer();
+  if (!buffer)
+    return 0;
+
+  size_t pitch = buffer->GetPitches()[0];
+  if (!pitch)
+    pitch = buffer->GetWidth() * 4;
+
+  size_t size = pitch * buffer->GetHeight();
+  // Chroma planes of media formats.
+  if (GetTotalPlanesForFormat(buffer->GetFormat()) > 1)
+    size += size / 2;
+
+  return size;
+}
+
 DisplayPlaneManager::DisplayPlaneManager(DisplayPlaneHandler *plane_handler,
                                          ResourceManager *resource_manager)
     : plane_handler_(plane_handler),
@@ -38,7 +78,8 @@ DisplayPlaneManager::DisplayPlaneManager(DisplayPlaneHandler *plane_handler,
       height_(0),
       total_overlays_(0),
       display_transform_(kIdentity),
-      release_surfaces_(false) {
+      release_surfaces_(false),
+      surface_pool_budget_(kDefaultSurfacePoolBudget) {
 }
 
 DisplayPlaneManager::~DisplayPlaneManager() {
@@ -71,6 +112,7 @@ bool DisplayPlaneManager::Initialize(uint32_t width, uint32_t height) {
   height_ = height;
   bool status = plane_handler_->PopulatePlanes(overlay_planes_);
   ResizeOverlays();
+  InvalidateAssignmentCache();
   return status;
 }
 
@@ -127,6 +169,7 @@ bool DisplayPlaneManager::ValidateLayers(
   // Let's mark all planes as free to be used.
   for (auto j = overlay_begin; j < overlay_planes_.end(); ++j) {
     j->get()->SetInUse(false);
+    j->get()->BeginFrameValidation();
   }
 
   size_t avail_planes = overlay_planes_.size() - composition.size();
@@ -142,6 +185,26 @@ bool DisplayPlaneManager::ValidateLayers(
     return true;
   }
 
+  // In case of full validation, check if we have already validated
+  // a layer stack with same attributes and re-use it.
+  bool full_validation = composition.empty() && (add_index == 0);
+  uint64_t signature = 0;
+  if (full_validation && !layers.empty()) {
+    signature = GetLayersSignature(layers);
+    if (ApplyCachedAssignment(signature, layers, composition, mark_later)) {
+      assignment_cache_hits_++;
+      return true;
+    }
+
+    assignment_cache_misses_++;
+
+    if (use_cost_model_ &&
+        ValidateLayersWithCostModel(layers, composition, mark_later)) {
+      CacheAssignment(signature, layers.size(), composition);
+      return true;
+    }
+  }
+
   std::vector<OverlayLayer *> cursor_layers;
   auto layer_begin = layers.begin();
   auto layer_end = layers.end();
@@ -233,6 +296,21 @@ bool DisplayPlaneManager::ValidateLayers(
           }
         }
 
+        // Rather keep a static layer with layers of last plane, if the
+        // plane it would take is needed by a frequently updated layer.
+        if (plane_index_moved &&
+            ShouldShareLastPlane(layers, layer, composition, layer_begin,
+                                 overlay_end - j)) {
+          j--;
+          DisplayPlaneState &last_plane = composition.back();
+          ISURFACETRACE(
+              "Added static Layer[%d] into last plane[%d] to keep plane free "
+              "for frequently updated layers \n",
+              layer->GetZorder(), last_plane.GetDisplayPlane()->id());
+          last_plane.AddLayer(layer);
+          continue;
+        }
+
         if (j < overlay_end || plane_index_moved) {
           // Separate plane added
           composition.emplace_back(plane, layer, this);
@@ -297,9 +375,341 @@ bool DisplayPlaneManager::ValidateLayers(
     }
   }
 
+  if (full_validation && !composition.empty())
+    CacheAssignment(signature, layers.size(), composition);
+
   return true;
 }
 
+bool DisplayPlaneManager::ValidateLayersWithCostModel(
+    std::vector<OverlayLayer> &layers, DisplayPlaneStateList &composition,
+    std::vector<NativeSurface *> &mark_later) {
+  CTRACE();
+  // Cursor is handled separately, same as greedy path.
+  std::vector<OverlayLayer *> candidates;
+  std::vector<OverlayLayer *> cursor_layers;
+  for (OverlayLayer &layer : layers) {
+    if (layer.IsCursorLayer() && cursor_plane_) {
+      cursor_layers.emplace_back(&layer);
+      continue;
+    }
+
+    candidates.emplace_back(&layer);
+  }
+
+  std::vector<DisplayPlane *> planes;
+  for (auto &plane : overlay_planes_) {
+    if (plane.get() != cursor_plane_)
+      planes.emplace_back(plane.get());
+  }
+
+  size_t total_layers = candidates.size();
+  size_t total_planes = planes.size();
+  if (!total_layers || !total_planes)
+    return false;
+
+  // scanout_cost[l * total_planes + p] is the cost of scanning out layer l
+  // directly with plane p, 0 if the plane cannot do it.
+  std::vector<uint64_t> scanout_cost(total_layers * total_planes, 0);
+  for (size_t l = 0; l < total_layers; l++) {
+    OverlayLayer *layer = candidates.at(l);
+    OverlayBuffer *layer_buffer = layer->GetBuffer();
+    if (layer->IsSolidColor() || layer->IsVideoLayer() || !layer_buffer ||
+        layer_buffer->GetFb() == 0)
+      continue;
+
+    uint64_t area = static_cast<uint64_t>(layer->GetDisplayFrameWidth()) *
+                    layer->GetDisplayFrameHeight();
+    for (size_t p = 0; p < total_planes; p++) {
+      if (planes.at(p)->ValidateLayer(layer))
+        scanout_cost[l * total_planes + p] = std::max<uint64_t>(area, 1);
+    }
+  }
+
+  // Cost of compositing layers [begin, end) with GPU and scanning out the
+  // offscreen surface. 0 if the run cannot be handled by one plane.
+  auto gpu_cost = [&candidates](size_t begin, size_t end) -> uint64_t {
+    uint64_t pixels = 0;
+    uint64_t pixel_cost = kGpuPixelCost;
+    HwcRect<int> bounds;
+    for (size_t l = begin; l < end; l++) {
+      const OverlayLayer *layer = candidates.at(l);
+      // Media content needs a plane of its own.
+      if (layer->IsVideoLayer() && (end - begin) > 1)
+        return 0;
+
+      if (layer->IsFrequentlyUpdated())
+        pixel_cost = kGpuPixelCost * kFrequentUpdateCostFactor;
+
+      pixels += static_cast<uint64_t>(layer->GetDisplayFrameWidth()) *
+                layer->GetDisplayFrameHeight();
+      CalculateRect(layer->GetDisplayFrame(), bounds);
+    }
+
+    uint64_t surface_area =
+        static_cast<uint64_t>(bounds.right - bounds.left) *
+        (bounds.bottom - bounds.top);
+    return pixels * pixel_cost + surface_area + kOffScreenSurfaceCost;
+  };
+
+  // cost[i * (total_planes + 1) + j] is the minimum cost of showing the
+  // first i layers using the first j planes, each plane taking a contiguous
+  // run of layers. run_begin remembers where the last run starts.
+  const uint64_t kInvalid = std::numeric_limits<uint64_t>::max();
+  size_t stride = total_planes + 1;
+  std::vector<uint64_t> cost((total_layers + 1) * stride, kInvalid);
+  std::vector<size_t> run_begin((total_layers + 1) * stride, 0);
+  cost[0] = 0;
+  for (size_t j = 1; j <= total_planes; j++) {
+    for (size_t i = 1; i <= total_layers; i++) {
+      for (size_t a = j - 1; a < i; a++) {
+        uint64_t previous = cost[a * stride + j - 1];
+        if (previous == kInvalid)
+          continue;
+
+        uint64_t run_cost = 0;
+        if (i - a == 1)
+          run_cost = scanout_cost[a * total_planes + j - 1];
+        if (!run_cost)
+          run_cost = gpu_cost(a, i);
+        if (!run_cost)
+          continue;
+
+        if (previous + run_cost < cost[i * stride + j]) {
+          cost[i * stride + j] = previous + run_cost;
+          run_begin[i * stride + j] = a;
+        }
+      }
+    }
+  }
+
+  size_t used_planes = 0;
+  uint64_t best_cost = kInvalid;
+  for (size_t j = 1; j <= total_planes; j++) {
+    if (cost[total_layers * stride + j] < best_cost) {
+      best_cost = cost[total_layers * stride + j];
+      used_planes = j;
+    }
+  }
+
+  if (best_cost == kInvalid)
+    return false;
+
+  std::vector<size_t> runs(used_planes + 1, total_layers);
+  for (size_t j = used_planes, i = total_layers; j > 0; j--) {
+    i = run_begin[i * stride + j];
+    runs[j - 1] = i;
+  }
+
+  ISURFACETRACE("Cost model assignment: %d layers on %d planes cost %llu \n",
+                total_layers, used_planes,
+                static_cast<unsigned long long>(best_cost));
+
+  for (size_t j = 0; j < used_planes; j++) {
+    DisplayPlane *plane = planes.at(j);
+    OverlayLayer *layer = candidates.at(runs[j]);
+    bool scanout = (runs[j + 1] - runs[j] == 1) &&
+                   scanout_cost[runs[j] * total_planes + j];
+    composition.emplace_back(plane, layer, this);
+    DisplayPlaneState &last_plane = composition.back();
+    for (size_t l = runs[j] + 1; l < runs[j + 1]; l++) {
+      last_plane.AddLayer(candidates.at(l));
+    }
+
+    if (scanout) {
+      layer->SupportedDisplayComposition(OverlayLayer::kAll);
+    } else {
+      layer->SupportedDisplayComposition(OverlayLayer::kGpu);
+      if (!last_plane.NeedsOffScreenComposition())
+        last_plane.ForceGPURendering();
+    }
+  }
+
+  if (!plane_handler_->TestCommit(composition)) {
+    ISURFACETRACE("Cost model assignment failed, using greedy path. \n");
+    for (DisplayPlaneState &plane : composition) {
+      MarkSurfacesForRecycling(&plane, mark_later, false);
+      plane.GetDisplayPlane()->SetInUse(false);
+    }
+
+    DisplayPlaneStateList().swap(composition);
+    return false;
+  }
+
+  if (!cursor_layers.empty()) {
+    if (cursor_layers.size() > 1) {
+      ETRACE("More than 1 cursor layers found, we don't support it");
+    }
+
+    composition.emplace_back(cursor_plane_, cursor_layers[0], this);
+    if (FallbacktoGPU(cursor_plane_, cursor_layers[0], composition)) {
+      composition.pop_back();
+      cursor_plane_->SetInUse(false);
+      // fallback to GPU compostion for cursor layers
+      composition.back().AddLayer(cursor_layers[0]);
+    }
+  }
+
+  ValidateAssignedPlanes(composition);
+  return true;
+}
+
+void DisplayPlaneManager::EnableCostModelAllocator(bool enable) {
+  if (use_cost_model_ != enable)
+    InvalidateAssignmentCache();
+
+  use_cost_model_ = enable;
+}
+
+uint64_t DisplayPlaneManager::GetLayersSignature(
+    const std::vector<OverlayLayer> &layers) const {
+  uint64_t hash = kHashSeed;
+  for (const OverlayLayer &layer : layers) {
+    OverlayBuffer *buffer = layer.GetBuffer();
+    if (buffer) {
+      HashCombine(hash, buffer->GetFormat());
+      HashCombine(hash, buffer->GetTilingMode());
+    } else {
+      HashCombine(hash, 0);
+      HashCombine(hash, 0);
+    }
+
+    HashCombine(hash, layer.GetSourceCropWidth());
+    HashCombine(hash, layer.GetSourceCropHeight());
+    HashCombine(hash, layer.GetDisplayFrameWidth());
+    HashCombine(hash, layer.GetDisplayFrameHeight());
+    HashCombine(hash, layer.GetMergedTransform());
+    HashCombine(hash, layer.GetAlpha());
+    HashCombine(hash, static_cast<uint32_t>(layer.GetBlending()));
+    uint32_t type = (layer.IsCursorLayer() << 0) | (layer.IsVideoLayer() << 1) |
+                    (layer.IsProtected() << 2) | (layer.IsSolidColor() << 3) |
+                    (layer.IsFrequentlyUpdated() << 4);
+    HashCombine(hash, type);
+  }
+
+  return hash;
+}
+
+bool DisplayPlaneManager::ApplyCachedAssignment(
+    uint64_t signature, std::vector<OverlayLayer> &layers,
+    DisplayPlaneStateList &composition,
+    std::vector<NativeSurface *> &mark_later) {
+  auto entry = assignment_cache_.begin();
+  for (; entry != assignment_cache_.end(); ++entry) {
+    if ((entry->signature_ == signature) &&
+        (entry->total_layers_ == layers.size()))
+      break;
+  }
+
+  if (entry == assignment_cache_.end())
+    return false;
+
+  // Mark entry as most recently used.
+  assignment_cache_.splice(assignment_cache_.begin(), assignment_cache_,
+                           entry);
+  const AssignmentCacheEntry &cached = assignment_cache_.front();
+
+  bool status = true;
+  for (const PlaneAssignment &assignment : cached.planes_) {
+    if (assignment.plane_index_ >= overlay_planes_.size()) {
+      status = false;
+      break;
+    }
+
+    DisplayPlane *plane = overlay_planes_.at(assignment.plane_index_).get();
+    OverlayLayer *layer = &(layers.at(assignment.source_layers_.at(0)));
+    if (assignment.scanout_) {
+      // Same checks FallbacktoGPU does before issuing a test commit.
+      OverlayBuffer *layer_buffer = layer->GetBuffer();
+      if (!layer_buffer || (layer_buffer->GetFb() == 0) ||
+          !plane->ValidateLayer(layer)) {
+        status = false;
+        break;
+      }
+    }
+
+    composition.emplace_back(plane, layer, this);
+    DisplayPlaneState &last_plane = composition.back();
+    size_t total_layers = assignment.source_layers_.size();
+    for (size_t i = 1; i < total_layers; i++) {
+      last_plane.AddLayer(&(layers.at(assignment.source_layers_.at(i))));
+    }
+
+    if (assignment.scanout_) {
+      layer->SupportedDisplayComposition(OverlayLayer::kAll);
+    } else {
+      layer->SupportedDisplayComposition(OverlayLayer::kGpu);
+      if (!last_plane.NeedsOffScreenComposition())
+        last_plane.ForceGPURendering();
+    }
+  }
+
+  if (status && plane_handler_->TestCommit(composition)) {
+    ISURFACETRACE("Re-using cached plane assignment for %d layers. \n",
+                  layers.size());
+    ValidateAssignedPlanes(composition);
+    return true;
+  }
+
+  ISURFACETRACE("Cached plane assignment failed, doing full validation. \n");
+  for (DisplayPlaneState &plane : composition) {
+    MarkSurfacesForRecycling(&plane, mark_later, false);
+    plane.GetDisplayPlane()->SetInUse(false);
+  }
+
+  DisplayPlaneStateList().swap(composition);
+  assignment_cache_.pop_front();
+  return false;
+}
+
+void DisplayPlaneManager::ValidateAssignedPlanes(
+    DisplayPlaneStateList &composition) {
+  for (DisplayPlaneState &plane : composition) {
+    if (plane.NeedsOffScreenComposition())
+      ValidateForDisplayScaling(plane, composition);
+  }
+}
+
+void DisplayPlaneManager::CacheAssignment(
+    uint64_t signature, size_t total_layers,
+    const DisplayPlaneStateList &composition) {
+  AssignmentCacheEntry entry;
+  entry.signature_ = signature;
+  entry.total_layers_ = total_layers;
+  for (const DisplayPlaneState &plane : composition) {
+    PlaneAssignment assignment;
+    DisplayPlane *display_plane = plane.GetDisplayPlane();
+    size_t total_planes = overlay_planes_.size();
+    for (size_t i = 0; i < total_planes; i++) {
+      if (overlay_planes_.at(i).get() == display_plane) {
+        assignment.plane_index_ = i;
+        break;
+      }
+    }
+
+    assignment.source_layers_ = plane.GetSourceLayers();
+    assignment.scanout_ = !plane.NeedsOffScreenComposition();
+    entry.planes_.emplace_back(std::move(assignment));
+  }
+
+  // Replace any stale entry for the same layer stack.
+  for (auto it = assignment_cache_.begin(); it != assignment_cache_.end();
+       ++it) {
+    if (it->signature_ == signature && it->total_layers_ == total_layers) {
+      assignment_cache_.erase(it);
+      break;
+    }
+  }
+
+  assignment_cache_.emplace_front(std::move(entry));
+  if (assignment_cache_.size() > kMaxAssignmentCacheSize)
+    assignment_cache_.pop_back();
+}
+
+void DisplayPlaneManager::InvalidateAssignmentCache() {
+  std::list<AssignmentCacheEntry>().swap(assignment_cache_);
+}
+
 DisplayPlaneState *DisplayPlaneManager::GetLastUsedOverlay(
     DisplayPlaneStateList &composition) {
   CTRACE();
@@ -440,39 +850,234 @@ void DisplayPlaneManager::ReleaseUnreservedPlanes(
     plane_index++;
   }
   ResizeOverlays();
+  InvalidateAssignmentCache();
 }
 
 void DisplayPlaneManager::ReleaseAllOffScreenTargets() {
   CTRACE();
-  std::vector<std::unique_ptr<NativeSurface>>().swap(surfaces_);
+  ScopedSpinLock lock(surface_pool_lock_);
+  std::vector<SurfaceBucket>().swap(surface_buckets_);
+  surface_pool_stats_.surfaces_ = 0;
+  surface_pool_stats_.bytes_ = 0;
 }
 
 void DisplayPlaneManager::ReleaseFreeOffScreenTargets(bool forced) {
   if (!release_surfaces_ && !forced)
     return;
+
+  ScopedSpinLock lock(surface_pool_lock_);
 #ifdef SURFACE_RECYCLE_TRACING
   ISURFACERECYCLETRACE(
       "invoking ReleaseFreeOffScreenTargets --forced:%d, "
-      "--release_surfaces_:%d, surfaces_.size() = %d",
-      forced, release_surfaces_, surfaces_.size());
+      "--release_surfaces_:%d, surfaces: %zu bytes: %zu",
+      forced, release_surfaces_, surface_pool_stats_.surfaces_,
+      surface_pool_stats_.bytes_);
+#endif
+  // Keep free surfaces around for re-use unless forced, as long as
+  // they fit in the budget.
+  EvictOffScreenTargets(forced ? 0 : surface_pool_budget_);
+#ifdef SURFACE_RECYCLE_TRACING
+  ISURFACERECYCLETRACE(
+      "After ReleaseFreeOffScreenTargets surfaces: %zu bytes: %zu hits: %d "
+      "misses: %d evictions: %d",
+      surface_pool_stats_.surfaces_, surface_pool_stats_.bytes_,
+      surface_pool_stats_.hits_, surface_pool_stats_.misses_,
+      surface_pool_stats_.evictions_);
 #endif
-  std::vector<std::unique_ptr<NativeSurface>> surfaces;
-  for (auto &fb : surfaces_) {
-    if (fb->IsOnScreen()) {
-      surfaces.emplace_back(fb.release());
+  release_surfaces_ = false;
+}
+
+void DisplayPlaneManager::EvictOffScreenTargets(size_t budget_bytes) {
+  // Free surfaces not of display size can never be handed out again.
+  for (auto bucket = surface_buckets_.begin();
+       bucket != surface_buckets_.end();) {
+    if (bucket->width_ != width_ || bucket->height_ != height_) {
+      std::vector<PooledSurface> &surfaces = bucket->surfaces_;
+      for (auto pooled = surfaces.begin(); pooled != surfaces.end();) {
+        if (pooled->surface_->IsOnScreen()) {
+          pooled++;
+          continue;
+        }
+
+        surface_pool_stats_.bytes_ -= pooled->size_;
+        surface_pool_stats_.surfaces_--;
+        surface_pool_stats_.evictions_++;
+        pooled = surfaces.erase(pooled);
+      }
     }
+
+    if (bucket->surfaces_.empty()) {
+      bucket = surface_buckets_.erase(bucket);
+    } else {
+      bucket++;
+    }
+  }
+
+  while (surface_pool_stats_.bytes_ > budget_bytes) {
+    std::vector<SurfaceBucket>::iterator lru_bucket = surface_buckets_.end();
+    size_t lru_index = 0;
+    uint64_t lru_time = std::numeric_limits<uint64_t>::max();
+    for (auto bucket = surface_buckets_.begin();
+         bucket != surface_buckets_.end(); bucket++) {
+      for (size_t i = 0; i < bucket->surfaces_.size(); i++) {
+        const PooledSurface &pooled = bucket->surfaces_.at(i);
+        if (pooled.surface_->IsOnScreen() || pooled.last_used_ >= lru_time)
+          continue;
+
+        lru_bucket = bucket;
+        lru_index = i;
+        lru_time = pooled.last_used_;
+      }
+    }
+
+    // Everything left is in use.
+    if (lru_bucket == surface_buckets_.end())
+      break;
+
+    surface_pool_stats_.bytes_ -= lru_bucket->surfaces_.at(lru_index).size_;
+    surface_pool_stats_.surfaces_--;
+    surface_pool_stats_.evictions_++;
+    lru_bucket->surfaces_.erase(lru_bucket->surfaces_.begin() + lru_index);
+    if (lru_bucket->surfaces_.empty())
+      surface_buckets_.erase(lru_bucket);
   }
+}
 
-  surfaces.swap(surfaces_);
+void DisplayPlaneManager::SetSurfacePoolBudget(size_t budget_bytes) {
+  ScopedSpinLock lock(surface_pool_lock_);
+  surface_pool_budget_ = budget_bytes;
+  release_surfaces_ = true;
+}
+
+void DisplayPlaneManager::PreWarmOffScreenTargets() {
+  if (overlay_planes_.empty())
+    return;
+
+  // Primary plane is the one most likely to need GPU composition.
+  DisplayPlane *plane = overlay_planes_.front().get();
+  size_t expected_size = static_cast<size_t>(width_) * height_ * 4;
+  while (true) {
+    uint32_t format = plane->GetPreferredFormat();
+    uint64_t modifier = plane->GetPreferredFormatModifier();
+    surface_pool_lock_.lock();
+    SurfaceBucket *bucket =
+        GetSurfaceBucket(format, modifier, hwcomposer::kLayerNormal);
+    bool pre_warmed =
+        (bucket && bucket->surfaces_.size() >= kPreWarmedSurfaces) ||
+        surface_pool_stats_.bytes_ + expected_size > surface_pool_budget_;
+    surface_pool_lock_.unlock();
+    if (pre_warmed)
+      break;
+
+    // Allocation happens without the pool lock, so that it doesn't hold
+    // up the present thread.
+    std::unique_ptr<NativeSurface> surface(AllocateOffScreenTarget(
+        plane, format, modifier, hwcomposer::kLayerNormal, false));
+    if (!surface->GetLayer()->GetBuffer()) {
+      ETRACE("Failed to pre-warm offscreen surface.");
+      break;
+    }
+
+    // Free to be used by any plane.
+    surface->SetSurfaceAge(-1);
+    ScopedSpinLock lock(surface_pool_lock_);
+    AddOffScreenTarget(surface.release(), format, hwcomposer::kLayerNormal);
+    surface_pool_stats_.pre_warmed_++;
+  }
+}
+
+DisplayPlaneManager::SurfaceBucket *DisplayPlaneManager::GetSurfaceBucket(
+    uint32_t format, uint64_t modifier, uint32_t usage) {
+  for (SurfaceBucket &bucket : surface_buckets_) {
+    if (bucket.width_ == width_ && bucket.height_ == height_ &&
+        bucket.format_ == format && bucket.modifier_ == modifier &&
+        bucket.usage_ == usage)
+      return &bucket;
+  }
+
+  return NULL;
+}
+
+NativeSurface *DisplayPlaneManager::CreateOffScreenTarget(DisplayPlane *plane,
+                                                          uint32_t format,
+                                                          uint64_t modifier,
+                                                          uint32_t usage,
+                                                          bool video_layer) {
+  NativeSurface *new_surface =
+      AllocateOffScreenTarget(plane, format, modifier, usage, video_layer);
+  ScopedSpinLock lock(surface_pool_lock_);
+  AddOffScreenTarget(new_surface, format, usage);
+  return new_surface;
+}
+
+NativeSurface *DisplayPlaneManager::AllocateOffScreenTarget(
+    DisplayPlane *plane, uint32_t format, uint64_t modifier, uint32_t usage,
+    bool video_layer) {
+  NativeSurface *new_surface = NULL;
+  if (usage == hwcomposer::kLayerVideo) {
 #ifdef SURFACE_RECYCLE_TRACING
-  ISURFACERECYCLETRACE(
-      "After ReleaseFreeOffScreenTargets surfaces_.size() = %d",
-      surfaces_.size());
+    ISURFACERECYCLETRACE("CreateVideoSurface for plane[%d]", plane->id());
+#endif
+    new_surface = CreateVideoSurface(width_, height_);
+  } else {
+#ifdef SURFACE_RECYCLE_TRACING
+    ISURFACERECYCLETRACE("Create3DSurface for plane[%d]", plane->id());
+#endif
+    new_surface = Create3DSurface(width_, height_);
+  }
+
+  bool modifer_succeeded = false;
+  new_surface->Init(resource_manager_, format, usage, modifier,
+                    &modifer_succeeded);
+  if (video_layer)
+    new_surface->GetLayer()->SetVideoLayer(true);
+
+  if (modifer_succeeded) {
+    plane->PreferredFormatModifierValidated();
+  } else {
+    plane->BlackListPreferredFormatModifier();
+  }
+
+  return new_surface;
+}
+
+void DisplayPlaneManager::AddOffScreenTarget(NativeSurface *new_surface,
+                                             uint32_t format, uint32_t usage) {
+  // Bucket by what was actually allocated, modifier might have been
+  // dropped.
+  OverlayBuffer *layer_buffer = new_surface->GetLayer()->GetBuffer();
+  uint32_t surface_format = layer_buffer ? layer_buffer->GetFormat() : format;
+  uint64_t surface_modifier = new_surface->GetModifier();
+  SurfaceBucket *bucket =
+      GetSurfaceBucket(surface_format, surface_modifier, usage);
+  if (!bucket) {
+    surface_buckets_.emplace_back();
+    bucket = &surface_buckets_.back();
+    bucket->width_ = width_;
+    bucket->height_ = height_;
+    bucket->format_ = surface_format;
+    bucket->modifier_ = surface_modifier;
+    bucket->usage_ = usage;
+  }
+
+  bucket->surfaces_.emplace_back();
+  PooledSurface &pooled = bucket->surfaces_.back();
+  pooled.surface_.reset(new_surface);
+  pooled.last_used_ = surface_pool_clock_;
+  pooled.size_ = GetSurfaceSize(new_surface);
+  surface_pool_stats_.surfaces_++;
+  surface_pool_stats_.bytes_ += pooled.size_;
+#ifdef SURFACE_RECYCLE_TRACING
+  ISURFACERECYCLETRACE("Add new surface into pool, surfaces: %zu bytes: %zu",
+                       surface_pool_stats_.surfaces_,
+                       surface_pool_stats_.bytes_);
 #endif
-  release_surfaces_ = false;
 }
 
 void DisplayPlaneManager::SetDisplayTransform(uint32_t transform) {
+  if (display_transform_ != transform)
+    InvalidateAssignmentCache();
+
   display_transform_ = transform;
 }
 
@@ -493,72 +1098,52 @@ void DisplayPlaneManager::EnsureOffScreenTarget(DisplayPlaneState &plane,
     preferred_format = plane.GetDisplayPlane()->GetPreferredFormat();
   }
 
+  if (video_separate && !force_normal_surface)
+    usage = hwcomposer::kLayerVideo;
+
   uint64_t preferred_modifier =
       plane.GetDisplayPlane()->GetPreferredFormatModifier();
   if (plane.IsVideoPlane())
     preferred_modifier = 0;
-  size_t surface_index = 0;
-  for (auto &srf : surfaces_) {
-    if (srf->GetSurfaceAge() == -1) {
-      OverlayBuffer *layer_buffer = srf->GetLayer()->GetBuffer();
-      if (!layer_buffer) {
+
+  surface_pool_lock_.lock();
+  surface_pool_clock_++;
+  SurfaceBucket *bucket =
+      GetSurfaceBucket(preferred_format, preferred_modifier, usage);
+  if (bucket) {
+    for (PooledSurface &pooled : bucket->surfaces_) {
+      NativeSurface *srf = pooled.surface_.get();
+      if (srf->GetSurfaceAge() != -1)
+        continue;
+
+      if (!srf->GetLayer()->GetBuffer()) {
 #ifdef SURFACE_RECYCLE_TRACING
         ISURFACERECYCLETRACE(
-            "Layer buffer is null, skip surface[%d] for plane[%d]/layer",
-            surface_index, plane.GetDisplayPlane()->id());
+            "Layer buffer is null, skip surface for plane[%d]/layer",
+            plane.GetDisplayPlane()->id());
 #endif
-        surface_index++;
         continue;
       }
-      uint32_t surface_format = layer_buffer->GetFormat();
-      if ((preferred_format == surface_format) &&
-          (preferred_modifier == srf->GetModifier())) {
-#ifdef SURFACE_RECYCLE_TRACING
-        ISURFACERECYCLETRACE("Reuse surface[%d] for the plane[%d].",
-                             surface_index, plane.GetDisplayPlane()->id());
-#endif
-        surface = srf.get();
-        break;
-      }
-    }
-    surface_index++;
-  }
 
-  if (!surface) {
-    NativeSurface *new_surface = NULL;
-    if (video_separate && !force_normal_surface) {
 #ifdef SURFACE_RECYCLE_TRACING
-      ISURFACERECYCLETRACE("CreateVideoSurface for plane[%d]",
+      ISURFACERECYCLETRACE("Reuse surface for the plane[%d].",
                            plane.GetDisplayPlane()->id());
 #endif
-      new_surface = CreateVideoSurface(width_, height_);
-      usage = hwcomposer::kLayerVideo;
-    } else {
-#ifdef SURFACE_RECYCLE_TRACING
-      ISURFACERECYCLETRACE("Create3DSurface for plane[%d]",
-                           plane.GetDisplayPlane()->id());
-#endif
-      new_surface = Create3DSurface(width_, height_);
-    }
-
-    bool modifer_succeeded = false;
-    new_surface->Init(resource_manager_, preferred_format, usage,
-                      preferred_modifier, &modifer_succeeded);
-    if (video_separate)
-      new_surface->GetLayer()->SetVideoLayer(true);
-
-    if (modifer_succeeded) {
-      plane.GetDisplayPlane()->PreferredFormatModifierValidated();
-    } else {
-      plane.GetDisplayPlane()->BlackListPreferredFormatModifier();
+      pooled.last_used_ = surface_pool_clock_;
+      surface = srf;
+      break;
     }
+  }
 
-    surfaces_.emplace_back(std::move(new_surface));
-#ifdef SURFACE_RECYCLE_TRACING
-    ISURFACERECYCLETRACE("Add new surface into surfaces_[%d]",
-                         surfaces_.size());
-#endif
-    surface = surfaces_.back().get();
+  if (surface) {
+    surface_pool_stats_.hits_++;
+    surface_pool_lock_.unlock();
+  } else {
+    surface_pool_stats_.misses_++;
+    surface_pool_lock_.unlock();
+    surface =
+        CreateOffScreenTarget(plane.GetDisplayPlane(), preferred_format,
+                              preferred_modifier, usage, video_separate);
   }
 
   surface->SetPlaneTarget(plane);
@@ -593,8 +1178,10 @@ bool DisplayPlaneManager::FallbacktoGPU(
   // TODO(kalyank): Take relevant factors into consideration to determine if
   // Plane Composition makes sense. i.e. layer size etc
   if (!plane_handler_->TestCommit(composition)) {
+    target_plane->LayerTestCommitted(layer, false);
     return true;
   }
+  target_plane->LayerTestCommitted(layer, true);
   layer->SupportedDisplayComposition(OverlayLayer::kAll);
   return false;
 }
@@ -996,6 +1583,44 @@ bool DisplayPlaneManager::SquashPlanesAsNeeded(
   return status;
 }
 
+bool DisplayPlaneManager::ShouldShareLastPlane(
+    const std::vector<OverlayLayer> &layers, const OverlayLayer *layer,
+    const DisplayPlaneStateList &composition,
+    std::vector<OverlayLayer>::const_iterator next_layer,
+    size_t free_planes) const {
+  if (composition.empty() || layer->IsFrequentlyUpdated() ||
+      layer->PreferSeparatePlane())
+    return false;
+
+  const DisplayPlaneState &last_plane = composition.back();
+  if (last_plane.IsVideoPlane() || last_plane.IsCursorPlane())
+    return false;
+
+  // Adding a static layer to a plane which is recomposited every frame
+  // anyway doesn't help.
+  for (const size_t &index : last_plane.GetSourceLayers()) {
+    if (layers.at(index).IsFrequentlyUpdated())
+      return false;
+  }
+
+  size_t remaining_layers = 0;
+  size_t frequently_updated = 0;
+  for (auto i = next_layer; i != layers.end(); ++i) {
+    if (i->IsCursorLayer() && cursor_plane_)
+      continue;
+
+    remaining_layers++;
+    if (i->IsFrequentlyUpdated() && !i->PreferSeparatePlane())
+      frequently_updated++;
+  }
+
+  // Every layer above gets a plane of its own anyway.
+  if (remaining_layers <= free_planes)
+    return false;
+
+  return frequently_updated > 0;
+}
+
 bool DisplayPlaneManager::ForceSeparatePlane(
     const DisplayPlaneState &last_plane, const OverlayLayer *target_layer) {
   if (last_plane.IsVideoPlane() || last_plane.IsCursorPlane())
@@ -17,11 +17,14 @@
 #ifndef COMMON_DISPLAY_DISPLAYPLANEMANAGER_H_
 #define COMMON_DISPLAY_DISPLAYPLANEMANAGER_H_
 
+#include <list>
 #include <map>
 #include <memory>
 #include <tuple>
 #include <vector>
 
+#include <spinlock.h>
+
 #include "displayplanehandler.h"
 #include "displayplanestate.h"
 
@@ -36,6 +39,21 @@ struct OverlayLayer;
 
 class DisplayPlaneManager {
  public:
+  // Statistics of offscreen surface pool.
+  struct SurfacePoolStats {
+    // Requests served with an existing free surface.
+    uint32_t hits_ = 0;
+    // Requests which had to allocate a new surface.
+    uint32_t misses_ = 0;
+    // Free surfaces released to stay within budget.
+    uint32_t evictions_ = 0;
+    // Surfaces allocated by PreWarmOffScreenTargets.
+    uint32_t pre_warmed_ = 0;
+    // Current number and total size of pooled surfaces.
+    size_t surfaces_ = 0;
+    size_t bytes_ = 0;
+  };
+
   DisplayPlaneManager(DisplayPlaneHandler *plane_handler,
                       ResourceManager *resource_manager);
 
@@ -68,12 +86,30 @@ class DisplayPlaneManager {
 
   bool CheckPlaneFormat(uint32_t format);
 
+  // Releases free surfaces exceeding pool budget, least recently used
+  // first. All free surfaces are released if forced is true.
   void ReleaseFreeOffScreenTargets(bool forced = false);
 
   void ReleaseAllOffScreenTargets();
 
   bool HasSurfaces() const {
-    return !surfaces_.empty();
+    ScopedSpinLock lock(surface_pool_lock_);
+    return !surface_buckets_.empty();
+  }
+
+  // Sets memory budget of offscreen surfaces. Free surfaces are
+  // released, least recently used first, when pool exceeds it.
+  void SetSurfacePoolBudget(size_t budget_bytes);
+
+  // Allocates offscreen surfaces for GPU composition ahead of time, so
+  // that first frames falling back to GPU don't need to allocate them.
+  // Can be called from a thread other than the present one, surfaces are
+  // allocated without holding the pool lock.
+  void PreWarmOffScreenTargets();
+
+  SurfacePoolStats GetSurfacePoolStats() const {
+    ScopedSpinLock lock(surface_pool_lock_);
+    return surface_pool_stats_;
   }
 
   uint32_t GetHeight() const {
@@ -115,6 +151,15 @@ class DisplayPlaneManager {
                               std::vector<NativeSurface *> &mark_later,
                               bool *validate_final_layers);
 
+  // Returns true if layer should be composited with layers of last plane
+  // in composition, so that the plane it would take can be used by a
+  // frequently updated layer from next_layer onwards.
+  bool ShouldShareLastPlane(
+      const std::vector<OverlayLayer> &layers, const OverlayLayer *layer,
+      const DisplayPlaneStateList &composition,
+      std::vector<OverlayLayer>::const_iterator next_layer,
+      size_t free_planes) const;
+
   // Returns true if we want to force target_layer to a separate plane than
   // adding it to
   // last_plane.
@@ -128,7 +173,123 @@ class DisplayPlaneManager {
   void EnsureOffScreenTarget(DisplayPlaneState &plane,
                              bool force_normal_surface = false);
 
+  // Number of full validations which re-used a previously validated
+  // plane assignment.
+  uint32_t GetAssignmentCacheHits() const {
+    return assignment_cache_hits_;
+  }
+
+  // Number of full validations which had to go through the complete
+  // plane assignment.
+  uint32_t GetAssignmentCacheMisses() const {
+    return assignment_cache_misses_;
+  }
+
+  // Selects the strategy used by ValidateLayers for a full validation.
+  // When enabled, layers are assigned to planes by minimizing an
+  // estimated composition cost instead of the greedy z-order sweep.
+  // The greedy sweep is still used for incremental validation and
+  // whenever the cost based assignment fails.
+  void EnableCostModelAllocator(bool enable);
+
+  bool IsCostModelAllocatorEnabled() const {
+    return use_cost_model_;
+  }
+
+  // Drops all cached plane assignments. Needs to be called whenever
+  // the planes or display state they were validated against change.
+  void InvalidateAssignmentCache();
+
  private:
+  struct PooledSurface {
+    std::unique_ptr<NativeSurface> surface_;
+    // Value of surface_pool_clock_ when surface was last handed out.
+    uint64_t last_used_ = 0;
+    size_t size_ = 0;
+  };
+
+  // Offscreen surfaces sharing same buffer attributes, any free one
+  // can be used for a plane needing these attributes.
+  struct SurfaceBucket {
+    uint32_t width_ = 0;
+    uint32_t height_ = 0;
+    uint32_t format_ = 0;
+    uint64_t modifier_ = 0;
+    uint32_t usage_ = 0;
+    std::vector<PooledSurface> surfaces_;
+  };
+
+  // Returns bucket for surfaces with given attributes of display size,
+  // NULL if there is none. Needs surface_pool_lock_.
+  SurfaceBucket *GetSurfaceBucket(uint32_t format, uint64_t modifier,
+                                  uint32_t usage);
+
+  // Allocates a new offscreen surface and adds it to the pool. Modifier
+  // used by the surface is reported back to plane.
+  NativeSurface *CreateOffScreenTarget(DisplayPlane *plane, uint32_t format,
+                                       uint64_t modifier, uint32_t usage,
+                                       bool video_layer);
+
+  // Allocates a new offscreen surface without adding it to the pool.
+  NativeSurface *AllocateOffScreenTarget(DisplayPlane *plane, uint32_t format,
+                                         uint64_t modifier, uint32_t usage,
+                                         bool video_layer);
+
+  // Adds new_surface to the pool, in the bucket of what was actually
+  // allocated for it. Needs surface_pool_lock_.
+  void AddOffScreenTarget(NativeSurface *new_surface, uint32_t format,
+                          uint32_t usage);
+
+  // Releases least recently used free surfaces till pool size is at most
+  // budget_bytes, or there are no more free surfaces. Needs
+  // surface_pool_lock_.
+  void EvictOffScreenTargets(size_t budget_bytes);
+
+  // Layers handled by one plane in a cached assignment.
+  struct PlaneAssignment {
+    // Index of the plane in overlay_planes_.
+    size_t plane_index_ = 0;
+    // Z-orders of layers composited by this plane.
+    std::vector<size_t> source_layers_;
+    // True if the plane scans out its layer directly.
+    bool scanout_ = false;
+  };
+
+  struct AssignmentCacheEntry {
+    uint64_t signature_ = 0;
+    size_t total_layers_ = 0;
+    std::vector<PlaneAssignment> planes_;
+  };
+
+  // Returns a hash of all attributes of layers which have an impact on
+  // plane assignment.
+  uint64_t GetLayersSignature(const std::vector<OverlayLayer> &layers) const;
+
+  // Tries to re-use a cached plane assignment for layers. Returns true
+  // if the cached assignment passed a test commit and composition has
+  // been populated.
+  bool ApplyCachedAssignment(uint64_t signature,
+                             std::vector<OverlayLayer> &layers,
+                             DisplayPlaneStateList &composition,
+                             std::vector<NativeSurface *> &mark_later);
+
+  // Assigns layers to planes by dynamic programming over contiguous
+  // z-order runs, each run being either scanned out directly (single
+  // layer) or composited by GPU into an offscreen surface. Returns
+  // false if no assignment passed the test commit, in which case
+  // composition is left empty.
+  bool ValidateLayersWithCostModel(std::vector<OverlayLayer> &layers,
+                                   DisplayPlaneStateList &composition,
+                                   std::vector<NativeSurface *> &mark_later);
+
+  // Applies the checks ValidateLayers does on planes as it adds them,
+  // for assignments which are built in one go.
+  void ValidateAssignedPlanes(DisplayPlaneStateList &composition);
+
+  // Stores plane assignment in composition for later re-use.
+  void CacheAssignment(uint64_t signature, size_t total_layers,
+                       const DisplayPlaneStateList &composition);
+
   DisplayPlaneState *GetLastUsedOverlay(DisplayPlaneStateList &composition);
   bool FallbacktoGPU(DisplayPlane *target_plane, OverlayLayer *layer,
                      const DisplayPlaneStateList &composition) const;
@@ -161,7 +322,7 @@ class DisplayPlaneManager {
   DisplayPlaneHandler *plane_handler_;
   ResourceManager *resource_manager_;
   DisplayPlane *cursor_plane_;
-  std::vector<std::unique_ptr<NativeSurface>> surfaces_;
+  std::vector<SurfaceBucket> surface_buckets_;
   std::vector<std::unique_ptr<DisplayPlane>> overlay_planes_;
 
   uint32_t width_;
@@ -169,6 +330,17 @@ class DisplayPlaneManager {
   uint32_t total_overlays_;
   uint32_t display_transform_;
   bool release_surfaces_;
+  // Most recently used assignment is at the front.
+  std::list<AssignmentCacheEntry> assignment_cache_;
+  uint32_t assignment_cache_hits_ = 0;
+  uint32_t assignment_cache_misses_ = 0;
+  bool use_cost_model_ = false;
+  size_t surface_pool_budget_;
+  uint64_t surface_pool_clock_ = 0;
+  SurfacePoolStats surface_pool_stats_;
+  // Guards surface_buckets_ and the surface pool state above, surfaces
+  // can be pre-warmed from another thread.
+  mutable SpinLock surface_pool_lock_;
 };
 
 }  // namespace hwcomposer
@@ -262,7 +262,8 @@ void DisplayPlaneState::RefreshLayerRects(
   const std::vector<size_t> &current_layers = private_data_->source_layers_;
   HwcRect<int> target_display_frame;
   HwcRect<float> target_source_crop;
-  HwcRect<int> surface_damage = HwcRect<int>(0, 0, 0, 0);
+  HwcRegion &surface_damage = private_data_->layer_damage_;
+  surface_damage.clear();
   for (const size_t &index : current_layers) {
     const OverlayLayer &layer = layers.at(index);
     const HwcRect<int> &df = layer.GetDisplayFrame();
@@ -271,7 +272,9 @@ void DisplayPlaneState::RefreshLayerRects(
     CalculateSourceRect(source_crop, target_source_crop);
 
     if (layer.HasLayerContentChanged()) {
-      CalculateRect(layer.GetSurfaceDamage(), surface_damage);
+      for (const HwcRect<int> &damage : layer.GetSurfaceDamageRegion()) {
+        AddDamageRect(damage, surface_damage);
+      }
     }
   }
 
@@ -496,6 +499,33 @@ void DisplayPlaneState::UpdateDamage(const HwcRect<int> &surface_damage) {
   }
 }
 
+void DisplayPlaneState::UpdateBufferAgeDamage(NativeSurface *surface) {
+  DisplayPlanePrivateState &state = *private_data_;
+  uint64_t frame = ++state.frame_count_;
+  state.damage_history_[frame % kDamageHistorySize] =
+      surface->GetFrameDamage();
+  uint64_t age = surface->GetBufferAge(frame);
+  if (!age || age > kDamageHistorySize) {
+    surface->UpdateSurfaceDamage(state.display_frame_, true);
+  } else {
+    for (uint64_t i = 1; i < age; i++) {
+      const HwcRegion &damage =
+          state.damage_history_[(frame - i) % kDamageHistorySize];
+      if (!damage.empty())
+        surface->UpdateSurfaceDamage(damage, true);
+    }
+  }
+
+  surface->SetRenderedFrame(frame);
+
+  // Damage of this frame is in the history now, other surfaces start
+  // accumulating the next one.
+  for (NativeSurface *other : state.surfaces_) {
+    if (other != surface)
+      other->ResetFrameDamage();
+  }
+}
+
 DisplayPlane *DisplayPlaneState::GetDisplayPlane() const {
   return private_data_->plane_;
 }
@@ -117,6 +117,12 @@ class DisplayPlaneState {
 
   void UpdateDamage(const HwcRect<int> &surface_damage);
 
+  // Called once for every frame composed to surface, the offscreen target
+  // of this plane. Adds damage of the frames since surface was last
+  // rendered, or the whole plane if that is unknown, to its damage and
+  // records damage of this frame for the other surfaces.
+  void UpdateBufferAgeDamage(NativeSurface *surface);
+
   DisplayPlane *GetDisplayPlane() const;
 
   void SetDisplayPlane(DisplayPlane *plane);
@@ -244,6 +250,10 @@ class DisplayPlaneState {
   void UpdateRotateFrame();
   void CalculateSourceCrop(HwcRect<float> &source_crop) const;
 
+  // Frames of damage kept per plane. Surfaces rendered longer ago are
+  // fully redrawn.
+  static const uint32_t kDamageHistorySize = 4;
+
   class DisplayPlanePrivateState {
    public:
     enum class PlaneType : int32_t {
@@ -297,6 +307,13 @@ class DisplayPlaneState {
     // Any offscreen surfaces used by this
     // plane.
     std::vector<NativeSurface *> surfaces_;
+    // Damage of the last kDamageHistorySize frames composed on this plane,
+    // indexed by frame modulo kDamageHistorySize.
+    HwcRegion damage_history_[kDamageHistorySize];
+    // Damage of source layers gathered by RefreshLayerRects.
+    HwcRegion layer_damage_;
+    // Frames composed on this plane, 0 is never used.
+    uint64_t frame_count_ = 0;
     PlaneType type_ = PlaneType::kNormal;
     uint32_t plane_transform_ = kIdentity;
     RotationType rotation_type_ = RotationType::kDisplayRotation;
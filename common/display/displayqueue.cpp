@@ -35,6 +35,23 @@
 
 namespace hwcomposer {
 
+// Time reserved before vblank for an atomic commit to be latched.
+static const int64_t kCommitLatchTime = 2000000;
+
+// Layers are spread over planes again once updates after idle mode went
+// on for kRevalidateTime, with no gap longer than kMaxTrackingInterval.
+static const int64_t kRevalidateTime = 66000000;
+static const int64_t kMaxTrackingInterval = 250000000;
+
+// Returns first vblank after time.
+static int64_t GetNextVblank(int64_t time, int64_t last_vblank,
+                             int64_t period) {
+  if (time < last_vblank)
+    return last_vblank;
+
+  return last_vblank + ((time - last_vblank) / period + 1) * period;
+}
+
 DisplayQueue::DisplayQueue(uint32_t gpu_fd, bool disable_explictsync,
                            NativeBufferHandler* buffer_handler,
                            PhysicalDisplay* display)
@@ -110,6 +127,7 @@ bool DisplayQueue::SetPowerMode(uint32_t power_mode) {
       vblank_handler_->SetPowerMode(kOn);
       power_mode_lock_.lock();
       state_ &= ~kIgnoreIdleRefresh;
+      pre_warm_surfaces_ = true;
       compositor_.Init(resource_manager_.get(), gpu_fd_);
       power_mode_lock_.unlock();
       break;
@@ -163,6 +181,19 @@ void DisplayQueue::ReleaseUnreservedPlanes(
   display_plane_manager_->ReleaseUnreservedPlanes(reserved_planes);
 }
 
+void DisplayQueue::EnableCostModelPlaneAllocator(bool enable) {
+  display_plane_manager_->EnableCostModelAllocator(enable);
+}
+
+void DisplayQueue::SetSurfacePoolBudget(uint32_t budget_mb) {
+  display_plane_manager_->SetSurfacePoolBudget(static_cast<size_t>(budget_mb)
+                                               << 20);
+}
+
+void DisplayQueue::SetCompositorContexts(uint32_t count) {
+  compositor_.SetContextCount(count);
+}
+
 void DisplayQueue::GetCachedLayers(const std::vector<OverlayLayer>& layers,
                                    int& re_validate_begin,
                                    DisplayPlaneStateList& composition) {
@@ -234,7 +265,17 @@ void DisplayQueue::InitializeOverlayLayers(
       previous_layer = &(in_flight_layers_.at(z_order));
     }
 
-    if (scaling_tracker_.scaling_state_ == ScalingTracker::kNeedsScaling) {
+    bool needs_scaling =
+        scaling_tracker_.scaling_state_ == ScalingTracker::kNeedsScaling;
+    // In case attributes are same as last frame, re-use its state and only
+    // pick up the new buffer.
+    bool initialized =
+        previous_layer && !needs_scaling && !handle_constraints &&
+        overlay_layer->InitializeFromPreviousFrame(
+            layer, resource_manager_.get(), previous_layer, z_order,
+            layer_index, display_plane_manager_->GetHeight(),
+            display_plane_manager_->GetWidth(), plane_transform_);
+    if (!initialized && needs_scaling) {
       HwcRect<int> display_frame = layer->GetDisplayFrame();
       display_frame.left =
           display_frame.left +
@@ -253,7 +294,7 @@ void DisplayQueue::InitializeOverlayLayers(
           display_frame, display_plane_manager_->GetHeight(),
           display_plane_manager_->GetWidth(), plane_transform_,
           handle_constraints);
-    } else {
+    } else if (!initialized) {
       overlay_layer->InitializeFromHwcLayer(
           layer, resource_manager_.get(), previous_layer, z_order, layer_index,
           display_plane_manager_->GetHeight(),
@@ -273,6 +314,10 @@ void DisplayQueue::InitializeOverlayLayers(
       if (overlay_layer->IsVideoLayer() != previous_layer->IsVideoLayer()) {
         re_validate_begin = 0;
       }
+      // Plane assignment depends on which layers are frequently updated.
+      if (overlay_layer->HasUpdateFrequencyChanged()) {
+        re_validate_begin = 0;
+      }
       if (re_validate_begin == size) {
         bool need_revalidate =
             overlay_layer->IsSolidColor() != previous_layer->IsSolidColor();
@@ -322,19 +367,28 @@ bool DisplayQueue::AssignAndCommitPlanes(
     std::vector<OverlayLayer>& layers, std::vector<HwcLayer*>* source_layers,
     bool validate_layers, int re_validate_begin, bool setMediaEffect,
     int32_t* retire_fence, ScopedStateTracker* tracker) {
-  DisplayPlaneStateList current_composition_planes;
+  DisplayPlaneStateList& current_composition_planes = composition_planes_;
+  current_composition_planes.clear();
   bool render_layers = false;
   bool composition_passed = true;
-  bool disable_overlays = state_ & kDisableOverlay;
+  bool disable_overlays =
+      (state_ & kDisableOverlay) || (tracker && tracker->single_plane_);
   bool disable_explictsync = state_ & kDisableExplictSync;
 
-  GetCachedLayers(layers, re_validate_begin, current_composition_planes);
+  {
+    FrameLatencyTracker::ScopedStage stage(latency_tracker_,
+                                           HWCFrameStage::kReValidatePlanes);
+    GetCachedLayers(layers, re_validate_begin, current_composition_planes);
+  }
+
   // We need to verify the rest layers and planes
   if (re_validate_begin < (int)layers.size()) {
     validate_layers = true;
   }
 
   if (validate_layers) {
+    FrameLatencyTracker::ScopedStage stage(latency_tracker_,
+                                           HWCFrameStage::kValidateLayers);
     display_plane_manager_->ValidateLayers(
         layers, re_validate_begin, disable_overlays, current_composition_planes,
         previous_plane_state_, surfaces_not_inuse_);
@@ -365,6 +419,8 @@ bool DisplayQueue::AssignAndCommitPlanes(
 
   // Handle any 3D Composition.
   if (render_layers) {
+    FrameLatencyTracker::ScopedStage stage(latency_tracker_,
+                                           HWCFrameStage::kCompositorDraw);
     compositor_.BeginFrame(disable_explictsync);
     // Prepare for final composition.
     if (!compositor_.Draw(current_composition_planes, layers)) {
@@ -375,6 +431,7 @@ bool DisplayQueue::AssignAndCommitPlanes(
 
   if (!composition_passed) {
     HandleCommitFailure(current_composition_planes);
+    current_composition_planes.clear();
     last_commit_failed_update_ = true;
     return false;
   }
@@ -394,6 +451,7 @@ bool DisplayQueue::AssignAndCommitPlanes(
 
   int32_t fence = 0;
   bool fence_released = false;
+  UpdateCommitDeadline();
   if (!IsIgnoreUpdates()) {
     composition_passed = display_->Commit(
         current_composition_planes, previous_plane_state_, disable_explictsync,
@@ -408,6 +466,7 @@ bool DisplayQueue::AssignAndCommitPlanes(
     DumpCurrentDisplayPlaneList(current_composition_planes);
     last_commit_failed_update_ = true;
     HandleCommitFailure(current_composition_planes);
+    current_composition_planes.clear();
     return false;
   }
 
@@ -422,7 +481,7 @@ bool DisplayQueue::AssignAndCommitPlanes(
       mark_not_inuse_.at(i)->SetSurfaceAge(-1);
     }
 
-    std::vector<NativeSurface*>().swap(mark_not_inuse_);
+    mark_not_inuse_.clear();
     if (tracker)
       tracker->ForceSurfaceRelease();
   }
@@ -431,6 +490,7 @@ bool DisplayQueue::AssignAndCommitPlanes(
 
   // Swap current and previous composition results.
   previous_plane_state_.swap(current_composition_planes);
+  current_composition_planes.clear();
 
   // Set Age for all offscreen surfaces.
   UpdateOnScreenSurfaces();
@@ -439,19 +499,19 @@ bool DisplayQueue::AssignAndCommitPlanes(
   // use next frame.
   if (!surfaces_not_inuse_.empty()) {
     size_t size = surfaces_not_inuse_.size();
-    std::vector<NativeSurface*> temp;
+    size_t kept = 0;
     for (uint32_t i = 0; i < size; i++) {
       NativeSurface* surface = surfaces_not_inuse_.at(i);
       uint32_t age = surface->GetSurfaceAge();
       if (age > 0) {
-        temp.emplace_back(surface);
+        surfaces_not_inuse_[kept++] = surface;
         surface->SetSurfaceAge(surface->GetSurfaceAge() - 1);
       } else {
         mark_not_inuse_.emplace_back(surface);
       }
     }
 
-    surfaces_not_inuse_.swap(temp);
+    surfaces_not_inuse_.resize(kept);
   }
 
   if (fence > 0) {
@@ -471,6 +531,200 @@ bool DisplayQueue::AssignAndCommitPlanes(
   return true;
 }
 
+void DisplayQueue::UpdateAllocationStats(uint64_t allocations) {
+  uint64_t count = GetAllocationCount() - allocations;
+  frame_allocations_.frames_++;
+  frame_allocations_.last_frame_allocations_ = count;
+  if (count)
+    frame_allocations_.allocating_frames_++;
+}
+
+void DisplayQueue::ScheduleFrame() {
+  frame_start_ = GetMonotonicTime();
+  target_vblank_ = 0;
+  if (variable_refresh_)
+    return;
+
+  if (!vblank_handler_->GetVblankTimeline(&last_vblank_, &vblank_period_))
+    return;
+
+  target_vblank_ =
+      GetNextVblank(frame_start_ + frame_timing_.composition_time_ +
+                        kCommitLatchTime,
+                    last_vblank_, vblank_period_);
+}
+
+bool DisplayQueue::GetVblankPeriod(int64_t* period) {
+  int64_t last_vblank = 0;
+  return vblank_handler_->GetVblankTimeline(&last_vblank, period);
+}
+
+void DisplayQueue::UpdateCommitDeadline() {
+  commit_deadline_ = 0;
+  // Cloned commits are not scheduled.
+  if (!frame_start_)
+    return;
+
+  int64_t now = GetMonotonicTime();
+  int64_t composition_time = now - frame_start_;
+  frame_start_ = 0;
+
+  // Follow slower frames quickly, faster ones slowly so that a single
+  // fast frame doesn't make us miss the next deadline.
+  int64_t& estimate = frame_timing_.composition_time_;
+  if (composition_time > estimate) {
+    estimate += (composition_time - estimate) / 2;
+  } else {
+    estimate += (composition_time - estimate) / 8;
+  }
+
+  frame_timing_.frames_++;
+  if (!target_vblank_)
+    return;
+
+  if (now + kCommitLatchTime > target_vblank_) {
+    frame_timing_.missed_deadlines_++;
+    IDISPLAYMANAGERTRACE(
+        "Frame missed its vblank by %lld us, missed: %llu",
+        (long long)((now + kCommitLatchTime - target_vblank_) / 1000),
+        (unsigned long long)frame_timing_.missed_deadlines_);
+    target_vblank_ =
+        GetNextVblank(now + kCommitLatchTime, last_vblank_, vblank_period_);
+  }
+
+  commit_deadline_ = target_vblank_ - kCommitLatchTime;
+}
+
+bool DisplayQueue::CommitCursorUpdate(std::vector<HwcLayer*>& source_layers,
+                                      bool handle_constraints,
+                                      int32_t* retire_fence,
+                                      ScopedIdleStateTracker& tracker) {
+  if (last_commit_failed_update_ || previous_plane_state_.empty() ||
+      IsIgnoreUpdates() || tracker.RenderIdleMode() ||
+      tracker.RevalidateLayers())
+    return false;
+
+  if (state_ & (kNeedsColorCorrection | kCanvasColorChanged |
+                kVideoDiscardProtected | kDisableOverlay))
+    return false;
+
+  if (scaling_tracker_.scaling_state_ == ScalingTracker::kNeedsScaling)
+    return false;
+
+  size_t size = source_layers.size();
+  if (size != in_flight_layers_.size())
+    return false;
+
+  // Find the cursor plane of last frame. Cursor needs to be the only
+  // layer on it and scanned out directly.
+  DisplayPlaneState* cursor_plane = NULL;
+  size_t cursor_index = 0;
+  for (DisplayPlaneState& plane : previous_plane_state_) {
+    if (!plane.IsCursorPlane())
+      continue;
+
+    const std::vector<size_t>& plane_layers = plane.GetSourceLayers();
+    if (plane_layers.size() != 1 || plane.NeedsOffScreenComposition())
+      return false;
+
+    cursor_plane = &plane;
+    cursor_index = plane_layers.front();
+    break;
+  }
+
+  if (!cursor_plane || cursor_index >= size)
+    return false;
+
+  for (size_t layer_index = 0; layer_index < size; layer_index++) {
+    HwcLayer* layer = source_layers.at(layer_index);
+    const OverlayLayer& previous_layer = in_flight_layers_.at(layer_index);
+    if (!layer->IsVisible() || layer->IsVideoLayer() ||
+        previous_layer.GetLayerIndex() != layer_index ||
+        layer->HasZorderChanged() || layer->HasLayerAttributesChanged() ||
+        layer->HasSourceRectChanged() ||
+        layer->GetAlpha() != previous_layer.GetAlpha() ||
+        layer->GetBlending() != previous_layer.GetBlending())
+      return false;
+
+    if (layer_index == cursor_index) {
+      if (!layer->IsCursorLayer() || !layer->GetNativeHandle())
+        return false;
+
+      continue;
+    }
+
+    // Everything else needs to be exactly what is on screen.
+    OverlayBuffer* buffer = previous_layer.GetBuffer();
+    HWCNativeHandle handle = buffer ? buffer->GetOriginalHandle() : NULL;
+    if (layer->HasLayerContentChanged() || layer->HasVisibleRegionChanged() ||
+        layer->HasDisplayRectChanged() || !layer->IsValidated() ||
+        layer->GetNativeHandle() != handle)
+      return false;
+  }
+
+  HwcLayer* cursor = source_layers.at(cursor_index);
+  OverlayLayer* previous_cursor = &(in_flight_layers_.at(cursor_index));
+  OverlayLayer cursor_layer;
+  cursor_layer.InitializeFromHwcLayer(
+      cursor, resource_manager_.get(), previous_cursor, cursor_index,
+      cursor_index, display_plane_manager_->GetHeight(),
+      display_plane_manager_->GetWidth(), plane_transform_,
+      handle_constraints);
+
+  OverlayBuffer* buffer = cursor_layer.GetBuffer();
+  OverlayBuffer* previous_buffer = previous_cursor->GetBuffer();
+  if (!cursor_layer.IsVisible() || !cursor_layer.IsCursorLayer() ||
+      !buffer || !previous_buffer ||
+      buffer->GetFormat() != previous_buffer->GetFormat() ||
+      buffer->GetWidth() != previous_buffer->GetWidth() ||
+      buffer->GetHeight() != previous_buffer->GetHeight()) {
+    // Let full update path consume the acquire fence.
+    cursor->SetAcquireFence(cursor_layer.ReleaseAcquireFence());
+    return false;
+  }
+
+  std::swap(*previous_cursor, cursor_layer);
+  cursor_plane->SetOverlayLayer(previous_cursor);
+  cursor_plane->RefreshLayerRects(in_flight_layers_);
+
+  int32_t fence = 0;
+  bool fence_released = false;
+  bool disable_explictsync = state_ & kDisableExplictSync;
+  UpdateCommitDeadline();
+  bool committed =
+      display_->CommitCursor(*cursor_plane, disable_explictsync, kms_fence_,
+                             &fence, &fence_released);
+  if (fence_released) {
+    kms_fence_ = 0;
+  }
+
+  if (!committed) {
+    // Restore what is on screen and take the full update path.
+    std::swap(*previous_cursor, cursor_layer);
+    cursor_plane->SetOverlayLayer(previous_cursor);
+    cursor_plane->RefreshLayerRects(in_flight_layers_);
+    cursor->SetAcquireFence(cursor_layer.ReleaseAcquireFence());
+    return false;
+  }
+
+  for (size_t layer_index = 0; layer_index < size; layer_index++) {
+    source_layers.at(layer_index)->SetReleaseFence(-1);
+  }
+
+  // Buffers of all other layers are still on screen, only previous
+  // cursor buffer is released with this commit.
+  if (fence > 0) {
+    *retire_fence = dup(fence);
+    kms_fence_ = fence;
+    cursor->SetReleaseFence(dup(fence));
+  }
+
+  previous_cursor->SetLayerComposition(OverlayLayer::kDisplay);
+  needs_clone_validation_ = false;
+  tracker.FrameHasCursor();
+  return true;
+}
+
 bool DisplayQueue::QueueUpdate(std::vector<HwcLayer*>& source_layers,
                                int32_t* retire_fence, bool* ignore_clone_update,
                                PixelUploaderCallback* call_back,
@@ -486,23 +740,34 @@ bool DisplayQueue::QueueUpdate(std::vector<HwcLayer*>& source_layers,
   if (tracker.IgnoreUpdate()) {
     return true;
   }
+  ScheduleFrame();
   source_layers_ = &source_layers;
-  std::vector<OverlayLayer> layers;
+  *retire_fence = -1;
+  if (CommitCursorUpdate(source_layers, handle_constraints, retire_fence,
+                         tracker)) {
+    *ignore_clone_update = false;
+    return true;
+  }
+
+  std::vector<OverlayLayer>& layers = frame_layers_;
   int re_validate_begin = -1;
   bool idle_frame = true;
   // If last commit failed, lets force full validation as
   // state might be all wrong in our side.
   bool validate_layers =
       last_commit_failed_update_ || previous_plane_state_.empty();
-  *retire_fence = -1;
 
   bool has_video_layer = false;
   bool has_cursor_layer = false;
   needs_clone_validation_ = false;
 
-  InitializeOverlayLayers(source_layers, handle_constraints, layers,
-                          has_video_layer, has_cursor_layer, re_validate_begin,
-                          idle_frame);
+  {
+    FrameLatencyTracker::ScopedStage stage(latency_tracker_,
+                                           HWCFrameStage::kLayerInit);
+    InitializeOverlayLayers(source_layers, handle_constraints, layers,
+                            has_video_layer, has_cursor_layer,
+                            re_validate_begin, idle_frame);
+  }
 
   if (validate_layers || re_validate_begin != source_layers.size()) {
     needs_clone_validation_ = true;
@@ -511,6 +776,13 @@ bool DisplayQueue::QueueUpdate(std::vector<HwcLayer*>& source_layers,
   if (has_cursor_layer)
     tracker.FrameHasCursor();
 
+  // Display is idle, compose all layers into a single plane so that
+  // the other planes can be disabled.
+  if (tracker.RenderIdleMode()) {
+    tracker.ForceSinglePlane();
+    validate_layers = true;
+  }
+
   // We are going to force GPU and validate all
   if (re_validate_begin == 0)
     validate_layers = true;
@@ -551,7 +823,7 @@ bool DisplayQueue::QueueUpdate(std::vector<HwcLayer*>& source_layers,
       for (size_t i = 0; i < size; i++) {
         mark_not_inuse_[i]->SetSurfaceAge(-1);
       }
-      std::vector<NativeSurface*>().swap(mark_not_inuse_);
+      mark_not_inuse_.clear();
       tracker.ForceSurfaceRelease();
     }
     return true;
@@ -691,9 +963,10 @@ void DisplayQueue::ResetPlanes(drmModeAtomicReqPtr pset) {
 }
 
 void DisplayQueue::IgnoreUpdates() {
-  idle_tracker_.idle_frames_ = 0;
+  idle_tracker_.idle_lock_.lock();
+  idle_tracker_.ResetIdleTracking(GetMonotonicTime());
   idle_tracker_.state_ = FrameStateTracker::kIgnoreUpdates;
-  idle_tracker_.revalidate_frames_counter_ = 0;
+  idle_tracker_.idle_lock_.unlock();
 }
 
 bool DisplayQueue::IsIgnoreUpdates() {
@@ -826,6 +1099,7 @@ void DisplayQueue::HandleExit() {
   IHOTPLUGEVENTTRACE("HandleExit Called: %p \n", this);
   power_mode_lock_.lock();
   state_ |= kIgnoreIdleRefresh;
+  pre_warm_surfaces_ = false;
   power_mode_lock_.unlock();
   vblank_handler_->SetPowerMode(kOff);
   if (!previous_plane_state_.empty()) {
@@ -989,28 +1263,143 @@ void DisplayQueue::HandleIdleCase() {
     return;
   }
 
-  if (idle_tracker_.idle_frames_ > kidleframes) {
+  if (!idle_tracker_.last_update_ || idle_tracker_.idle_requested_ ||
+      GetMonotonicTime() - idle_tracker_.last_update_ <
+          idle_tracker_.idle_timeout_.Get()) {
     idle_tracker_.idle_lock_.unlock();
     return;
   }
 
-  if (idle_tracker_.idle_frames_ < kidleframes) {
-    idle_tracker_.idle_frames_++;
-    idle_tracker_.idle_lock_.unlock();
-    return;
-  }
-
-  idle_tracker_.idle_frames_++;
   power_mode_lock_.lock();
   if (!(state_ & kIgnoreIdleRefresh) && refresh_callback_ &&
       (state_ & kPoweredOn)) {
     refresh_callback_->Callback(refrsh_display_id_);
+    // Not requested again till the next present. Without a callback
+    // detection is retried, till one is registered.
+    idle_tracker_.idle_requested_ = true;
     idle_tracker_.state_ |= FrameStateTracker::kPrepareIdleComposition;
   }
   power_mode_lock_.unlock();
   idle_tracker_.idle_lock_.unlock();
 }
 
+void DisplayQueue::HandlePreWarmSurfaces() {
+  power_mode_lock_.lock();
+  bool pre_warm = pre_warm_surfaces_ && (state_ & kPoweredOn);
+  pre_warm_surfaces_ = false;
+  power_mode_lock_.unlock();
+  if (pre_warm)
+    display_plane_manager_->PreWarmOffScreenTargets();
+}
+
+DisplayQueue::IdleStats DisplayQueue::GetIdleStats() {
+  idle_tracker_.idle_lock_.lock();
+  IdleStats stats = idle_tracker_.stats_;
+  if (idle_tracker_.state_start_) {
+    int64_t elapsed = GetMonotonicTime() - idle_tracker_.state_start_;
+    if (idle_tracker_.idle_)
+      stats.idle_time_ += elapsed;
+    else
+      stats.active_time_ += elapsed;
+  }
+
+  stats.idle_timeout_ = idle_tracker_.idle_timeout_.Get();
+  idle_tracker_.idle_lock_.unlock();
+  return stats;
+}
+
+bool DisplayQueue::SetIdleTimeout(uint32_t min_timeout_ms,
+                                  uint32_t max_timeout_ms) {
+  if (!min_timeout_ms || min_timeout_ms > max_timeout_ms) {
+    ETRACE("Invalid idle timeout range %u - %u ms", min_timeout_ms,
+           max_timeout_ms);
+    return false;
+  }
+
+  idle_tracker_.idle_lock_.lock();
+  idle_tracker_.idle_timeout_.SetRange(min_timeout_ms * 1000000LL,
+                                       max_timeout_ms * 1000000LL);
+  idle_tracker_.idle_lock_.unlock();
+  return true;
+}
+
+void DisplayQueue::FrameStateTracker::FramePresented(int64_t now) {
+  int64_t interval = last_update_ ? now - last_update_ : 0;
+  idle_timeout_.FramePresented(interval);
+
+  last_update_ = now;
+  idle_requested_ = false;
+  if (!state_start_)
+    state_start_ = now;
+
+  state_ &= ~kPrepareComposition;
+  if (state_ & kRenderIdleDisplay) {
+    state_ &= ~kRenderIdleDisplay;
+    state_ |= kTrackingFrames;
+    tracking_start_ = 0;
+    SetIdle(true, now);
+  } else if (state_ & kRevalidateLayers) {
+    // Layers have been validated to use all planes again.
+    state_ &= ~(kRevalidateLayers | kTrackingFrames);
+    tracking_start_ = 0;
+    SetIdle(false, now);
+  } else if (state_ & kTrackingFrames) {
+    if (!tracking_start_) {
+      AdaptIdleTimeout(now - state_start_);
+      tracking_start_ = now;
+    } else if (interval > kMaxTrackingInterval) {
+      // Sporadic updates, keep composing into a single plane.
+      tracking_start_ = now;
+    } else if (now - tracking_start_ >= kRevalidateTime) {
+      state_ &= ~kTrackingFrames;
+      state_ |= kRevalidateLayers;
+      tracking_start_ = 0;
+    }
+  }
+}
+
+void DisplayQueue::FrameStateTracker::AdaptIdleTimeout(int64_t idle_duration) {
+  if (idle_timeout_.Adapt(idle_duration))
+    stats_.early_exits_++;
+
+  IDISPLAYMANAGERTRACE("Idle for %lld ms, idle timeout now %lld ms",
+                       (long long)(idle_duration / 1000000),
+                       (long long)(idle_timeout_.Get() / 1000000));
+}
+
+void DisplayQueue::FrameStateTracker::SetIdle(bool idle, int64_t now) {
+  if (idle == idle_)
+    return;
+
+  AccountStateTime(now);
+  if (idle)
+    stats_.idle_entries_++;
+
+  idle_ = idle;
+}
+
+void DisplayQueue::FrameStateTracker::AccountStateTime(int64_t now) {
+  if (!state_start_)
+    return;
+
+  if (idle_)
+    stats_.idle_time_ += now - state_start_;
+  else
+    stats_.active_time_ += now - state_start_;
+
+  state_start_ = now;
+}
+
+void DisplayQueue::FrameStateTracker::ResetIdleTracking(int64_t now) {
+  // Time is not accounted till the next present.
+  AccountStateTime(now);
+  state_start_ = 0;
+  idle_ = false;
+  idle_requested_ = false;
+  last_update_ = 0;
+  tracking_start_ = 0;
+}
+
 void DisplayQueue::ForceRefresh() {
   if (idle_tracker_.state_ & FrameStateTracker::kForceIgnoreUpdates)
     return;
@@ -1039,6 +1428,8 @@ void DisplayQueue::ForceIgnoreUpdates(bool force) {
 void DisplayQueue::DisplayConfigurationChanged() {
   // Mark it as needs modeset, so that in next queue update we do a modeset
   state_ |= kConfigurationChanged;
+  // Period of the new mode has to be measured again.
+  vblank_handler_->ResetVblankTimeline();
 }
 
 void DisplayQueue::UpdateScalingRatio(uint32_t primary_width,
@@ -1074,8 +1465,10 @@ void DisplayQueue::ResetQueue() {
     ignore_updates = true;
   }
 
+  idle_tracker_.idle_lock_.lock();
+  idle_tracker_.ResetIdleTracking(GetMonotonicTime());
   idle_tracker_.state_ = 0;
-  idle_tracker_.idle_frames_ = 0;
+  idle_tracker_.idle_lock_.unlock();
   if (ignore_updates) {
     idle_tracker_.state_ |= FrameStateTracker::kIgnoreUpdates;
   }
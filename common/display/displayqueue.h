@@ -22,13 +22,17 @@
 #include <stdint.h>
 #include <stdlib.h>
 
+#include <atomic>
 #include <memory>
 #include <queue>
 #include <vector>
 
 #include "compositor.h"
 #include "displayplanemanager.h"
+#include "framelatencytracker.h"
 #include "hwcthread.h"
+#include "hwcutils.h"
+#include "idletimeout.h"
 #include "platformdefines.h"
 #include "resourcemanager.h"
 #include "vblankeventhandler.h"
@@ -54,7 +58,6 @@ class DisplayPlaneHandler;
 struct HwcLayer;
 class NativeBufferHandler;
 
-static uint32_t kidleframes = 250;
 class DisplayQueue {
  public:
   DisplayQueue(uint32_t gpu_fd, bool disable_explictsync,
@@ -94,6 +97,10 @@ class DisplayQueue {
 
   void HandleIdleCase();
 
+  // Allocates offscreen surfaces after the display has been powered on.
+  // Called from the vblank thread, so that it stays off the present path.
+  void HandlePreWarmSurfaces();
+
   void DisplayConfigurationChanged();
 
   bool IsIgnoreUpdates();
@@ -159,8 +166,84 @@ class DisplayQueue {
   }
 
   void ReleaseUnreservedPlanes(std::vector<uint32_t>& reserved_planes);
+
+  void EnableCostModelPlaneAllocator(bool enable);
+
+  void SetSurfacePoolBudget(uint32_t budget_mb);
+
+  void SetCompositorContexts(uint32_t count);
   void DumpCurrentDisplayPlaneList(DisplayPlaneStateList& composition);
 
+  // Frame scheduling statistics, times are in nanoseconds.
+  struct FrameTimingStats {
+    uint64_t frames_ = 0;
+    // Frames composed too late for the vblank they were scheduled for.
+    uint64_t missed_deadlines_ = 0;
+    // Moving estimate of time from QueueUpdate till commit.
+    int64_t composition_time_ = 0;
+  };
+
+  const FrameTimingStats& GetFrameTimingStats() const {
+    return frame_timing_;
+  }
+
+  // Heap allocations done while QueueUpdate runs, by any thread. Only
+  // counted when built with ENABLE_ALLOCATION_TRACKING, frames in steady
+  // state are expected not to allocate.
+  struct FrameAllocationStats {
+    uint64_t frames_ = 0;
+    // Frames which did at least one allocation.
+    uint64_t allocating_frames_ = 0;
+    uint64_t last_frame_allocations_ = 0;
+  };
+
+  const FrameAllocationStats& GetFrameAllocationStats() const {
+    return frame_allocations_;
+  }
+
+  // Latency histograms of the stages of presenting a frame. Stages done
+  // by the display backend are added by it.
+  FrameLatencyTracker& GetFrameLatencyTracker() {
+    return latency_tracker_;
+  }
+
+  // Idle detection statistics, times are in nanoseconds.
+  struct IdleStats {
+    // Time spent using all planes.
+    int64_t active_time_ = 0;
+    // Time spent with all layers composed into a single plane.
+    int64_t idle_time_ = 0;
+    uint32_t idle_entries_ = 0;
+    // Idle periods which ended before the idle timeout had passed.
+    uint32_t early_exits_ = 0;
+    // Current idle timeout.
+    int64_t idle_timeout_ = 0;
+  };
+
+  IdleStats GetIdleStats();
+
+  // Sets range in milliseconds within which idle timeout is adapted to
+  // the present cadence of this display.
+  bool SetIdleTimeout(uint32_t min_timeout_ms, uint32_t max_timeout_ms);
+
+  // Returns CLOCK_MONOTONIC time by which the frame being committed has
+  // to be handed to the kernel to be shown at its scheduled vblank.
+  // Returns 0 if the frame is not scheduled for any vblank.
+  int64_t GetCommitDeadline() const {
+    return commit_deadline_;
+  }
+
+  // With variable refresh, the panel refreshes once a frame is committed
+  // instead of at fixed vblank intervals, so frames are committed as soon
+  // as they are composed rather than scheduled for a vblank.
+  void SetVariableRefresh(bool enable) {
+    if (variable_refresh_.exchange(enable) != enable)
+      vblank_handler_->ResetVblankTimeline();
+  }
+
+  // Returns time in nanoseconds between the last two vblanks.
+  bool GetVblankPeriod(int64_t* period);
+
  private:
   enum QueueState {
     kNeedsColorCorrection = 1 << 0,  // Needs Color correction.
@@ -203,12 +286,31 @@ class DisplayQueue {
       kForceIgnoreUpdates = 1 << 6  // Ignore all commits/updates.
     };
 
-    uint32_t idle_frames_ = 0;
+    // Updates state once a frame has been presented at time now.
+    void FramePresented(int64_t now);
+    // Adapts idle timeout to how long the last idle period lasted.
+    void AdaptIdleTimeout(int64_t idle_duration);
+    void SetIdle(bool idle, int64_t now);
+    // Adds time since state_start_ to time spent in current state.
+    void AccountStateTime(int64_t now);
+    // Called when no frame is on screen or updates are ignored.
+    void ResetIdleTracking(int64_t now);
+
     bool has_cursor_layer_ = false;
     SpinLock idle_lock_;
     int state_ = kPrepareComposition;
-    uint32_t revalidate_frames_counter_ = 0;
     size_t total_planes_ = 1;
+    // Set once refresh has been requested to enter idle mode.
+    bool idle_requested_ = false;
+    bool idle_ = false;
+    // Time of last present, 0 if nothing has been presented yet.
+    int64_t last_update_ = 0;
+    // Time of first update after entering idle mode, 0 if none yet.
+    int64_t tracking_start_ = 0;
+    // Time current idle or active period started.
+    int64_t state_start_ = 0;
+    IdleTimeout idle_timeout_;
+    IdleStats stats_;
   };
 
   struct ScopedStateTracker {
@@ -216,7 +318,13 @@ class DisplayQueue {
       forced_ = true;
     }
 
+    // Compose all layers into a single plane.
+    void ForceSinglePlane() {
+      single_plane_ = true;
+    }
+
     bool forced_ = false;
+    bool single_plane_ = false;
   };
 
   struct ScopedIdleStateTracker : public ScopedStateTracker {
@@ -228,6 +336,7 @@ class DisplayQueue {
           compositor_(compositor),
           resource_manager_(resource_manager),
           queue_(queue) {
+      allocations_ = GetAllocationCount();
       tracker_.idle_lock_.lock();
       tracker_.state_ |= FrameStateTracker::kPrepareComposition;
       tracker_.has_cursor_layer_ = false;
@@ -263,7 +372,7 @@ class DisplayQueue {
         tracker_.state_ = 0;
       }
 
-      tracker_.revalidate_frames_counter_ = 0;
+      tracker_.tracking_start_ = 0;
     }
 
     bool IgnoreUpdate() const {
@@ -276,28 +385,7 @@ class DisplayQueue {
 
     ~ScopedIdleStateTracker() {
       tracker_.idle_lock_.lock();
-      // Reset idle frame count. We want that idle frames
-      // are continuous to detect idle mode scenario.
-      tracker_.idle_frames_ = 0;
-
-      tracker_.state_ &= ~FrameStateTracker::kPrepareComposition;
-      if (tracker_.state_ & FrameStateTracker::kRenderIdleDisplay) {
-        tracker_.state_ &= ~FrameStateTracker::kRenderIdleDisplay;
-        tracker_.state_ |= FrameStateTracker::kTrackingFrames;
-        tracker_.revalidate_frames_counter_ = 0;
-      } else if (tracker_.state_ & FrameStateTracker::kTrackingFrames) {
-        if (tracker_.revalidate_frames_counter_ > 3) {
-          tracker_.state_ &= ~FrameStateTracker::kTrackingFrames;
-          tracker_.state_ |= FrameStateTracker::kRevalidateLayers;
-          tracker_.revalidate_frames_counter_ = 0;
-        } else {
-          tracker_.revalidate_frames_counter_++;
-        }
-      } else if (tracker_.state_ & FrameStateTracker::kRevalidateLayers) {
-        tracker_.state_ &= ~FrameStateTracker::kRevalidateLayers;
-        tracker_.revalidate_frames_counter_ = 0;
-      }
-
+      tracker_.FramePresented(GetMonotonicTime());
       tracker_.total_planes_ = queue_->previous_plane_state_.size();
       tracker_.idle_lock_.unlock();
 
@@ -306,9 +394,14 @@ class DisplayQueue {
 
       if (resource_manager_->PreparePurgedResources())
         compositor_.FreeResources();
+
+      // Release layers of this frame, keeping storage for the next one.
+      queue_->frame_layers_.clear();
+      queue_->UpdateAllocationStats(allocations_);
     }
 
    private:
+    uint64_t allocations_;
     struct FrameStateTracker& tracker_;
     Compositor& compositor_;
     ResourceManager* resource_manager_;
@@ -374,6 +467,25 @@ class DisplayQueue {
                              bool setMediaEffect, int32_t* retire_fence,
                              ScopedStateTracker* tracker);
 
+  // Commits only the cursor plane in case cursor position or buffer is
+  // the only thing which changed since last frame. Returns false if
+  // a full validation and commit is needed.
+  bool CommitCursorUpdate(std::vector<HwcLayer*>& source_layers,
+                          bool handle_constraints, int32_t* retire_fence,
+                          ScopedIdleStateTracker& tracker);
+
+  // Accounts allocations done since allocations, as returned by
+  // GetAllocationCount, to the current frame.
+  void UpdateAllocationStats(uint64_t allocations);
+
+  // Picks the vblank a new frame should be shown at, based on time it
+  // took to compose recent frames. Not done with variable refresh.
+  void ScheduleFrame();
+
+  // Updates composition time estimate and commit deadline of the frame
+  // scheduled with ScheduleFrame. Needs to be called right before commit.
+  void UpdateCommitDeadline();
+
   Compositor compositor_;
   uint32_t gpu_fd_;
   uint32_t brightness_;
@@ -388,6 +500,10 @@ class DisplayQueue {
   std::unique_ptr<ResourceManager> resource_manager_;
   std::vector<OverlayLayer> in_flight_layers_;
   DisplayPlaneStateList previous_plane_state_;
+  // Layers and planes of the frame being composed. These are members so
+  // that their storage is re-used across frames.
+  std::vector<OverlayLayer> frame_layers_;
+  DisplayPlaneStateList composition_planes_;
   FrameStateTracker idle_tracker_;
   ScalingTracker scaling_tracker_;
   // shared_ptr since we need to use this outside of the thread lock (to
@@ -398,6 +514,8 @@ class DisplayQueue {
   int state_ = kConfigurationChanged;
   PhysicalDisplay* display_ = NULL;
   SpinLock power_mode_lock_;
+  // Guarded by power_mode_lock_.
+  bool pre_warm_surfaces_ = false;
   // to disable hwclock monitoring.
   bool handle_display_initializations_ = true;
   uint32_t plane_transform_ = kIdentity;
@@ -420,6 +538,16 @@ class DisplayQueue {
   // frame.
   std::vector<NativeSurface*> surfaces_not_inuse_;
   std::vector<HwcLayer*>* source_layers_ = NULL;
+  // Frame scheduling state, see ScheduleFrame.
+  FrameTimingStats frame_timing_;
+  int64_t frame_start_ = 0;
+  int64_t last_vblank_ = 0;
+  int64_t vblank_period_ = 0;
+  int64_t target_vblank_ = 0;
+  int64_t commit_deadline_ = 0;
+  std::atomic<bool> variable_refresh_{false};
+  FrameAllocationStats frame_allocations_;
+  FrameLatencyTracker latency_tracker_;
 };
 
 }  // namespace hwcomposer
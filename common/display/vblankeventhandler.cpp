@@ -51,6 +51,8 @@ bool VblankEventHandler::SetPowerMode(uint32_t power_mode) {
   if (power_mode != kOn) {
     Exit();
   } else {
+    // No vblanks were seen while the thread was stopped.
+    ResetVblankTimeline();
     if (!InitWorker()) {
       ETRACE("Failed to initalize thread for VblankEventHandler. %s",
              PRINTERROR());
@@ -99,12 +101,37 @@ int VblankEventHandler::VSyncControl(bool enabled) {
   return 0;
 }
 
+void VblankEventHandler::ResetVblankTimeline() {
+  spin_lock_.lock();
+  previous_timestamp_ = -1;
+  spin_lock_.unlock();
+}
+
+bool VblankEventHandler::GetVblankTimeline(int64_t* last_vblank,
+                                           int64_t* period) {
+  spin_lock_.lock();
+  int64_t timestamp = previous_timestamp_;
+  int64_t vperiod = vperiod_;
+  spin_lock_.unlock();
+
+  if (timestamp < 0 || vperiod <= 0 || vperiod >= kOneSecondNs)
+    return false;
+
+  *last_vblank = timestamp;
+  *period = vperiod;
+  return true;
+}
+
 void VblankEventHandler::HandlePageFlipEvent(unsigned int sec,
                                              unsigned int usec) {
   int64_t timestamp = ((int64_t)sec * kOneSecondNs) + ((int64_t)usec * 1000);
   IPAGEFLIPEVENTTRACE("HandleVblankCallBack Frame Time %f",
                       static_cast<float>(timestamp - last_timestamp_) / (1000));
-  int64_t vperiod = timestamp - previous_timestamp_;
+  // Period follows the committed frames with variable refresh, so report
+  // the measured one rather than the period of the mode.
+  int64_t vperiod = vperiod_;
+  if (previous_timestamp_ >= 0)
+    vperiod = timestamp - previous_timestamp_;
   last_timestamp_ = timestamp;
 
   IPAGEFLIPEVENTTRACE("Callback called from HandlePageFlipEvent. %lu",
@@ -130,6 +157,7 @@ void VblankEventHandler::HandleWait() {
 
 void VblankEventHandler::HandleRoutine() {
   queue_->HandleIdleCase();
+  queue_->HandlePreWarmSurfaces();
 
   drmVBlank vblank;
   memset(&vblank, 0, sizeof(vblank));
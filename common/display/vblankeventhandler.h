@@ -50,6 +50,14 @@ class VblankEventHandler : public HWCThread {
 
   int VSyncControl(bool enabled);
 
+  // Returns timestamp of the last vblank and the refresh period, in
+  // nanoseconds. Returns false till two vblanks have been seen.
+  bool GetVblankTimeline(int64_t* last_vblank, int64_t* period);
+
+  // Drops the measured period, to be called when the mode or refresh
+  // behaviour of the display changes.
+  void ResetVblankTimeline();
+
  protected:
   void HandleRoutine() override;
   void HandleWait() override;
@@ -62,7 +70,7 @@ class VblankEventHandler : public HWCThread {
   std::shared_ptr<VsyncPeriodCallback> callback_2_4_ = NULL;
   SpinLock spin_lock_;
   uint32_t display_;
-  int64_t vperiod_;
+  int64_t vperiod_ = 0;
   bool enabled_ = false;
 
   int fd_;
@@ -15,133 +15,81 @@
 */
 
 #include "disjoint_layers.h"
-#include <assert.h>
 #include <stdint.h>
 #include <algorithm>
-#include <iostream>
-#include <list>
-#include <map>
-#include <set>
 #include <utility>
 #include <vector>
-#include "hwctrace.h"
 #include "hwcutils.h"
 
 namespace hwcomposer {
 
-enum EventType { START, END };
+typedef DrawRegionScratch::Span Span;
 
-struct YPOI {
-  EventType type;
-  uint64_t y;
-  uint64_t rect_id;
+static void CloseSpan(Span &span, int right, std::vector<RectSet<int>> *out) {
+  out->emplace_back(
+      RectSet<int>(span.id_set, Rect<int>(span.left, span.top, right,
+                                          span.bottom)));
+}
 
-  bool operator<(const YPOI &rhs) const {
-    if (y == rhs.y)
-      return rect_id < rhs.rect_id;
-    else
-      return (y < rhs.y);
-  }
-};
-
-// Any region will have start X and set of Y coordinates.
-struct Region {
-  uint64_t sx;
-  std::set<YPOI> y_points;
-  RectIDs rect_ids;
-};
-
-// POI is the point of interest while traversing through x coordinates
-struct POI {
-  EventType type;
-  uint64_t rect_id;
-  uint64_t x;
-  uint64_t top_y;
-  uint64_t bot_y;
-
-  bool operator<(const POI &rhs) const {
-    return (x <= rhs.x);
+// Adds span of the column starting at x. It is merged with the span at
+// the same place in the previous column if both are covered by the same
+// rects. Spans of the previous column above it which weren't merged end
+// at x.
+static void AddSpan(DrawRegionScratch &scratch, size_t &open_index, int x,
+                    int top, int bottom, const RectIDs &id_set,
+                    std::vector<RectSet<int>> *out) {
+  std::vector<Span> &open = scratch.open;
+  while (open_index < open.size() && open[open_index].top < top) {
+    CloseSpan(open[open_index], x, out);
+    open_index++;
   }
-};
-
-// This function will take active region and right x
-// For an active region there will be set of YPOI
-// It will traverse through each y_poi and given out
-// rectangle with rect_ids active at that time.
-void GenerateOutLayers(Region *reg, uint64_t x,
-                       const HwcRect<int> &damage_region,
-                       std::vector<RectSet<int>> *out) {
-  Rect<int> out_rect;
-  out_rect.left = std::max(damage_region.left, static_cast<int>(reg->sx));
-  out_rect.right = std::min(damage_region.right, static_cast<int>(x));
-  RectIDs rect_ids;
-
-  for (std::set<YPOI>::iterator y_poi_it = reg->y_points.begin();
-       y_poi_it != reg->y_points.end(); y_poi_it++) {
-    const YPOI &y_poi = *y_poi_it;
-    // No need to check for start or end event
-    // as rect_ids is empty
-    if (rect_ids.isEmpty()) {
-      out_rect.top = std::max(damage_region.top, static_cast<int>(y_poi.y));
-      rect_ids.add(y_poi.rect_id);
-    } else {
-      if (out_rect.top == static_cast<int>(y_poi.y)) {
-        if (y_poi.type == START) {
-          rect_ids.add(y_poi.rect_id);
-        } else {
-          rect_ids.subtract(y_poi.rect_id);
-        }
-        continue;
-      }
-      out_rect.bottom = y_poi.y;
-      if (AnalyseOverlap(damage_region, out_rect) == kOutside)
-        continue;
-
-      out->emplace_back(RectSet<int>(rect_ids, out_rect));
-      out_rect.top = std::max(damage_region.top, static_cast<int>(y_poi.y));
-      if (y_poi.type == START) {
-        rect_ids.add(y_poi.rect_id);
-      } else {
-        rect_ids.subtract(y_poi.rect_id);
-      }
-    }
+
+  if (open_index < open.size() && open[open_index].top == top &&
+      open[open_index].bottom == bottom && open[open_index].id_set == id_set) {
+    scratch.next.emplace_back(std::move(open[open_index]));
+    open_index++;
+    return;
   }
+
+  scratch.next.emplace_back(Span{x, top, bottom, id_set});
 }
 
-// This function will remove y coordinates corresponding to given rect_id
-void RemoveYpois(Region *reg, uint64_t rect_id) {
-  std::set<YPOI>::iterator top_it = reg->y_points.begin();
-  while (top_it != reg->y_points.end()) {
-    if ((*top_it).rect_id == rect_id) {
-      reg->y_points.erase(top_it++);
-    } else {
-      top_it++;
-    }
+// Ends all spans of the previous column not merged into the current one.
+static void NextColumn(DrawRegionScratch &scratch, size_t open_index, int x,
+                       std::vector<RectSet<int>> *out) {
+  for (size_t i = open_index; i < scratch.open.size(); i++) {
+    CloseSpan(scratch.open[i], x, out);
   }
+
+  scratch.open.swap(scratch.next);
+  scratch.next.clear();
 }
 
-bool compare_region(const Region *first, const Region *second) {
-  uint64_t first_min_y = (*(first->y_points.begin())).y;
-  uint64_t second_min_y = (*(second->y_points.begin())).y;
-  return (first_min_y < second_min_y);
+// Marks rects spanning the whole of [x0, x1). Kept branch free over the
+// separate edge arrays, so that it gets vectorized.
+static void MarkActive(const int *left, const int *right, size_t count,
+                       int x0, int x1, uint8_t *active) {
+  for (size_t i = 0; i < count; i++) {
+    active[i] = (left[i] <= x0) & (right[i] >= x1);
+  }
 }
 
 void get_draw_regions(const std::vector<Rect<int>> &in,
                       const HwcRect<int> &damage_region,
-                      std::vector<RectSet<int>> *out) {
-  if (in.size() > RectIDs::max_elements) {
-    return;
-  }
-
-  // Set of all point of interests from input rectangles.
-  std::set<POI> pois;
-  std::list<Region *> imp_reg;
-  std::list<Region> active_regions;
-
-  // This loop will add all point of interests into pois.
-  for (uint64_t i = 0; i < in.size(); i++) {
+                      std::vector<RectSet<int>> *out,
+                      DrawRegionScratch *scratch) {
+  DrawRegionScratch &s = *scratch;
+  s.left.clear();
+  s.top.clear();
+  s.right.clear();
+  s.bottom.clear();
+  s.ids.clear();
+  s.xs.clear();
+  s.open.clear();
+  s.next.clear();
+
+  for (size_t i = 0; i < in.size(); i++) {
     const Rect<int> &rect = in[i];
-
     // Filter out empty or invalid rects.
     if (rect.left >= rect.right || rect.top >= rect.bottom)
       continue;
@@ -149,210 +97,107 @@ void get_draw_regions(const std::vector<Rect<int>> &in,
     if (AnalyseOverlap(damage_region, rect) == kOutside)
       continue;
 
-    POI poi;
-    poi.rect_id = i;
-    poi.x = std::max(damage_region.left, rect.left);
-    poi.top_y = std::max(damage_region.top, rect.top);
-    poi.bot_y = std::min(damage_region.bottom, rect.bottom);
-    poi.type = START;
-    pois.insert(poi);
-
-    poi.type = END;
-    poi.x = std::min(damage_region.right, rect.right);
-    pois.insert(poi);
+    s.left.emplace_back(std::max(damage_region.left, rect.left));
+    s.top.emplace_back(std::max(damage_region.top, rect.top));
+    s.right.emplace_back(std::min(damage_region.right, rect.right));
+    s.bottom.emplace_back(std::min(damage_region.bottom, rect.bottom));
+    s.ids.emplace_back(i);
+    s.xs.emplace_back(s.left.back());
+    s.xs.emplace_back(s.right.back());
   }
 
-  for (std::set<POI>::iterator it = pois.begin(); it != pois.end(); ++it) {
-    const POI &poi = *it;
-    // First rectangle has to be inserted into active region
-    // This condition will be true if existing all active
-    // regions are already copied to out.
-    // If current poi is of type END there are no active regions,
-    // then this poi might already covered in previous pass
-    if (active_regions.size() == 0 && poi.type == START) {
-      Region reg;
-      reg.sx = poi.x;
-      YPOI y_poi;
-
-      y_poi.rect_id = poi.rect_id;
-      y_poi.type = START;
-      y_poi.y = poi.top_y;
-      reg.y_points.insert(y_poi);
-
-      y_poi.type = END;
-      y_poi.y = poi.bot_y;
-      reg.y_points.insert(y_poi);
-
-      RectIDs rectIds;
-      rectIds.add(poi.rect_id);
-      reg.rect_ids = rectIds;
-      active_regions.push_back(reg);
-      continue;
-    }
+  size_t count = s.ids.size();
+  if (!count)
+    return;
+
+  std::sort(s.xs.begin(), s.xs.end());
+  s.xs.erase(std::unique(s.xs.begin(), s.xs.end()), s.xs.end());
+
+  s.by_top.resize(count);
+  s.by_bottom.resize(count);
+  for (size_t i = 0; i < count; i++) {
+    s.by_top[i] = i;
+    s.by_bottom[i] = i;
+  }
 
-    // If active_regions in not empty, Check if current
-    // poi y points fall in range of any existing
-    // active_regions.
-    // If yes, get that active region and do further processing
-    // If No, create a new region and insert into active regions
-    // If it is start event then there is possibility that multiple
-    // active_regions get impacted.
-    // If it is end event then one or none active_regions will get
-    // impacted.
-    bool found = false;
-    imp_reg.clear();
-    std::list<Region>::iterator it_reg = active_regions.begin();
-    while (it_reg != active_regions.end()) {
-      Region &cur_reg = *it_reg;
-      uint64_t min_y = (*(cur_reg.y_points.begin())).y;
-      uint64_t max_y = (*(cur_reg.y_points.rbegin())).y;
-      // If bottom y is less than minimum y in region or top y is greater than
-      // max y in region, then this region is not impacted by this rect
-      if (poi.bot_y <= min_y || poi.top_y >= max_y) {
-        it_reg++;
-        continue;
-      } else {
-        found = true;
-        // Found atleast one affected active region. If it is start event,
-        // add rect_id to cur_reg.rect_ids, also top_y and bot_y to
-        // cur_reg.y_points. if it is end event, remove rect_id from
-        // cur_reg.rect_ids and also top_y and bot_y from cur_reg.y_points.
-        // Also, if it is end event, check cur_reg.rect_ids is non empty,
-        // if it is empty remove region from active_regions.
-        // If it is start or end event, check next poi.x and see if it is same
-        // and
-        // those y coordinates fall in this region and it is END event, if yes
-        // 1) remove that rect_id and y coordinates as well
-        // 2)contine to check next poi.x until you find mismatch x.
-        if (poi.x == cur_reg.sx) {
-          if (poi.type == START) {
-            cur_reg.rect_ids.add(poi.rect_id);
-            imp_reg.push_back(&cur_reg);
-          }
-
-          it_reg++;
-          continue;
-        }
-        if (poi.type == START) {
-          GenerateOutLayers(&cur_reg, poi.x, damage_region, out);
-          cur_reg.sx = poi.x;
-          cur_reg.rect_ids.add(poi.rect_id);
-          imp_reg.push_back(&cur_reg);
-          std::set<POI>::iterator next_poi_it = it;
-          next_poi_it++;
-          for (; next_poi_it != pois.end(); next_poi_it++) {
-            const POI &next_poi = *next_poi_it;
-            if (next_poi.x != poi.x) {
-              break;
-            } else {
-              if (next_poi.bot_y <= min_y || next_poi.top_y >= max_y ||
-                  next_poi.type == START) {
-                continue;
-              }
-              cur_reg.rect_ids.subtract(next_poi.rect_id);
-              RemoveYpois(&cur_reg, next_poi.rect_id);
-            }
-          }
-          it_reg++;
-        } else {
-          GenerateOutLayers(&cur_reg, poi.x, damage_region, out);
-          RemoveYpois(&cur_reg, poi.rect_id);
-          cur_reg.sx = poi.x;
-          cur_reg.rect_ids.subtract(poi.rect_id);
-
-          std::set<POI>::iterator next_poi_it = it;
-          next_poi_it++;
-          for (; next_poi_it != pois.end(); next_poi_it++) {
-            const POI &next_poi = *next_poi_it;
-            if (next_poi.x != poi.x) {
-              break;
-            } else {
-              if (next_poi.bot_y <= min_y || next_poi.top_y >= max_y ||
-                  next_poi.type == START) {
-                continue;
-              }
-              cur_reg.rect_ids.subtract(next_poi.rect_id);
-              RemoveYpois(&cur_reg, next_poi.rect_id);
-            }
-          }
-          if (cur_reg.rect_ids.isEmpty()) {
-            active_regions.erase(it_reg++);
-          } else {
-            it_reg++;
-          }
-        }
+  const std::vector<int> &tops = s.top;
+  const std::vector<int> &bottoms = s.bottom;
+  std::sort(s.by_top.begin(), s.by_top.end(),
+            [&tops](uint32_t a, uint32_t b) { return tops[a] < tops[b]; });
+  std::sort(
+      s.by_bottom.begin(), s.by_bottom.end(),
+      [&bottoms](uint32_t a, uint32_t b) { return bottoms[a] < bottoms[b]; });
+
+  // Sweep the columns between neighbouring x coordinates top to bottom.
+  // Within a column rects covering it only start or end at their top
+  // and bottom edges.
+  s.active.resize(count);
+  RectIDs id_set;
+  for (size_t column = 0; column + 1 < s.xs.size(); column++) {
+    int x0 = s.xs[column];
+    int x1 = s.xs[column + 1];
+    MarkActive(s.left.data(), s.right.data(), count, x0, x1,
+               s.active.data());
+
+    size_t open_index = 0;
+    size_t top_index = 0;
+    size_t bottom_index = 0;
+    int y = 0;
+    while (true) {
+      while (top_index < count && !s.active[s.by_top[top_index]])
+        top_index++;
+
+      while (bottom_index < count && !s.active[s.by_bottom[bottom_index]])
+        bottom_index++;
+
+      // Every active rect ends after it starts.
+      if (bottom_index == count)
+        break;
+
+      int next_y = bottoms[s.by_bottom[bottom_index]];
+      if (top_index < count)
+        next_y = std::min(next_y, tops[s.by_top[top_index]]);
+
+      if (!id_set.isEmpty() && next_y > y)
+        AddSpan(s, open_index, x0, y, next_y, id_set, out);
+
+      y = next_y;
+      while (bottom_index < count &&
+             bottoms[s.by_bottom[bottom_index]] == y) {
+        if (s.active[s.by_bottom[bottom_index]])
+          id_set.subtract(s.ids[s.by_bottom[bottom_index]]);
+
+        bottom_index++;
       }
-    }
-    // If no affected active region found, add new active region
-    if (!found && poi.type == START) {
-      Region reg;
-      reg.sx = poi.x;
-      YPOI y_poi;
-
-      y_poi.rect_id = poi.rect_id;
-      y_poi.type = START;
-      y_poi.y = poi.top_y;
-      reg.y_points.insert(y_poi);
-
-      y_poi.type = END;
-      y_poi.y = poi.bot_y;
-      reg.y_points.insert(y_poi);
-
-      RectIDs rectIds;
-      rectIds.add(poi.rect_id);
-      reg.rect_ids = rectIds;
-      active_regions.push_back(reg);
-    } else {
-      if (imp_reg.size() > 1 && poi.type == START) {
-        imp_reg.sort(compare_region);
-        uint64_t cur_y = 0;
-        for (std::list<Region *>::iterator cur_imp_reg_it = imp_reg.begin();
-             cur_imp_reg_it != imp_reg.end(); cur_imp_reg_it++) {
-          Region &cur_imp_reg = *(*cur_imp_reg_it);
-          YPOI y_poi;
-          y_poi.rect_id = poi.rect_id;
-          y_poi.type = START;
-
-          if (cur_y == 0) {
-            y_poi.y = poi.top_y;
-          } else {
-            y_poi.y = cur_y;
-          }
-          // This is to split vertical
-          // line into all impacted
-          // regions.
-          cur_imp_reg.y_points.insert(y_poi);
-          // Take bottom of current region as start of next impacted region
-          cur_y = (*(cur_imp_reg.y_points.rbegin())).y;
-          std::list<Region *>::iterator next_imp_reg_it = cur_imp_reg_it;
-          next_imp_reg_it++;
-          if (next_imp_reg_it == imp_reg.end()) {
-            // If there is an another
-            // region which is impacted, no
-            // need to add anything.
-            // if there is no other active region left,
-            // take bottom y and push into this active region
-            y_poi.y = poi.bot_y;
-          } else {
-            y_poi.y = cur_y;
-          }
-          y_poi.type = END;
-          cur_imp_reg.y_points.insert(y_poi);
-        }
-      } else if (imp_reg.size() == 1 && poi.type == START) {
-        // Only one region got impacted add y coordinated to that region
-        std::list<Region *>::iterator cur_imp_reg_it = imp_reg.begin();
-        YPOI y_poi;
-        y_poi.rect_id = poi.rect_id;
-        y_poi.type = START;
-        y_poi.y = poi.top_y;
-        (*cur_imp_reg_it)->y_points.insert(y_poi);
-        y_poi.type = END;
-        y_poi.y = poi.bot_y;
-        (*cur_imp_reg_it)->y_points.insert(y_poi);
+
+      while (top_index < count && tops[s.by_top[top_index]] == y) {
+        if (s.active[s.by_top[top_index]])
+          id_set.add(s.ids[s.by_top[top_index]]);
+
+        top_index++;
       }
     }
+
+    NextColumn(s, open_index, x0, out);
   }
+
+  NextColumn(s, 0, s.xs.back(), out);
+}
+
+void get_draw_regions(const std::vector<Rect<int>> &in,
+                      const HwcRegion &damage_region,
+                      std::vector<RectSet<int>> *out,
+                      DrawRegionScratch *scratch) {
+  for (const HwcRect<int> &damage : damage_region) {
+    get_draw_regions(in, damage, out, scratch);
+  }
+}
+
+void get_draw_regions(const std::vector<Rect<int>> &in,
+                      const HwcRect<int> &damage_region,
+                      std::vector<RectSet<int>> *out) {
+  DrawRegionScratch scratch;
+  get_draw_regions(in, damage_region, out, &scratch);
 }
 
 }  // namespace hwcomposer
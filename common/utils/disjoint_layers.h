@@ -28,6 +28,8 @@
 namespace hwcomposer {
 
 // Some of the structs are adopted from drm_hwcomposer
+// Set of rect ids of any size. Ids below 64 are kept inline, so that sets
+// of up to 64 rects never allocate.
 struct RectIDs {
  public:
   typedef uint64_t TId;
@@ -40,46 +42,111 @@ struct RectIDs {
   }
 
   void add(TId id) {
-    bitset |= ((uint64_t)1) << id;
+    if (id < kInlineBits) {
+      bitset |= ((uint64_t)1) << id;
+      return;
+    }
+
+    size_t word = id / kInlineBits - 1;
+    if (word >= overflow.size())
+      overflow.resize(word + 1, 0);
+
+    overflow[word] |= ((uint64_t)1) << (id % kInlineBits);
   }
 
   void subtract(TId id) {
-    bitset &= ~(((uint64_t)1) << id);
+    if (id < kInlineBits) {
+      bitset &= ~(((uint64_t)1) << id);
+      return;
+    }
+
+    size_t word = id / kInlineBits - 1;
+    if (word >= overflow.size())
+      return;
+
+    overflow[word] &= ~(((uint64_t)1) << (id % kInlineBits));
+    // Keep no trailing empty words, so that equal sets compare equal.
+    while (!overflow.empty() && !overflow.back())
+      overflow.pop_back();
+  }
+
+  bool test(TId id) const {
+    if (id < kInlineBits)
+      return bitset & (((uint64_t)1) << id);
+
+    size_t word = id / kInlineBits - 1;
+    if (word >= overflow.size())
+      return false;
+
+    return overflow[word] & (((uint64_t)1) << (id % kInlineBits));
   }
 
   bool isEmpty() const {
-    return bitset == 0;
+    return bitset == 0 && overflow.empty();
   }
 
-  uint64_t getBits() const {
-    return bitset;
+  // Calls func with every id in the set, in increasing order.
+  template <typename TFunc>
+  void forEach(TFunc func) const {
+    ForEachBit(bitset, 0, func);
+    for (size_t word = 0; word < overflow.size(); word++) {
+      ForEachBit(overflow[word], (word + 1) * kInlineBits, func);
+    }
   }
 
   bool operator==(const RectIDs &rhs) const {
-    return bitset == rhs.bitset;
+    return bitset == rhs.bitset && overflow == rhs.overflow;
+  }
+
+  bool operator!=(const RectIDs &rhs) const {
+    return !(*this == rhs);
   }
 
   bool operator<(const RectIDs &rhs) const {
+    if (overflow.size() != rhs.overflow.size())
+      return overflow.size() < rhs.overflow.size();
+
+    for (size_t word = overflow.size(); word > 0; word--) {
+      if (overflow[word - 1] != rhs.overflow[word - 1])
+        return overflow[word - 1] < rhs.overflow[word - 1];
+    }
+
     return bitset < rhs.bitset;
   }
 
   RectIDs operator|(const RectIDs &rhs) const {
-    RectIDs ret;
-    ret.bitset = bitset | rhs.bitset;
+    RectIDs ret = *this;
+    ret.bitset |= rhs.bitset;
+    if (ret.overflow.size() < rhs.overflow.size())
+      ret.overflow.resize(rhs.overflow.size(), 0);
+
+    for (size_t word = 0; word < rhs.overflow.size(); word++) {
+      ret.overflow[word] |= rhs.overflow[word];
+    }
+
     return ret;
   }
 
   RectIDs operator|(TId id) const {
-    RectIDs ret;
-    ret.bitset = bitset;
+    RectIDs ret = *this;
     ret.add(id);
     return ret;
   }
 
-  static const int max_elements = sizeof(TId) * 8;
-
  private:
+  static const TId kInlineBits = sizeof(uint64_t) * 8;
+
+  template <typename TFunc>
+  static void ForEachBit(uint64_t bits, TId base, TFunc &func) {
+    while (bits) {
+      func(base + __builtin_ctzll(bits));
+      bits &= bits - 1;
+    }
+  }
+
   uint64_t bitset;
+  // Ids from 64 onwards, 64 per word.
+  std::vector<uint64_t> overflow;
 };
 
 template <typename TNum>
@@ -95,6 +162,50 @@ struct RectSet {
   }
 };
 
+// Storage get_draw_regions works in. Keeping it around between calls
+// avoids allocating on every call.
+struct DrawRegionScratch {
+  // Part of a column of the sweep covered by the same rects.
+  struct Span {
+    int left;
+    int top;
+    int bottom;
+    RectIDs id_set;
+  };
+
+  // Rects clipped to the damage region, one array per edge.
+  std::vector<int> left;
+  std::vector<int> top;
+  std::vector<int> right;
+  std::vector<int> bottom;
+  std::vector<uint32_t> ids;
+  // Rects in order of top and bottom edge.
+  std::vector<uint32_t> by_top;
+  std::vector<uint32_t> by_bottom;
+  // Distinct x coordinates of all edges.
+  std::vector<int> xs;
+  // Rects covering the current column.
+  std::vector<uint8_t> active;
+  // Spans of previous and current column.
+  std::vector<Span> open;
+  std::vector<Span> next;
+};
+
+// Splits the parts of rects in "in" within damage_region into disjoint
+// rectangles, each with the ids (indexes in "in") of all rects covering
+// it. Neighbouring columns covered by the same rects are merged.
+void get_draw_regions(const std::vector<Rect<int>> &in,
+                      const HwcRect<int> &damage_region,
+                      std::vector<RectSet<int>> *out,
+                      DrawRegionScratch *scratch);
+
+// Same as above for each rect of damage_region, which have to be
+// disjoint.
+void get_draw_regions(const std::vector<Rect<int>> &in,
+                      const HwcRegion &damage_region,
+                      std::vector<RectSet<int>> *out,
+                      DrawRegionScratch *scratch);
+
 void get_draw_regions(const std::vector<Rect<int>> &in,
                       const HwcRect<int> &damage_region,
                       std::vector<RectSet<int>> *out);
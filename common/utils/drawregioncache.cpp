@@ -0,0 +1,75 @@
+/*
+// Copyright (c) 2016 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+*/
+
+#include "drawregioncache.h"
+
+#include <iterator>
+
+#include "hwcutils.h"
+
+namespace hwcomposer {
+
+static void HashRect(uint64_t &hash, const HwcRect<int> &rect) {
+  HashCombine(hash, static_cast<uint32_t>(rect.left));
+  HashCombine(hash, static_cast<uint32_t>(rect.top));
+  HashCombine(hash, static_cast<uint32_t>(rect.right));
+  HashCombine(hash, static_cast<uint32_t>(rect.bottom));
+}
+
+const std::vector<RectSet<int>> &DrawRegionCache::GetDrawRegions(
+    const std::vector<HwcRect<int>> &rects, const HwcRegion &damage_region) {
+  uint64_t hash = kHashSeed;
+  HashCombine(hash, rects.size());
+  for (const HwcRect<int> &rect : rects) {
+    HashRect(hash, rect);
+  }
+
+  HashCombine(hash, damage_region.size());
+  for (const HwcRect<int> &rect : damage_region) {
+    HashRect(hash, rect);
+  }
+
+  for (auto it = entries_.begin(); it != entries_.end(); ++it) {
+    if (it->hash_ != hash || it->damage_region_ != damage_region ||
+        it->rects_ != rects)
+      continue;
+
+    entries_.splice(entries_.begin(), entries_, it);
+    return entries_.front().regions_;
+  }
+
+  // Re-use storage of the least recently used entry.
+  if (entries_.size() < kMaxEntries) {
+    entries_.emplace_front();
+  } else {
+    entries_.splice(entries_.begin(), entries_, std::prev(entries_.end()));
+  }
+
+  Entry &entry = entries_.front();
+  entry.hash_ = hash;
+  entry.rects_ = rects;
+  entry.damage_region_ = damage_region;
+  entry.regions_.clear();
+  get_draw_regions(rects, damage_region, &entry.regions_, &scratch_);
+  return entry.regions_;
+}
+
+void DrawRegionCache::Clear() {
+  std::list<Entry>().swap(entries_);
+  scratch_ = DrawRegionScratch();
+}
+
+}  // namespace hwcomposer
@@ -0,0 +1,60 @@
+/*
+// Copyright (c) 2016 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+*/
+
+#ifndef COMMON_UTILS_DRAWREGIONCACHE_H_
+#define COMMON_UTILS_DRAWREGIONCACHE_H_
+
+#include <stdint.h>
+
+#include <hwcdefs.h>
+
+#include <list>
+#include <vector>
+
+#include "disjoint_layers.h"
+
+namespace hwcomposer {
+
+// Remembers the regions get_draw_regions computed for the last few sets of
+// layer rects. Animations usually only change buffer content, leaving
+// layer geometry and damage the same over many frames.
+class DrawRegionCache {
+ public:
+  // Returns regions of get_draw_regions(rects, damage_region). Reference is
+  // valid till next call.
+  const std::vector<RectSet<int>> &GetDrawRegions(
+      const std::vector<HwcRect<int>> &rects,
+      const HwcRegion &damage_region);
+
+  void Clear();
+
+ private:
+  struct Entry {
+    uint64_t hash_ = 0;
+    std::vector<HwcRect<int>> rects_;
+    HwcRegion damage_region_;
+    std::vector<RectSet<int>> regions_;
+  };
+
+  static const size_t kMaxEntries = 8;
+
+  // Most recently used entry first.
+  std::list<Entry> entries_;
+  DrawRegionScratch scratch_;
+};
+
+}  // namespace hwcomposer
+#endif  // COMMON_UTILS_DRAWREGIONCACHE_H_
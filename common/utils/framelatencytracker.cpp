@@ -0,0 +1,129 @@
+/*
+// Copyright (c) 2016 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+*/
+
+#include "framelatencytracker.h"
+
+#include <algorithm>
+
+#include "hwcutils.h"
+
+namespace hwcomposer {
+
+FrameLatencyTracker::FrameLatencyTracker() {
+  Reset();
+}
+
+void FrameLatencyTracker::AddSample(HWCFrameStage stage, int64_t duration) {
+  uint32_t index = static_cast<uint32_t>(stage);
+  if (index >= kStages)
+    return;
+
+  uint64_t value_us = duration > 0 ? duration / 1000 : 0;
+  Histogram& histogram = histograms_[index];
+  histogram.buckets_[GetBucket(value_us)].fetch_add(1,
+                                                    std::memory_order_relaxed);
+  histogram.total_us_.fetch_add(value_us, std::memory_order_relaxed);
+  uint64_t max_us = histogram.max_us_.load(std::memory_order_relaxed);
+  while (value_us > max_us &&
+         !histogram.max_us_.compare_exchange_weak(max_us, value_us,
+                                                  std::memory_order_relaxed)) {
+  }
+}
+
+void FrameLatencyTracker::AddCommitSamples(
+    int64_t commit_end, const std::vector<int32_t>& in_fences,
+    int32_t out_fence) {
+  int64_t on_screen = 0;
+  if (out_fence <= 0 || !GetFenceSignalTime(out_fence, &on_screen))
+    return;
+
+  // Kernel waits for the acquire fences, flip happens on the first vblank
+  // after the last one signaled.
+  int64_t gpu_done = commit_end;
+  for (int32_t fence : in_fences) {
+    int64_t signal_time = 0;
+    if (fence > 0 && GetFenceSignalTime(fence, &signal_time))
+      gpu_done = std::max(gpu_done, signal_time);
+  }
+
+  AddSample(HWCFrameStage::kGpuFenceWait, gpu_done - commit_end);
+  AddSample(HWCFrameStage::kVBlank, on_screen - gpu_done);
+}
+
+void FrameLatencyTracker::GetHistogram(HWCFrameStage stage,
+                                       HWCLatencyHistogram* histogram) const {
+  histogram->samples_ = 0;
+  histogram->total_us_ = 0;
+  histogram->max_us_ = 0;
+  histogram->buckets_.clear();
+  uint32_t index = static_cast<uint32_t>(stage);
+  if (index >= kStages)
+    return;
+
+  const Histogram& source = histograms_[index];
+  for (uint32_t bucket = 0; bucket < kBuckets; bucket++) {
+    uint32_t count = source.buckets_[bucket].load(std::memory_order_relaxed);
+    if (!count)
+      continue;
+
+    histogram->samples_ += count;
+    histogram->buckets_.emplace_back(GetBucketLimit(bucket), count);
+  }
+
+  histogram->total_us_ = source.total_us_.load(std::memory_order_relaxed);
+  histogram->max_us_ = source.max_us_.load(std::memory_order_relaxed);
+}
+
+void FrameLatencyTracker::Reset() {
+  for (Histogram& histogram : histograms_) {
+    for (std::atomic<uint32_t>& bucket : histogram.buckets_)
+      bucket.store(0, std::memory_order_relaxed);
+
+    histogram.total_us_.store(0, std::memory_order_relaxed);
+    histogram.max_us_.store(0, std::memory_order_relaxed);
+  }
+}
+
+uint32_t FrameLatencyTracker::GetBucket(uint64_t value_us) {
+  if (value_us < kSubBuckets)
+    return value_us;
+
+  value_us = std::min<uint64_t>(value_us, (1ULL << kMaxExponent) - 1);
+  uint32_t exponent = 63 - __builtin_clzll(value_us);
+  uint32_t sub_bucket =
+      (value_us >> (exponent - kSubBucketBits)) - kSubBuckets;
+  return kSubBuckets + (exponent - kSubBucketBits) * kSubBuckets + sub_bucket;
+}
+
+uint64_t FrameLatencyTracker::GetBucketLimit(uint32_t bucket) {
+  if (bucket < kSubBuckets)
+    return bucket + 1;
+
+  uint32_t exponent = (bucket - kSubBuckets) / kSubBuckets;
+  uint64_t sub_bucket = (bucket - kSubBuckets) % kSubBuckets;
+  return (kSubBuckets + sub_bucket + 1) << exponent;
+}
+
+FrameLatencyTracker::ScopedStage::ScopedStage(FrameLatencyTracker& tracker,
+                                              HWCFrameStage stage)
+    : tracker_(tracker), stage_(stage), start_(GetMonotonicTime()) {
+}
+
+FrameLatencyTracker::ScopedStage::~ScopedStage() {
+  tracker_.AddSample(stage_, GetMonotonicTime() - start_);
+}
+
+}  // namespace hwcomposer
@@ -0,0 +1,88 @@
+/*
+// Copyright (c) 2016 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+*/
+
+#ifndef COMMON_UTILS_FRAMELATENCYTRACKER_H_
+#define COMMON_UTILS_FRAMELATENCYTRACKER_H_
+
+#include <stdint.h>
+
+#include <hwcdefs.h>
+
+#include <atomic>
+#include <vector>
+
+namespace hwcomposer {
+
+// Keeps latency histograms of the stages of presenting a frame on one
+// display. Samples can be added from any thread without locking, so
+// that timing is always enabled.
+class FrameLatencyTracker {
+ public:
+  FrameLatencyTracker();
+
+  // Adds duration in nanoseconds to histogram of stage.
+  void AddSample(HWCFrameStage stage, int64_t duration);
+
+  // Adds GPU fence wait and vblank samples of a frame whose atomic commit
+  // returned at commit_end, once out_fence has signaled. Frames for which
+  // signal times aren't available are skipped.
+  void AddCommitSamples(int64_t commit_end,
+                        const std::vector<int32_t>& in_fences,
+                        int32_t out_fence);
+
+  void GetHistogram(HWCFrameStage stage,
+                    HWCLatencyHistogram* histogram) const;
+
+  void Reset();
+
+  // Adds time between construction and destruction to stage.
+  class ScopedStage {
+   public:
+    ScopedStage(FrameLatencyTracker& tracker, HWCFrameStage stage);
+    ~ScopedStage();
+
+   private:
+    FrameLatencyTracker& tracker_;
+    HWCFrameStage stage_;
+    int64_t start_;
+  };
+
+ private:
+  // Every power of two range of microseconds is split into
+  // kSubBuckets linear buckets, i.e. buckets are at most 25% wide.
+  static const uint32_t kSubBucketBits = 2;
+  static const uint32_t kSubBuckets = 1 << kSubBucketBits;
+  // Samples of 2^kMaxExponent us (~16s) or more end up in last bucket.
+  static const uint32_t kMaxExponent = 24;
+  static const uint32_t kBuckets =
+      kSubBuckets + (kMaxExponent - kSubBucketBits) * kSubBuckets;
+  static const uint32_t kStages =
+      static_cast<uint32_t>(HWCFrameStage::kNumStages);
+
+  struct Histogram {
+    std::atomic<uint32_t> buckets_[kBuckets];
+    std::atomic<uint64_t> total_us_;
+    std::atomic<uint64_t> max_us_;
+  };
+
+  static uint32_t GetBucket(uint64_t value_us);
+  static uint64_t GetBucketLimit(uint32_t bucket);
+
+  Histogram histograms_[kStages];
+};
+
+}  // namespace hwcomposer
+#endif  // COMMON_UTILS_FRAMELATENCYTRACKER_H_
@@ -17,11 +17,39 @@
 #include "hwcutils.h"
 
 #include <poll.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#include <time.h>
 
 #include "hwctrace.h"
 
 #include <drm_fourcc.h>
 
+#include <atomic>
+
+#ifdef ENABLE_ALLOCATION_TRACKING
+// Counted for the whole process, as frames are partly composed by other
+// threads, e.g. CompositorThread.
+static std::atomic<uint64_t> allocation_count(0);
+
+// Counts allocations to verify the present path doesn't allocate once
+// it reached steady state. Only meant for debug builds.
+void* operator new(size_t size) {
+  allocation_count.fetch_add(1, std::memory_order_relaxed);
+  void* ptr = malloc(size ? size : 1);
+  if (!ptr)
+    abort();
+
+  return ptr;
+}
+
+void operator delete(void* ptr) noexcept {
+  free(ptr);
+}
+#endif
+
 namespace hwcomposer {
 
 int HWCPoll(int fd, int timeout) {
@@ -37,6 +65,62 @@ int HWCPoll(int fd, int timeout) {
   return ret;
 }
 
+int64_t GetMonotonicTime() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return static_cast<int64_t>(ts.tv_sec) * 1000000000LL + ts.tv_nsec;
+}
+
+uint64_t GetAllocationCount() {
+#ifdef ENABLE_ALLOCATION_TRACKING
+  return allocation_count.load(std::memory_order_relaxed);
+#else
+  return 0;
+#endif
+}
+
+// Layout of struct sync_fence_info and struct sync_file_info of
+// linux/sync_file.h, which isn't available with older kernel headers.
+struct SyncFenceInfo {
+  char obj_name[32];
+  char driver_name[32];
+  int32_t status;
+  uint32_t flags;
+  uint64_t timestamp_ns;
+};
+
+struct SyncFileInfo {
+  char name[32];
+  int32_t status;
+  uint32_t flags;
+  uint32_t num_fences;
+  uint32_t pad;
+  uint64_t sync_fence_info;
+};
+
+#define HWC_SYNC_IOC_FILE_INFO _IOWR('>', 4, struct SyncFileInfo)
+
+// Fences of a frame are merged out of a few at most.
+static const uint32_t kMaxSyncFileFences = 8;
+
+bool GetFenceSignalTime(int32_t fence, int64_t* signal_time) {
+  struct SyncFenceInfo fences[kMaxSyncFileFences];
+  struct SyncFileInfo info;
+  memset(&info, 0, sizeof(info));
+  info.num_fences = kMaxSyncFileFences;
+  info.sync_fence_info = reinterpret_cast<uintptr_t>(fences);
+  if (ioctl(fence, HWC_SYNC_IOC_FILE_INFO, &info) < 0 || info.status != 1)
+    return false;
+
+  uint64_t timestamp = 0;
+  for (uint32_t i = 0; i < info.num_fences; i++) {
+    timestamp = std::max(timestamp, fences[i].timestamp_ns);
+  }
+
+  *signal_time = timestamp;
+  return timestamp != 0;
+}
+
 bool IsLayerAlphaBlendingCommitted(OverlayLayer* layer) {
   uint64_t alpha = 0xFF;
 
@@ -74,6 +158,56 @@ void ResetRectToRegion(const HwcRegion& hwc_region, HwcRect<int>& rect) {
   }
 }
 
+static int64_t RectArea(const HwcRect<int>& rect) {
+  return static_cast<int64_t>(rect.right - rect.left) *
+         (rect.bottom - rect.top);
+}
+
+bool AddDamageRect(const HwcRect<int>& rect, HwcRegion& damage) {
+  if (rect.left >= rect.right || rect.top >= rect.bottom)
+    return false;
+
+  for (const HwcRect<int>& current : damage) {
+    if (IsEnclosedBy(rect, current))
+      return false;
+  }
+
+  damage.emplace_back(rect);
+  while (damage.size() > 1) {
+    size_t first = 0;
+    size_t second = 0;
+    int64_t least_waste = INT64_MAX;
+    HwcRect<int> merged;
+    for (size_t i = 0; i < damage.size(); i++) {
+      for (size_t j = i + 1; j < damage.size(); j++) {
+        HwcRect<int> bounds = damage[i];
+        CalculateRect(damage[j], bounds);
+        // Overlapping rects are always merged, so that no pixel is
+        // drawn twice.
+        int64_t waste = INT64_MIN;
+        if (!IsOverlapping(damage[i], damage[j])) {
+          waste = RectArea(bounds) - RectArea(damage[i]) - RectArea(damage[j]);
+        }
+
+        if (waste < least_waste) {
+          least_waste = waste;
+          first = i;
+          second = j;
+          merged = bounds;
+        }
+      }
+    }
+
+    if (least_waste > 0 && damage.size() <= kMaxDamageRects)
+      break;
+
+    damage[first] = merged;
+    damage.erase(damage.begin() + second);
+  }
+
+  return true;
+}
+
 void CalculateRect(const HwcRect<int>& target_rect, HwcRect<int>& new_rect) {
   if (new_rect.empty()) {
     new_rect = target_rect;
@@ -192,6 +326,42 @@ std::string StringifyRegion(HwcRegion region) {
   return ss.str();
 }
 
+std::string StringifyLatencyHistogram(HWCFrameStage stage,
+                                      const HWCLatencyHistogram& histogram) {
+  static const char* const kStageNames[] = {
+      "LayerInit",    "ValidateLayers", "ReValidatePlanes", "CompositorDraw",
+      "GpuFenceWait", "AtomicCommit",   "VBlank"};
+  uint32_t index = static_cast<uint32_t>(stage);
+  std::stringstream ss;
+  if (index < static_cast<uint32_t>(HWCFrameStage::kNumStages))
+    ss << kStageNames[index];
+
+  ss << ": samples " << histogram.samples_;
+  if (!histogram.samples_)
+    return ss.str();
+
+  // Percentiles are reported as limit of the bucket they fall into.
+  static const uint32_t kPercentiles[] = {50, 90, 99};
+  ss << " avg " << histogram.total_us_ / histogram.samples_ << "us";
+  uint64_t count = 0;
+  size_t bucket = 0;
+  for (uint32_t percentile : kPercentiles) {
+    uint64_t rank = (histogram.samples_ * percentile + 99) / 100;
+    while (bucket < histogram.buckets_.size() &&
+           count + histogram.buckets_[bucket].second < rank) {
+      count += histogram.buckets_[bucket].second;
+      bucket++;
+    }
+
+    if (bucket < histogram.buckets_.size())
+      ss << " p" << percentile << " <" << histogram.buckets_[bucket].first
+         << "us";
+  }
+
+  ss << " max " << histogram.max_us_ << "us";
+  return ss.str();
+}
+
 HwcRect<int> RotateRect(const HwcRect<int>& rect, int disp_width,
                         int disp_height, uint32_t transform) {
   int ox = 0, oy = 0;
@@ -0,0 +1,71 @@
+/*
+// Copyright (c) 2016 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+*/
+
+#include "idletimeout.h"
+
+#include <algorithm>
+
+namespace hwcomposer {
+
+// Default range within which idle timeout is adapted.
+static const int64_t kDefaultMinIdleTimeout = 500000000;
+static const int64_t kDefaultMaxIdleTimeout = 4000000000;
+
+// Display is considered idle only after this many present intervals
+// without an update.
+static const int64_t kIdleCadenceFactor = 4;
+
+// Idle periods lasting this many idle timeouts make the timeout shorter.
+static const int64_t kStaticIdleFactor = 4;
+
+IdleTimeout::IdleTimeout()
+    : timeout_(kDefaultMaxIdleTimeout),
+      min_timeout_(kDefaultMinIdleTimeout),
+      max_timeout_(kDefaultMaxIdleTimeout) {
+}
+
+void IdleTimeout::SetRange(int64_t min_timeout, int64_t max_timeout) {
+  min_timeout_ = min_timeout;
+  max_timeout_ = max_timeout;
+  timeout_ = std::max(std::min(timeout_, max_timeout_), min_timeout_);
+}
+
+void IdleTimeout::FramePresented(int64_t interval) {
+  // Longer gaps are idle periods rather than part of the cadence.
+  if (interval > 0 && interval < max_timeout_)
+    present_interval_ += (interval - present_interval_) / 8;
+}
+
+bool IdleTimeout::Adapt(int64_t idle_duration) {
+  if (idle_duration < timeout_) {
+    // Content changed again sooner than it took to detect it as static,
+    // switching planes twice wasn't worth it.
+    timeout_ = std::min(timeout_ * 2, max_timeout_);
+    return true;
+  }
+
+  if (idle_duration > kStaticIdleFactor * timeout_)
+    timeout_ = std::max(timeout_ - timeout_ / 4, min_timeout_);
+
+  return false;
+}
+
+int64_t IdleTimeout::Get() const {
+  int64_t timeout = std::max(timeout_, kIdleCadenceFactor * present_interval_);
+  return std::min(timeout, max_timeout_);
+}
+
+}  // namespace hwcomposer
@@ -0,0 +1,54 @@
+/*
+// Copyright (c) 2016 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+*/
+
+#ifndef COMMON_UTILS_IDLETIMEOUT_H_
+#define COMMON_UTILS_IDLETIMEOUT_H_
+
+#include <stdint.h>
+
+namespace hwcomposer {
+
+// Time without updates after which a display is considered idle, adapted
+// to the present cadence of the display and to how long its idle periods
+// last. Times are in nanoseconds. Not thread safe.
+class IdleTimeout {
+ public:
+  IdleTimeout();
+
+  // Sets range within which timeout is adapted, current timeout is
+  // clamped to it.
+  void SetRange(int64_t min_timeout, int64_t max_timeout);
+
+  // Adds interval between the last two presents to the present cadence.
+  void FramePresented(int64_t interval);
+
+  // Adapts timeout to how long the last idle period lasted. Returns true
+  // if the idle period ended before the timeout had passed.
+  bool Adapt(int64_t idle_duration);
+
+  // Time after last present when display is considered idle.
+  int64_t Get() const;
+
+ private:
+  int64_t timeout_;
+  int64_t min_timeout_;
+  int64_t max_timeout_;
+  // Moving average of time between presents.
+  int64_t present_interval_ = 0;
+};
+
+}  // namespace hwcomposer
+#endif  // COMMON_UTILS_IDLETIMEOUT_H_
@@ -20,6 +20,7 @@
 #include <binder/Parcel.h>
 #include <binder/ProcessState.h>
 #include "hwcdefs.h"
+#include "hwcutils.h"
 #include "iahwc2.h"
 
 #define HWC_VERSION_STRING                                             \
@@ -485,6 +486,34 @@ status_t HwcService::Controls::WidiSetSingleDisplay(bool enable) {
   // TO DO
   return OK;
 }
+
+status_t HwcService::Controls::DisplayGetLatencyReport(uint32_t display,
+                                                       String8 *report) {
+  hwcomposer::NativeDisplay *phyDisplay;
+  if (!display) {
+    phyDisplay = mHwc.GetPrimaryDisplay();
+  } else {
+    phyDisplay = mHwc.GetExtendedDisplay(display - 1);
+  }
+
+  if (!phyDisplay)
+    return android::BAD_VALUE;
+
+  for (uint32_t i = 0;
+       i < static_cast<uint32_t>(hwcomposer::HWCFrameStage::kNumStages); i++) {
+    hwcomposer::HWCFrameStage stage =
+        static_cast<hwcomposer::HWCFrameStage>(i);
+    hwcomposer::HWCLatencyHistogram histogram;
+    if (!phyDisplay->GetFrameStageLatency(stage, &histogram))
+      return android::INVALID_OPERATION;
+
+    report->append(
+        hwcomposer::StringifyLatencyHistogram(stage, histogram).c_str());
+    report->append("\n");
+  }
+
+  return OK;
+}
 void HwcService::RegisterListener(ENotification notify,
                                   NotifyCallback *pCallback) {
   // TO DO
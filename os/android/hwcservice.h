@@ -122,6 +122,8 @@ class HwcService : public BnService {
     status_t MdsUpdateInputState(bool state);
     status_t WidiGetSingleDisplay(bool* pEnabled);
     status_t WidiSetSingleDisplay(bool enable);
+    status_t DisplayGetLatencyReport(uint32_t display,
+                                     android::String8* report);
 
    private:
     IAHWC2& mHwc;
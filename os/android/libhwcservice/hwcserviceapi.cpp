@@ -16,6 +16,8 @@
 
 #include "hwcserviceapi.h"
 
+#include <string.h>
+
 #include "icontrols.h"
 #include "iservice.h"
 
@@ -431,4 +433,21 @@ status_t HwcService_Widi_SetSingleDisplay(HWCSHANDLE hwcs, EHwcsBool enable) {
   }
   return pContext->mControls->WidiSetSingleDisplay(enable);
 }
+
+status_t HwcService_Display_GetLatencyReport(HWCSHANDLE hwcs, uint32_t display,
+                                             char* report, uint32_t size) {
+  HwcsContext* pContext = static_cast<HwcsContext*>(hwcs);
+  if (!pContext || !report || !size) {
+    return android::BAD_VALUE;
+  }
+  String8 latency;
+  status_t ret =
+      pContext->mControls->DisplayGetLatencyReport(display, &latency);
+  if (ret != OK) {
+    return ret;
+  }
+  strncpy(report, latency.string(), size - 1);
+  report[size - 1] = '\0';
+  return OK;
+}
 }
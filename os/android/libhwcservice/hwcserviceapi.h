@@ -291,6 +291,11 @@ status_t HwcService_MDS_UpdateInputState(HWCSHANDLE hwcs, EHwcsBool state);
 status_t HwcService_Widi_GetSingleDisplay(HWCSHANDLE hwcs, EHwcsBool *enable);
 status_t HwcService_Widi_SetSingleDisplay(HWCSHANDLE hwcs, EHwcsBool enable);
 
+// Latency of the stages of presenting frames on display, one line per
+// stage. report is truncated to size, including the terminating null.
+status_t HwcService_Display_GetLatencyReport(HWCSHANDLE hwcs, uint32_t display,
+                                             char *report, uint32_t size);
+
 #ifdef __cplusplus
 }
 #endif
@@ -73,6 +73,7 @@ class BpControls : public BpInterface<IControls> {
     TRANSACT_TRIGGER_PANORAMA,
     TRANSACT_SHUTDOWN_PANORAMA,
 #endif
+    TRANSACT_DISPLAY_GET_LATENCY_REPORT,
   };
 
   status_t DisplaySetOverscan(uint32_t display, int32_t xoverscan,
@@ -615,6 +616,28 @@ class BpControls : public BpInterface<IControls> {
     }
     return reply.readInt32();
   }
+
+  status_t DisplayGetLatencyReport(uint32_t display,
+                                   String8 *report) override {
+    if (!report) {
+      return android::BAD_VALUE;
+    }
+    Parcel data;
+    Parcel reply;
+    data.writeInterfaceToken(IControls::getInterfaceDescriptor());
+    data.writeInt32(display);
+    status_t ret =
+        remote()->transact(TRANSACT_DISPLAY_GET_LATENCY_REPORT, data, &reply);
+    if (ret != NO_ERROR) {
+      ALOGW("%s() transact failed: %d", __FUNCTION__, ret);
+      return ret;
+    }
+    status_t res = reply.readInt32();
+    if (res != OK)
+      return res;
+    *report = reply.readString8();
+    return OK;
+  }
 };
 
 IMPLEMENT_META_INTERFACE(Controls, "iahwc.controls");
@@ -914,6 +937,16 @@ status_t BnControls::onTransact(uint32_t code, const Parcel &data,
       reply->writeInt32(ret);
       return NO_ERROR;
     }
+    case BpControls::TRANSACT_DISPLAY_GET_LATENCY_REPORT: {
+      CHECK_INTERFACE(IControls, data, reply);
+      uint32_t display = data.readInt32();
+      String8 report;
+      status_t ret = this->DisplayGetLatencyReport(display, &report);
+      reply->writeInt32(ret);
+      if (ret == OK)
+        reply->writeString8(report);
+      return NO_ERROR;
+    }
 
     default:
       return BBinder::onTransact(code, data, reply, flags);
@@ -19,6 +19,7 @@
 
 #include <binder/IInterface.h>
 #include <binder/Parcel.h>
+#include <utils/String8.h>
 #include "hwcserviceapi.h"
 
 namespace hwcomposer {
@@ -98,6 +99,9 @@ class IControls : public android::IInterface {
 
   virtual status_t WidiGetSingleDisplay(bool *pEnabled) = 0;
   virtual status_t WidiSetSingleDisplay(bool enable) = 0;
+
+  virtual status_t DisplayGetLatencyReport(uint32_t display,
+                                           android::String8 *report) = 0;
 };
 
 class BnControls : public android::BnInterface<IControls> {
@@ -41,6 +41,7 @@ static void usage() {
           "\t-e: Set Sharpness\n"
           "\t-d: Set deinterlace\n"
           "\t-r: Restore all default video colors/deinterlace \n"
+          "\t-l: Print latency of the stages of presenting frames\n"
 #ifdef ENABLE_PANORAMA
           "\t-w: Trigger Panorama with option of hotplug simulation or not\n"
           "\t-m: Shutdown Panorama with option of hotplug simulation or not\n";
@@ -67,15 +68,16 @@ int main(int argc, char** argv) {
   bool disable_hdcp_for_display = false;
   bool disable_hdcp_for_all_display = false;
   bool restore = false;
+  bool print_latency = false;
 #ifdef ENABLE_PANORAMA
   bool trigger_panorama = false;
   bool shutdown_panorama = false;
 #endif
   int ch;
 #ifdef ENABLE_PANORAMA
-  while ((ch = getopt(argc, argv, "gsphijkurabcdemw")) != -1) {
+  while ((ch = getopt(argc, argv, "gsphijkurabcdelmw")) != -1) {
 #else
-  while ((ch = getopt(argc, argv, "gsphijkurabcde")) != -1) {
+  while ((ch = getopt(argc, argv, "gsphijkurabcdel")) != -1) {
 #endif
     switch (ch) {
       case 'g':
@@ -121,6 +123,9 @@ int main(int argc, char** argv) {
       case 'k':
         disable_hdcp_for_all_display = true;
         break;
+      case 'l':
+        print_latency = true;
+        break;
 #ifdef ENABLE_PANORAMA
       case 'w':
         trigger_panorama = true;
@@ -260,6 +265,16 @@ int main(int argc, char** argv) {
     HwcService_Video_DisableHDCPSession_AllDisplays(hwcs);
   }
 
+  if (print_latency) {
+    char report[4096];
+    if (HwcService_Display_GetLatencyReport(hwcs, display, report,
+                                            sizeof(report)) == OK) {
+      aout << report;
+    } else {
+      aout << "Failed to get latency report\n";
+    }
+  }
+
 #ifdef ENABLE_PANORAMA
   if (trigger_panorama) {
     int simulation_hotplug = 0;
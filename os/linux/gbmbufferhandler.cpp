@@ -367,6 +367,17 @@ void *GbmBufferHandler::Map(HWCNativeHandle handle, uint32_t x, uint32_t y,
                     stride, map_data);
 }
 
+void *GbmBufferHandler::MapForRead(HWCNativeHandle handle, uint32_t x,
+                                   uint32_t y, uint32_t width, uint32_t height,
+                                   uint32_t *stride, void **map_data,
+                                   size_t plane) const {
+  if (!handle->bo)
+    return NULL;
+
+  return gbm_bo_map(handle->bo, x, y, width, height, GBM_BO_TRANSFER_READ,
+                    stride, map_data);
+}
+
 int32_t GbmBufferHandler::UnMap(HWCNativeHandle handle, void *map_data) const {
   if (!handle->bo)
     return -1;
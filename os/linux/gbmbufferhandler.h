@@ -52,6 +52,9 @@ class GbmBufferHandler : public NativeBufferHandler {
   bool GetInterlace(HWCNativeHandle handle) const override {
     return false;
   }
+  void *MapForRead(HWCNativeHandle handle, uint32_t x, uint32_t y,
+                   uint32_t width, uint32_t height, uint32_t *stride,
+                   void **map_data, size_t plane) const override;
 
  private:
   uint32_t fd_;
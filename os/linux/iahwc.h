@@ -105,6 +105,7 @@ enum iahwc_function_descriptors {
   IAHWC_FUNC_LAYER_SET_SURFACE_DAMAGE,
   IAHWC_FUNC_LAYER_SET_PLANE_ALPHA,
   IAHWC_FUNC_LAYER_SET_INDEX,
+  IAHWC_FUNC_DISPLAY_GET_LATENCY_REPORT,
 };
 
 enum iahwc_callback_descriptor {
@@ -224,6 +225,9 @@ typedef int (*IAHWC_PFN_LAYER_SET_INDEX)(iahwc_device_t*,
                                          iahwc_display_t display_handle,
                                          iahwc_layer_t layer_handle,
                                          uint32_t layer_index);
+typedef int (*IAHWC_PFN_DISPLAY_GET_LATENCY_REPORT)(
+    iahwc_device_t*, iahwc_display_t display_handle, uint32_t* size,
+    char* report);
 typedef int (*IAHWC_PFN_VSYNC)(iahwc_callback_data_t data,
                                iahwc_display_t display, int64_t timestamp);
 typedef int (*IAHWC_PFN_PIXEL_UPLOADER)(iahwc_callback_data_t data,
@@ -17,6 +17,7 @@
 #include "linux_frontend.h"
 #include <commondrmutils.h>
 #include <hwcrect.h>
+#include <hwcutils.h>
 
 #include "nativebufferhandler.h"
 
@@ -231,6 +232,10 @@ iahwc_function_ptr_t IAHWC::HookGetFunctionPtr(iahwc_device_t* /* device */,
       return ToHook<IAHWC_PFN_LAYER_SET_INDEX>(
           LayerHook<decltype(&IAHWCLayer::SetLayerIndex),
                     &IAHWCLayer::SetLayerIndex, uint32_t>);
+    case IAHWC_FUNC_DISPLAY_GET_LATENCY_REPORT:
+      return ToHook<IAHWC_PFN_DISPLAY_GET_LATENCY_REPORT>(
+          DisplayHook<decltype(&IAHWCDisplay::GetLatencyReport),
+                      &IAHWCDisplay::GetLatencyReport, uint32_t*, char*>);
     case IAHWC_FUNC_INVALID:
     default:
       return NULL;
@@ -329,6 +334,36 @@ int IAHWC::IAHWCDisplay::GetDisplayName(uint32_t* size, char* name) {
   return IAHWC_ERROR_NONE;
 }
 
+int IAHWC::IAHWCDisplay::GetLatencyReport(uint32_t* size, char* report) {
+  std::string string;
+  for (uint32_t i = 0;
+       i < static_cast<uint32_t>(hwcomposer::HWCFrameStage::kNumStages); i++) {
+    hwcomposer::HWCFrameStage stage =
+        static_cast<hwcomposer::HWCFrameStage>(i);
+    hwcomposer::HWCLatencyHistogram histogram;
+    if (!native_display_->GetFrameStageLatency(stage, &histogram))
+      return IAHWC_ERROR_NO_RESOURCES;
+
+    string += hwcomposer::StringifyLatencyHistogram(stage, histogram) + "\n";
+  }
+
+  // Size includes the terminating NUL.
+  uint32_t length = static_cast<uint32_t>(string.length());
+  if (!report) {
+    *size = length + 1;
+    return IAHWC_ERROR_NONE;
+  }
+
+  if (!*size)
+    return IAHWC_ERROR_BAD_PARAMETER;
+
+  uint32_t copied = std::min(*size - 1, length);
+  memcpy(report, string.c_str(), copied);
+  report[copied] = '\0';
+  *size = copied + 1;
+  return IAHWC_ERROR_NONE;
+}
+
 int IAHWC::IAHWCDisplay::GetDisplayConfigs(uint32_t* num_configs,
                                            uint32_t* configs) {
   bool ret = native_display_->GetDisplayConfigs(num_configs, configs);
@@ -83,6 +83,9 @@ class IAHWC : public iahwc_device {
     int GetConnectionStatus(int32_t* status);
     int GetDisplayInfo(uint32_t config, int attribute, int32_t* value);
     int GetDisplayName(uint32_t* size, char* name);
+    // Reports latency of the stages of presenting frames, one line per
+    // stage. Works like GetDisplayName with regard to size.
+    int GetLatencyReport(uint32_t* size, char* report);
     int GetDisplayConfigs(uint32_t* num_configs, uint32_t* configs);
     int SetDisplayGamma(float r, float b, float g);
     int SetDisplayConfig(uint32_t config);
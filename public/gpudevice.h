@@ -168,6 +168,9 @@ class GpuDevice : public HWCThread {
   void ParsePhysicalDisplayRotation(
       std::string& value, std::vector<uint32_t>& display_rotation,
       std::vector<uint32_t>& rotation_display_index);
+  void ParseIdleTimeoutSetting(
+      std::string& value, std::vector<uint32_t>& idle_timeouts,
+      std::vector<uint32_t>& idle_timeout_display_index);
   void ParseFloatDisplaySetting(std::string& value,
                                 std::vector<HwcRect<int32_t>>& float_displays,
                                 std::vector<uint32_t>& float_display_indices);
@@ -181,6 +184,9 @@ class GpuDevice : public HWCThread {
   void InitializeDisplayRotation(std::vector<uint32_t>& display_rotation,
                                  std::vector<uint32_t>& rotation_display_index,
                                  std::vector<NativeDisplay*>& displays);
+  void InitializeIdleTimeout(std::vector<uint32_t>& idle_timeouts,
+                             std::vector<uint32_t>& idle_timeout_display_index,
+                             std::vector<NativeDisplay*>& displays);
   void InitializeMosaicDisplay(
       std::vector<NativeDisplay*>& total_displays_,
       std::vector<std::vector<uint32_t>>& mosaic_displays,
@@ -195,6 +201,13 @@ class GpuDevice : public HWCThread {
   std::vector<NativeDisplay*> total_displays_;
 
   bool reserve_plane_ = false;
+  bool use_cost_plane_allocator_ = false;
+  // -1 when SURFACE_POOL_BUDGET is not set.
+  int32_t surface_pool_budget_mb_ = -1;
+  uint32_t compositor_contexts_ = 0;
+  bool use_pipelined_commit_ = false;
+  bool use_adaptive_sync_ = false;
+  bool use_group_commit_ = false;
   bool enable_all_display_ = false;
   std::map<uint8_t, std::vector<uint32_t>> reserved_drm_display_planes_map_;
   uint32_t initialization_state_ = kUnInitialized;
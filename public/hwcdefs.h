@@ -23,6 +23,7 @@
 #include <hwcrect.h>
 
 #include <unordered_map>
+#include <utility>
 #include <vector>
 
 namespace hwcomposer {
@@ -94,6 +95,28 @@ enum class DisplayType : int32_t {
   kLogical = 3,
   kMosaic = 4,
 };
+
+// Stages of presenting a frame, latency of each is tracked per display.
+enum class HWCFrameStage : uint32_t {
+  kLayerInit = 0,         // Initializing OverlayLayers from HwcLayers.
+  kValidateLayers = 1,    // Assigning layers to planes.
+  kReValidatePlanes = 2,  // Re-using plane assignment of last frame.
+  kCompositorDraw = 3,    // Recording GPU composition.
+  kGpuFenceWait = 4,      // Acquire fences signaling after commit.
+  kAtomicCommit = 5,      // Atomic commit ioctl.
+  kVBlank = 6,            // Waiting for vblank to show the frame.
+  kNumStages = 7
+};
+
+// Latencies in microseconds of one frame stage.
+struct HWCLatencyHistogram {
+  uint64_t samples_ = 0;
+  uint64_t total_us_ = 0;
+  uint64_t max_us_ = 0;
+  // Non empty buckets in increasing order, as latency limit which samples
+  // are below and number of samples.
+  std::vector<std::pair<uint64_t, uint64_t>> buckets_;
+};
 #endif  //__cplusplus
 
 enum DisplayPowerMode {
@@ -101,7 +101,9 @@ struct HwcLayer {
    *        layer has not changed from last Present call.
    *        If no of rects is zero than assumption is that
    *        the contents of layer has completely changed
-   *        from last Present call.
+   *        from last Present call. Otherwise rects are
+   *        kept apart, merged down to at most
+   *        kMaxDamageRects.
    */
   void SetSurfaceDamage(const HwcRegion& surface_damage);
 
@@ -248,7 +250,10 @@ struct HwcLayer {
   }
 
   void SetLayerCompositionType(HWCLayerCompositionType type) {
-    composition_type_ = type;
+    if (composition_type_ != type) {
+      composition_type_ = type;
+      fingerprint_ = 0;
+    }
   }
 
   HWCLayerCompositionType GetLayerCompositionType() {
@@ -282,10 +287,26 @@ struct HwcLayer {
    */
   const HwcRect<int>& GetLayerDamage();
 
+  /**
+   * API for getting damage area caused by this layer for current
+   * frame update as disjoint rects, GetLayerDamage() bounds them.
+   */
+  const HwcRegion& GetLayerDamageRegion();
+
+  /**
+   * API for getting a fingerprint of the attributes which decide how
+   * this layer is shown, i.e. display frame, source crop, transform,
+   * alpha, blending, z order, dataspace, solid color and layer type.
+   * Buffer and damage are not part of it. Layers with equal fingerprints
+   * in consecutive frames can re-use previous composition results.
+   */
+  uint64_t GetStateFingerprint();
+
  private:
   void Validate();
   void UpdateRenderingDamage(const HwcRect<int>& old_rect,
                              const HwcRect<int>& newrect, bool same_rect);
+  void AddRenderingDamage(const HwcRect<int>& rect);
 
   /*
    Get Rendering Damage from source surface damage
@@ -295,6 +316,8 @@ struct HwcLayer {
   void SufaceDamageTransfrom();
 
   void SetTotalDisplays(uint32_t total_displays);
+
+  void UpdateStateFingerprint();
   friend class VirtualDisplay;
   friend class PhysicalDisplay;
   friend class MosaicDisplay;
@@ -331,6 +354,10 @@ struct HwcLayer {
   HwcRect<int> surface_damage_;
   HwcRect<int> visible_rect_;
   HwcRect<int> current_rendering_damage_;
+  // Rects bounded by surface_damage_ and current_rendering_damage_.
+  HwcRegion surface_damage_region_;
+  HwcRegion rendering_damage_region_;
+  HwcRegion damage_scratch_;
   HWCBlending blending_ = HWCBlending::kBlendingNone;
   HWCNativeHandle sf_handle_ = 0;
   int32_t release_fd_ = -1;
@@ -346,6 +373,8 @@ struct HwcLayer {
   bool is_video_layer_ = false;
   uint32_t solid_color_ = 0xff;
   bool use_for_mosaic_ = false;
+  // 0 till calculated, reset whenever an attribute changes.
+  uint64_t fingerprint_ = 0;
 
   HWCLayerCompositionType composition_type_ = Composition_Device;
 };
@@ -41,6 +41,29 @@ namespace hwcomposer {
  */
 int HWCPoll(int fd, int timeout);
 
+/**
+ * Returns current CLOCK_MONOTONIC time in nanoseconds. This is the
+ * clock used for vblank timestamps.
+ */
+int64_t GetMonotonicTime();
+
+/**
+ * Returns number of heap allocations done through operator new by all
+ * threads of the process. Always returns 0 unless built with
+ * ENABLE_ALLOCATION_TRACKING (--enable-allocation-tracking).
+ */
+uint64_t GetAllocationCount();
+
+/**
+ * Get CLOCK_MONOTONIC time in nanoseconds at which a sync file fence
+ * signaled
+ *
+ * For fences merged out of several ones this is when the last of them
+ * signaled.
+ * @return false if fence hasn't signaled yet or time couldn't be queried
+ */
+bool GetFenceSignalTime(int32_t fence, int64_t* signal_time);
+
 bool IsLayerAlphaBlendingCommitted(OverlayLayer* layer);
 
 /**
@@ -53,6 +76,24 @@ bool IsLayerAlphaBlendingCommitted(OverlayLayer* layer);
  */
 void ResetRectToRegion(const HwcRegion& hwc_region, HwcRect<int>& rect);
 
+/**
+ * Maximum number of rectangles kept in a damage region
+ */
+static const size_t kMaxDamageRects = 4;
+
+/**
+ * Add a rectangle to a damage region
+ *
+ * Rectangles of the region are kept disjoint and at most kMaxDamageRects.
+ * Overlapping rectangles, and rectangles tiling their bounds exactly, are
+ * merged. Past kMaxDamageRects the pair whose bounds add the least area
+ * is merged.
+ * @param rect The rectangle to add, ignored if it has no area
+ * @param damage The region to add to
+ * @return True if the region changed
+ */
+bool AddDamageRect(const HwcRect<int>& rect, HwcRegion& damage);
+
 /**
  * Expand the bounds of a rectangle to enclose the bounds of a target rectangle
  *
@@ -235,6 +276,26 @@ inline HwcRect<int> Intersection(const hwcomposer::HwcRect<int>& rect1,
   return rect;
 }
 
+/**
+ * Initial value to be used with HashCombine.
+ */
+static const uint64_t kHashSeed = 0xcbf29ce484222325ULL;
+
+/**
+ * Mix a value into a running hash
+ *
+ * FNV-1a over the bytes of value. Meant for building cache keys out of
+ * a handful of integer attributes, not for hashing large buffers.
+ * @param hash running hash, should start as kHashSeed
+ * @param value value to be mixed into hash
+ */
+inline void HashCombine(uint64_t& hash, uint64_t value) {
+  for (int i = 0; i < 8; i++) {
+    hash ^= (value >> (i * 8)) & 0xff;
+    hash *= 0x100000001b3ULL;
+  }
+}
+
 /**
  * Pretty-print HwcRect for debugging.
  */
@@ -245,6 +306,13 @@ std::string StringifyRect(HwcRect<int> rect);
  */
 std::string StringifyRegion(HwcRegion region);
 
+/**
+ * Pretty-print latency histogram of a frame stage as a single line of
+ * average, percentiles and maximum.
+ */
+std::string StringifyLatencyHistogram(HWCFrameStage stage,
+                                      const HWCLatencyHistogram& histogram);
+
 HwcRect<int> RotateRect(const HwcRect<int>& rect, int disp_width,
                         int disp_height, uint32_t transform);
 HwcRect<int> ScaleRect(HwcRect<int> rect, float x_scale, float y_scale);
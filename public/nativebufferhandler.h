@@ -56,6 +56,13 @@ class NativeBufferHandler {
 
   virtual uint32_t GetFd() const = 0;
   virtual bool GetInterlace(HWCNativeHandle handle) const = 0;
+
+  // Maps handle for reading only, e.g. to compose from it on the CPU.
+  virtual void *MapForRead(HWCNativeHandle handle, uint32_t x, uint32_t y,
+                           uint32_t width, uint32_t height, uint32_t *stride,
+                           void **map_data, size_t plane) const {
+    return Map(handle, x, y, width, height, stride, map_data, plane);
+  }
 };
 
 }  // namespace hwcomposer
@@ -480,6 +480,18 @@ class NativeDisplay {
     return false;
   }
 
+  // Frames presented on displays from now till EndCommitGroup are
+  // committed with a single atomic commit, so that they reach the screen
+  // together. Returns false if frames are committed separately.
+  virtual bool BeginCommitGroup(
+      const std::vector<NativeDisplay *> & /*displays*/) {
+    return false;
+  }
+
+  // Commits frames presented since BeginCommitGroup.
+  virtual void EndCommitGroup() {
+  }
+
  protected:
   friend class PhysicalDisplay;
   friend class GpuDevice;
@@ -506,6 +518,31 @@ class NativeDisplay {
   virtual void RotateDisplay(HWCRotation /*rotation*/) {
   }
 
+  // Sets range within which the time without updates, after which all
+  // layers are composed into a single plane, is adapted to the present
+  // cadence of this display. Times are in milliseconds.
+  virtual bool SetIdleTimeout(uint32_t /*min_timeout_ms*/,
+                              uint32_t /*max_timeout_ms*/) {
+    return false;
+  }
+
+  // Returns time in milliseconds this display spent using all planes
+  // (active) and composing all layers into a single plane (idle).
+  virtual bool GetIdleStateTimes(uint64_t * /*active_ms*/,
+                                 uint64_t * /*idle_ms*/) {
+    return false;
+  }
+
+  // Returns latency histogram of stage, accumulated over the frames
+  // presented on this display since last reset.
+  virtual bool GetFrameStageLatency(HWCFrameStage /*stage*/,
+                                    HWCLatencyHistogram * /*histogram*/) {
+    return false;
+  }
+
+  virtual void ResetFrameStageLatency() {
+  }
+
  private:
   std::vector<uint64_t> LayerIds_;
   uint64_t current_max_layer_ids_ = 0;
@@ -0,0 +1,237 @@
+/*
+// Copyright (c) 2016 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+*/
+
+// Checks the SIMD blend kernels of the CPU compositor against the scalar
+// one on random layer stacks and banded blending against a single pass,
+// then reports how long each kernel takes to blend a 1920x1080 frame.
+// Exits with 1 if any check failed.
+//
+// Usage: cpucompositorbench [iterations] [seed]
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <algorithm>
+#include <chrono>
+#include <random>
+#include <vector>
+
+#include "cpublend.h"
+
+using hwcomposer::CPUBlendKernel;
+using hwcomposer::CPUBlendLayer;
+using hwcomposer::CPUBlendRegion;
+using hwcomposer::CPUBlendScratch;
+using hwcomposer::CPUImage;
+
+static const uint32_t kWidth = 1920;
+static const uint32_t kHeight = 1080;
+
+static const char *KernelName(CPUBlendKernel kernel) {
+  switch (kernel) {
+    case hwcomposer::kBlendAVX2:
+      return "avx2";
+    case hwcomposer::kBlendSSE41:
+      return "sse4.1";
+    default:
+      return "scalar";
+  }
+}
+
+static void RandomImage(std::mt19937 &rng, uint32_t width, uint32_t height,
+                        std::vector<uint8_t> *pixels, CPUImage *image) {
+  std::uniform_int_distribution<int> byte(0, 255);
+  std::uniform_int_distribution<int> coin(0, 1);
+  pixels->resize(width * height * 4);
+  for (uint8_t &value : *pixels) {
+    value = byte(rng);
+  }
+
+  image->pixels = pixels->data();
+  image->stride = width * 4;
+  image->width = width;
+  image->height = height;
+  image->swap_rb = coin(rng);
+  image->opaque = !coin(rng) && !coin(rng);
+}
+
+// Picks an unscaled, scaled or rotated mapping of the target to image.
+static void RandomLayer(std::mt19937 &rng, const CPUImage *image,
+                        CPUBlendLayer *layer) {
+  std::uniform_int_distribution<int> kind(0, 5);
+  std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+  layer->image = kind(rng) ? image : NULL;
+  layer->alpha = kind(rng) ? 1.0f : unit(rng);
+  layer->premult = kind(rng) ? 1.0f : 0.0f;
+  if (!kind(rng)) {
+    for (int c = 0; c < 3; c++) {
+      layer->color[c] = unit(rng) * 0.25f;
+    }
+  }
+
+  switch (kind(rng)) {
+    case 0:
+    case 1:
+      // Scaled.
+      layer->ds_dx = 0.25f + unit(rng) * 2;
+      layer->dt_dy = 0.25f + unit(rng) * 2;
+      layer->s_origin = unit(rng) * 32 - 16;
+      layer->t_origin = unit(rng) * 32 - 16;
+      break;
+    case 2:
+      // Rotated by 90 degrees.
+      layer->ds_dy = 1;
+      layer->dt_dx = -1;
+      layer->t_origin = static_cast<float>(image->height);
+      break;
+    default:
+      layer->ds_dx = 1;
+      layer->dt_dy = 1;
+      break;
+  }
+}
+
+template <typename TFunc>
+static double TimeCalls(uint32_t iterations, TFunc func) {
+  auto start = std::chrono::steady_clock::now();
+  for (uint32_t i = 0; i < iterations; i++) {
+    func();
+  }
+
+  std::chrono::duration<double, std::milli> elapsed =
+      std::chrono::steady_clock::now() - start;
+  return elapsed.count() / iterations;
+}
+
+static void BlendFrame(CPUBlendKernel kernel,
+                       const std::vector<CPUBlendLayer> &layers,
+                       CPUBlendScratch *scratch, std::vector<uint8_t> *out) {
+  std::vector<CPUBlendRegion> regions(1);
+  regions[0].width = kWidth;
+  regions[0].height = kHeight;
+  regions[0].layers = layers;
+  out->resize(kWidth * kHeight * 4);
+  hwcomposer::BlendRegions(kernel, regions, out->data(), kWidth * 4, 0, 1,
+                           scratch);
+}
+
+int main(int argc, char *argv[]) {
+  uint32_t iterations = argc > 1 ? atoi(argv[1]) : 200;
+  uint32_t seed = argc > 2 ? atoi(argv[2]) : 1;
+  std::mt19937 rng(seed);
+
+  std::vector<CPUBlendKernel> kernels;
+  CPUBlendKernel best = hwcomposer::GetBestBlendKernel();
+  for (int kernel = hwcomposer::kBlendSSE41; kernel <= best; kernel++) {
+    kernels.emplace_back(static_cast<CPUBlendKernel>(kernel));
+  }
+
+  // Equivalence on random stacks, SIMD kernels may only differ from the
+  // scalar one by rounding.
+  uint32_t failures = 0;
+  CPUBlendScratch scratch;
+  std::uniform_int_distribution<size_t> layer_dist(1, 6);
+  std::uniform_int_distribution<uint32_t> size_dist(1, 300);
+  for (uint32_t i = 0; i < iterations; i++) {
+    std::vector<std::vector<uint8_t>> pixels(6);
+    std::vector<CPUImage> images(6);
+    std::vector<CPUBlendLayer> layers(layer_dist(rng));
+    for (size_t j = 0; j < layers.size(); j++) {
+      RandomImage(rng, size_dist(rng), size_dist(rng), &pixels[j], &images[j]);
+      RandomLayer(rng, &images[j], &layers[j]);
+    }
+
+    uint32_t x = size_dist(rng);
+    uint32_t y = size_dist(rng);
+    size_t count = std::min<size_t>(size_dist(rng), hwcomposer::kCPUBlendSpan);
+    std::vector<uint8_t> expected(count * 4);
+    hwcomposer::BlendSpan(hwcomposer::kBlendScalar, layers.data(),
+                          layers.size(), x, y, count, &scratch,
+                          expected.data());
+    for (CPUBlendKernel kernel : kernels) {
+      std::vector<uint8_t> actual(count * 4);
+      hwcomposer::BlendSpan(kernel, layers.data(), layers.size(), x, y, count,
+                            &scratch, actual.data());
+      for (size_t k = 0; k < actual.size(); k++) {
+        if (abs(actual[k] - expected[k]) > 1) {
+          fprintf(stderr, "Check %u: %s differs at byte %zu, %d != %d\n", i,
+                  KernelName(kernel), k, actual[k], expected[k]);
+          failures++;
+          break;
+        }
+      }
+    }
+  }
+
+  printf("Equivalence: %u failures in %u random stacks.\n", failures,
+         iterations);
+
+  // Blending bands on several threads has to cover every row once.
+  std::vector<uint8_t> pixels;
+  CPUImage image;
+  RandomImage(rng, 300, 300, &pixels, &image);
+  std::vector<CPUBlendRegion> regions(6);
+  for (size_t j = 0; j < regions.size(); j++) {
+    regions[j].x = size_dist(rng);
+    regions[j].y = size_dist(rng) + j * 120;
+    regions[j].width = size_dist(rng);
+    regions[j].height = size_dist(rng);
+    regions[j].layers.resize(2);
+    RandomLayer(rng, &image, &regions[j].layers[0]);
+    RandomLayer(rng, &image, &regions[j].layers[1]);
+  }
+
+  std::vector<uint8_t> single(kWidth * kHeight * 4);
+  hwcomposer::BlendRegions(best, regions, single.data(), kWidth * 4, 0, 1,
+                           &scratch);
+  std::vector<uint8_t> banded(kWidth * kHeight * 4);
+  for (uint32_t band = 0; band < 3; band++) {
+    hwcomposer::BlendRegions(best, regions, banded.data(), kWidth * 4, band, 3,
+                             &scratch);
+  }
+
+  if (single != banded) {
+    fprintf(stderr, "Banded blending differs from a single pass.\n");
+    failures++;
+  }
+
+  // Frame timings, full screen layers.
+  kernels.insert(kernels.begin(), hwcomposer::kBlendScalar);
+  printf("%8s %12s %12s\n", "layers", "kernel", "frame ms");
+  const size_t kLayers[] = {1, 2, 4};
+  for (size_t count : kLayers) {
+    std::vector<std::vector<uint8_t>> pixels(count);
+    std::vector<CPUImage> images(count);
+    std::vector<CPUBlendLayer> layers(count);
+    for (size_t j = 0; j < count; j++) {
+      RandomImage(rng, kWidth, kHeight, &pixels[j], &images[j]);
+      images[j].opaque = j == count - 1;
+      layers[j].image = &images[j];
+      layers[j].ds_dx = 1;
+      layers[j].dt_dy = 1;
+    }
+
+    std::vector<uint8_t> out;
+    for (CPUBlendKernel kernel : kernels) {
+      double frame_ms = TimeCalls(iterations / 20 + 1, [&]() {
+        BlendFrame(kernel, layers, &scratch, &out);
+      });
+      printf("%8zu %12s %12.2f\n", count, KernelName(kernel), frame_ms);
+    }
+  }
+
+  return failures ? 1 : 0;
+}
@@ -0,0 +1,236 @@
+/*
+// Copyright (c) 2016 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+*/
+
+// Checks get_draw_regions against the previous std::set based
+// implementation and a brute force reference on random rect sets, then
+// reports how long both take for different numbers of rects. Exits with
+// 1 if any check failed.
+//
+// Usage: drawregionsbench [iterations] [seed]
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <algorithm>
+#include <chrono>
+#include <random>
+#include <vector>
+
+#include "disjoint_layers.h"
+#include "legacydrawregions.h"
+
+using hwcomposer::DrawRegionScratch;
+using hwcomposer::HwcRect;
+using hwcomposer::RectIDs;
+using hwcomposer::RectSet;
+
+static const int kWidth = 1920;
+static const int kHeight = 1080;
+
+static std::vector<HwcRect<int>> RandomRects(std::mt19937 &rng,
+                                             size_t count) {
+  // Snap coordinates to a grid now and then, so that edges are shared.
+  std::uniform_int_distribution<int> x_dist(-64, kWidth + 64);
+  std::uniform_int_distribution<int> y_dist(-64, kHeight + 64);
+  std::uniform_int_distribution<int> snap(0, 3);
+  std::vector<HwcRect<int>> rects;
+  for (size_t i = 0; i < count; i++) {
+    int x[2] = {x_dist(rng), x_dist(rng)};
+    int y[2] = {y_dist(rng), y_dist(rng)};
+    for (int j = 0; j < 2; j++) {
+      if (!snap(rng)) {
+        x[j] -= x[j] % 240;
+        y[j] -= y[j] % 135;
+      }
+    }
+
+    rects.emplace_back(HwcRect<int>(std::min(x[0], x[1]), std::min(y[0], y[1]),
+                                    std::max(x[0], x[1]),
+                                    std::max(y[0], y[1])));
+  }
+
+  return rects;
+}
+
+static HwcRect<int> RandomDamage(std::mt19937 &rng) {
+  std::uniform_int_distribution<int> full(0, 1);
+  if (full(rng))
+    return HwcRect<int>(0, 0, kWidth, kHeight);
+
+  std::uniform_int_distribution<int> x_dist(0, kWidth);
+  std::uniform_int_distribution<int> y_dist(0, kHeight);
+  int x0 = x_dist(rng);
+  int x1 = x_dist(rng);
+  int y0 = y_dist(rng);
+  int y1 = y_dist(rng);
+  return HwcRect<int>(std::min(x0, x1), std::min(y0, y1), std::max(x0, x1),
+                      std::max(y0, y1));
+}
+
+// Returns rects of out covering the cell at x, y, checking that there
+// is at most one.
+static const RectSet<int> *FindRegion(const std::vector<RectSet<int>> &out,
+                                      int x, int y, bool *overlap) {
+  const RectSet<int> *found = NULL;
+  for (const RectSet<int> &region : out) {
+    if (x < region.rect.left || x >= region.rect.right || y < region.rect.top ||
+        y >= region.rect.bottom)
+      continue;
+
+    if (found)
+      *overlap = true;
+
+    found = &region;
+  }
+
+  return found;
+}
+
+// Checks that every cell of the grid through all edges is covered by
+// exactly the rects of "in" covering it, according to out. If reference
+// is not NULL, it has to give the same answer for every cell.
+static bool CheckRegions(const std::vector<HwcRect<int>> &in,
+                         const HwcRect<int> &damage,
+                         const std::vector<RectSet<int>> &out,
+                         const std::vector<RectSet<int>> *reference) {
+  std::vector<int> xs = {damage.left, damage.right};
+  std::vector<int> ys = {damage.top, damage.bottom};
+  for (const HwcRect<int> &rect : in) {
+    xs.emplace_back(std::min(std::max(rect.left, damage.left), damage.right));
+    xs.emplace_back(std::min(std::max(rect.right, damage.left), damage.right));
+    ys.emplace_back(std::min(std::max(rect.top, damage.top), damage.bottom));
+    ys.emplace_back(std::min(std::max(rect.bottom, damage.top), damage.bottom));
+  }
+
+  std::sort(xs.begin(), xs.end());
+  xs.erase(std::unique(xs.begin(), xs.end()), xs.end());
+  std::sort(ys.begin(), ys.end());
+  ys.erase(std::unique(ys.begin(), ys.end()), ys.end());
+
+  for (size_t i = 0; i + 1 < xs.size(); i++) {
+    for (size_t j = 0; j + 1 < ys.size(); j++) {
+      int x = xs[i];
+      int y = ys[j];
+      RectIDs expected;
+      for (size_t k = 0; k < in.size(); k++) {
+        if (x >= in[k].left && x < in[k].right && y >= in[k].top &&
+            y < in[k].bottom)
+          expected.add(k);
+      }
+
+      bool overlap = false;
+      const RectSet<int> *region = FindRegion(out, x, y, &overlap);
+      RectIDs actual;
+      if (region)
+        actual = region->id_set;
+
+      if (overlap || actual != expected) {
+        fprintf(stderr, "Wrong rects at %d,%d\n", x, y);
+        return false;
+      }
+
+      if (!reference)
+        continue;
+
+      region = FindRegion(*reference, x, y, &overlap);
+      RectIDs legacy;
+      if (region)
+        legacy = region->id_set;
+
+      if (legacy != actual) {
+        fprintf(stderr, "Differs from previous implementation at %d,%d\n", x,
+                y);
+        return false;
+      }
+    }
+  }
+
+  return true;
+}
+
+template <typename TFunc>
+static double TimeCalls(uint32_t iterations, TFunc func) {
+  auto start = std::chrono::steady_clock::now();
+  for (uint32_t i = 0; i < iterations; i++) {
+    func();
+  }
+
+  std::chrono::duration<double, std::micro> elapsed =
+      std::chrono::steady_clock::now() - start;
+  return elapsed.count() / iterations;
+}
+
+int main(int argc, char *argv[]) {
+  uint32_t iterations = argc > 1 ? atoi(argv[1]) : 200;
+  uint32_t seed = argc > 2 ? atoi(argv[2]) : 1;
+  std::mt19937 rng(seed);
+
+  // Equivalence on random rect sets. Legacy implementation gives up on
+  // more than 64 rects, brute force check still applies to those.
+  uint32_t failures = 0;
+  std::uniform_int_distribution<size_t> count_dist(1, 96);
+  for (uint32_t i = 0; i < iterations; i++) {
+    size_t count = count_dist(rng);
+    std::vector<HwcRect<int>> in = RandomRects(rng, count);
+    HwcRect<int> damage = RandomDamage(rng);
+    std::vector<RectSet<int>> out;
+    hwcomposer::get_draw_regions(in, damage, &out);
+    std::vector<RectSet<int>> legacy;
+    if (count <= 64)
+      hwcomposer::legacy_get_draw_regions(in, damage, &legacy);
+
+    if (!CheckRegions(in, damage, out, count <= 64 ? &legacy : NULL)) {
+      fprintf(stderr, "Check %u with %zu rects failed.\n", i, count);
+      failures++;
+    }
+  }
+
+  printf("Equivalence: %u of %u random rect sets failed.\n", failures,
+         iterations);
+
+  printf("%8s %12s %12s %10s %10s\n", "rects", "legacy us", "sweep us",
+         "legacy out", "sweep out");
+  const size_t kCounts[] = {4, 8, 16, 32, 64, 128, 256};
+  for (size_t count : kCounts) {
+    std::vector<HwcRect<int>> in = RandomRects(rng, count);
+    HwcRect<int> damage(0, 0, kWidth, kHeight);
+    std::vector<RectSet<int>> out;
+    DrawRegionScratch scratch;
+    double sweep_us = TimeCalls(iterations, [&]() {
+      out.clear();
+      hwcomposer::get_draw_regions(in, damage, &out, &scratch);
+    });
+
+    std::vector<RectSet<int>> legacy;
+    double legacy_us = 0;
+    if (count <= 64) {
+      legacy_us = TimeCalls(iterations, [&]() {
+        legacy.clear();
+        hwcomposer::legacy_get_draw_regions(in, damage, &legacy);
+      });
+    }
+
+    if (count <= 64) {
+      printf("%8zu %12.2f %12.2f %10zu %10zu\n", count, legacy_us, sweep_us,
+             legacy.size(), out.size());
+    } else {
+      printf("%8zu %12s %12.2f %10s %10zu\n", count, "-", sweep_us, "-",
+             out.size());
+    }
+  }
+
+  return failures ? 1 : 0;
+}
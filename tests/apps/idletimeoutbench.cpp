@@ -0,0 +1,127 @@
+/*
+// Copyright (c) 2016 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+*/
+
+// Checks how the idle timeout adapts to the idle periods and present
+// cadence of a display, then replays a present pattern alternating
+// between animation and static content and reports the timeout and
+// early idle exits over time. Exits with 1 if any check failed.
+//
+// Usage: idletimeoutbench
+
+#include <stdio.h>
+
+#include "idletimeout.h"
+
+using hwcomposer::IdleTimeout;
+
+static const int64_t kMs = 1000000;
+
+static uint32_t failures = 0;
+
+static void Expect(const char *check, int64_t value, int64_t expected) {
+  if (value == expected)
+    return;
+
+  fprintf(stderr, "%s: %lld ms, expected %lld ms\n", check,
+          (long long)(value / kMs), (long long)(expected / kMs));
+  failures++;
+}
+
+static void CheckAdapt() {
+  IdleTimeout timeout;
+  timeout.SetRange(100 * kMs, 800 * kMs);
+  Expect("Clamped to max", timeout.Get(), 800 * kMs);
+
+  // Idle periods in between timeout and four timeouts keep it.
+  if (timeout.Adapt(2000 * kMs))
+    Expect("Not an early exit", 1, 0);
+  Expect("Kept", timeout.Get(), 800 * kMs);
+
+  // Long idle periods shrink it by a quarter, down to min.
+  timeout.Adapt(4000 * kMs);
+  Expect("Shrunk", timeout.Get(), 600 * kMs);
+  for (int i = 0; i < 16; i++)
+    timeout.Adapt(10000 * kMs);
+  Expect("Clamped to min", timeout.Get(), 100 * kMs);
+
+  // Early exits double it, up to max.
+  if (!timeout.Adapt(50 * kMs))
+    Expect("Early exit", 0, 1);
+  Expect("Doubled", timeout.Get(), 200 * kMs);
+  for (int i = 0; i < 4; i++)
+    timeout.Adapt(50 * kMs);
+  Expect("Doubled up to max", timeout.Get(), 800 * kMs);
+
+  timeout.SetRange(100 * kMs, 400 * kMs);
+  Expect("Clamped to new max", timeout.Get(), 400 * kMs);
+}
+
+static void CheckCadence() {
+  IdleTimeout timeout;
+  timeout.SetRange(100 * kMs, 800 * kMs);
+  for (int i = 0; i < 16; i++)
+    timeout.Adapt(10000 * kMs);
+  Expect("Timeout before cadence", timeout.Get(), 100 * kMs);
+
+  // Presents every 16ms keep the timeout, as four intervals are shorter.
+  for (int i = 0; i < 64; i++)
+    timeout.FramePresented(16 * kMs);
+  Expect("Timeout at 60 fps", timeout.Get(), 100 * kMs);
+
+  // Slow cadence makes timeout four times its moving average.
+  for (int i = 0; i < 256; i++)
+    timeout.FramePresented(160 * kMs);
+  int64_t value = timeout.Get();
+  if (value < 600 * kMs || value > 640 * kMs)
+    Expect("Timeout at 6 fps", value, 640 * kMs);
+
+  // Gaps of max timeout or longer are idle periods, not cadence.
+  timeout.FramePresented(800 * kMs);
+  Expect("Idle gap ignored", timeout.Get(), value);
+
+  // Cadence doesn't push timeout past max.
+  for (int i = 0; i < 256; i++)
+    timeout.FramePresented(400 * kMs);
+  Expect("Cadence clamped to max", timeout.Get(), 800 * kMs);
+}
+
+// Replays 16ms updates with idle periods in between, where every third
+// idle period ends shortly after idle mode was entered.
+static void ReplayPattern() {
+  IdleTimeout timeout;
+  uint32_t early_exits = 0;
+  printf("%8s %12s %12s %12s\n", "period", "idle ms", "timeout ms",
+         "early exits");
+  for (int period = 0; period < 16; period++) {
+    for (int i = 0; i < 30; i++)
+      timeout.FramePresented(16 * kMs);
+
+    int64_t idle = (period % 3 == 2 ? 200 : 20000) * kMs;
+    if (timeout.Adapt(idle))
+      early_exits++;
+
+    printf("%8d %12lld %12lld %12u\n", period, (long long)(idle / kMs),
+           (long long)(timeout.Get() / kMs), early_exits);
+  }
+}
+
+int main(int, char *[]) {
+  CheckAdapt();
+  CheckCadence();
+  printf("Idle timeout: %u failures.\n", failures);
+  ReplayPattern();
+  return failures ? 1 : 0;
+}
@@ -0,0 +1,483 @@
+/*
+// Copyright (c) 2016 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+*/
+
+// Runs layer stacks through DisplayPlaneManager::ValidateLayers against a
+// fake display described in a json file and reports validation latency,
+// TestCommit counts and how layers were split between planes and GPU.
+// No GPU or display is needed, build with --enable-dummy-compositor.
+//
+// Usage: planevalidationbench <config.json>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+#include <chrono>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <drm_fourcc.h>
+#include <json.h>
+
+#include <hwcdefs.h>
+#include <hwclayer.h>
+
+#include "displayplanemanager.h"
+#include "fakebufferhandler.h"
+#include "fakedisplayplanehandler.h"
+#include "nativesurface.h"
+#include "overlaylayer.h"
+#include "resourcemanager.h"
+
+struct BENCH_LAYER {
+  uint32_t format = DRM_FORMAT_XRGB8888;
+  uint32_t type = hwcomposer::kLayerNormal;
+  uint32_t source_width = 0;
+  uint32_t source_height = 0;
+  hwcomposer::HwcRect<float> source_crop;
+  hwcomposer::HwcRect<int> frame;
+  uint32_t transform = hwcomposer::kIdentity;
+  uint8_t alpha = 0xFF;
+  hwcomposer::HWCBlending blending = hwcomposer::HWCBlending::kBlendingNone;
+  bool has_crop = false;
+};
+
+struct BENCH_STACK {
+  std::string name;
+  std::vector<BENCH_LAYER> layers;
+};
+
+struct BENCH_PARAMETERS {
+  uint32_t width = 1920;
+  uint32_t height = 1080;
+  uint32_t iterations = 200;
+  std::vector<FakePlaneCaps> planes;
+  FakeTestCommitRules rules;
+  uint32_t random_stacks = 0;
+  uint32_t random_min_layers = 2;
+  uint32_t random_max_layers = 8;
+  uint32_t random_seed = 1;
+  std::vector<uint32_t> random_formats;
+  std::vector<BENCH_STACK> stacks;
+};
+
+struct BENCH_RESULT {
+  std::vector<double> latencies_us;
+  uint32_t test_commits = 0;
+  uint32_t failed_test_commits = 0;
+  uint32_t planes = 0;
+  uint32_t scanout_layers = 0;
+  uint32_t gpu_layers = 0;
+};
+
+static uint32_t parseFormat(const char* format) {
+  if (strlen(format) != 4) {
+    fprintf(stderr, "Invalid format %s, expected fourcc like XR24\n", format);
+    return 0;
+  }
+
+  return fourcc_code(format[0], format[1], format[2], format[3]);
+}
+
+static uint32_t parseLayerType(const char* type) {
+  if (!strcmp(type, "video"))
+    return hwcomposer::kLayerVideo;
+  if (!strcmp(type, "cursor"))
+    return hwcomposer::kLayerCursor;
+  return hwcomposer::kLayerNormal;
+}
+
+static hwcomposer::HWCBlending parseBlending(const char* blending) {
+  if (!strcmp(blending, "premult"))
+    return hwcomposer::HWCBlending::kBlendingPremult;
+  if (!strcmp(blending, "coverage"))
+    return hwcomposer::HWCBlending::kBlendingCoverage;
+  return hwcomposer::HWCBlending::kBlendingNone;
+}
+
+static void parseFormats(json_object* value, std::vector<uint32_t>* formats) {
+  int len = json_object_array_length(value);
+  for (int i = 0; i < len; i++) {
+    uint32_t format = parseFormat(
+        json_object_get_string(json_object_array_get_idx(value, i)));
+    if (format)
+      formats->push_back(format);
+  }
+}
+
+static void parsePlane(json_object* object, FakePlaneCaps* caps) {
+  json_object_object_foreach(object, key, value) {
+    if (!strcmp(key, "formats")) {
+      parseFormats(value, &caps->formats);
+    } else if (!strcmp(key, "universal")) {
+      caps->universal = json_object_get_boolean(value);
+    } else if (!strcmp(key, "rotation")) {
+      caps->rotation = json_object_get_boolean(value);
+    } else if (!strcmp(key, "alpha")) {
+      caps->alpha = json_object_get_boolean(value);
+    } else if (!strcmp(key, "max_upscale")) {
+      caps->max_upscale = json_object_get_double(value);
+    } else if (!strcmp(key, "max_downscale")) {
+      caps->max_downscale = json_object_get_double(value);
+    } else if (!strcmp(key, "max_width")) {
+      caps->max_width = json_object_get_int(value);
+    } else if (!strcmp(key, "max_height")) {
+      caps->max_height = json_object_get_int(value);
+    }
+  }
+}
+
+static void parseLayer(json_object* object, BENCH_LAYER* layer) {
+  json_object_object_foreach(object, key, value) {
+    if (!strcmp(key, "format")) {
+      layer->format = parseFormat(json_object_get_string(value));
+    } else if (!strcmp(key, "type")) {
+      layer->type = parseLayerType(json_object_get_string(value));
+    } else if (!strcmp(key, "transform")) {
+      layer->transform = json_object_get_int(value);
+    } else if (!strcmp(key, "alpha")) {
+      layer->alpha = json_object_get_int(value);
+    } else if (!strcmp(key, "blending")) {
+      layer->blending = parseBlending(json_object_get_string(value));
+    } else if (!strcmp(key, "source")) {
+      json_object_object_foreach(value, source_key, source_value) {
+        if (!strcmp(source_key, "width")) {
+          layer->source_width = json_object_get_int(source_value);
+        } else if (!strcmp(source_key, "height")) {
+          layer->source_height = json_object_get_int(source_value);
+        } else if (!strcmp(source_key, "crop")) {
+          int x = 0, y = 0, width = 0, height = 0;
+          json_object_object_foreach(source_value, crop_key, crop_value) {
+            if (!strcmp(crop_key, "x"))
+              x = json_object_get_int(crop_value);
+            else if (!strcmp(crop_key, "y"))
+              y = json_object_get_int(crop_value);
+            else if (!strcmp(crop_key, "width"))
+              width = json_object_get_int(crop_value);
+            else if (!strcmp(crop_key, "height"))
+              height = json_object_get_int(crop_value);
+          }
+          layer->source_crop =
+              hwcomposer::HwcRect<float>(x, y, x + width, y + height);
+          layer->has_crop = true;
+        }
+      }
+    } else if (!strcmp(key, "frame")) {
+      int x = 0, y = 0, width = 0, height = 0;
+      json_object_object_foreach(value, frame_key, frame_value) {
+        if (!strcmp(frame_key, "x"))
+          x = json_object_get_int(frame_value);
+        else if (!strcmp(frame_key, "y"))
+          y = json_object_get_int(frame_value);
+        else if (!strcmp(frame_key, "width"))
+          width = json_object_get_int(frame_value);
+        else if (!strcmp(frame_key, "height"))
+          height = json_object_get_int(frame_value);
+      }
+      layer->frame = hwcomposer::HwcRect<int>(x, y, x + width, y + height);
+    }
+  }
+
+  int frame_width = layer->frame.right - layer->frame.left;
+  int frame_height = layer->frame.bottom - layer->frame.top;
+  if (!layer->source_width)
+    layer->source_width = frame_width;
+  if (!layer->source_height)
+    layer->source_height = frame_height;
+  if (!layer->has_crop)
+    layer->source_crop = hwcomposer::HwcRect<float>(
+        0, 0, layer->source_width, layer->source_height);
+}
+
+static bool parseBenchJson(const char* json_path, BENCH_PARAMETERS* params) {
+  json_object* jso = json_object_from_file(json_path);
+  if (jso == NULL) {
+    return false;
+  }
+
+  json_object_object_foreach(jso, key, value) {
+    if (!strcmp(key, "width")) {
+      params->width = json_object_get_int(value);
+    } else if (!strcmp(key, "height")) {
+      params->height = json_object_get_int(value);
+    } else if (!strcmp(key, "iterations")) {
+      params->iterations = json_object_get_int(value);
+    } else if (!strcmp(key, "planes")) {
+      int len = json_object_array_length(value);
+      for (int i = 0; i < len; i++) {
+        FakePlaneCaps caps;
+        parsePlane(json_object_array_get_idx(value, i), &caps);
+        params->planes.push_back(caps);
+      }
+    } else if (!strcmp(key, "test_commit")) {
+      json_object_object_foreach(value, rule_key, rule_value) {
+        if (!strcmp(rule_key, "max_scaled_planes"))
+          params->rules.max_scaled_planes = json_object_get_int(rule_value);
+        else if (!strcmp(rule_key, "max_fetch_pixels"))
+          params->rules.max_fetch_pixels = json_object_get_int64(rule_value);
+        else if (!strcmp(rule_key, "latency_us"))
+          params->rules.latency_us = json_object_get_int(rule_value);
+      }
+    } else if (!strcmp(key, "random_stacks")) {
+      json_object_object_foreach(value, random_key, random_value) {
+        if (!strcmp(random_key, "count"))
+          params->random_stacks = json_object_get_int(random_value);
+        else if (!strcmp(random_key, "min_layers"))
+          params->random_min_layers = json_object_get_int(random_value);
+        else if (!strcmp(random_key, "max_layers"))
+          params->random_max_layers = json_object_get_int(random_value);
+        else if (!strcmp(random_key, "seed"))
+          params->random_seed = json_object_get_int(random_value);
+        else if (!strcmp(random_key, "formats"))
+          parseFormats(random_value, &params->random_formats);
+      }
+    } else if (!strcmp(key, "stacks")) {
+      int len = json_object_array_length(value);
+      for (int i = 0; i < len; i++) {
+        BENCH_STACK stack;
+        json_object_object_foreach(json_object_array_get_idx(value, i),
+                                   stack_key, stack_value) {
+          if (!strcmp(stack_key, "name")) {
+            stack.name = std::string(json_object_get_string(stack_value));
+          } else if (!strcmp(stack_key, "layers")) {
+            int layers = json_object_array_length(stack_value);
+            for (int j = 0; j < layers; j++) {
+              BENCH_LAYER layer;
+              parseLayer(json_object_array_get_idx(stack_value, j), &layer);
+              stack.layers.push_back(layer);
+            }
+          }
+        }
+        params->stacks.push_back(stack);
+      }
+    }
+  }
+
+  json_object_put(jso);
+  return true;
+}
+
+// Synthetic stacks: an opaque full screen layer at the bottom followed by
+// randomly placed and sized layers.
+static void generateRandomStacks(BENCH_PARAMETERS* params) {
+  if (params->random_formats.empty()) {
+    params->random_formats.push_back(DRM_FORMAT_XRGB8888);
+    params->random_formats.push_back(DRM_FORMAT_ARGB8888);
+  }
+
+  std::mt19937 generator(params->random_seed);
+  for (uint32_t i = 0; i < params->random_stacks; i++) {
+    BENCH_STACK stack;
+    stack.name = "random_" + std::to_string(i);
+    std::uniform_int_distribution<uint32_t> total(
+        params->random_min_layers,
+        std::max(params->random_min_layers, params->random_max_layers));
+    uint32_t layers = total(generator);
+    for (uint32_t j = 0; j < layers; j++) {
+      BENCH_LAYER layer;
+      if (j == 0) {
+        layer.frame =
+            hwcomposer::HwcRect<int>(0, 0, params->width, params->height);
+      } else {
+        std::uniform_int_distribution<int> width(64, params->width);
+        std::uniform_int_distribution<int> height(64, params->height);
+        int w = width(generator);
+        int h = height(generator);
+        std::uniform_int_distribution<int> x(0, params->width - w);
+        std::uniform_int_distribution<int> y(0, params->height - h);
+        int left = x(generator);
+        int top = y(generator);
+        layer.frame = hwcomposer::HwcRect<int>(left, top, left + w, top + h);
+        std::uniform_int_distribution<size_t> format(
+            0, params->random_formats.size() - 1);
+        layer.format = params->random_formats.at(format(generator));
+        layer.blending = hwcomposer::HWCBlending::kBlendingPremult;
+        if (layer.format == DRM_FORMAT_NV12)
+          layer.type = hwcomposer::kLayerVideo;
+      }
+
+      // Every fourth layer is scaled by up to 2x in either direction.
+      layer.source_width = layer.frame.right - layer.frame.left;
+      layer.source_height = layer.frame.bottom - layer.frame.top;
+      if (j % 4 == 3) {
+        std::uniform_real_distribution<float> scale(0.5f, 2.0f);
+        float factor = scale(generator);
+        layer.source_width = std::max(1, (int)(layer.source_width * factor));
+        layer.source_height = std::max(1, (int)(layer.source_height * factor));
+      }
+
+      layer.source_crop = hwcomposer::HwcRect<float>(
+          0, 0, layer.source_width, layer.source_height);
+      stack.layers.push_back(layer);
+    }
+
+    params->stacks.push_back(stack);
+  }
+}
+
+static double percentile(std::vector<double>& values, double percent) {
+  if (values.empty())
+    return 0;
+
+  std::sort(values.begin(), values.end());
+  size_t index = static_cast<size_t>(percent / 100.0 * (values.size() - 1));
+  return values.at(index);
+}
+
+// Validates stack iterations times with a fresh plane manager. If cold is
+// true, cached plane assignments are dropped before every validation so that
+// every iteration goes through the full allocator.
+static void runStack(const BENCH_PARAMETERS& params, const BENCH_STACK& stack,
+                     bool cost_model, bool cold, BENCH_RESULT* result) {
+  FakeNativeBufferHandler buffer_handler;
+  FakeDisplayPlaneHandler plane_handler(params.planes, params.rules);
+  hwcomposer::ResourceManager resource_manager(&buffer_handler);
+  std::vector<HWCNativeHandle> handles;
+  std::vector<hwcomposer::HwcLayer> hwc_layers(stack.layers.size());
+  std::vector<hwcomposer::OverlayLayer> layers;
+  layers.reserve(stack.layers.size());
+
+  {
+    hwcomposer::DisplayPlaneManager plane_manager(&plane_handler,
+                                                  &resource_manager);
+    if (!plane_manager.Initialize(params.width, params.height)) {
+      fprintf(stderr, "Failed to initialize plane manager.\n");
+      return;
+    }
+
+    plane_manager.EnableCostModelAllocator(cost_model);
+
+    for (size_t i = 0; i < stack.layers.size(); i++) {
+      const BENCH_LAYER& layer = stack.layers.at(i);
+      HWCNativeHandle handle = 0;
+      buffer_handler.CreateBuffer(layer.source_width, layer.source_height,
+                                  layer.format, &handle, layer.type);
+      handles.push_back(handle);
+
+      hwcomposer::HwcLayer& hwc_layer = hwc_layers.at(i);
+      hwc_layer.SetNativeHandle(handle);
+      hwc_layer.SetSourceCrop(layer.source_crop);
+      hwc_layer.SetDisplayFrame(layer.frame, 0, 0);
+      hwc_layer.SetTransform(layer.transform);
+      hwc_layer.SetAlpha(layer.alpha);
+      hwc_layer.SetBlending(layer.blending);
+
+      layers.emplace_back();
+      layers.back().InitializeFromHwcLayer(&hwc_layer, NULL, NULL, i, i,
+                                           params.height, params.width,
+                                           hwcomposer::kIdentity, false);
+    }
+
+    std::vector<hwcomposer::NativeSurface*> mark_later;
+    for (uint32_t i = 0; i < params.iterations; i++) {
+      hwcomposer::DisplayPlaneStateList composition;
+      hwcomposer::DisplayPlaneStateList previous_composition;
+      if (cold)
+        plane_manager.InvalidateAssignmentCache();
+
+      plane_handler.ResetStats();
+      auto start = std::chrono::steady_clock::now();
+      plane_manager.ValidateLayers(layers, 0, false, composition,
+                                   previous_composition, mark_later);
+      auto end = std::chrono::steady_clock::now();
+      result->latencies_us.push_back(
+          std::chrono::duration<double, std::micro>(end - start).count());
+      result->test_commits += plane_handler.GetTestCommits();
+      result->failed_test_commits += plane_handler.GetFailedTestCommits();
+
+      if (i == 0) {
+        result->planes = composition.size();
+        for (hwcomposer::DisplayPlaneState& plane : composition) {
+          if (plane.Scanout() && !plane.NeedsOffScreenComposition())
+            result->scanout_layers += plane.GetSourceLayers().size();
+          else
+            result->gpu_layers += plane.GetSourceLayers().size();
+        }
+      }
+
+      // Return offscreen surfaces to the pool, as if the frame had been
+      // presented and replaced by the next one.
+      for (hwcomposer::DisplayPlaneState& plane : composition) {
+        plane_manager.MarkSurfacesForRecycling(&plane, mark_later, false);
+      }
+      mark_later.clear();
+    }
+  }
+
+  layers.clear();
+  resource_manager.PurgeBuffer();
+  std::vector<hwcomposer::ResourceHandle> purged;
+  std::vector<hwcomposer::MediaResourceHandle> purged_media;
+  bool has_gpu_resource = false;
+  resource_manager.GetPurgedResources(purged, purged_media, &has_gpu_resource);
+  for (hwcomposer::ResourceHandle& resource : purged)
+    buffer_handler.DestroyHandle(resource.handle_);
+  for (HWCNativeHandle handle : handles)
+    buffer_handler.DestroyHandle(handle);
+}
+
+static void printResult(const char* stack, const char* allocator,
+                        const char* mode, uint32_t iterations,
+                        BENCH_RESULT& result) {
+  double p50 = percentile(result.latencies_us, 50);
+  double p90 = percentile(result.latencies_us, 90);
+  double p99 = percentile(result.latencies_us, 99);
+  printf("%-16s %-7s %-5s %9.2f %9.2f %9.2f %8.2f %8.2f %6u %7u %5u\n", stack,
+         allocator, mode, p50, p90, p99,
+         iterations ? (double)result.test_commits / iterations : 0,
+         iterations ? (double)result.failed_test_commits / iterations : 0,
+         result.planes, result.scanout_layers, result.gpu_layers);
+}
+
+int main(int argc, char* argv[]) {
+  if (argc < 2) {
+    fprintf(stderr, "Usage: %s <config.json>\n", argv[0]);
+    return 1;
+  }
+
+  BENCH_PARAMETERS params;
+  if (!parseBenchJson(argv[1], &params)) {
+    fprintf(stderr, "Failed to parse %s\n", argv[1]);
+    return 1;
+  }
+
+  if (params.planes.empty()) {
+    fprintf(stderr, "No planes described in %s\n", argv[1]);
+    return 1;
+  }
+
+  generateRandomStacks(&params);
+
+  printf("%-16s %-7s %-5s %9s %9s %9s %8s %8s %6s %7s %5s\n", "stack",
+         "alloc", "cache", "p50(us)", "p90(us)", "p99(us)", "tests",
+         "failed", "planes", "scanout", "gpu");
+  const char* allocators[] = {"greedy", "cost"};
+  const char* modes[] = {"cold", "warm"};
+  for (const BENCH_STACK& stack : params.stacks) {
+    for (int allocator = 0; allocator < 2; allocator++) {
+      for (int mode = 0; mode < 2; mode++) {
+        BENCH_RESULT result;
+        runStack(params, stack, allocator == 1, mode == 0, &result);
+        printResult(stack.name.c_str(), allocators[allocator], modes[mode],
+                    params.iterations, result);
+      }
+    }
+  }
+
+  return 0;
+}
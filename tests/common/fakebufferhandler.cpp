@@ -0,0 +1,121 @@
+/*
+// Copyright (c) 2016 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+*/
+
+#include "fakebufferhandler.h"
+
+#include <drm_fourcc.h>
+
+#include "factory.h"
+#include "nativesurface.h"
+
+FakeOverlayBuffer::FakeOverlayBuffer() {
+  static uint32_t fb_id = 0;
+  fb_id_ = ++fb_id;
+}
+
+void FakeOverlayBuffer::InitializeFromNativeHandle(
+    HWCNativeHandle handle, hwcomposer::ResourceManager *buffer_manager) {
+  handle_ = handle;
+  image_.handle_ = handle;
+  media_image_.handle_ = handle;
+}
+
+bool FakeNativeBufferHandler::CreateBuffer(uint32_t w, uint32_t h, int format,
+                                           HWCNativeHandle *handle,
+                                           uint32_t layer_type,
+                                           bool *modifier_used,
+                                           int64_t modifier,
+                                           bool raw_pixel_buffer) const {
+  struct gbm_handle *temp = new struct gbm_handle();
+  temp->meta_data_.width_ = w;
+  temp->meta_data_.height_ = h;
+  temp->meta_data_.format_ = format ? format : DRM_FORMAT_XRGB8888;
+  temp->meta_data_.native_format_ = temp->meta_data_.format_;
+  temp->meta_data_.num_planes_ = 1;
+  temp->meta_data_.pitches_[0] = w * 4;
+  temp->meta_data_.offsets_[0] = 0;
+  temp->meta_data_.usage_ = static_cast<hwcomposer::HWCLayerType>(layer_type);
+  temp->layer_type_ = layer_type;
+  temp->hwc_buffer_ = true;
+  if (modifier_used)
+    *modifier_used = false;
+
+  *handle = temp;
+  return true;
+}
+
+bool FakeNativeBufferHandler::ReleaseBuffer(HWCNativeHandle handle) const {
+  return true;
+}
+
+void FakeNativeBufferHandler::DestroyHandle(HWCNativeHandle handle) const {
+  delete handle;
+}
+
+bool FakeNativeBufferHandler::ImportBuffer(HWCNativeHandle handle) const {
+  return true;
+}
+
+void FakeNativeBufferHandler::CopyHandle(HWCNativeHandle source,
+                                         HWCNativeHandle *target) const {
+  struct gbm_handle *temp = new struct gbm_handle();
+  temp->meta_data_.width_ = source->meta_data_.width_;
+  temp->meta_data_.height_ = source->meta_data_.height_;
+  temp->meta_data_.format_ = source->meta_data_.format_;
+  temp->meta_data_.native_format_ = source->meta_data_.native_format_;
+  temp->meta_data_.tiling_mode_ = source->meta_data_.tiling_mode_;
+  temp->meta_data_.num_planes_ = source->meta_data_.num_planes_;
+  temp->meta_data_.pitches_[0] = source->meta_data_.pitches_[0];
+  temp->meta_data_.offsets_[0] = source->meta_data_.offsets_[0];
+  temp->meta_data_.usage_ = source->meta_data_.usage_;
+  temp->layer_type_ = source->layer_type_;
+  temp->hwc_buffer_ = source->hwc_buffer_;
+  *target = temp;
+}
+
+uint32_t FakeNativeBufferHandler::GetTotalPlanes(HWCNativeHandle handle) const {
+  return handle->meta_data_.num_planes_;
+}
+
+void *FakeNativeBufferHandler::Map(HWCNativeHandle handle, uint32_t x,
+                                   uint32_t y, uint32_t width, uint32_t height,
+                                   uint32_t *stride, void **map_data,
+                                   size_t plane) const {
+  return NULL;
+}
+
+int32_t FakeNativeBufferHandler::UnMap(HWCNativeHandle handle,
+                                       void *map_data) const {
+  return -1;
+}
+
+// The validation benchmark is linked against the plane management sources
+// only, the following replace the DRM buffer and compositor factories.
+namespace hwcomposer {
+
+std::shared_ptr<OverlayBuffer> OverlayBuffer::CreateOverlayBuffer() {
+  return std::make_shared<FakeOverlayBuffer>();
+}
+
+NativeSurface *Create3DSurface(uint32_t width, uint32_t height) {
+  return new NativeSurface(width, height);
+}
+
+NativeSurface *CreateVideoSurface(uint32_t width, uint32_t height) {
+  return new NativeSurface(width, height);
+}
+
+}  // namespace hwcomposer
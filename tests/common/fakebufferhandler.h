@@ -0,0 +1,167 @@
+/*
+// Copyright (c) 2016 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+*/
+
+#ifndef TESTS_COMMON_FAKEBUFFERHANDLER_H_
+#define TESTS_COMMON_FAKEBUFFERHANDLER_H_
+
+#include <nativebufferhandler.h>
+#include <platformdefines.h>
+
+#include "overlaybuffer.h"
+
+// NativeBufferHandler which only allocates buffer metadata. No memory is
+// backing the buffers, so it can be used to drive plane validation without
+// a GPU or display.
+class FakeNativeBufferHandler : public hwcomposer::NativeBufferHandler {
+ public:
+  FakeNativeBufferHandler() = default;
+  ~FakeNativeBufferHandler() override = default;
+
+  bool CreateBuffer(uint32_t w, uint32_t h, int format,
+                    HWCNativeHandle *handle = NULL,
+                    uint32_t layer_type = hwcomposer::kLayerNormal,
+                    bool *modifier_used = NULL, int64_t modifier = -1,
+                    bool raw_pixel_buffer = false) const override;
+
+  bool ReleaseBuffer(HWCNativeHandle handle) const override;
+
+  void DestroyHandle(HWCNativeHandle handle) const override;
+
+  bool ImportBuffer(HWCNativeHandle handle) const override;
+
+  void CopyHandle(HWCNativeHandle source,
+                  HWCNativeHandle *target) const override;
+
+  uint32_t GetTotalPlanes(HWCNativeHandle handle) const override;
+
+  void *Map(HWCNativeHandle handle, uint32_t x, uint32_t y, uint32_t width,
+            uint32_t height, uint32_t *stride, void **map_data,
+            size_t plane) const override;
+
+  int32_t UnMap(HWCNativeHandle handle, void *map_data) const override;
+
+  uint32_t GetFd() const override {
+    return 0;
+  }
+
+  bool GetInterlace(HWCNativeHandle handle) const override {
+    return false;
+  }
+};
+
+// OverlayBuffer reporting the metadata of a handle created by
+// FakeNativeBufferHandler. Every buffer gets an unique, non zero
+// framebuffer id so that it is considered for direct scanout.
+class FakeOverlayBuffer : public hwcomposer::OverlayBuffer {
+ public:
+  FakeOverlayBuffer();
+  ~FakeOverlayBuffer() override = default;
+
+  void InitializeFromNativeHandle(
+      HWCNativeHandle handle,
+      hwcomposer::ResourceManager *buffer_manager) override;
+
+  uint32_t GetDataSpace() const override {
+    return handle_->meta_data_.dataspace_;
+  }
+
+  uint32_t GetWidth() const override {
+    return handle_->meta_data_.width_;
+  }
+
+  uint32_t GetHeight() const override {
+    return handle_->meta_data_.height_;
+  }
+
+  uint32_t GetFormat() const override {
+    return handle_->meta_data_.format_;
+  }
+
+  hwcomposer::HWCLayerType GetUsage() const override {
+    return handle_->meta_data_.usage_;
+  }
+
+  uint32_t GetFb(bool *isNewCreated = NULL) override {
+    if (isNewCreated)
+      *isNewCreated = false;
+    return fb_id_;
+  }
+
+  uint32_t GetPrimeFD() const override {
+    return 0;
+  }
+
+  const uint32_t *GetPitches() const override {
+    return handle_->meta_data_.pitches_;
+  }
+
+  const uint32_t *GetOffsets() const override {
+    return handle_->meta_data_.offsets_;
+  }
+
+  uint32_t GetTilingMode() const override {
+    return handle_->meta_data_.tiling_mode_;
+  }
+
+  void SetDataSpace(uint32_t dataspace) override {
+    handle_->meta_data_.dataspace_ = dataspace;
+  }
+
+  bool GetInterlace() override {
+    return false;
+  }
+
+  void SetInterlace(bool isInterlaced) override {
+  }
+
+  const hwcomposer::ResourceHandle &GetGpuResource(
+      hwcomposer::GpuDisplay egl_display, bool external_import) override {
+    return image_;
+  }
+
+  const hwcomposer::ResourceHandle &GetGpuResource() override {
+    return image_;
+  }
+
+  const hwcomposer::MediaResourceHandle &GetMediaResource(
+      hwcomposer::MediaDisplay display, uint32_t width,
+      uint32_t height) override {
+    return media_image_;
+  }
+
+  bool CreateFrameBufferWithModifier(uint64_t modifier) override {
+    return false;
+  }
+
+  HWCNativeHandle GetOriginalHandle() const override {
+    return handle_;
+  }
+
+  void SetOriginalHandle(HWCNativeHandle handle) override {
+    handle_ = handle;
+  }
+
+  void Dump() override {
+  }
+
+ private:
+  HWCNativeHandle handle_ = 0;
+  uint32_t fb_id_ = 0;
+  hwcomposer::ResourceHandle image_;
+  hwcomposer::MediaResourceHandle media_image_;
+};
+
+#endif  // TESTS_COMMON_FAKEBUFFERHANDLER_H_
@@ -0,0 +1,192 @@
+/*
+// Copyright (c) 2016 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+*/
+
+#include "fakedisplayplanehandler.h"
+
+#include <drm_fourcc.h>
+#include <math.h>
+
+#include <algorithm>
+#include <chrono>
+
+#include "displayplanestate.h"
+#include "hwctrace.h"
+#include "overlaylayer.h"
+
+FakeDisplayPlane::FakeDisplayPlane(uint32_t plane_id,
+                                   const FakePlaneCaps &caps)
+    : id_(plane_id), caps_(caps) {
+  preferred_format_ = caps_.formats.empty() ? 0 : caps_.formats.front();
+  for (uint32_t format : caps_.formats) {
+    if (format == DRM_FORMAT_XRGB8888) {
+      preferred_format_ = format;
+      break;
+    }
+  }
+
+  preferred_video_format_ = preferred_format_;
+  for (uint32_t format : caps_.formats) {
+    if (format == DRM_FORMAT_NV12) {
+      preferred_video_format_ = format;
+      break;
+    }
+  }
+}
+
+bool FakeDisplayPlane::ValidateLayer(const hwcomposer::OverlayLayer *layer) {
+  uint32_t alpha = 0xFF;
+  if (layer->GetBlending() == hwcomposer::HWCBlending::kBlendingPremult)
+    alpha = layer->GetAlpha();
+
+  if (alpha != 0 && alpha != 0xFF && !caps_.alpha)
+    return false;
+
+  hwcomposer::OverlayBuffer *layer_buffer = layer->GetBuffer();
+  if (!layer_buffer)
+    return false;
+
+  if (!IsSupportedFormat(layer_buffer->GetFormat()))
+    return false;
+
+  return IsSupportedTransform(layer->GetMergedTransform());
+}
+
+bool FakeDisplayPlane::IsSupportedFormat(uint32_t format) {
+  for (uint32_t element : caps_.formats) {
+    if (element == format)
+      return true;
+  }
+
+  return false;
+}
+
+bool FakeDisplayPlane::IsSupportedTransform(uint32_t transform) const {
+  if (transform == hwcomposer::kIdentity)
+    return true;
+
+  return caps_.rotation;
+}
+
+bool FakeDisplayPlane::CanScale(uint32_t src_width, uint32_t src_height,
+                                uint32_t dst_width,
+                                uint32_t dst_height) const {
+  if (!src_width || !src_height || !dst_width || !dst_height)
+    return false;
+
+  if ((caps_.max_width && src_width > caps_.max_width) ||
+      (caps_.max_height && src_height > caps_.max_height))
+    return false;
+
+  float scale_x = static_cast<float>(dst_width) / src_width;
+  float scale_y = static_cast<float>(dst_height) / src_height;
+  if (scale_x > caps_.max_upscale || scale_y > caps_.max_upscale)
+    return false;
+
+  if (1.0f / scale_x > caps_.max_downscale ||
+      1.0f / scale_y > caps_.max_downscale)
+    return false;
+
+  return true;
+}
+
+void FakeDisplayPlane::Dump() const {
+  DUMPTRACE("Fake Plane ID: %d Universal: %d Enabled: %d", id_,
+            caps_.universal, in_use_);
+  for (size_t j = 0; j < caps_.formats.size(); j++)
+    DUMPTRACE("Format: %4.4s", (char *)&caps_.formats[j]);
+}
+
+FakeDisplayPlaneHandler::FakeDisplayPlaneHandler(
+    const std::vector<FakePlaneCaps> &planes, const FakeTestCommitRules &rules)
+    : planes_(planes), rules_(rules) {
+}
+
+bool FakeDisplayPlaneHandler::PopulatePlanes(
+    std::vector<std::unique_ptr<hwcomposer::DisplayPlane>> &overlay_planes) {
+  if (planes_.empty())
+    return false;
+
+  for (size_t i = 0; i < planes_.size(); i++) {
+    overlay_planes.emplace_back(new FakeDisplayPlane(i + 1, planes_.at(i)));
+  }
+
+  return true;
+}
+
+bool FakeDisplayPlaneHandler::TestCommit(
+    const hwcomposer::DisplayPlaneStateList &composition) const {
+  test_commits_++;
+  if (rules_.latency_us) {
+    auto end = std::chrono::steady_clock::now() +
+               std::chrono::microseconds(rules_.latency_us);
+    while (std::chrono::steady_clock::now() < end) {
+    }
+  }
+
+  if (!CheckComposition(composition)) {
+    failed_test_commits_++;
+    return false;
+  }
+
+  return true;
+}
+
+bool FakeDisplayPlaneHandler::CheckComposition(
+    const hwcomposer::DisplayPlaneStateList &composition) const {
+  uint32_t scaled_planes = 0;
+  uint64_t fetch_pixels = 0;
+  for (const hwcomposer::DisplayPlaneState &plane : composition) {
+    FakeDisplayPlane *display_plane =
+        static_cast<FakeDisplayPlane *>(plane.GetDisplayPlane());
+    const hwcomposer::OverlayLayer *layer = plane.GetOverlayLayer();
+    if (!display_plane || !layer || !layer->GetBuffer())
+      return false;
+
+    if (!display_plane->IsSupportedFormat(layer->GetBuffer()->GetFormat()))
+      return false;
+
+    // Same source and destination DrmPlane::UpdateProperties would program.
+    const hwcomposer::HwcRect<int> &display_frame = plane.GetDisplayFrame();
+    uint32_t src_width = layer->GetSourceCropWidth();
+    uint32_t src_height = layer->GetSourceCropHeight();
+    uint32_t dst_width = display_frame.right - display_frame.left;
+    uint32_t dst_height = display_frame.bottom - display_frame.top;
+    if (layer->IsCursorLayer()) {
+      src_width = dst_width = layer->GetDisplayFrameWidth();
+      src_height = dst_height = layer->GetDisplayFrameHeight();
+    }
+
+    uint32_t transform = layer->GetMergedTransform();
+    if (transform & (hwcomposer::kTransform90 | hwcomposer::kTransform270))
+      std::swap(dst_width, dst_height);
+
+    if (src_width != dst_width || src_height != dst_height)
+      scaled_planes++;
+
+    if (!display_plane->CanScale(src_width, src_height, dst_width, dst_height))
+      return false;
+
+    fetch_pixels += static_cast<uint64_t>(src_width) * src_height;
+  }
+
+  if (rules_.max_scaled_planes && scaled_planes > rules_.max_scaled_planes)
+    return false;
+
+  if (rules_.max_fetch_pixels && fetch_pixels > rules_.max_fetch_pixels)
+    return false;
+
+  return true;
+}
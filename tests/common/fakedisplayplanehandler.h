@@ -0,0 +1,164 @@
+/*
+// Copyright (c) 2016 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+*/
+
+#ifndef TESTS_COMMON_FAKEDISPLAYPLANEHANDLER_H_
+#define TESTS_COMMON_FAKEDISPLAYPLANEHANDLER_H_
+
+#include <stdint.h>
+
+#include <memory>
+#include <vector>
+
+#include "displayplane.h"
+#include "displayplanehandler.h"
+
+// Capabilities of one fake plane.
+struct FakePlaneCaps {
+  std::vector<uint32_t> formats;
+  // False for a plane which can only be used for cursor.
+  bool universal = true;
+  // Plane supports 90/180/270 rotation.
+  bool rotation = false;
+  // Plane supports per plane alpha.
+  bool alpha = false;
+  // Maximum ratio of display frame to source crop size, 1 if the
+  // plane cannot upscale.
+  float max_upscale = 1.0f;
+  // Maximum ratio of source crop to display frame size, 1 if the
+  // plane cannot downscale.
+  float max_downscale = 1.0f;
+  // Maximum source size, 0 if unlimited.
+  uint32_t max_width = 0;
+  uint32_t max_height = 0;
+};
+
+// Limits checked by FakeDisplayPlaneHandler::TestCommit over the whole
+// composition, modeling shared resources of the pipe.
+struct FakeTestCommitRules {
+  // Number of planes which can be scaled at the same time, 0 if unlimited.
+  uint32_t max_scaled_planes = 0;
+  // Maximum sum of source pixels fetched by all planes, 0 if unlimited.
+  uint64_t max_fetch_pixels = 0;
+  // Time spent in every TestCommit, to model the atomic ioctl.
+  uint32_t latency_us = 0;
+};
+
+class FakeDisplayPlane : public hwcomposer::DisplayPlane {
+ public:
+  FakeDisplayPlane(uint32_t plane_id, const FakePlaneCaps &caps);
+  ~FakeDisplayPlane() override = default;
+
+  uint32_t id() const override {
+    return id_;
+  }
+
+  bool ValidateLayer(const hwcomposer::OverlayLayer *layer) override;
+
+  bool IsSupportedFormat(uint32_t format) override;
+
+  bool IsSupportedTransform(uint32_t transform) const override;
+
+  uint32_t GetPreferredVideoFormat() const override {
+    return preferred_video_format_;
+  }
+
+  uint32_t GetPreferredFormat() const override {
+    return preferred_format_;
+  }
+
+  uint64_t GetPreferredFormatModifier() const override {
+    return 0;
+  }
+
+  void BlackListPreferredFormatModifier() override {
+  }
+
+  void PreferredFormatModifierValidated() override {
+  }
+
+  void LayerTestCommitted(const hwcomposer::OverlayLayer *layer,
+                          bool passed) override {
+  }
+
+  void BeginFrameValidation() override {
+  }
+
+  void SetInUse(bool in_use) override {
+    in_use_ = in_use;
+  }
+
+  bool InUse() const override {
+    return in_use_;
+  }
+
+  bool IsUniversal() override {
+    return caps_.universal;
+  }
+
+  // Returns true if source of src_width x src_height can be shown
+  // in a display frame of dst_width x dst_height by this plane.
+  bool CanScale(uint32_t src_width, uint32_t src_height, uint32_t dst_width,
+                uint32_t dst_height) const;
+
+  void Dump() const override;
+
+ private:
+  uint32_t id_;
+  FakePlaneCaps caps_;
+  uint32_t preferred_format_;
+  uint32_t preferred_video_format_;
+  bool in_use_ = false;
+};
+
+// DisplayPlaneHandler standing in for a DRM pipe. TestCommit accepts a
+// composition only if every plane supports the format and scaling of its
+// layer and the composition fits into FakeTestCommitRules.
+class FakeDisplayPlaneHandler : public hwcomposer::DisplayPlaneHandler {
+ public:
+  FakeDisplayPlaneHandler(const std::vector<FakePlaneCaps> &planes,
+                          const FakeTestCommitRules &rules);
+  ~FakeDisplayPlaneHandler() override = default;
+
+  bool PopulatePlanes(std::vector<std::unique_ptr<hwcomposer::DisplayPlane>>
+                          &overlay_planes) override;
+
+  bool TestCommit(
+      const hwcomposer::DisplayPlaneStateList &composition) const override;
+
+  uint32_t GetTestCommits() const {
+    return test_commits_;
+  }
+
+  uint32_t GetFailedTestCommits() const {
+    return failed_test_commits_;
+  }
+
+  void ResetStats() {
+    test_commits_ = 0;
+    failed_test_commits_ = 0;
+  }
+
+ private:
+  bool CheckComposition(
+      const hwcomposer::DisplayPlaneStateList &composition) const;
+
+  std::vector<FakePlaneCaps> planes_;
+  FakeTestCommitRules rules_;
+  mutable uint32_t test_commits_ = 0;
+  mutable uint32_t failed_test_commits_ = 0;
+};
+
+#endif  // TESTS_COMMON_FAKEDISPLAYPLANEHANDLER_H_
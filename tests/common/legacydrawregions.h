@@ -0,0 +1,33 @@
+/*
+// Copyright (c) 2016 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+*/
+
+#ifndef TESTS_COMMON_LEGACYDRAWREGIONS_H_
+#define TESTS_COMMON_LEGACYDRAWREGIONS_H_
+
+#include <vector>
+
+#include "disjoint_layers.h"
+
+namespace hwcomposer {
+
+// Previous implementation of get_draw_regions, based on std::set, kept
+// as reference for drawregionsbench. Handles at most 64 rects.
+void legacy_get_draw_regions(const std::vector<Rect<int>> &in,
+                             const HwcRect<int> &damage_region,
+                             std::vector<RectSet<int>> *out);
+
+}  // namespace hwcomposer
+#endif  // TESTS_COMMON_LEGACYDRAWREGIONS_H_
@@ -55,6 +55,8 @@ endif
 LOCAL_SRC_FILES := \
         physicaldisplay.cpp \
         drm/drmdisplay.cpp \
+        drm/drmcommitgroup.cpp \
+        drm/drmcommitthread.cpp \
         drm/drmbuffer.cpp \
         drm/drmplane.cpp \
         drm/drmdisplaymanager.cpp \
@@ -90,6 +90,27 @@ class DisplayManager {
                                     uint32_t SRMLength) = 0;
   virtual void RemoveUnreservedPlanes() = 0;
 
+  // Selects the plane allocation strategy used by all displays.
+  virtual void EnableCostModelPlaneAllocator(bool enable) = 0;
+
+  // Sets memory budget, in MB, of offscreen surfaces kept around for
+  // re-use by each display.
+  virtual void SetSurfacePoolBudget(uint32_t budget_mb) = 0;
+
+  // Sets number of GL contexts each display renders offscreen planes
+  // with in parallel.
+  virtual void SetCompositorContexts(uint32_t count) = 0;
+
+  // Commits frames of all displays from a separate thread per display.
+  virtual void EnablePipelinedCommit(bool enable) = 0;
+
+  // Uses variable refresh on all displays connected to capable panels.
+  virtual void EnableAdaptiveSync(bool enable) = 0;
+
+  // Commits frames of cloned and mosaic displays with a single atomic
+  // commit.
+  virtual void EnableGroupCommit(bool enable) = 0;
+
   virtual FrameBufferManager *GetFrameBufferManager() = 0;
 };
 
@@ -75,6 +75,20 @@ class DisplayPlane {
    */
   virtual void PreferredFormatModifierValidated() = 0;
 
+  /**
+   * API for informing Display Plane about the result of a
+   * test commit which tried to scan out layer directly with
+   * this plane. Planes can use this to reject similar layers
+   * in ValidateLayer, without another test commit.
+   */
+  virtual void LayerTestCommitted(const OverlayLayer* layer, bool passed) = 0;
+
+  /**
+   * API for informing Display Plane that layers of a new
+   * frame are about to be validated.
+   */
+  virtual void BeginFrameValidation() = 0;
+
   virtual void SetInUse(bool in_use) = 0;
 
   virtual bool InUse() const = 0;
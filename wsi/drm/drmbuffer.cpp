@@ -57,7 +57,8 @@ DrmBuffer::~DrmBuffer() {
 #if USE_GL
   texture_initialized = image_.texture_ > 0;
 #elif USE_VK
-  texture_initialized = image_.texture_ != VK_NULL_HANDLE;
+  // The compositor destroys imported images in ReleaseGPUResources.
+  texture_initialized = image_.image_ != VK_NULL_HANDLE;
 #endif
 
 #ifndef DISABLE_VA
@@ -0,0 +1,151 @@
+/*
+// Copyright (c) 2016 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+*/
+
+#include "drmcommitgroup.h"
+
+#include <unistd.h>
+#include <xf86drmMode.h>
+
+#include <algorithm>
+
+#include "hwctrace.h"
+#include "overlaybuffer.h"
+
+namespace hwcomposer {
+
+DrmCommitGroup::DrmCommitGroup() {
+}
+
+DrmCommitGroup::~DrmCommitGroup() {
+  for (int32_t fence : in_fences_) {
+    if (fence > 0)
+      close(fence);
+  }
+}
+
+bool DrmCommitGroup::Initialize(uint32_t gpu_fd, uint32_t out_fence_ptr_prop) {
+  gpu_fd_ = gpu_fd;
+  return commit_thread_.Initialize(gpu_fd, out_fence_ptr_prop, NULL);
+}
+
+bool DrmCommitGroup::Begin() {
+  lock_.lock();
+  if (open_) {
+    lock_.unlock();
+    return false;
+  }
+
+  open_ = true;
+  lock_.unlock();
+
+  if (!pset_)
+    pset_.reset(drmModeAtomicAlloc());
+
+  if (!pset_) {
+    ETRACE("Failed to allocate property set %d", -ENOMEM);
+    End();
+    return false;
+  }
+
+  return true;
+}
+
+bool DrmCommitGroup::AddFrame(
+    uint32_t crtc_id, drmModeAtomicReqPtr pset,
+    std::vector<int32_t>& in_fences,
+    std::vector<std::shared_ptr<OverlayBuffer>>& buffers,
+    int32_t* commit_fence) {
+  if (!pset_)
+    return false;
+
+  int32_t fence = commit_thread_.CreateRetireFence();
+  if (fence < 0)
+    return false;
+
+  int cursor = drmModeAtomicGetCursor(pset_.get());
+  if (drmModeAtomicMerge(pset_.get(), pset) < 0) {
+    IDISPLAYMANAGERTRACE("Failed to add frame of crtc %d to group.", crtc_id);
+    drmModeAtomicSetCursor(pset_.get(), cursor);
+    close(fence);
+    return false;
+  }
+
+  crtcs_.emplace_back(crtc_id);
+  lock_.lock();
+  if (std::find(members_.begin(), members_.end(), crtc_id) == members_.end())
+    members_.emplace_back(crtc_id);
+  lock_.unlock();
+  in_fences_.insert(in_fences_.end(), in_fences.begin(), in_fences.end());
+  buffers_.insert(buffers_.end(), buffers.begin(), buffers.end());
+  in_fences.clear();
+  buffers.clear();
+  *commit_fence = fence;
+  return true;
+}
+
+bool DrmCommitGroup::End() {
+  bool success = true;
+  if (!crtcs_.empty()) {
+    // Retire fences have been handed out already, so a group failing the
+    // test is still queued to fail in order and signal them. Its pipes
+    // are told to recover with their next frame.
+    if (drmModeAtomicCommit(gpu_fd_, pset_.get(), DRM_MODE_ATOMIC_TEST_ONLY,
+                            NULL)) {
+      ETRACE("Test commit of group failed.");
+      pset_.reset();
+      success = false;
+    }
+
+    if (!commit_thread_.QueueCommit(pset_, DRM_MODE_ATOMIC_NONBLOCK, 0, crtcs_,
+                                    in_fences_, buffers_, NULL))
+      success = false;
+
+    crtcs_.clear();
+    // Fences of a failed commit are closed by the commit thread.
+    in_fences_.clear();
+    buffers_.clear();
+  }
+
+  lock_.lock();
+  if (!success)
+    failed_crtcs_ = members_;
+
+  open_ = false;
+  lock_.unlock();
+  return success;
+}
+
+bool DrmCommitGroup::HasCommitFailed(uint32_t crtc_id) {
+  lock_.lock();
+  if (commit_thread_.HasCommitFailed())
+    failed_crtcs_ = members_;
+
+  bool failed = false;
+  auto crtc = std::find(failed_crtcs_.begin(), failed_crtcs_.end(), crtc_id);
+  if (crtc != failed_crtcs_.end()) {
+    failed_crtcs_.erase(crtc);
+    failed = true;
+  }
+
+  lock_.unlock();
+  return failed;
+}
+
+void DrmCommitGroup::Flush() {
+  commit_thread_.Flush();
+}
+
+}  // namespace hwcomposer
@@ -0,0 +1,89 @@
+/*
+// Copyright (c) 2016 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+*/
+
+#ifndef WSI_DRM_DRMCOMMITGROUP_H_
+#define WSI_DRM_DRMCOMMITGROUP_H_
+
+#include <stdint.h>
+#include <xf86drmMode.h>
+
+#include <drmscopedtypes.h>
+#include <spinlock.h>
+
+#include <memory>
+#include <vector>
+
+#include "drmcommitthread.h"
+
+namespace hwcomposer {
+
+class OverlayBuffer;
+
+// Merges frames of several pipes into a single atomic commit, so that
+// cloned and mosaic displays don't tear relative to each other and are
+// updated with one ioctl. Merged frames are committed from a
+// DrmCommitThread, all pipes of a group share one retire fence.
+class DrmCommitGroup {
+ public:
+  DrmCommitGroup();
+  ~DrmCommitGroup();
+
+  // Returns false if frames of a group cannot be committed together.
+  bool Initialize(uint32_t gpu_fd, uint32_t out_fence_ptr_prop);
+
+  // Starts collecting frames. Returns false if a group is already open.
+  bool Begin();
+
+  // Adds pset updating pipe crtc_id to the group. On success in_fences
+  // and buffers are taken over and commit_fence signals once the group is
+  // on screen, or has failed to commit.
+  bool AddFrame(uint32_t crtc_id, drmModeAtomicReqPtr pset,
+                std::vector<int32_t>& in_fences,
+                std::vector<std::shared_ptr<OverlayBuffer>>& buffers,
+                int32_t* commit_fence);
+
+  // Tests frames added since Begin with a single test commit and queues
+  // them as one commit. Returns false, and marks all pipes of the group
+  // as failed, if they cannot be committed together.
+  bool End();
+
+  // Returns true if a group pipe crtc_id was part of failed to commit
+  // since last call for crtc_id. All pipes of a group are told about a
+  // failure, as their retire fences signaled without the frame reaching
+  // the screen.
+  bool HasCommitFailed(uint32_t crtc_id);
+
+  // Waits till all committed groups are on screen.
+  void Flush();
+
+ private:
+  DrmCommitThread commit_thread_;
+  SpinLock lock_;
+  bool open_ = false;
+  uint32_t gpu_fd_ = 0;
+  // Frames added since Begin.
+  ScopedDrmAtomicReqPtr pset_;
+  std::vector<uint32_t> crtcs_;
+  std::vector<int32_t> in_fences_;
+  std::vector<std::shared_ptr<OverlayBuffer>> buffers_;
+  // Pipes which have been part of a group.
+  std::vector<uint32_t> members_;
+  // Pipes not yet told about a failed group commit.
+  std::vector<uint32_t> failed_crtcs_;
+};
+
+}  // namespace hwcomposer
+#endif  // WSI_DRM_DRMCOMMITGROUP_H_
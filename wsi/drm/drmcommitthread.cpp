@@ -0,0 +1,380 @@
+/*
+// Copyright (c) 2016 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+*/
+
+#include "drmcommitthread.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#include <unistd.h>
+#include <xf86drmMode.h>
+
+#include <algorithm>
+
+#include "framelatencytracker.h"
+#include "hwctrace.h"
+#include "hwcutils.h"
+#include "overlaybuffer.h"
+
+#ifndef SW_SYNC_IOC_MAGIC
+struct sw_sync_create_fence_data {
+  uint32_t value;
+  char name[32];
+  int32_t fence;
+};
+
+#define SW_SYNC_IOC_MAGIC 'W'
+#define SW_SYNC_IOC_CREATE_FENCE \
+  _IOWR(SW_SYNC_IOC_MAGIC, 0, struct sw_sync_create_fence_data)
+#define SW_SYNC_IOC_INC _IOW(SW_SYNC_IOC_MAGIC, 1, uint32_t)
+#endif
+
+namespace hwcomposer {
+
+// Frames presented but not yet on screen when QueueCommit returns.
+// Offscreen surfaces are triple buffered, allowing more would let the
+// compositor render to a surface which is still scanned out.
+static const uint32_t kMaxPendingCommits = 1;
+
+static const int64_t kOneMillisecondNs = 1000000;
+
+DrmCommitThread::DrmCommitThread() : HWCThread(-8, "DrmCommitThread") {
+  if (!cevent_.Initialize() || !qevent_.Initialize())
+    return;
+
+  fd_chandler_.AddFd(cevent_.get_fd());
+  fd_qhandler_.AddFd(qevent_.get_fd());
+}
+
+DrmCommitThread::~DrmCommitThread() {
+  ExitThread();
+  if (timeline_fd_ >= 0)
+    close(timeline_fd_);
+}
+
+bool DrmCommitThread::Initialize(uint32_t gpu_fd, uint32_t out_fence_ptr_prop,
+                                 FrameLatencyTracker* latency_tracker) {
+  // We need to know when a commit is on screen.
+  if (!out_fence_ptr_prop)
+    return false;
+
+  timeline_fd_ = open("/sys/kernel/debug/sync/sw_sync", O_RDWR);
+  if (timeline_fd_ < 0)
+    timeline_fd_ = open("/dev/sw_sync", O_RDWR);
+
+  if (timeline_fd_ < 0) {
+    ITRACE("Failed to open sw_sync timeline. %s", PRINTERROR());
+    return false;
+  }
+
+  gpu_fd_ = gpu_fd;
+  out_fence_ptr_prop_ = out_fence_ptr_prop;
+  latency_tracker_ = latency_tracker;
+  if (!InitWorker()) {
+    ETRACE("Failed to initalize DrmCommitThread. %s", PRINTERROR());
+    return false;
+  }
+
+  return true;
+}
+
+bool DrmCommitThread::QueueCommit(
+    ScopedDrmAtomicReqPtr& pset, uint32_t flags, int64_t commit_time,
+    const std::vector<uint32_t>& crtcs, std::vector<int32_t>& in_fences,
+    std::vector<std::shared_ptr<OverlayBuffer>>& buffers,
+    int32_t* retire_fence) {
+  // Drop buffers of frames which are no longer on screen.
+  std::list<PendingCommit> released;
+  queue_lock_.lock();
+  released.swap(released_);
+  queue_lock_.unlock();
+
+  // Re-use list node and vectors of a released frame for this one.
+  std::list<PendingCommit> commit;
+  if (released.empty()) {
+    commit.emplace_back();
+  } else {
+    commit.splice(commit.begin(), released, released.begin());
+  }
+
+  released.clear();
+  PendingCommit& pending = commit.front();
+  pending.buffers_.clear();
+  pending.pset_ = std::move(pset);
+  pending.flags_ = flags;
+  pending.commit_time_ = commit_time;
+  pending.in_fences_.swap(in_fences);
+  pending.buffers_.swap(buffers);
+  pending.crtcs_ = crtcs;
+  pending.out_fences_.clear();
+
+  // A frame which cannot be committed is still queued, so that it fails
+  // in order and retire fences handed out for it signal.
+  bool success = true;
+  if (retire_fence) {
+    *retire_fence = CreateRetireFence();
+    if (*retire_fence < 0) {
+      pending.pset_.reset();
+      success = false;
+    }
+  }
+
+  timeline_point_++;
+
+  queue_lock_.lock();
+  queued_.splice(queued_.end(), commit);
+  pending_++;
+  queue_lock_.unlock();
+  qevent_.Signal();
+  Resume();
+
+  WaitForPendingCommits(kMaxPendingCommits);
+  return success;
+}
+
+int32_t DrmCommitThread::CreateRetireFence() {
+  struct sw_sync_create_fence_data data;
+  memset(&data, 0, sizeof(data));
+  data.value = timeline_point_ + 1;
+  strncpy(data.name, "hwc retire fence", sizeof(data.name) - 1);
+  if (ioctl(timeline_fd_, SW_SYNC_IOC_CREATE_FENCE, &data) < 0) {
+    ETRACE("Failed to create retire fence. %s", PRINTERROR());
+    return -1;
+  }
+
+  return data.fence;
+}
+
+void DrmCommitThread::Flush() {
+  WaitForPendingCommits(0);
+}
+
+bool DrmCommitThread::HasCommitFailed() {
+  queue_lock_.lock();
+  bool failed = commit_failed_;
+  commit_failed_ = false;
+  queue_lock_.unlock();
+  return failed;
+}
+
+void DrmCommitThread::WaitForPendingCommits(uint32_t max_pending) {
+  queue_lock_.lock();
+  while (pending_ > max_pending && initialized_) {
+    queue_lock_.unlock();
+    Wait();
+    queue_lock_.lock();
+  }
+  queue_lock_.unlock();
+}
+
+void DrmCommitThread::Wait() {
+  if (fd_chandler_.Poll(-1) <= 0) {
+    ETRACE("Poll Failed in DrmCommitThread %s", PRINTERROR());
+    return;
+  }
+
+  if (fd_chandler_.IsReady(cevent_.get_fd())) {
+    // If eventfd_ is ready, we need to wait on it (using read()) to clean
+    // the flag that says it is ready.
+    cevent_.Wait();
+  }
+}
+
+void DrmCommitThread::ReleaseFences(PendingCommit& commit) {
+  for (int32_t fence : commit.in_fences_) {
+    if (fence > 0)
+      close(fence);
+  }
+
+  commit.in_fences_.clear();
+  for (int32_t fence : commit.out_fences_) {
+    if (fence > 0)
+      close(fence);
+  }
+
+  commit.out_fences_.clear();
+}
+
+bool DrmCommitThread::WaitForCommitTime(int64_t commit_time) {
+  // Rather commit a bit early than miss the vblank.
+  int timeout = (commit_time - GetMonotonicTime()) / kOneMillisecondNs;
+  if (timeout <= 0)
+    return false;
+
+  if (fd_qhandler_.Poll(timeout) <= 0)
+    return false;
+
+  if (fd_qhandler_.IsReady(qevent_.get_fd())) {
+    qevent_.Wait();
+    return true;
+  }
+
+  return false;
+}
+
+bool DrmCommitThread::MergeReplacedCommit(PendingCommit& replaced,
+                                          PendingCommit& commit) {
+  // Properties set by both frames take the value of the newer one.
+  if (drmModeAtomicMerge(replaced.pset_.get(), commit.pset_.get()) < 0) {
+    ETRACE("Failed to merge replaced frame.");
+    return false;
+  }
+
+  commit.pset_.swap(replaced.pset_);
+  // Planes set by the replaced frame only still need its acquire fences
+  // and buffers.
+  commit.in_fences_.insert(commit.in_fences_.end(),
+                           replaced.in_fences_.begin(),
+                           replaced.in_fences_.end());
+  replaced.in_fences_.clear();
+  commit.buffers_.insert(commit.buffers_.end(), replaced.buffers_.begin(),
+                         replaced.buffers_.end());
+  replaced.buffers_.clear();
+  for (uint32_t crtc : replaced.crtcs_) {
+    if (std::find(commit.crtcs_.begin(), commit.crtcs_.end(), crtc) ==
+        commit.crtcs_.end())
+      commit.crtcs_.emplace_back(crtc);
+  }
+
+  return true;
+}
+
+bool DrmCommitThread::AddOutFences(PendingCommit& commit) {
+  // List nodes don't move and out_fences_ isn't resized till this frame
+  // is released, so out fences can be written by the kernel directly
+  // into this commit.
+  commit.out_fences_.assign(commit.crtcs_.size(), -1);
+  for (size_t i = 0; i < commit.crtcs_.size(); i++) {
+    if (drmModeAtomicAddProperty(commit.pset_.get(), commit.crtcs_[i],
+                                 out_fence_ptr_prop_,
+                                 (uintptr_t)&commit.out_fences_[i]) < 0) {
+      ETRACE("Failed to add OUT_FENCE_PTR property to pset.");
+      return false;
+    }
+  }
+
+  return true;
+}
+
+void DrmCommitThread::IncrementTimeLine(uint32_t increment) {
+  if (ioctl(timeline_fd_, SW_SYNC_IOC_INC, &increment) < 0) {
+    ETRACE("Failed to increment commit timeline. %s", PRINTERROR());
+  }
+}
+
+void DrmCommitThread::HandleRoutine() {
+  while (1) {
+    std::list<PendingCommit> current;
+    queue_lock_.lock();
+    if (queued_.empty()) {
+      queue_lock_.unlock();
+      return;
+    }
+
+    // Late latching, newer frame replaces one waiting for its commit
+    // time. Frames without a commit time are never dropped.
+    while (queued_.size() > 1 && queued_.front().commit_time_) {
+      if (!MergeReplacedCommit(queued_.front(), *std::next(queued_.begin())))
+        break;
+
+      ReleaseFences(queued_.front());
+      released_.splice(released_.end(), queued_, queued_.begin());
+      replaced_++;
+    }
+
+    int64_t commit_time = queued_.front().commit_time_;
+    queue_lock_.unlock();
+
+    if (commit_time && WaitForCommitTime(commit_time))
+      continue;
+
+    queue_lock_.lock();
+    current.splice(current.begin(), queued_, queued_.begin());
+    uint32_t done = replaced_ + 1;
+    replaced_ = 0;
+    queue_lock_.unlock();
+
+    PendingCommit& commit = current.front();
+    int64_t commit_start = GetMonotonicTime();
+    int ret = -EINVAL;
+    if (commit.pset_ && AddOutFences(commit))
+      ret = drmModeAtomicCommit(gpu_fd_, commit.pset_.get(), commit.flags_,
+                                NULL);
+    if (ret) {
+      ETRACE("Failed to commit pset ret=%s\n", PRINTERROR());
+    } else {
+      int64_t commit_end = GetMonotonicTime();
+      for (int32_t fence : commit.out_fences_) {
+        if (fence > 0)
+          HWCPoll(fence, -1);
+      }
+
+      if (latency_tracker_ && commit.out_fences_.size() == 1) {
+        latency_tracker_->AddSample(HWCFrameStage::kAtomicCommit,
+                                    commit_end - commit_start);
+        latency_tracker_->AddCommitSamples(commit_end, commit.in_fences_,
+                                           commit.out_fences_.front());
+      }
+    }
+
+    ReleaseFences(commit);
+    commit.pset_.reset();
+    // Signal retire fences handed out for this frame and the ones it
+    // replaced. In case of failure previous frame stays on screen and
+    // its buffers are still kept.
+    IncrementTimeLine(done);
+
+    queue_lock_.lock();
+    if (ret) {
+      commit_failed_ = true;
+      released_.splice(released_.end(), current);
+    } else {
+      released_.splice(released_.end(), on_screen_);
+      on_screen_.splice(on_screen_.end(), current);
+    }
+
+    pending_ -= done;
+    queue_lock_.unlock();
+    cevent_.Signal();
+  }
+}
+
+void DrmCommitThread::HandleExit() {
+  // Nothing will commit the remaining frames, make sure nobody keeps
+  // waiting for them.
+  queue_lock_.lock();
+  for (PendingCommit& commit : queued_) {
+    ReleaseFences(commit);
+  }
+
+  IncrementTimeLine(queued_.size() + replaced_);
+  released_.splice(released_.end(), queued_);
+  replaced_ = 0;
+  pending_ = 0;
+  queue_lock_.unlock();
+  cevent_.Signal();
+}
+
+void DrmCommitThread::ExitThread() {
+  HWCThread::Exit();
+  queue_lock_.lock();
+  std::list<PendingCommit>().swap(on_screen_);
+  std::list<PendingCommit>().swap(released_);
+  queue_lock_.unlock();
+}
+
+}  // namespace hwcomposer
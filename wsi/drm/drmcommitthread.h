@@ -0,0 +1,133 @@
+/*
+// Copyright (c) 2016 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+*/
+
+#ifndef WSI_DRM_DRMCOMMITTHREAD_H_
+#define WSI_DRM_DRMCOMMITTHREAD_H_
+
+#include <stdint.h>
+
+#include <drmscopedtypes.h>
+#include <spinlock.h>
+
+#include <list>
+#include <memory>
+#include <vector>
+
+#include "fdhandler.h"
+#include "hwcevent.h"
+#include "hwcthread.h"
+
+namespace hwcomposer {
+
+class FrameLatencyTracker;
+class OverlayBuffer;
+
+// Commits frames of one pipe, or of a group of pipes committed together,
+// from a separate thread, so that presenting a frame doesn't need to wait
+// for the previous one to reach the screen.
+// Retire fences handed out for queued frames come from a sw_sync
+// timeline, which is advanced once the OUT_FENCE_PTR fences of all pipes
+// of the corresponding commit signal.
+// Frames with a commit time are held back till then, a frame queued in
+// the meantime replaces them. As psets only carry the planes a frame
+// changes, the replaced frame's pset is applied underneath the new one.
+class DrmCommitThread : public HWCThread {
+ public:
+  DrmCommitThread();
+  ~DrmCommitThread() override;
+
+  // Returns false if pipelined commits cannot be used. Commit latency of
+  // frames is added to latency_tracker, if any.
+  bool Initialize(uint32_t gpu_fd, uint32_t out_fence_ptr_prop,
+                  FrameLatencyTracker* latency_tracker);
+
+  // Queues pset updating pipes crtcs to be committed with flags, not
+  // before commit_time (CLOCK_MONOTONIC, 0 to commit right away). Takes
+  // ownership of pset, in_fences and buffers, leaving empty vectors whose
+  // storage can be re-used. retire_fence, if not NULL, signals once this
+  // frame is on screen. Returns once at most one queued frame isn't on
+  // screen yet. A frame which fails to queue still retires in order.
+  bool QueueCommit(ScopedDrmAtomicReqPtr& pset, uint32_t flags,
+                   int64_t commit_time, const std::vector<uint32_t>& crtcs,
+                   std::vector<int32_t>& in_fences,
+                   std::vector<std::shared_ptr<OverlayBuffer>>& buffers,
+                   int32_t* retire_fence);
+
+  // Returns a fence which signals once the frame queued next is on
+  // screen, -1 on failure.
+  int32_t CreateRetireFence();
+
+  // Waits till all queued frames are on screen.
+  void Flush();
+
+  // Returns true if any queued commit failed since last call.
+  bool HasCommitFailed();
+
+  void HandleRoutine() override;
+  void HandleExit() override;
+  void ExitThread();
+
+ private:
+  struct PendingCommit {
+    ScopedDrmAtomicReqPtr pset_;
+    uint32_t flags_ = 0;
+    int64_t commit_time_ = 0;
+    std::vector<uint32_t> crtcs_;
+    // Filled in by the kernel, one per pipe.
+    std::vector<int32_t> out_fences_;
+    std::vector<int32_t> in_fences_;
+    // Keeps framebuffers alive till the next frame is on screen.
+    std::vector<std::shared_ptr<OverlayBuffer>> buffers_;
+  };
+
+  void WaitForPendingCommits(uint32_t max_pending);
+  // Makes commit carry the state of replaced, which won't be committed.
+  bool MergeReplacedCommit(PendingCommit& replaced, PendingCommit& commit);
+  bool AddOutFences(PendingCommit& commit);
+  // Returns true if a new frame was queued before commit_time.
+  bool WaitForCommitTime(int64_t commit_time);
+  void ReleaseFences(PendingCommit& commit);
+  void IncrementTimeLine(uint32_t increment);
+  void Wait();
+
+  SpinLock queue_lock_;
+  // Frames waiting to be committed.
+  std::list<PendingCommit> queued_;
+  // Frame committed last.
+  std::list<PendingCommit> on_screen_;
+  // Frames whose buffers can be released by the caller thread.
+  std::list<PendingCommit> released_;
+  // Frames queued or committed but not yet on screen.
+  uint32_t pending_ = 0;
+  // Frames replaced since last commit. These are accounted as pending
+  // till the frame replacing them is on screen.
+  uint32_t replaced_ = 0;
+  bool commit_failed_ = false;
+  uint32_t gpu_fd_ = 0;
+  uint32_t out_fence_ptr_prop_ = 0;
+  FrameLatencyTracker* latency_tracker_ = NULL;
+  int timeline_fd_ = -1;
+  uint32_t timeline_point_ = 0;
+  // Signaled when a frame is done.
+  FDHandler fd_chandler_;
+  HWCEvent cevent_;
+  // Signaled when a frame is queued.
+  FDHandler fd_qhandler_;
+  HWCEvent qevent_;
+};
+
+}  // namespace hwcomposer
+#endif  // WSI_DRM_DRMCOMMITTHREAD_H_
@@ -32,6 +32,8 @@
 
 #include "displayplanemanager.h"
 #include "displayqueue.h"
+#include "drmcommitgroup.h"
+#include "drmcommitthread.h"
 #include "drmdisplaymanager.h"
 #include "wsi_utils.h"
 
@@ -42,6 +44,8 @@
 namespace hwcomposer {
 
 static const int32_t kUmPerInch = 25400;
+// Maximum number of TEST_ONLY results remembered per pipe.
+static const size_t kMaxTestCommitCacheSize = 32;
 
 DrmDisplay::DrmDisplay(uint32_t gpu_fd, uint32_t pipe_id, uint32_t crtc_id,
                        DrmDisplayManager *manager)
@@ -74,6 +78,7 @@ bool DrmDisplay::InitializeDisplay() {
   GetDrmObjectPropertyValue("GAMMA_LUT_SIZE", crtc_props, &lut_size_);
   GetDrmObjectProperty("OUT_FENCE_PTR", crtc_props, &out_fence_ptr_prop_);
   GetDrmObjectProperty("background_color", crtc_props, &canvas_color_prop_);
+  GetDrmObjectProperty("VRR_ENABLED", crtc_props, &vrr_enabled_prop_);
 
   return true;
 }
@@ -159,6 +164,7 @@ bool DrmDisplay::ConnectDisplay(const drmModeModeInfo &mode_info,
                                 const drmModeConnector *connector,
                                 uint32_t config) {
   IHOTPLUGEVENTTRACE("DrmDisplay::Connect recieved.");
+  InvalidateTestCommitCache();
   // TODO(kalyan): Add support for multi monitor case.
   if (connector_ && connector->connector_id == connector_) {
     IHOTPLUGEVENTTRACE(
@@ -222,6 +228,9 @@ bool DrmDisplay::ConnectDisplay(const drmModeModeInfo &mode_info,
   GetDrmObjectProperty("Broadcast RGB", connector_props, &broadcastrgb_id_);
   GetDrmObjectProperty("DPMS", connector_props, &dpms_prop_);
   GetDrmObjectProperty("max bpc", connector_props, &max_bpc_prop_);
+  uint64_t vrr_capable = 0;
+  GetDrmObjectPropertyValue("vrr_capable", connector_props, &vrr_capable);
+  vrr_capable_ = vrr_capable != 0;
 
   DrmConnectorGetDCIP3Support(connector_props);
   if (dcip3_) {
@@ -577,14 +586,22 @@ void DrmDisplay::UpdateDisplayConfig() {
   SetDisplayAttribute(modes_[config_]);
   vsync_period_ = modes_[config_].vrefresh;
   SPIN_UNLOCK(display_lock_);
+  InvalidateTestCommitCache();
 }
 
 bool DrmDisplay::GetDisplayVsyncPeriod(uint32_t *outVsyncPeriod) {
+  int64_t period = 0;
+  if (vrr_enabled_ && display_queue_->GetVblankPeriod(&period)) {
+    *outVsyncPeriod = period;
+    return true;
+  }
+
   return GetDisplayAttribute(config_, HWCDisplayAttribute::kRefreshRate,
                              reinterpret_cast<int32_t *>(outVsyncPeriod));
 }
 
 void DrmDisplay::PowerOn() {
+  InvalidateTestCommitCache();
   flags_ = 0;
   flags_ |= DRM_MODE_ATOMIC_ALLOW_MODESET;
   drmModeConnectorSetProperty(gpu_fd_, connector_, dpms_prop_,
@@ -682,6 +699,27 @@ bool DrmDisplay::Commit(
     ETRACE("Failed to commit without DrmMaster");
     return true;
   }
+
+  // Resetting planes, modesets and recovering from a failed group commit
+  // are done separately, once frames committed with a group are on screen.
+  bool group_failed = commit_group_ && commit_group_->HasCommitFailed(crtc_id_);
+  bool group_frame = commit_group_ && !group_failed &&
+                     !disable_explicit_fence && !first_commit_ &&
+                     !(display_state_ & kNeedsModeset);
+  if (group_committed_ && !group_frame) {
+    manager_->FlushCommitGroup();
+    group_committed_ = false;
+  }
+
+  // Resetting planes, modesets and recovering from a failed commit are
+  // done synchronously, once all queued frames are on screen.
+  bool queue_frame = commit_thread_ && !disable_explicit_fence &&
+                     !group_frame && !group_failed && !first_commit_ &&
+                     !(display_state_ & kNeedsModeset) &&
+                     !commit_thread_->HasCommitFailed();
+  if (commit_thread_ && !queue_frame)
+    commit_thread_->Flush();
+
   // Do the actual commit.
   ScopedDrmAtomicReqPtr pset(drmModeAtomicAlloc());
   *previous_fence_released = false;
@@ -691,8 +729,53 @@ bool DrmDisplay::Commit(
     return false;
   }
 
-  // Disable not-in-used plane once DRM master is reset
-  if (first_commit_)
+  if (group_frame) {
+    if (AddGroupFrame(composition_planes, previous_composition_planes,
+                      pset.get(), previous_fence, commit_fence,
+                      previous_fence_released))
+      return true;
+
+    // Commit separately, once frames committed with a group are on screen.
+    if (group_committed_) {
+      manager_->FlushCommitGroup();
+      group_committed_ = false;
+    }
+
+    pset.reset(drmModeAtomicAlloc());
+    if (!pset) {
+      ETRACE("Failed to allocate property set %d", -ENOMEM);
+      return false;
+    }
+  }
+
+  if (queue_frame) {
+    std::vector<const DisplayPlaneState *> &planes = queued_planes_;
+    planes.clear();
+    for (const DisplayPlaneState &comp_plane : composition_planes) {
+      if (!UpdatePlane(comp_plane, pset.get())) {
+        ETRACE("Failed to Commit layers.");
+        return false;
+      }
+
+      planes.emplace_back(&comp_plane);
+    }
+
+    DisableUnusedPlanes(previous_composition_planes, pset.get());
+    // Hold the frame back as long as it still makes its vblank, so that
+    // a newer one can replace it.
+    if (!QueueFrame(pset, planes, display_queue_->GetCommitDeadline(),
+                    previous_fence, commit_fence, previous_fence_released)) {
+      ETRACE("Failed to queue frame.");
+      return false;
+    }
+
+    UpdateCommittedPlanes(composition_planes);
+    return true;
+  }
+
+  // Disable not-in-used plane once DRM master is reset, or a group
+  // commit failed to update them.
+  if (first_commit_ || group_failed)
     display_queue_->ResetPlanes(pset.get());
 
   if (display_state_ & kNeedsModeset) {
@@ -722,6 +805,7 @@ bool DrmDisplay::Commit(
   int32_t fence = *commit_fence;
   if (fence > 0) {
     HWCPoll(fence, -1);
+    SampleCommittedFrame(fence);
     close(fence);
     *commit_fence = 0;
   }
@@ -745,65 +829,343 @@ bool DrmDisplay::CommitFrame(
   }
 
   for (const DisplayPlaneState &comp_plane : comp_planes) {
-    DrmPlane *plane = static_cast<DrmPlane *>(comp_plane.GetDisplayPlane());
+    if (!UpdatePlane(comp_plane, pset))
+      return false;
+  }
 
-    OverlayLayer *layer = (OverlayLayer *)comp_plane.GetOverlayLayer();
-    const HwcRect<int> &display_rect = layer->GetDisplayFrame();
-
-    // Recalculate the layer's display frame position before drm commit
-    // if there is plane transform with the type display rotation.
-    uint32_t plane_transform = layer->GetPlaneTransform();
-    hwcomposer::DisplayPlaneState::RotationType rotation_type =
-        comp_plane.GetRotationType();
-    if ((plane_transform != kIdentity) &&
-        (rotation_type == DisplayPlaneState::RotationType::kDisplayRotation)) {
-      HwcRect<int> rotated_rect;
-      if (layer->IsVideoLayer()) {
-        rotated_rect =
-            RotateRect(display_rect, width_, height_, plane_transform);
-      } else {
-        rotated_rect =
-            RotateScaleRect(display_rect, width_, height_, plane_transform);
-      }
-      layer->SetDisplayFrame(rotated_rect);
-    }
+  DisableUnusedPlanes(previous_composition_planes, pset);
 
-    int32_t fence = layer->GetAcquireFence();
-    if (fence > 0) {
-      plane->SetNativeFence(dup(fence));
-    } else {
-      plane->SetNativeFence(-1);
-    }
+#ifndef ENABLE_DOUBLE_BUFFERING
+  if (previous_fence > 0) {
+    HWCPoll(previous_fence, -1);
+    SampleCommittedFrame(previous_fence);
+    close(previous_fence);
+    *previous_fence_released = true;
+  }
+#endif
 
-    if (comp_plane.Scanout() && !comp_plane.IsSurfaceRecycled()) {
-      plane->SetBuffer(layer->GetSharedBuffer());
-    }
+  FrameLatencyTracker &latency = display_queue_->GetFrameLatencyTracker();
+  int64_t commit_start = GetMonotonicTime();
+  int ret = drmModeAtomicCommit(gpu_fd_, pset, flags, NULL);
+  if (ret) {
+    ETRACE("Failed to commit pset ret=%s\n", PRINTERROR());
+    // A cached test result may not hold anymore, e.g. when other pipes
+    // use more bandwidth than when it was tested.
+    InvalidateTestCommitCache();
+    return false;
+  }
 
-    if (!plane->UpdateProperties(pset, crtc_id_, comp_plane))
-      return false;
+  int64_t commit_end = GetMonotonicTime();
+  latency.AddSample(HWCFrameStage::kAtomicCommit, commit_end - commit_start);
+  std::vector<const DisplayPlaneState *> &planes = queued_planes_;
+  planes.clear();
+  for (const DisplayPlaneState &comp_plane : comp_planes) {
+    planes.emplace_back(&comp_plane);
   }
 
+  TrackCommittedFrame(commit_end, planes);
+  UpdateCommittedPlanes(comp_planes);
+  return true;
+}
+
+void DrmDisplay::TrackCommittedFrame(
+    int64_t commit_end, const std::vector<const DisplayPlaneState *> &planes) {
+  for (int32_t fence : tracked_fences_) {
+    close(fence);
+  }
+
+  tracked_fences_.clear();
+  tracked_commit_end_ = commit_end;
+  for (const DisplayPlaneState *comp_plane : planes) {
+    int32_t fence = comp_plane->GetOverlayLayer()->GetAcquireFence();
+    if (fence > 0)
+      tracked_fences_.emplace_back(dup(fence));
+  }
+}
+
+void DrmDisplay::SampleCommittedFrame(int32_t out_fence) {
+  if (tracked_commit_end_) {
+    display_queue_->GetFrameLatencyTracker().AddCommitSamples(
+        tracked_commit_end_, tracked_fences_, out_fence);
+  }
+
+  for (int32_t fence : tracked_fences_) {
+    close(fence);
+  }
+
+  tracked_fences_.clear();
+  tracked_commit_end_ = 0;
+}
+
+void DrmDisplay::DisableUnusedPlanes(
+    const DisplayPlaneStateList &previous_composition_planes,
+    drmModeAtomicReqPtr pset) {
   for (const DisplayPlaneState &comp_plane : previous_composition_planes) {
     DrmPlane *plane = static_cast<DrmPlane *>(comp_plane.GetDisplayPlane());
     if (plane->InUse())
       continue;
     plane->Disable(pset);
   }
+}
+
+void DrmDisplay::UpdateCommittedPlanes(
+    const DisplayPlaneStateList &comp_planes) {
+  // Test commits are done on top of what is committed, so all of its
+  // state is part of the key of cached results.
+  uint64_t planes_signature = kHashSeed;
+  for (const DisplayPlaneState &comp_plane : comp_planes) {
+    DrmPlane *plane = static_cast<DrmPlane *>(comp_plane.GetDisplayPlane());
+    plane->HashProperties(crtc_id_, comp_plane, &planes_signature);
+  }
+  committed_planes_signature_ = planes_signature;
+}
+
+bool DrmDisplay::QueueFrame(
+    ScopedDrmAtomicReqPtr &pset,
+    const std::vector<const DisplayPlaneState *> &planes, int64_t commit_time,
+    int32_t previous_fence, int32_t *commit_fence,
+    bool *previous_fence_released) {
+  // Acquire fences and buffers need to stay valid till the commit thread
+  // is done with this frame.
+  std::vector<int32_t> &in_fences = commit_fences_;
+  std::vector<std::shared_ptr<OverlayBuffer>> &buffers = commit_buffers_;
+  in_fences.clear();
+  buffers.clear();
+  for (const DisplayPlaneState *comp_plane : planes) {
+    DrmPlane *plane = static_cast<DrmPlane *>(comp_plane->GetDisplayPlane());
+    in_fences.emplace_back(plane->ReleaseNativeFence());
+    buffers.emplace_back(comp_plane->GetOverlayLayer()->GetSharedBuffer());
+  }
+
+  // Commit thread takes care of ordering frames, no need to wait here.
+  if (previous_fence > 0) {
+    close(previous_fence);
+    *previous_fence_released = true;
+  }
+
+  return commit_thread_->QueueCommit(pset, flags_, commit_time, commit_crtcs_,
+                                     in_fences, buffers, commit_fence);
+}
+
+bool DrmDisplay::AddGroupFrame(
+    const DisplayPlaneStateList &comp_planes,
+    const DisplayPlaneStateList &previous_composition_planes,
+    drmModeAtomicReqPtr pset, int32_t previous_fence, int32_t *commit_fence,
+    bool *previous_fence_released) {
+  // Acquire fences and buffers need to stay valid till the group is
+  // committed.
+  std::vector<int32_t> &in_fences = commit_fences_;
+  std::vector<std::shared_ptr<OverlayBuffer>> &buffers = commit_buffers_;
+  in_fences.clear();
+  buffers.clear();
+  bool success = true;
+  for (const DisplayPlaneState &comp_plane : comp_planes) {
+    if (!UpdatePlane(comp_plane, pset)) {
+      success = false;
+      break;
+    }
+
+    DrmPlane *plane = static_cast<DrmPlane *>(comp_plane.GetDisplayPlane());
+    in_fences.emplace_back(plane->ReleaseNativeFence());
+    buffers.emplace_back(comp_plane.GetOverlayLayer()->GetSharedBuffer());
+  }
+
+  if (success) {
+    DisableUnusedPlanes(previous_composition_planes, pset);
+    success = commit_group_->AddFrame(crtc_id_, pset, in_fences, buffers,
+                                      commit_fence);
+  }
+
+  if (!success) {
+    for (int32_t fence : in_fences) {
+      if (fence > 0)
+        close(fence);
+    }
+
+    in_fences.clear();
+    buffers.clear();
+    return false;
+  }
+
+  // Group commit can only go ahead once a frame committed separately is
+  // on screen, commit thread of the group takes care of ordering others.
+  if (previous_fence > 0) {
+    if (!group_committed_)
+      HWCPoll(previous_fence, -1);
+
+    close(previous_fence);
+    *previous_fence_released = true;
+  }
+
+  group_committed_ = true;
+  UpdateCommittedPlanes(comp_planes);
+  return true;
+}
+
+bool DrmDisplay::BeginCommitGroup(
+    const std::vector<NativeDisplay *> &displays) {
+  return manager_->BeginCommitGroup(displays);
+}
+
+void DrmDisplay::EndCommitGroup() {
+  manager_->EndCommitGroup();
+}
+
+void DrmDisplay::EnableAdaptiveSync(bool enable) {
+  adaptive_sync_ = enable;
+}
+
+void DrmDisplay::EnablePipelinedCommit(bool enable) {
+  if (!enable) {
+    if (commit_thread_) {
+      commit_thread_->Flush();
+      commit_thread_.reset();
+    }
+    return;
+  }
+
+  if (commit_thread_)
+    return;
+
+  std::unique_ptr<DrmCommitThread> commit_thread(new DrmCommitThread());
+  if (!commit_thread->Initialize(gpu_fd_, out_fence_ptr_prop_,
+                                 &display_queue_->GetFrameLatencyTracker())) {
+    ITRACE("Pipelined commits are not supported on crtc %d.", crtc_id_);
+    return;
+  }
+
+  commit_crtcs_.assign(1, crtc_id_);
+  commit_thread_.swap(commit_thread);
+}
+
+void DrmDisplay::FlushPendingCommits() const {
+  if (commit_thread_)
+    commit_thread_->Flush();
+
+  if (group_committed_)
+    manager_->FlushCommitGroup();
+}
+
+bool DrmDisplay::UpdatePlane(const DisplayPlaneState &comp_plane,
+                             drmModeAtomicReqPtr pset) {
+  DrmPlane *plane = static_cast<DrmPlane *>(comp_plane.GetDisplayPlane());
+
+  OverlayLayer *layer = (OverlayLayer *)comp_plane.GetOverlayLayer();
+  const HwcRect<int> &display_rect = layer->GetDisplayFrame();
+
+  // Recalculate the layer's display frame position before drm commit
+  // if there is plane transform with the type display rotation.
+  uint32_t plane_transform = layer->GetPlaneTransform();
+  hwcomposer::DisplayPlaneState::RotationType rotation_type =
+      comp_plane.GetRotationType();
+  if ((plane_transform != kIdentity) &&
+      (rotation_type == DisplayPlaneState::RotationType::kDisplayRotation)) {
+    HwcRect<int> rotated_rect;
+    if (layer->IsVideoLayer()) {
+      rotated_rect = RotateRect(display_rect, width_, height_, plane_transform);
+    } else {
+      rotated_rect =
+          RotateScaleRect(display_rect, width_, height_, plane_transform);
+    }
+    layer->SetDisplayFrame(rotated_rect);
+  }
+
+  int32_t fence = layer->GetAcquireFence();
+  if (fence > 0) {
+    plane->SetNativeFence(dup(fence));
+  } else {
+    plane->SetNativeFence(-1);
+  }
+
+  if (comp_plane.Scanout() && !comp_plane.IsSurfaceRecycled()) {
+    plane->SetBuffer(layer->GetSharedBuffer());
+  }
+
+  return plane->UpdateProperties(pset, crtc_id_, comp_plane);
+}
+
+bool DrmDisplay::CommitCursor(const DisplayPlaneState &cursor_plane,
+                              bool disable_explicit_fence,
+                              int32_t previous_fence, int32_t *commit_fence,
+                              bool *previous_fence_released) {
+  CTRACE();
+  *previous_fence_released = false;
+  if (!manager_->IsDrmMaster()) {
+    ETRACE("Failed to commit without DrmMaster");
+    return true;
+  }
+
+  // Planes need to be reset or a modeset applied, go through full commit.
+  // Frames of a group are always committed with all their planes.
+  if (first_commit_ || (display_state_ & kNeedsModeset) || commit_group_)
+    return false;
+
+  if (group_committed_) {
+    manager_->FlushCommitGroup();
+    group_committed_ = false;
+  }
+
+  bool queue_frame = commit_thread_ && !disable_explicit_fence;
+  if (commit_thread_) {
+    if (commit_thread_->HasCommitFailed())
+      return false;
+
+    if (!queue_frame)
+      commit_thread_->Flush();
+  }
+
+  ScopedDrmAtomicReqPtr pset(drmModeAtomicAlloc());
+  if (!pset) {
+    ETRACE("Failed to allocate property set %d", -ENOMEM);
+    return false;
+  }
+
+  if (!disable_explicit_fence && out_fence_ptr_prop_ && !queue_frame)
+    GetFence(pset.get(), commit_fence);
+
+  // Only the cursor plane properties are part of this request, all other
+  // planes keep scanning out what was committed with the last frame.
+  if (!UpdatePlane(cursor_plane, pset.get()))
+    return false;
+
+  std::vector<const DisplayPlaneState *> planes(1, &cursor_plane);
+  // Cursor updates are committed right away, they only carry the cursor
+  // plane and must never be dropped for late latching.
+  if (queue_frame) {
+    return QueueFrame(pset, planes, 0, previous_fence, commit_fence,
+                      previous_fence_released);
+  }
 
 #ifndef ENABLE_DOUBLE_BUFFERING
   if (previous_fence > 0) {
     HWCPoll(previous_fence, -1);
+    SampleCommittedFrame(previous_fence);
     close(previous_fence);
     *previous_fence_released = true;
   }
 #endif
 
-  int ret = drmModeAtomicCommit(gpu_fd_, pset, flags, NULL);
+  int64_t commit_start = GetMonotonicTime();
+  int ret = drmModeAtomicCommit(gpu_fd_, pset.get(), flags_, NULL);
   if (ret) {
-    ETRACE("Failed to commit pset ret=%s\n", PRINTERROR());
+    ETRACE("Failed to commit cursor pset ret=%s\n", PRINTERROR());
     return false;
   }
 
+  int64_t commit_end = GetMonotonicTime();
+  display_queue_->GetFrameLatencyTracker().AddSample(
+      HWCFrameStage::kAtomicCommit, commit_end - commit_start);
+  TrackCommittedFrame(commit_end, planes);
+
+#ifdef ENABLE_DOUBLE_BUFFERING
+  int32_t fence = *commit_fence;
+  if (fence > 0) {
+    HWCPoll(fence, -1);
+    SampleCommittedFrame(fence);
+    close(fence);
+    *commit_fence = 0;
+  }
+#endif
   return true;
 }
 
@@ -931,6 +1293,8 @@ void DrmDisplay::ApplyPendingCTM(
     return;
   }
 
+  FlushPendingCommits();
+
   if (ctm_post_offset_id_prop_ == 0) {
     ETRACE("ctm_post_offset_id_prop_ == 0");
     return;
@@ -965,6 +1329,7 @@ void DrmDisplay::ApplyPendingLUT(struct drm_color_lut *lut) const {
   if (lut_id_prop_ == 0)
     return;
 
+  FlushPendingCommits();
   uint32_t lut_blob_id = 0;
 
   drmModeCreatePropertyBlob(
@@ -1006,6 +1371,7 @@ void DrmDisplay::SetPipeCanvasColor(uint16_t bpc, uint16_t red, uint16_t green,
   if (canvas_color_prop_ == 0)
     return;
 
+  FlushPendingCommits();
   uint64_t canvas_color = 0;
   if (bpc == 8)
     canvas_color = DRM_RGBA8888(red, green, blue, alpha);
@@ -1173,6 +1539,7 @@ void DrmDisplay::SetColorCorrection(struct gamma_colors gamma,
 }
 
 bool DrmDisplay::ApplyPendingModeset(drmModeAtomicReqPtr property_set) {
+  InvalidateTestCommitCache();
   if (old_blob_id_) {
     drmModeDestroyPropertyBlob(gpu_fd_, old_blob_id_);
     old_blob_id_ = 0;
@@ -1196,6 +1563,18 @@ bool DrmDisplay::ApplyPendingModeset(drmModeAtomicReqPtr property_set) {
     return false;
   }
 
+  if (vrr_enabled_prop_) {
+    bool vrr_enabled = adaptive_sync_ && vrr_capable_;
+    if (drmModeAtomicAddProperty(property_set, crtc_id_, vrr_enabled_prop_,
+                                 vrr_enabled) < 0) {
+      ETRACE("Failed to add VRR_ENABLED property to pset");
+      return false;
+    }
+
+    vrr_enabled_ = vrr_enabled;
+    display_queue_->SetVariableRefresh(vrr_enabled);
+  }
+
   old_blob_id_ = blob_id_;
   blob_id_ = 0;
 
@@ -1216,6 +1595,8 @@ bool DrmDisplay::GetFence(drmModeAtomicReqPtr property_set,
 
 void DrmDisplay::Disable(const DisplayPlaneStateList &composition_planes) {
   IHOTPLUGEVENTTRACE("Disable: Disabling Display: %p", this);
+  InvalidateTestCommitCache();
+  FlushPendingCommits();
 
   for (const DisplayPlaneState &comp_plane : composition_planes) {
     DrmPlane *plane = static_cast<DrmPlane *>(comp_plane.GetDisplayPlane());
@@ -1229,11 +1610,25 @@ void DrmDisplay::Disable(const DisplayPlaneStateList &composition_planes) {
 
 void DrmDisplay::ReleaseUnreservedPlanes(
     std::vector<uint32_t> &reserved_planes) {
+  InvalidateTestCommitCache();
   display_queue_->ReleaseUnreservedPlanes(reserved_planes);
 }
 
+void DrmDisplay::EnableCostModelPlaneAllocator(bool enable) {
+  display_queue_->EnableCostModelPlaneAllocator(enable);
+}
+
+void DrmDisplay::SetSurfacePoolBudget(uint32_t budget_mb) {
+  display_queue_->SetSurfacePoolBudget(budget_mb);
+}
+
+void DrmDisplay::SetCompositorContexts(uint32_t count) {
+  display_queue_->SetCompositorContexts(count);
+}
+
 bool DrmDisplay::PopulatePlanes(
     std::vector<std::unique_ptr<DisplayPlane>> &overlay_planes) {
+  InvalidateTestCommitCache();
   ScopedDrmPlaneResPtr plane_resources(drmModeGetPlaneResources(gpu_fd_));
   if (!plane_resources) {
     ETRACE("Failed to get plane resources");
@@ -1320,23 +1715,66 @@ void DrmDisplay::NotifyClientsOfDisplayChangeStatus() {
 }
 
 bool DrmDisplay::TestCommit(const DisplayPlaneStateList &composition) const {
+  // Identical configurations can skip the ioctl. Only successes are
+  // cached, a failure may be caused by the load of other pipes or
+  // bandwidth limits and not by this configuration.
+  uint64_t signature = kHashSeed;
+  HashCombine(signature, committed_planes_signature_);
+  for (auto &plane_state : composition) {
+    DrmPlane *plane = static_cast<DrmPlane *>(plane_state.GetDisplayPlane());
+    plane->HashProperties(crtc_id_, plane_state, &signature);
+  }
+
+  test_commit_cache_lock_.lock();
+  for (auto it = test_commit_cache_.begin(); it != test_commit_cache_.end();
+       ++it) {
+    if (it->signature_ == signature) {
+      bool status = it->status_;
+      test_commit_cache_.splice(test_commit_cache_.begin(), test_commit_cache_,
+                                it);
+      test_commit_cache_lock_.unlock();
+      return status;
+    }
+  }
+  test_commit_cache_lock_.unlock();
+
+  bool status = true;
   ScopedDrmAtomicReqPtr pset(drmModeAtomicAlloc());
   for (auto &plane_state : composition) {
     DrmPlane *plane = static_cast<DrmPlane *>(plane_state.GetDisplayPlane());
     if (!(plane->UpdateProperties(pset.get(), crtc_id_, plane_state, true))) {
-      return false;
+      status = false;
+      break;
     }
   }
 
-  if (drmModeAtomicCommit(gpu_fd_, pset.get(), DRM_MODE_ATOMIC_TEST_ONLY,
-                          NULL)) {
+  if (status && drmModeAtomicCommit(gpu_fd_, pset.get(),
+                                    DRM_MODE_ATOMIC_TEST_ONLY, NULL)) {
     IDISPLAYMANAGERTRACE("Test Commit Failed. %s ", PRINTERROR());
-    return false;
+    status = false;
   }
 
+  if (!status)
+    return false;
+
+  TestCommitResult result;
+  result.signature_ = signature;
+  result.status_ = status;
+  test_commit_cache_lock_.lock();
+  test_commit_cache_.emplace_front(result);
+  if (test_commit_cache_.size() > kMaxTestCommitCacheSize)
+    test_commit_cache_.pop_back();
+  test_commit_cache_lock_.unlock();
+
   return true;
 }
 
+void DrmDisplay::InvalidateTestCommitCache() {
+  test_commit_cache_lock_.lock();
+  std::list<TestCommitResult>().swap(test_commit_cache_);
+  test_commit_cache_lock_.unlock();
+}
+
 std::unique_ptr<DrmPlane> DrmDisplay::CreatePlane(uint32_t plane_id,
                                                   uint32_t possible_crtcs) {
   return std::unique_ptr<DrmPlane>(new DrmPlane(plane_id, possible_crtcs));
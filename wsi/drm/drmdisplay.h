@@ -23,6 +23,9 @@
 
 #include <drmscopedtypes.h>
 
+#include <list>
+#include <string>
+
 #include "drmplane.h"
 #include "physicaldisplay.h"
 
@@ -42,6 +45,8 @@ enum pipe_bpc {
   PIPE_BPC_SIXTEEN = 16
 };
 
+class DrmCommitGroup;
+class DrmCommitThread;
 class DrmDisplayManager;
 class DisplayPlaneState;
 class DisplayQueue;
@@ -94,6 +99,19 @@ class DrmDisplay : public PhysicalDisplay {
               bool disable_explicit_fence, int32_t previous_fence,
               int32_t *commit_fence, bool *previous_fence_released) override;
 
+  bool BeginCommitGroup(const std::vector<NativeDisplay *> &displays) override;
+  void EndCommitGroup() override;
+
+  // Frames are added to group, if not NULL, instead of being committed
+  // separately.
+  void SetCommitGroup(DrmCommitGroup *group) {
+    commit_group_ = group;
+  }
+
+  uint32_t OutFencePtrProperty() const {
+    return out_fence_ptr_prop_;
+  }
+
   uint32_t CrtcId() const {
     return crtc_id_;
   }
@@ -105,6 +123,11 @@ class DrmDisplay : public PhysicalDisplay {
   void SetDisplayAttribute(const drmModeModeInfo &mode_info);
   void SetFakeAttribute(const drmModeModeInfo &mode_info);
 
+  bool CommitCursor(const DisplayPlaneState &cursor_plane,
+                    bool disable_explicit_fence, int32_t previous_fence,
+                    int32_t *commit_fence,
+                    bool *previous_fence_released) override;
+
   bool TestCommit(const DisplayPlaneStateList &commit_planes) const override;
 
   bool PopulatePlanes(
@@ -126,6 +149,19 @@ class DrmDisplay : public PhysicalDisplay {
 
   void ReleaseUnreservedPlanes(std::vector<uint32_t> &reserved_planes);
 
+  void EnableCostModelPlaneAllocator(bool enable);
+
+  void SetSurfacePoolBudget(uint32_t budget_mb);
+
+  void SetCompositorContexts(uint32_t count);
+
+  // Commits frames from a separate thread, see DrmCommitThread.
+  void EnablePipelinedCommit(bool enable);
+
+  // Enables variable refresh on the next modeset, if the connector is
+  // capable of it.
+  void EnableAdaptiveSync(bool enable);
+
   void HandleLazyInitialization() override;
 
   void SetPlanesUpdated(bool updated) {
@@ -173,6 +209,34 @@ class DrmDisplay : public PhysicalDisplay {
                    const DisplayPlaneStateList &previous_composition_planes,
                    drmModeAtomicReqPtr pset, uint32_t flags,
                    int32_t previous_fence, bool *previous_fence_released);
+  bool UpdatePlane(const DisplayPlaneState &comp_plane,
+                   drmModeAtomicReqPtr pset);
+  void DisableUnusedPlanes(
+      const DisplayPlaneStateList &previous_composition_planes,
+      drmModeAtomicReqPtr pset);
+  void UpdateCommittedPlanes(const DisplayPlaneStateList &comp_planes);
+  // Keeps acquire fences of planes committed at commit_end, so that
+  // latency of the frame can be sampled once it is on screen.
+  void TrackCommittedFrame(
+      int64_t commit_end, const std::vector<const DisplayPlaneState *> &planes);
+  // Adds latency samples of tracked frame once out_fence, its signaled
+  // commit fence, is available.
+  void SampleCommittedFrame(int32_t out_fence);
+  // Queues frame to commit_thread_, holding it back till commit_time if
+  // not 0.
+  bool QueueFrame(ScopedDrmAtomicReqPtr &pset,
+                  const std::vector<const DisplayPlaneState *> &planes,
+                  int64_t commit_time, int32_t previous_fence,
+                  int32_t *commit_fence, bool *previous_fence_released);
+  // Adds frame to commit_group_, returns false if it needs to be
+  // committed separately.
+  bool AddGroupFrame(const DisplayPlaneStateList &comp_planes,
+                     const DisplayPlaneStateList &previous_composition_planes,
+                     drmModeAtomicReqPtr pset, int32_t previous_fence,
+                     int32_t *commit_fence, bool *previous_fence_released);
+  // Waits till all frames queued to commit_thread_, or committed with a
+  // group, are on screen.
+  void FlushPendingCommits() const;
   uint64_t DrmRGBA(uint16_t, uint16_t red, uint16_t green, uint16_t blue,
                    uint16_t alpha) const;
   std::unique_ptr<DrmPlane> CreatePlane(uint32_t plane_id,
@@ -183,6 +247,10 @@ class DrmDisplay : public PhysicalDisplay {
 
   void TraceFirstCommit();
 
+  // Drops all cached TEST_ONLY results. Needs to be called whenever
+  // pipe state which isn't part of the test commit changes.
+  void InvalidateTestCommitCache();
+
   uint32_t FindPreferedDisplayMode(size_t modes_size);
   uint32_t FindPerformaceDisplayMode(size_t modes_size);
 
@@ -204,7 +272,12 @@ class DrmDisplay : public PhysicalDisplay {
   uint32_t hdcp_srm_id_prop_ = 0;
   uint32_t edid_prop_ = 0;
   uint32_t canvas_color_prop_ = 0;
+  uint32_t vrr_enabled_prop_ = 0;
   uint32_t connector_ = 0;
+  bool vrr_capable_ = false;
+  bool adaptive_sync_ = false;
+  // Variable refresh state applied with the last modeset.
+  bool vrr_enabled_ = false;
   bool dcip3_ = false;
   uint32_t max_bpc_prop_ = 0;
   uint64_t lut_size_ = 0;
@@ -227,6 +300,32 @@ class DrmDisplay : public PhysicalDisplay {
   DrmDisplayManager *manager_;
   uint32_t vsync_period_ = 0;
   uint32_t connection_type_ = 0;
+
+  // Outcome of a TEST_ONLY commit for a given plane configuration.
+  struct TestCommitResult {
+    uint64_t signature_ = 0;
+    bool status_ = false;
+  };
+
+  // Most recently used result is at the front.
+  mutable std::list<TestCommitResult> test_commit_cache_;
+  mutable SpinLock test_commit_cache_lock_;
+  // Hash of the state of planes enabled on this pipe by the last commit.
+  uint64_t committed_planes_signature_ = 0;
+  std::unique_ptr<DrmCommitThread> commit_thread_;
+  // Pipe updated by frames queued to commit_thread_.
+  std::vector<uint32_t> commit_crtcs_;
+  // Per frame state of queued commits, kept to re-use storage.
+  std::vector<const DisplayPlaneState *> queued_planes_;
+  std::vector<int32_t> commit_fences_;
+  std::vector<std::shared_ptr<OverlayBuffer>> commit_buffers_;
+  // Group this display is presented with, see BeginCommitGroup.
+  DrmCommitGroup *commit_group_ = NULL;
+  // Last frame was committed with a group.
+  bool group_committed_ = false;
+  // Frame committed last without commit_thread_.
+  int64_t tracked_commit_end_ = 0;
+  std::vector<int32_t> tracked_fences_;
 };
 
 }  // namespace hwcomposer
@@ -45,6 +45,7 @@ DrmDisplayManager::DrmDisplayManager() : HWCThread(-8, "DisplayManager") {
 DrmDisplayManager::~DrmDisplayManager() {
   CTRACE();
   std::vector<std::unique_ptr<DrmDisplay>>().swap(displays_);
+  commit_group_.reset();
 
 #ifndef DISABLE_HOTPLUG_NOTIFICATION
   close(hotplug_fd_);
@@ -696,6 +697,106 @@ void DrmDisplayManager::RemoveUnreservedPlanes() {
   }
 }
 
+void DrmDisplayManager::EnableCostModelPlaneAllocator(bool enable) {
+  size_t size = displays_.size();
+  for (size_t i = 0; i < size; i++) {
+    displays_.at(i)->EnableCostModelPlaneAllocator(enable);
+  }
+}
+
+void DrmDisplayManager::SetSurfacePoolBudget(uint32_t budget_mb) {
+  size_t size = displays_.size();
+  for (size_t i = 0; i < size; i++) {
+    displays_.at(i)->SetSurfacePoolBudget(budget_mb);
+  }
+}
+
+void DrmDisplayManager::SetCompositorContexts(uint32_t count) {
+  size_t size = displays_.size();
+  for (size_t i = 0; i < size; i++) {
+    displays_.at(i)->SetCompositorContexts(count);
+  }
+}
+
+void DrmDisplayManager::EnablePipelinedCommit(bool enable) {
+  size_t size = displays_.size();
+  for (size_t i = 0; i < size; i++) {
+    displays_.at(i)->EnablePipelinedCommit(enable);
+  }
+}
+
+void DrmDisplayManager::EnableAdaptiveSync(bool enable) {
+  size_t size = displays_.size();
+  for (size_t i = 0; i < size; i++) {
+    displays_.at(i)->EnableAdaptiveSync(enable);
+  }
+}
+
+void DrmDisplayManager::EnableGroupCommit(bool enable) {
+  use_group_commit_ = enable;
+}
+
+bool DrmDisplayManager::BeginCommitGroup(
+    const std::vector<NativeDisplay *> &displays) {
+  if (!use_group_commit_ || !group_displays_.empty())
+    return false;
+
+  for (NativeDisplay *display : displays) {
+    for (std::unique_ptr<DrmDisplay> &drm_display : displays_) {
+      if (drm_display.get() == display && drm_display->IsConnected()) {
+        group_displays_.emplace_back(drm_display.get());
+        break;
+      }
+    }
+  }
+
+  if (group_displays_.size() < 2) {
+    group_displays_.clear();
+    return false;
+  }
+
+  if (!commit_group_) {
+    std::unique_ptr<DrmCommitGroup> group(new DrmCommitGroup());
+    DrmDisplay *display = group_displays_.front();
+    if (!group->Initialize(fd_, display->OutFencePtrProperty())) {
+      ITRACE("Frames of several displays cannot be committed together.");
+      use_group_commit_ = false;
+      group_displays_.clear();
+      return false;
+    }
+
+    commit_group_.swap(group);
+  }
+
+  if (!commit_group_->Begin()) {
+    group_displays_.clear();
+    return false;
+  }
+
+  for (DrmDisplay *display : group_displays_) {
+    display->SetCommitGroup(commit_group_.get());
+  }
+
+  return true;
+}
+
+void DrmDisplayManager::EndCommitGroup() {
+  if (group_displays_.empty())
+    return;
+
+  for (DrmDisplay *display : group_displays_) {
+    display->SetCommitGroup(NULL);
+  }
+
+  group_displays_.clear();
+  commit_group_->End();
+}
+
+void DrmDisplayManager::FlushCommitGroup() {
+  if (commit_group_)
+    commit_group_->Flush();
+}
+
 FrameBufferManager *DrmDisplayManager::GetFrameBufferManager() {
   return frame_buffer_manager_.get();
 }
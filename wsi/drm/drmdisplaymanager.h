@@ -27,6 +27,7 @@
 
 #include "displaymanager.h"
 #include "displayplanemanager.h"
+#include "drmcommitgroup.h"
 #include "drmdisplay.h"
 #include "drmscopedtypes.h"
 #include "framebuffermanager.h"
@@ -101,6 +102,25 @@ class DrmDisplayManager : public HWCThread, public DisplayManager {
                             uint32_t SRMLength) override;
   void RemoveUnreservedPlanes() override;
 
+  void EnableCostModelPlaneAllocator(bool enable) override;
+
+  void SetSurfacePoolBudget(uint32_t budget_mb) override;
+
+  void SetCompositorContexts(uint32_t count) override;
+
+  void EnablePipelinedCommit(bool enable) override;
+
+  void EnableAdaptiveSync(bool enable) override;
+
+  void EnableGroupCommit(bool enable) override;
+
+  // Frames presented on displays till EndCommitGroup are committed
+  // together. Returns false if displays cannot be grouped.
+  bool BeginCommitGroup(const std::vector<NativeDisplay *> &displays);
+  void EndCommitGroup();
+  // Waits till frames committed with a group are on screen.
+  void FlushCommitGroup();
+
   FrameBufferManager *GetFrameBufferManager() override;
 
  protected:
@@ -113,6 +133,10 @@ class DrmDisplayManager : public HWCThread, public DisplayManager {
   std::map<uint32_t, std::unique_ptr<NativeDisplay>> virtual_displays_;
   std::unique_ptr<FrameBufferManager> frame_buffer_manager_;
   std::vector<std::unique_ptr<DrmDisplay>> displays_;
+  std::unique_ptr<DrmCommitGroup> commit_group_;
+  // Displays of the open commit group.
+  std::vector<DrmDisplay *> group_displays_;
+  bool use_group_commit_ = false;
   std::shared_ptr<DisplayHotPlugEventCallback> callback_ = NULL;
   std::unique_ptr<NativeBufferHandler> buffer_handler_;
   GpuDevice &device_ = GpuDevice::getInstance();
@@ -28,6 +28,48 @@
 
 namespace hwcomposer {
 
+// Limits of the pipe scalers used by non cursor planes.
+static const float kMaxDownScale = 3.0f;
+static const uint32_t kMinScaledSize = 8;
+static const uint32_t kMinScaledYUVSize = 16;
+static const uint32_t kMaxScaledSize = 4096;
+
+// Number of layer configurations remembered as failing a test commit.
+static const size_t kMaxRejectedLayers = 16;
+// A rejected layer configuration is let through to a test commit again
+// after kRejectedLayerRetryInterval frames, as the failure might have
+// been caused by other planes in the composition.
+static const uint32_t kRejectedLayerRetryInterval = 32;
+
+// Returns horizontal and vertical chroma subsampling of format.
+static void GetChromaSubsampling(uint32_t format, uint32_t* hsub,
+                                 uint32_t* vsub) {
+  *hsub = 1;
+  *vsub = 1;
+  switch (format) {
+    case DRM_FORMAT_NV12:
+    case DRM_FORMAT_NV21:
+    case DRM_FORMAT_P010:
+    case DRM_FORMAT_YUV420:
+    case DRM_FORMAT_YVU420:
+    case DRM_FORMAT_NV12_Y_TILED_INTEL:
+    case DRM_FORMAT_YVU420_ANDROID:
+      *hsub = 2;
+      *vsub = 2;
+      break;
+    case DRM_FORMAT_NV16:
+    case DRM_FORMAT_YUV422:
+    case DRM_FORMAT_UYVY:
+    case DRM_FORMAT_YUYV:
+    case DRM_FORMAT_YVYU:
+    case DRM_FORMAT_VYUY:
+      *hsub = 2;
+      break;
+    default:
+      break;
+  }
+}
+
 DrmPlane::Property::Property() {
 }
 
@@ -264,9 +306,25 @@ bool DrmPlane::Initialize(uint32_t gpu_fd, const std::vector<uint32_t>& formats,
 
     drmModeFreePropertyBlob(blob);
   }
+
+  InitializeCapabilities();
   return true;
 }
 
+void DrmPlane::InitializeCapabilities() {
+  caps_ = Capabilities();
+  rejected_layers_.clear();
+  // Cursor planes are scanned out with buffer size and cannot scale.
+  if (type_ == DRM_PLANE_TYPE_CURSOR)
+    return;
+
+  caps_.scaling = true;
+  caps_.max_downscale = kMaxDownScale;
+  caps_.min_scaled_size = kMinScaledSize;
+  caps_.min_scaled_yuv_size = kMinScaledYUVSize;
+  caps_.max_scaled_size = kMaxScaledSize;
+}
+
 bool DrmPlane::UpdateProperties(drmModeAtomicReqPtr property_set,
                                 uint32_t crtc_id,
                                 const DisplayPlaneState& plane,
@@ -387,6 +445,51 @@ bool DrmPlane::UpdateProperties(drmModeAtomicReqPtr property_set,
   return true;
 }
 
+void DrmPlane::HashProperties(uint32_t crtc_id, const DisplayPlaneState& plane,
+                              uint64_t* hash) const {
+  const OverlayLayer* layer = plane.GetOverlayLayer();
+  OverlayBuffer* buffer = layer->GetBuffer();
+  HashCombine(*hash, id_);
+  HashCombine(*hash, crtc_id);
+  if (!buffer) {
+    HashCombine(*hash, 0);
+    return;
+  }
+
+  HashCombine(*hash, buffer->GetFormat());
+  HashCombine(*hash, buffer->GetTilingMode());
+  HashCombine(*hash, buffer->GetFb() == 0);
+
+  HwcRect<int> display_frame = plane.GetRotatedDisplayFrame();
+  if (plane.GetRotationType() !=
+      DisplayPlaneState::RotationType::kDisplayRotation) {
+    display_frame = plane.GetDisplayFrame();
+  }
+
+  HashCombine(*hash, static_cast<uint32_t>(display_frame.left));
+  HashCombine(*hash, static_cast<uint32_t>(display_frame.top));
+  if (layer->IsCursorLayer()) {
+    HashCombine(*hash, buffer->GetWidth());
+    HashCombine(*hash, buffer->GetHeight());
+  } else {
+    const HwcRect<float>& source_crop = layer->GetSourceCrop();
+    HashCombine(*hash, layer->GetDisplayFrameWidth());
+    HashCombine(*hash, layer->GetDisplayFrameHeight());
+    HashCombine(*hash, static_cast<int>(ceilf(source_crop.left)));
+    HashCombine(*hash, static_cast<int>(ceilf(source_crop.top)));
+    HashCombine(*hash, layer->GetSourceCropWidth());
+    HashCombine(*hash, layer->GetSourceCropHeight());
+  }
+
+  HashCombine(*hash, layer->IsProtected());
+  HashCombine(*hash, layer->GetMergedTransform());
+  if (layer->GetBlending() == HWCBlending::kBlendingPremult) {
+    HashCombine(*hash, layer->GetAlpha());
+  } else {
+    HashCombine(*hash, 0xFFFF);
+  }
+}
+
 void DrmPlane::SetNativeFence(int32_t fd) {
   // Release any existing fence.
   if (kms_fence_ > 0) {
@@ -396,6 +499,12 @@ void DrmPlane::SetNativeFence(int32_t fd) {
   kms_fence_ = fd;
 }
 
+int32_t DrmPlane::ReleaseNativeFence() {
+  int32_t fence = kms_fence_;
+  kms_fence_ = -1;
+  return fence;
+}
+
 void DrmPlane::SetBuffer(std::shared_ptr<OverlayBuffer>& buffer) {
   buffer_ = buffer;
 }
@@ -482,13 +591,134 @@ bool DrmPlane::ValidateLayer(const OverlayLayer* layer) {
     return false;
   }
 
-  if (!IsSupportedFormat(layer_buffer->GetFormat())) {
+  uint32_t format = layer_buffer->GetFormat();
+  if (!IsSupportedFormat(format)) {
     IDISPLAYMANAGERTRACE(
         "Layer cannot be supported as format is not supported.");
     return false;
   }
 
-  return IsSupportedTransform(transform);
+  if (!IsSupportedTransform(transform))
+    return false;
+
+  if (!ValidateLayerRects(layer, format)) {
+    IDISPLAYMANAGERTRACE(
+        "Layer cannot be supported as scaling or crop is out of limits.");
+    return false;
+  }
+
+  if (!rejected_layers_.empty()) {
+    uint64_t key = GetRejectionKey(layer);
+    for (const RejectedLayer& rejected : rejected_layers_) {
+      if (rejected.key_ == key)
+        return validated_frames_ - rejected.rejected_at_ >=
+               kRejectedLayerRetryInterval;
+    }
+  }
+
+  return true;
+}
+
+bool DrmPlane::ValidateLayerRects(const OverlayLayer* layer,
+                                  uint32_t format) const {
+  // Cursor is programmed with buffer size, see UpdateProperties.
+  if (layer->IsCursorLayer())
+    return true;
+
+  uint32_t src_width = layer->GetSourceCropWidth();
+  uint32_t src_height = layer->GetSourceCropHeight();
+  uint32_t dst_width = layer->GetDisplayFrameWidth();
+  uint32_t dst_height = layer->GetDisplayFrameHeight();
+  if (layer->GetMergedTransform() & (kTransform90 | kTransform270))
+    std::swap(dst_width, dst_height);
+
+  if (!src_width || !src_height || !dst_width || !dst_height)
+    return false;
+
+  // Crop of subsampled YUV formats needs to be aligned to chroma.
+  uint32_t hsub = 1;
+  uint32_t vsub = 1;
+  GetChromaSubsampling(format, &hsub, &vsub);
+  const HwcRect<float>& source_crop = layer->GetSourceCrop();
+  uint32_t src_x = static_cast<uint32_t>(ceilf(source_crop.left));
+  uint32_t src_y = static_cast<uint32_t>(ceilf(source_crop.top));
+  if ((src_x % hsub) || (src_width % hsub) || (src_y % vsub) ||
+      (src_height % vsub))
+    return false;
+
+  if (src_width == dst_width && src_height == dst_height)
+    return true;
+
+  if (!caps_.scaling)
+    return false;
+
+  uint32_t min_size =
+      vsub > 1 ? caps_.min_scaled_yuv_size : caps_.min_scaled_size;
+  if (src_width < min_size || src_height < min_size ||
+      dst_width < caps_.min_scaled_size || dst_height < caps_.min_scaled_size)
+    return false;
+
+  if (src_width > caps_.max_scaled_size || src_height > caps_.max_scaled_size)
+    return false;
+
+  if (static_cast<float>(src_width) / dst_width >= caps_.max_downscale ||
+      static_cast<float>(src_height) / dst_height >= caps_.max_downscale)
+    return false;
+
+  return true;
+}
+
+uint64_t DrmPlane::GetRejectionKey(const OverlayLayer* layer) const {
+  OverlayBuffer* layer_buffer = layer->GetBuffer();
+  uint64_t key = kHashSeed;
+  HashCombine(key, layer_buffer->GetFormat());
+  HashCombine(key, layer_buffer->GetTilingMode());
+  HashCombine(key, layer->GetMergedTransform());
+  HashCombine(key, layer->GetBlending() == HWCBlending::kBlendingPremult &&
+                       layer->GetAlpha() != 0xFF);
+  // Scale factors in 1/8th steps, so that layers of similar size share
+  // a key.
+  uint32_t dst_width = std::max(layer->GetDisplayFrameWidth(), 1u);
+  uint32_t dst_height = std::max(layer->GetDisplayFrameHeight(), 1u);
+  HashCombine(key, (layer->GetSourceCropWidth() << 3) / dst_width);
+  HashCombine(key, (layer->GetSourceCropHeight() << 3) / dst_height);
+  return key;
+}
+
+void DrmPlane::BeginFrameValidation() {
+  validated_frames_++;
+}
+
+void DrmPlane::LayerTestCommitted(const OverlayLayer* layer, bool passed) {
+  if (!layer->GetBuffer() || layer->IsCursorLayer())
+    return;
+
+  uint64_t key = GetRejectionKey(layer);
+  auto rejected = rejected_layers_.begin();
+  for (; rejected != rejected_layers_.end(); ++rejected) {
+    if (rejected->key_ == key)
+      break;
+  }
+
+  if (passed) {
+    if (rejected != rejected_layers_.end())
+      rejected_layers_.erase(rejected);
+    return;
+  }
+
+  if (rejected != rejected_layers_.end()) {
+    rejected->rejected_at_ = validated_frames_;
+    return;
+  }
+
+  if (rejected_layers_.size() >= kMaxRejectedLayers)
+    rejected_layers_.erase(rejected_layers_.begin());
+
+  rejected_layers_.emplace_back();
+  rejected_layers_.back().key_ = key;
+  rejected_layers_.back().rejected_at_ = validated_frames_;
+  IDISPLAYMANAGERTRACE("Plane %d rejects layers like %d after test commit.",
+                       id_, layer->GetZorder());
 }
 
 bool DrmPlane::IsSupportedFormat(uint32_t format) {
@@ -582,6 +812,8 @@ void DrmPlane::Dump() const {
     DUMPTRACE("Format: %4.4s", (char*)&supported_formats_[j]);
 
   DUMPTRACE("Enabled: %d", in_use_);
+  DUMPTRACE("Scaling: %d Rejected layer configurations: %zu", caps_.scaling,
+            rejected_layers_.size());
 
   if (alpha_prop_.id != 0)
     DUMPTRACE("Alpha property is supported.");
@@ -26,7 +26,7 @@
 
 #include "displayplane.h"
 #include "displayplanestate.h"
-#include "drmbuffer.h"
+#include "overlaybuffer.h"
 #include "drmscopedtypes.h"
 
 namespace hwcomposer {
@@ -47,8 +47,17 @@ class DrmPlane : public DisplayPlane {
                         const DisplayPlaneState& plane,
                         bool test_commit = false) const;
 
+  // Mixes the values UpdateProperties would write for plane into hash.
+  // Buffer and fence handles are left out, so that two states which
+  // differ only in content give the same result.
+  void HashProperties(uint32_t crtc_id, const DisplayPlaneState& plane,
+                      uint64_t* hash) const;
+
   void SetNativeFence(int32_t fd);
 
+  // Returns fence set with SetNativeFence, the caller owns it afterwards.
+  int32_t ReleaseNativeFence();
+
   void SetBuffer(std::shared_ptr<OverlayBuffer>& buffer);
 
   bool Disable(drmModeAtomicReqPtr property_set);
@@ -73,6 +82,10 @@ class DrmPlane : public DisplayPlane {
 
   void PreferredFormatModifierValidated() override;
 
+  void LayerTestCommitted(const OverlayLayer* layer, bool passed) override;
+
+  void BeginFrameValidation() override;
+
   void Dump() const override;
 
   void SetInUse(bool in_use) override;
@@ -89,6 +102,38 @@ class DrmPlane : public DisplayPlane {
   bool IsSupportedModifier(uint64_t modifier, uint32_t format);
 
  private:
+  // Static limits of this plane, filled in by Initialize from plane
+  // properties and what we know about the display engine.
+  struct Capabilities {
+    // Plane can scale at all.
+    bool scaling = false;
+    // Maximum ratio of source to destination size, per axis.
+    float max_downscale = 1.0f;
+    // Minimum source and destination size of a scaled layer.
+    uint32_t min_scaled_size = 0;
+    // Minimum source size of a scaled planar YUV layer.
+    uint32_t min_scaled_yuv_size = 0;
+    // Maximum source size of a scaled layer.
+    uint32_t max_scaled_size = 0;
+  };
+
+  // Layer attributes which failed a test commit with this plane.
+  struct RejectedLayer {
+    uint64_t key_ = 0;
+    // Value of validated_frames_ when the last test commit failed.
+    uint64_t rejected_at_ = 0;
+  };
+
+  void InitializeCapabilities();
+
+  // Returns true if source crop and display frame of layer are within
+  // scaling and alignment limits of this plane.
+  bool ValidateLayerRects(const OverlayLayer* layer, uint32_t format) const;
+
+  // Returns key describing attributes of layer which may cause a test
+  // commit to fail with this plane.
+  uint64_t GetRejectionKey(const OverlayLayer* layer) const;
+
   struct Property {
     Property();
     bool Initialize(uint32_t fd, const char* name,
@@ -139,6 +184,11 @@ class DrmPlane : public DisplayPlane {
   std::vector<format_mods> formats_modifiers_;
   std::shared_ptr<OverlayBuffer> buffer_ = NULL;
   bool use_modifier_ = true;
+  Capabilities caps_;
+  // Most recently rejected layer is at the back.
+  std::vector<RejectedLayer> rejected_layers_;
+  // Number of frames validated with this plane.
+  uint64_t validated_frames_ = 0;
 };
 
 }  // namespace hwcomposer
@@ -331,6 +331,7 @@ bool PhysicalDisplay::Present(std::vector<HwcLayer *> &source_layers,
   }
 
   bool ignore_clone_update = false;
+  bool grouped = !clones_.empty() && BeginCommitGroup(presentation_group_);
   bool success = display_queue_->QueueUpdate(source_layers, retire_fence,
                                              &ignore_clone_update, call_back,
                                              handle_constraints);
@@ -338,6 +339,9 @@ bool PhysicalDisplay::Present(std::vector<HwcLayer *> &source_layers,
     HandleClonedDisplays(this);
   }
 
+  if (grouped)
+    EndCommitGroup();
+
   size_t size = source_layers.size();
   for (size_t layer_index = 0; layer_index < size; layer_index++) {
     HwcLayer *layer = source_layers.at(layer_index);
@@ -550,9 +554,33 @@ void PhysicalDisplay::RotateDisplay(HWCRotation rotation) {
   display_queue_->RotateDisplay(rotation);
 }
 
+bool PhysicalDisplay::SetIdleTimeout(uint32_t min_timeout_ms,
+                                     uint32_t max_timeout_ms) {
+  return display_queue_->SetIdleTimeout(min_timeout_ms, max_timeout_ms);
+}
+
+bool PhysicalDisplay::GetIdleStateTimes(uint64_t *active_ms,
+                                        uint64_t *idle_ms) {
+  DisplayQueue::IdleStats stats = display_queue_->GetIdleStats();
+  *active_ms = stats.active_time_ / 1000000;
+  *idle_ms = stats.idle_time_ / 1000000;
+  return true;
+}
+
+bool PhysicalDisplay::GetFrameStageLatency(HWCFrameStage stage,
+                                           HWCLatencyHistogram *histogram) {
+  display_queue_->GetFrameLatencyTracker().GetHistogram(stage, histogram);
+  return true;
+}
+
+void PhysicalDisplay::ResetFrameStageLatency() {
+  display_queue_->GetFrameLatencyTracker().Reset();
+}
+
 void PhysicalDisplay::RefreshClones() {
   display_state_ &= ~kRefreshClonedDisplays;
   std::vector<NativeDisplay *>().swap(clones_);
+  presentation_group_.clear();
   if (cloned_displays_.empty())
     return;
 
@@ -565,6 +593,10 @@ void PhysicalDisplay::RefreshClones() {
     clones_.emplace_back(display);
   }
 
+  presentation_group_.emplace_back(this);
+  presentation_group_.insert(presentation_group_.end(), clones_.begin(),
+                             clones_.end());
+
   uint32_t primary_width = Width();
   uint32_t primary_height = Height();
   for (auto display : clones_) {
@@ -160,6 +160,16 @@ class PhysicalDisplay : public NativeDisplay, public DisplayPlaneHandler {
 
   void RotateDisplay(HWCRotation rotation) override;
 
+  bool SetIdleTimeout(uint32_t min_timeout_ms,
+                      uint32_t max_timeout_ms) override;
+
+  bool GetIdleStateTimes(uint64_t *active_ms, uint64_t *idle_ms) override;
+
+  bool GetFrameStageLatency(HWCFrameStage stage,
+                            HWCLatencyHistogram *histogram) override;
+
+  void ResetFrameStageLatency() override;
+
   const NativeBufferHandler *GetNativeBufferHandler() const override;
 
   void SetPAVPSessionStatus(bool enabled, uint32_t pavp_session_id,
@@ -198,6 +208,20 @@ class PhysicalDisplay : public NativeDisplay, public DisplayPlaneHandler {
                       bool disable_explicit_fence, int32_t previous_fence,
                       int32_t *commit_fence, bool *previous_fence_released) = 0;
 
+  /**
+   * API for updating only the cursor plane, all other planes keep
+   * showing content of the last Commit.
+   * @param cursor_plane cursor plane with the updated layer.
+   * @param disable_explicit_fence is set to true if we want a hardware fence
+   *        associated with this commit request set to commit_fence.
+   * @param commit_fence hardware fence associated with this commit request.
+   * Returns false if a full Commit is needed instead.
+   */
+  virtual bool CommitCursor(const DisplayPlaneState &cursor_plane,
+                            bool disable_explicit_fence,
+                            int32_t previous_fence, int32_t *commit_fence,
+                            bool *previous_fence_released) = 0;
+
   /**
    * API is called if current active display configuration has changed.
    * Implementations need to reset any state in this case.
@@ -323,6 +347,8 @@ class PhysicalDisplay : public NativeDisplay, public DisplayPlaneHandler {
   NativeDisplay *source_display_ = NULL;
   std::vector<NativeDisplay *> cloned_displays_;
   std::vector<NativeDisplay *> clones_;
+  // This display followed by clones_, committed together if possible.
+  std::vector<NativeDisplay *> presentation_group_;
   uint32_t config_ = DEFAULT_CONFIG_ID;
   bool bypassClientCTM_ = false;
 };
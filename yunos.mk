@@ -48,7 +48,10 @@ LOCAL_SRC_FILES := os/alios/hwf_alioshal.cpp \
     common/utils/hwcthread.cpp \
     common/utils/hwcevent.cpp \
     common/utils/fdhandler.cpp \
+    common/utils/framelatencytracker.cpp \
+    common/utils/idletimeout.cpp \
     common/utils/disjoint_layers.cpp \
+    common/utils/drawregioncache.cpp \
     common/display/virtualdisplay.cpp \
     common/display/displayqueue.cpp \
     common/display/displayplanestate.cpp \
@@ -56,6 +59,7 @@ LOCAL_SRC_FILES := os/alios/hwf_alioshal.cpp \
     common/display/vblankeventhandler.cpp \
     common/compositor/compositor.cpp \
     common/compositor/compositorthread.cpp \
+    common/compositor/renderworker.cpp \
     common/compositor/nativesurface.cpp \
     common/compositor/factory.cpp \
     common/compositor/renderstate.cpp \
@@ -70,6 +74,8 @@ LOCAL_SRC_FILES := os/alios/hwf_alioshal.cpp \
     wsi/drm/drmdisplaymanager.cpp \
     wsi/drm/drmscopedtypes.cpp \
     wsi/drm/drmdisplay.cpp \
+    wsi/drm/drmcommitgroup.cpp \
+    wsi/drm/drmcommitthread.cpp \
     wsi/drm/drmplane.cpp \
     wsi/drm/drmbuffer.cpp \
     wsi/physicaldisplay.cpp \